@@ -14,6 +14,7 @@
 #include <klib/io.hpp>
 #include <klib/cstdlib.hpp>
 #include <devices/BIOSVideoIO.hpp>
+#include <devices/serial.hpp>
 #include <earlyLib/memory.hpp>
 #include <earlyLib/diskRead16.hpp>
 #include <earlyLib/memoryDetection16.hpp>
@@ -22,6 +23,7 @@
 #include <fs/mbr.hpp>
 #include <sys/elf.h>
 #include <sys/multiboot.h>
+#include <debug.h>
 
 
 /*******************************************************************************
@@ -40,6 +42,7 @@ extern "C" {
 // MBR is at _final_mbr_address
 static fs::MBR *const mbr = reinterpret_cast<fs::MBR*>(_final_mbr_address);
 io::_outstream<io::framebuffer_terminal> out;
+static io::serial_port serial;
 static uint8_t disk;
 
 // Tracemax stuff, we really should improve this
@@ -192,8 +195,8 @@ void* elf32_load(elf32_Ehdr *header )
     // Conversions inside for are necessary for pointer arithmetic to work
     // e_phnum is in bytes, but pointer arithmetic will assume size
     {
-        out << "Found segment at 0x" << reinterpret_cast<uint32_t>(ph)
-            << " of type " << ph->p_type << "\n";
+        io::format("Found segment at 0x{:X} of type {:X}\n",reinterpret_cast<uint32_t>(ph),
+                ph->p_type);
 
         if( !(elf_check_prog_header(ph)) ) return 0; // We've hit something
         if( ph->p_type != PT_LOAD ) continue; // We don't care about these
@@ -203,7 +206,7 @@ void* elf32_load(elf32_Ehdr *header )
                 (reinterpret_cast<uint32_t>(header) + ph->p_offset);
         
         // Copy it!
-        out << "Loading it to 0x" << reinterpret_cast<uint32_t>(dest) << "\n";
+        io::format("Loading it to 0x{:X}\n",reinterpret_cast<uint32_t>(dest));
         memcpy(dest,src,ph->p_filesz);
 
         // Check to see if p_memsz > p_filesz
@@ -218,7 +221,7 @@ void* elf32_load(elf32_Ehdr *header )
             (reinterpret_cast<uint8_t*>(ph) - header->e_phentsize);
     void* finalMem = reinterpret_cast<void*>(ph->p_paddr + ph->p_memsz);
 
-    out << "Loaded " << i << " segments total!\n";
+    io::format("Loaded {:X} segments total!\n",i);
     return finalMem;
 }
 
@@ -232,6 +235,10 @@ void _stage1Main( uint32_t dx, uint32_t __stop_stage1, uint32_t cursor)
     terminal.setCursor(row,column);
     out.hex();        
 
+    // Output, traces included, goes out COM1 too. Polled, there's no IDT
+    if (serial.init())
+        out.mirror(&serial);
+
     // Print the header
     terminal.setColor(io::vga_color::VGA_COLOR_LIGHT_GREY,io::vga_color::VGA_COLOR_BLUE);
     out << "Welcome to RainbowOS 32-bit protected mode bootloader!\n";
@@ -308,6 +315,7 @@ void _stage1Main( uint32_t dx, uint32_t __stop_stage1, uint32_t cursor)
     uint32_t kernelAddr = kernelElfHeader->e_entry;
     uint32_t mbInfoPtr = reinterpret_cast<uint32_t>(mbInfo);
 
+    BOOT_MARK(BOOT_MARK_KERNEL_LOADED)
     jumpKernel(kernelAddr,mbInfoPtr,index);
 
     earlyPanic("Should never get here, something is wrong!!");
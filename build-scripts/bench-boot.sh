@@ -0,0 +1,103 @@
+#!/bin/bash
+# HELPER SCRIPT FOR CMAKE
+#
+# Boots the diskimage headless under qemu a number of times, and times the boot
+# phases from the marks stage0, stage1 and the kernel write to the 0xE9 debug
+# port (see include/bootloader/commonDefines.h). The kernel ends the run through
+# isa-debug-exit once INIT.ELF is spawned. Prints the median and the 95th
+# percentile of each phase, and fails if the median time to kmain is over the
+# limit
+# Expect invocation bench-boot.sh $(qemu) $(diskimage) $(iterations) \
+#        $(max_kmain_ms) [$(timeout_s)]
+# A limit of 0 only reports
+#
+#
+# 2025 Diogo Gomes
+
+set -u
+
+qemu=$1
+diskimage=$2
+iterations=$3
+max_kmain_ms=$4
+timeout_s=${5:-60}
+
+# Marks in the order they come, and the phase that ends at each
+marks=(a b c d e f)
+phases=("firmware" "stage0" "stage1" "kernel load" "kernel init" "user start")
+
+if [ ! -f "$diskimage" ]; then
+    echo "No diskimage at $diskimage"
+    exit 1
+fi
+
+results=$(mktemp)
+trap 'rm -f "$results"' EXIT
+
+# Microseconds, from a $EPOCHREALTIME
+micro() {
+    echo $(( ${1%.*} * 1000000 + 10#${1#*.} ))
+}
+
+# One boot. Prints the time of each mark since qemu started, in microseconds,
+# on one line, or nothing if the boot didn't get to the end
+boot() {
+    local start mark
+    local -A seen=()
+    start=$EPOCHREALTIME
+    # snapshot=on, since the kernel writes to the volume. iobase is BOOT_EXIT_PORT
+    while IFS= read -r -n1 -d '' mark; do
+        [ -n "$mark" ] && [ -z "${seen[$mark]:-}" ] && seen[$mark]=$EPOCHREALTIME
+    done < <(timeout "$timeout_s" "$qemu" -nographic -serial none -monitor none \
+        -debugcon stdio -device isa-debug-exit,iobase=0xf4,iosize=0x04 \
+        -drive file="$diskimage",format=raw,snapshot=on 2>/dev/null)
+
+    local line=""
+    for mark in "${marks[@]}"; do
+        [ -z "${seen[$mark]:-}" ] && return
+        line+="$(( $(micro "${seen[$mark]}") - $(micro "$start") )) "
+    done
+    echo "$line"
+}
+
+for (( i = 1; i <= iterations; i++ )); do
+    line=$(boot)
+    if [ -z "$line" ]; then
+        echo "Boot $i didn't get to INIT.ELF within ${timeout_s}s"
+        exit 1
+    fi
+    echo "$line" >> "$results"
+    echo "Boot $i of $iterations: $line"
+done
+
+# Median and 95th percentile (nearest rank) of a column of microseconds, in ms
+stats() {
+    sort -n | awk '{ v[NR] = $1 } END {
+        p95 = int((NR * 95 + 99) / 100)
+        printf "%10.2f %10.2f", (NR % 2 ? v[(NR + 1) / 2] : (v[NR / 2] + v[NR / 2 + 1]) / 2) / 1000, v[p95] / 1000
+    }'
+}
+
+echo
+printf "%-16s %10s %10s\n" "phase (ms)" "median" "p95"
+previous=""
+for (( m = 0; m < ${#marks[@]}; m++ )); do
+    column=$(( m + 1 ))
+    if [ -z "$previous" ]; then
+        values=$(awk -v c=$column '{ print $c }' "$results")
+    else
+        values=$(awk -v c=$column -v p=$previous '{ print $c - $p }' "$results")
+    fi
+    printf "%-16s %s\n" "${phases[$m]}" "$(echo "$values" | stats)"
+    previous=$column
+done
+kmain_column=4
+printf "%-16s %s\n" "to kmain" "$(awk -v c=$kmain_column '{ print $c }' "$results" | stats)"
+printf "%-16s %s\n" "total" "$(awk -v c=${#marks[@]} '{ print $c }' "$results" | stats)"
+
+median_kmain=$(awk -v c=$kmain_column '{ print $c }' "$results" | stats | awk '{ print $1 }')
+if [ "$max_kmain_ms" != "0" ] && awk -v m="$median_kmain" -v l="$max_kmain_ms" 'BEGIN { exit !(m > l) }'; then
+    echo "Time to kmain regressed: median ${median_kmain} ms, limit ${max_kmain_ms} ms"
+    exit 1
+fi
+exit 0
@@ -4,7 +4,7 @@
 # Script to generate the final diskimage. Mounts the dirs, copies the files over,
 # and injects the fat info
 # Expect invocation generate-diskimage.sh $(diskimage) $(diskimage_loopback) \
-#        $(rootsrcdir) $(mount_dir) $(stage0) $(stage1) $(kernel)
+#        $(rootsrcdir) $(mount_dir) $(stage0) $(stage1) $(kernel) $(init)
 #
 #
 # 2025 Diogo Gomes
@@ -31,6 +31,7 @@ mount_dir=$4
 stage0=$5
 stage1=$6
 kernel=$7
+init=$8
 
 if ! sudo ${rootsrcdir}/build-scripts/mountdirs.sh ${mount_dir} \
           ${diskimage_loopback} ${diskimage} ${current_user}; then
@@ -38,8 +39,9 @@ if ! sudo ${rootsrcdir}/build-scripts/mountdirs.sh ${mount_dir} \
     exit 1
 fi
 
-# Now copy the kernel over
+# Now copy the kernel over, and the first user program
 cp ${kernel} ${mount_dir}/kernel.bin
+cp ${init} ${mount_dir}/INIT.ELF
 sync
 
 # Inject stage0/stage1 into diskimage
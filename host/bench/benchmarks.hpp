@@ -0,0 +1,18 @@
+/**
+ * @file benchmarks.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Every file of benchmarks, for main.cpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <hostTest.hpp>
+
+extern const host::suite<host::benchmark> fat32Benchmarks;
+extern const host::suite<host::benchmark> formatBenchmarks;
+extern const host::suite<host::benchmark> memoryBenchmarks;
@@ -0,0 +1,143 @@
+/**
+ * @file fat32Bench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Benchmarks of fs::fat32's hot paths, on an image made for them: a
+ * directory with a lot in it, and a big file. The image file is in the
+ * host's own page cache, so the library's work is most of what's timed
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "benchmarks.hpp"
+#include <fs/fat32.hpp>
+#include <klib/string.h>
+
+using host::benchmark;
+
+static const char* const IMAGE =            "fat32Bench.img";
+
+// 64 MiB, 8 sectors (4 KiB) a cluster
+static const uint64_t IMAGE_SECTORS =       131072;
+static const uint8_t SECTORS_PER_CLUSTER =  8;
+
+// Entries in the root directory, the last one looked up
+static const uint32_t DIRECTORY_FILES =     500;
+
+// Of the big file, in clusters
+static const uint32_t FILE_CLUSTERS =       1024;
+
+static const uint8_t ATTRIBUTE_ARCHIVE =
+        static_cast<uint8_t>(fs::fat32_dirEntry_attributes::ARCHIVE);
+
+static fs::fat32* volume;
+static fs::fat32_dirEntry bigFile;
+static uint8_t* buffer;
+static const size_t BUFFER_SIZE =           64 * 1024;
+
+static void fileName(uint32_t number, char* name)
+{
+    memcpy(name,"F0000.DAT",10);
+    for (size_t digit = 4; digit != 0; digit--, number /= 10)
+        name[digit] = static_cast<char>('0' + number % 10);
+}
+
+static bool makeVolume()
+{
+    if (volume != nullptr)
+        return true;
+    if (!host::createImage(IMAGE,IMAGE_SECTORS) || !host::formatFAT32(SECTORS_PER_CLUSTER))
+        return false;
+    volume = new fs::fat32(&host::readSectors,&host::writeSectors);
+    buffer = new uint8_t[BUFFER_SIZE];
+    if (volume == nullptr || buffer == nullptr || volume->init(0) != 0)
+        return false;
+
+    char name[10];
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    for (uint32_t i = 0; i < DIRECTORY_FILES; i++)
+    {
+        fileName(i,name);
+        if (volume->createEntry(volume->rootCluster(),name,9,ATTRIBUTE_ARCHIVE,0,&entry,
+                &location) != fs::fat32_createResult::SUCCESS)
+            return false;
+    }
+
+    // Its clusters hold whatever the image had, nothing reads them for meaning
+    const uint32_t first = volume->allocateClusters(0,FILE_CLUSTERS);
+    if (first == 0 || volume->createEntry(volume->rootCluster(),"BIG.DAT",7,ATTRIBUTE_ARCHIVE,
+            first,&bigFile,&location) != fs::fat32_createResult::SUCCESS)
+        return false;
+    bigFile.size = static_cast<uint32_t>(FILE_CLUSTERS * volume->clusterSize());
+    return volume->writeEntry(&location,&bigFile) && volume->flush();
+}
+
+/**========================================================================
+ *                           Benchmarks
+ *========================================================================**/
+
+static void lookupLast(uint32_t iterations)
+{
+    char name[10];
+    fileName(DIRECTORY_FILES - 1,name);
+    fs::fat32_dirEntry entry;
+    for (uint32_t i = 0; i < iterations; i++)
+        host::keep(volume->lookup(volume->rootCluster(),name,9,&entry,nullptr));
+}
+
+static void lookupMissing(uint32_t iterations)
+{
+    fs::fat32_dirEntry entry;
+    for (uint32_t i = 0; i < iterations; i++)
+        host::keep(volume->lookup(volume->rootCluster(),"NOTHERE.DAT",11,&entry,nullptr));
+}
+
+static void listDirectory(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        uint32_t cursor = FAT32_DIRECTORY_START;
+        while (volume->readDirectory(volume->rootCluster(),&cursor,buffer,4096) > 0)
+            ;
+    }
+}
+
+static void readFile(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (size_t offset = 0; offset < bigFile.size; offset += BUFFER_SIZE)
+            host::keep(volume->readFile(&bigFile,offset,buffer,BUFFER_SIZE));
+    }
+}
+
+static void allocateAndFree(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const uint32_t first = volume->allocateClusters(0,64);
+        if (first != 0)
+            volume->freeChain(first);
+    }
+}
+
+static void checkVolume(uint32_t iterations)
+{
+    fs::fat32_checkResult result;
+    for (uint32_t i = 0; i < iterations; i++)
+        host::keep(volume->check(&result));
+}
+
+static const benchmark benchmarks[] = {
+    {"fat32.lookupLast",&makeVolume,&lookupLast,nullptr,2000},
+    {"fat32.lookupMissing",&makeVolume,&lookupMissing,nullptr,2000},
+    {"fat32.readDirectory",&makeVolume,&listDirectory,nullptr,2000},
+    {"fat32.readFile4MiB",&makeVolume,&readFile,nullptr,100},
+    {"fat32.allocateFree64",&makeVolume,&allocateAndFree,nullptr,20000},
+    {"fat32.check",&makeVolume,&checkVolume,nullptr,200},
+};
+
+const host::suite<benchmark> fat32Benchmarks = {benchmarks,sizeof(benchmarks) / sizeof(benchmarks[0])};
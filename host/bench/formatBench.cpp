@@ -0,0 +1,164 @@
+/**
+ * @file formatBench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Benchmarks of the number conversions and io::formatTo() in
+ * klib/format.hpp, next to xtoa() and a line put together from it the way
+ * the << operators did
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "benchmarks.hpp"
+#include <klib/format.hpp>
+#include <klib/cstdlib.hpp>
+#include <klib/string.h>
+
+using host::benchmark;
+
+// Numbers converted per iteration, spread over every length
+static const size_t NUMBERS =               256;
+
+static uint32_t narrow[NUMBERS];
+static uint64_t wide[NUMBERS];
+
+static bool makeNumbers()
+{
+    uint64_t value = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < NUMBERS; i++)
+    {
+        value ^= value << 13;
+        value ^= value >> 7;
+        value ^= value << 17;
+        narrow[i] = static_cast<uint32_t>(value >> (i % 32));
+        wide[i] = value >> (i % 64);
+    }
+    return true;
+}
+
+/**
+ * @brief Append a string, as the << operators did
+ * 
+ */
+static size_t append(char* line, size_t length, const char* str)
+{
+    const size_t size = strlen(str);
+    memcpy(line + length,str,size);
+    return length + size;
+}
+
+/**========================================================================
+ *                           Benchmarks
+ *========================================================================**/
+
+static void xtoaDecimal(uint32_t iterations)
+{
+    char str[MAX_NUM_STR_SIZE];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (size_t j = 0; j < NUMBERS; j++)
+        {
+            xtoa(narrow[j],str,10);
+            host::keep(str[0]);
+        }
+    }
+}
+
+static void formatDecimal(uint32_t iterations)
+{
+    char str[io::FORMAT_NUMBER_SIZE];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (size_t j = 0; j < NUMBERS; j++)
+            host::keep(io::formatDecimal(narrow[j],str));
+    }
+}
+
+static void xtoaDecimal64(uint32_t iterations)
+{
+    char str[MAX_NUM_STR_SIZE];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (size_t j = 0; j < NUMBERS; j++)
+        {
+            xtoa(wide[j],str,10);
+            host::keep(str[0]);
+        }
+    }
+}
+
+static void formatDecimal64(uint32_t iterations)
+{
+    char str[io::FORMAT_NUMBER_SIZE];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (size_t j = 0; j < NUMBERS; j++)
+            host::keep(io::formatDecimal(wide[j],str));
+    }
+}
+
+static void xtoaHex(uint32_t iterations)
+{
+    char str[MAX_NUM_STR_SIZE];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (size_t j = 0; j < NUMBERS; j++)
+        {
+            xtoa(wide[j],str,16);
+            host::keep(str[0]);
+        }
+    }
+}
+
+static void formatHex(uint32_t iterations)
+{
+    char str[io::FORMAT_NUMBER_SIZE];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (size_t j = 0; j < NUMBERS; j++)
+            host::keep(io::formatHex(wide[j],str,true));
+    }
+}
+
+static void xtoaLine(uint32_t iterations)
+{
+    char line[128];
+    char str[MAX_NUM_STR_SIZE];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const size_t j = i % NUMBERS;
+        size_t length = append(line,0,"Cluster 0x");
+        length = append(line,length,xtoa(narrow[j],str,16));
+        length = append(line,length," of file ");
+        length = append(line,length,"KERNEL.BIN");
+        length = append(line,length," at ");
+        length = append(line,length,xtoa(wide[j],str,10));
+        host::keep(length);
+    }
+}
+
+static void formatLine(uint32_t iterations)
+{
+    char line[128];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const size_t j = i % NUMBERS;
+        host::keep(io::formatTo(line,sizeof(line),"Cluster 0x{:X} of file {} at {}",narrow[j],
+                "KERNEL.BIN",wide[j]));
+    }
+}
+
+static const benchmark benchmarks[] = {
+    {"format.xtoaDecimal",&makeNumbers,&xtoaDecimal,nullptr,2000},
+    {"format.formatDecimal",&makeNumbers,&formatDecimal,nullptr,2000},
+    {"format.xtoaDecimal64",&makeNumbers,&xtoaDecimal64,nullptr,1000},
+    {"format.formatDecimal64",&makeNumbers,&formatDecimal64,nullptr,1000},
+    {"format.xtoaHex",&makeNumbers,&xtoaHex,nullptr,2000},
+    {"format.formatHex",&makeNumbers,&formatHex,nullptr,2000},
+    {"format.xtoaLine",&makeNumbers,&xtoaLine,nullptr,200000},
+    {"format.formatLine",&makeNumbers,&formatLine,nullptr,200000},
+};
+
+const host::suite<benchmark> formatBenchmarks = {benchmarks,sizeof(benchmarks) / sizeof(benchmarks[0])};
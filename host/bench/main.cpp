@@ -0,0 +1,94 @@
+/**
+ * @file main.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Microbenchmark runner for the host build of lib. Runs every
+ * benchmark, or the ones with the argument in their name, and prints the
+ * best of a few timed runs. Made to be run under perf
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "benchmarks.hpp"
+
+// Timed runs of each benchmark, after one to warm up
+static const uint32_t RUNS =                5;
+
+// --quick does this much of each, once, to see they still work
+static const uint32_t QUICK_DIVISOR =       100;
+
+static const host::suite<host::benchmark>* const suites[] = {&fat32Benchmarks,&formatBenchmarks,&memoryBenchmarks};
+
+static bool same(const char* a, const char* b)
+{
+    while (*a != '\0' && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+int main(int argc, char** argv)
+{
+    host::initializeHeap();
+    bool quick = false;
+    bool failed = false;
+    const char* filter = "";
+    for (int i = 1; i < argc; i++)
+    {
+        if (same(argv[i],"--quick"))
+            quick = true;
+        else
+            filter = argv[i];
+    }
+
+    for (const host::suite<host::benchmark>* suite : suites)
+    {
+        for (size_t i = 0; i < suite->count; i++)
+        {
+            const host::benchmark* bench = suite->entries + i;
+            if (!host::contains(bench->name,filter))
+                continue;
+
+            uint32_t iterations = bench->iterations;
+            uint32_t runs = RUNS;
+            if (quick)
+            {
+                iterations = iterations / QUICK_DIVISOR != 0 ? iterations / QUICK_DIVISOR : 1;
+                runs = 0;
+            }
+
+            if (bench->setUp != nullptr && !bench->setUp())
+            {
+                host::print("%-28s couldn't be set up\n",bench->name);
+                failed = true;
+                continue;
+            }
+            bench->run(iterations);
+            uint64_t best = UINT64_MAX;
+            for (uint32_t run = 0; run < runs; run++)
+            {
+                const uint64_t start = host::nanoseconds();
+                bench->run(iterations);
+                const uint64_t time = host::nanoseconds() - start;
+                if (time < best)
+                    best = time;
+            }
+            if (bench->tearDown != nullptr)
+                bench->tearDown();
+
+            if (runs != 0)
+            {
+                host::print("%-28s %10llu ns/op (%u iterations)\n",bench->name,
+                        static_cast<unsigned long long>(best / iterations),iterations);
+            }
+            else
+                host::print("%-28s ok\n",bench->name);
+        }
+    }
+    host::closeImage();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file memoryBench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Benchmarks of the heap in earlyLib/memory.hpp, and of the copies
+ * in klib/string.h
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "benchmarks.hpp"
+#include <earlyLib/memory.hpp>
+#include <klib/string.h>
+
+using host::benchmark;
+
+// Blocks kept allocated around the ones the benchmarks make, since both
+// kalloc() and kfree() walk the list of them
+static const size_t LIVE_BLOCKS =           1000;
+
+// Allocated and then freed, last first, by churn
+static const size_t CHURN_BLOCKS =          256;
+
+static const size_t COPY_SIZE =             4096;
+
+static void* live[LIVE_BLOCKS];
+static uint8_t source[COPY_SIZE];
+static uint8_t destination[COPY_SIZE];
+
+static bool allocateLive()
+{
+    for (size_t i = 0; i < LIVE_BLOCKS; i++)
+    {
+        live[i] = kalloc(16 + (i % 8) * 16);
+        if (live[i] == nullptr)
+            return false;
+    }
+    return true;
+}
+
+static void freeLive()
+{
+    for (size_t i = LIVE_BLOCKS; i != 0; i--)
+        kfree(live[i - 1]);
+}
+
+/**========================================================================
+ *                           Benchmarks
+ *========================================================================**/
+
+static void allocateFree(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        void* block = kalloc(64);
+        host::keep(block);
+        kfree(block);
+    }
+}
+
+static void churn(uint32_t iterations)
+{
+    void* blocks[CHURN_BLOCKS];
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (size_t j = 0; j < CHURN_BLOCKS; j++)
+            blocks[j] = kalloc(8 + (j * 37) % 512);
+        for (size_t j = CHURN_BLOCKS; j != 0; j--)
+            kfree(blocks[j - 1]);
+    }
+}
+
+static void copy(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        memcpy(destination,source,COPY_SIZE);
+        host::keep(destination[i % COPY_SIZE]);
+    }
+}
+
+static void fill(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        memset(destination,static_cast<int>(i),COPY_SIZE);
+        host::keep(destination[i % COPY_SIZE]);
+    }
+}
+
+static void compare(uint32_t iterations)
+{
+    memcpy(destination,source,COPY_SIZE);
+    for (uint32_t i = 0; i < iterations; i++)
+        host::keep(memcmp(destination,source,COPY_SIZE));
+}
+
+static const benchmark benchmarks[] = {
+    {"memory.allocateFree",&allocateLive,&allocateFree,&freeLive,20000},
+    {"memory.churn256",&allocateLive,&churn,&freeLive,20},
+    {"string.memcpy4KiB",nullptr,&copy,nullptr,100000},
+    {"string.memset4KiB",nullptr,&fill,nullptr,100000},
+    {"string.memcmp4KiB",nullptr,&compare,nullptr,100000},
+};
+
+const host::suite<benchmark> memoryBenchmarks = {benchmarks,sizeof(benchmarks) / sizeof(benchmarks[0])};
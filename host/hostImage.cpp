@@ -0,0 +1,90 @@
+/**
+ * @file hostImage.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definition of formatFAT32() from hostSupport.hpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <hostSupport.hpp>
+#include <fs/fat32.hpp>
+#include <klib/string.h>
+
+static const size_t SECTOR_SIZE =           512;
+static const uint16_t RESERVED_SECTORS =    32;
+static const uint8_t NUMBER_OF_FATS =       2;
+static const uint32_t ROOT_CLUSTER =        2;
+static const uint16_t FSINFO_SECTOR =       1;
+static const uint16_t BACKUP_BOOT_SECTOR =  6;
+
+static const uint16_t BOOT_SIGNATURE =      0xAA55;
+
+bool host::formatFAT32(uint8_t sectorsPerCluster)
+{
+    const uint64_t sectors = imageSectors();
+    if (sectors <= RESERVED_SECTORS || sectors > UINT32_MAX || sectorsPerCluster == 0)
+        return false;
+
+    // Enough FAT for every cluster there would be with no FAT at all, which
+    // leaves a few entries over
+    const uint32_t total = static_cast<uint32_t>(sectors);
+    const uint32_t FATsectors = static_cast<uint32_t>(((total - RESERVED_SECTORS) / sectorsPerCluster + 2) *
+            sizeof(uint32_t) + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    const uint32_t dataStart = RESERVED_SECTORS + NUMBER_OF_FATS * FATsectors;
+    if (total <= dataStart + sectorsPerCluster)
+        return false;
+    const uint32_t clusters = (total - dataStart) / sectorsPerCluster;
+
+    fs::VBR vbr = {};
+    const uint8_t jump[] = {0xEB,0x58,0x90};
+    memcpy(vbr.jump,jump,sizeof(jump));
+    memcpy(vbr.OEM,"RAINBOW ",sizeof(vbr.OEM));
+    vbr.bpd.bytesPerSector = SECTOR_SIZE;
+    vbr.bpd.sectorsPerCluster = sectorsPerCluster;
+    vbr.bpd.reservedSectors = RESERVED_SECTORS;
+    vbr.bpd.numberOfFATs = NUMBER_OF_FATS;
+    vbr.bpd.mediaDescriptor = 0xF8;
+    vbr.bpd.sectorsPerTrack = 63;
+    vbr.bpd.numberOfHeads = 255;
+    vbr.bpd.largeSectorCount = total;
+    vbr.bpd.sectorsPerFAT = FATsectors;
+    vbr.bpd.clusterNumberRoot = ROOT_CLUSTER;
+    vbr.bpd.sectorNumberFSInfo = FSINFO_SECTOR;
+    vbr.bpd.sectorNumberBackupBoot = BACKUP_BOOT_SECTOR;
+    vbr.bpd.driveNumber = 0x80;
+    vbr.bpd.signature = 0x29;
+    vbr.bpd.volumeIDSerial = 0x52424F57;
+    memcpy(vbr.bpd.volumeLabelString,"RAINBOWHOST",sizeof(vbr.bpd.volumeLabelString));
+    memcpy(vbr.bpd.systemIdentifierStr,"FAT32   ",sizeof(vbr.bpd.systemIdentifierStr));
+    vbr.bootableSignature = BOOT_SIGNATURE;
+
+    fs::FAT32FSInfo info = {};
+    info.leadSignature = FSINFO_LEAD_SIGNATURE;
+    info.anotherSignature = FSINFO_OTHER_SIGNATURE;
+    info.lastFreeClusterCount = clusters - 1;
+    info.hintAvailableCluster = ROOT_CLUSTER + 1;
+    info.trailSignature = FSINFO_TRAIL_SIGNATURE;
+
+    if (!writeSectors(0,&vbr,1) || !writeSectors(BACKUP_BOOT_SECTOR,&vbr,1) ||
+            !writeSectors(FSINFO_SECTOR,&info,1))
+        return false;
+
+    // The image starts out zeroed, so only the first sector of each FAT
+    // and the root directory need writing
+    uint32_t FAT[SECTOR_SIZE / sizeof(uint32_t)] = {0x0FFFFFF8,0x0FFFFFFF,0x0FFFFFFF};
+    for (uint32_t copy = 0; copy < NUMBER_OF_FATS; copy++)
+    {
+        if (!writeSectors(RESERVED_SECTORS + copy * FATsectors,FAT,1))
+            return false;
+    }
+    const uint8_t empty[SECTOR_SIZE] = {};
+    for (uint32_t i = 0; i < sectorsPerCluster; i++)
+    {
+        if (!writeSectors(dataStart + i,empty,1))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file hostSupport.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from hostSupport.hpp, on top of the C library. The only
+ * file of the host programs that uses its headers, since klib/string.h and
+ * klib/stdlib.h declare some of the same functions
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <hostSupport.hpp>
+#include <earlyLib/memory.hpp>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const size_t SECTOR_SIZE =           512;
+
+static int image = -1;
+static bool imageWritable;
+
+alignas(16) static uint8_t heapMemory[host::HEAP_SIZE];
+
+/**
+ * @brief The library's panic, from klib/stdlib.h, which can't be included
+ * with stdlib.h. Here it says why, and aborts, so a debugger or the test that
+ * hit it can tell
+ * 
+ */
+extern "C" [[noreturn]] void earlyPanic(const char* str);
+
+extern "C" [[noreturn]] void earlyPanic(const char* str)
+{
+    fprintf(stderr,"earlyPanic(): %s\n",str);
+    abort();
+}
+
+void host::initializeHeap()
+{
+    mem::heapInitialize(heapMemory,sizeof(heapMemory));
+}
+
+bool host::openImage(const char* path, bool writable)
+{
+    closeImage();
+    image = open(path,writable ? O_RDWR : O_RDONLY);
+    imageWritable = writable;
+    return image >= 0;
+}
+
+bool host::createImage(const char* path, uint64_t sectors)
+{
+    closeImage();
+    image = open(path,O_RDWR | O_CREAT | O_TRUNC,0644);
+    imageWritable = true;
+    if (image < 0)
+        return false;
+    if (ftruncate(image,static_cast<off_t>(sectors * SECTOR_SIZE)) != 0)
+    {
+        closeImage();
+        return false;
+    }
+    return true;
+}
+
+void host::closeImage()
+{
+    if (image >= 0)
+        close(image);
+    image = -1;
+}
+
+uint64_t host::imageSectors()
+{
+    struct stat status;
+    if (image < 0 || fstat(image,&status) != 0)
+        return 0;
+    return static_cast<uint64_t>(status.st_size) / SECTOR_SIZE;
+}
+
+int host::readSectors(uint64_t LBA, void* buffer, size_t sectors)
+{
+    const size_t size = sectors * SECTOR_SIZE;
+    return image >= 0 && pread(image,buffer,size,static_cast<off_t>(LBA * SECTOR_SIZE)) ==
+            static_cast<ssize_t>(size);
+}
+
+int host::writeSectors(uint64_t LBA, const void* buffer, size_t sectors)
+{
+    const size_t size = sectors * SECTOR_SIZE;
+    return image >= 0 && imageWritable &&
+            pwrite(image,buffer,size,static_cast<off_t>(LBA * SECTOR_SIZE)) ==
+            static_cast<ssize_t>(size);
+}
+
+void host::print(const char* format, ...)
+{
+    va_list arguments;
+    va_start(arguments,format);
+    vprintf(format,arguments);
+    va_end(arguments);
+    fflush(stdout);
+}
+
+uint64_t host::nanoseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+}
+
+bool host::contains(const char* string, const char* part)
+{
+    for (; *string != '\0'; string++)
+    {
+        size_t i = 0;
+        while (part[i] != '\0' && string[i] == part[i])
+            i++;
+        if (part[i] == '\0')
+            return true;
+    }
+    return *part == '\0';
+}
@@ -0,0 +1,101 @@
+/**
+ * @file hostSupport.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief What lib needs around it to run as a host program: a disk, which
+ * is an image file, a heap, output and a clock. Everything else in the host
+ * programs only includes headers from the tree
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace host
+{
+
+/* Size of the heap kalloc() and new get, out of the program's own memory */
+static const size_t HEAP_SIZE =             64 * 1024 * 1024;
+
+/**
+ * @brief Give the heap its memory. Before anything uses new
+ * 
+ */
+void initializeHeap();
+
+/**
+ * @brief Open a disk image, which readSectors() and writeSectors() go to
+ * from then on. Closes the one before
+ * 
+ * @param path Path to it
+ * @param writable Whether writeSectors() may change it
+ * @return true It's open
+ */
+bool openImage(const char* path, bool writable);
+
+/**
+ * @brief Make an empty disk image, and open it
+ * 
+ * @param path Path to it, replaced if it's there
+ * @param sectors Its size
+ * @return true It's open
+ */
+bool createImage(const char* path, uint64_t sectors);
+
+/**
+ * @brief Close the image, if there's one open
+ * 
+ */
+void closeImage();
+
+/* Size of the open image, in sectors */
+uint64_t imageSectors();
+
+/**
+ * @brief For fs::fat32, reads sectors of the open image
+ * 
+ * @return int 1 if it read all of them, 0 if not
+ */
+int readSectors(uint64_t LBA, void* buffer, size_t sectors);
+
+/**
+ * @brief For fs::fat32, writes sectors of the open image
+ * 
+ * @return int 1 if it wrote all of them, 0 if not
+ */
+int writeSectors(uint64_t LBA, const void* buffer, size_t sectors);
+
+/**
+ * @brief Put a FAT32 volume on the whole open image, with an empty root
+ * directory, as fs::fat32 wants it: 2 FATs, and FSInfo
+ * 
+ * @param sectorsPerCluster A power of 2
+ * @return true It got to the image
+ */
+bool formatFAT32(uint8_t sectorsPerCluster);
+
+/**
+ * @brief printf(), to standard output
+ * 
+ */
+void print(const char* format, ...) __attribute__((format(printf,1,2)));
+
+/**
+ * @brief A monotonic clock
+ * 
+ * @return uint64_t Nanoseconds since some point
+ */
+uint64_t nanoseconds();
+
+/**
+ * @brief Whether a string has another in it, for picking tests by name
+ * 
+ */
+bool contains(const char* string, const char* part);
+
+} // namespace host
@@ -0,0 +1,79 @@
+/**
+ * @file hostTest.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief The unit tests and benchmarks the host runners go through. Each
+ * file of them has a table, listed in the runner's main.cpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <hostSupport.hpp>
+
+namespace host
+{
+
+/**
+ * @brief A unit test
+ * 
+ */
+struct testCase
+{
+    const char*         name;
+
+    /* true if it passed. CHECK() says what didn't */
+    bool                (*run)();
+};
+
+/**
+ * @brief A microbenchmark
+ * 
+ */
+struct benchmark
+{
+    const char*         name;
+
+    /* Do it so many times. Set up and tear down happen outside the timing,
+       and either can be nullptr. The benchmark fails if setUp() does */
+    bool                (*setUp)();
+    void                (*run)(uint32_t iterations);
+    void                (*tearDown)();
+
+    /* Iterations for one timed run */
+    uint32_t            iterations;
+};
+
+/**
+ * @brief Tests and benchmarks from one file
+ * 
+ */
+template <typename T> struct suite
+{
+    const T*            entries;
+    size_t              count;
+};
+
+/* Fail a test, saying where, unless something is true */
+#define CHECK(condition)                                                          \
+    do                                                                            \
+    {                                                                             \
+        if (!(condition))                                                         \
+        {                                                                         \
+            host::print("    %s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#condition); \
+            return false;                                                         \
+        }                                                                         \
+    } while (0)
+
+/* Keep the compiler from dropping work a benchmark only does for the time */
+template <typename T> static inline void keep(const T& value)
+{
+    __asm__ __volatile__ ("" : : "r,m"(value) : "memory");
+}
+
+} // namespace host
@@ -0,0 +1,135 @@
+/**
+ * @file dcacheTests.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Tests of how the dentry cache tells names apart
+ * (kernelInternal/fs/dentryName.hpp), against what fs::fat32 finds when a
+ * name is made or taken away in another case than it's looked up in
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "tests.hpp"
+#include <kernelInternal/fs/dentryName.hpp>
+#include <fs/fat32.hpp>
+#include <klib/string.h>
+
+using host::testCase;
+using kernel::vfs::dentryNameCacheable;
+using kernel::vfs::hashDentryName;
+using kernel::vfs::sameDentryName;
+
+static const char* const IMAGE =            "dcacheTest.img";
+static const uint64_t IMAGE_SECTORS =       32768;
+
+// Stands in for the directory's address
+static const uint32_t SEED =                0x1000;
+
+static const uint8_t ATTRIBUTE_ARCHIVE =
+        static_cast<uint8_t>(fs::fat32_dirEntry_attributes::ARCHIVE);
+
+static fs::fat32* freshVolume()
+{
+    if (!host::createImage(IMAGE,IMAGE_SECTORS) || !host::formatFAT32(1))
+        return nullptr;
+    fs::fat32* volume = new fs::fat32(&host::readSectors,&host::writeSectors);
+    if (volume == nullptr || volume->init(0) != 0)
+        return nullptr;
+    return volume;
+}
+
+/**
+ * @brief Whether the cache takes two names for the same entry, on a
+ * filesystem that ignores case
+ * 
+ */
+static bool sameEntry(const char* a, const char* b)
+{
+    const size_t length = strlen(a);
+    return length == strlen(b) && dentryNameCacheable(a,length,true) &&
+            dentryNameCacheable(b,length,true) &&
+            hashDentryName(SEED,a,length,true) == hashDentryName(SEED,b,length,true) &&
+            sameDentryName(a,b,length,true);
+}
+
+static bool found(fs::fat32* volume, const char* name)
+{
+    fs::fat32_dirEntry entry;
+    return volume->lookup(volume->rootCluster(),name,strlen(name),&entry,nullptr) == 0;
+}
+
+/**========================================================================
+ *                           Tests
+ *========================================================================**/
+
+static bool names()
+{
+    CHECK(sameEntry("init.elf","INIT.ELF"));
+    CHECK(sameEntry("Log.Txt","lOG.tXT"));
+    CHECK(!sameEntry("LOG.TXT","LOG.TXF"));
+    CHECK(!sameEntry("[.TXT","{.TXT"));
+
+    // Case matters everywhere else
+    CHECK(!sameDentryName("init.elf","INIT.ELF",8,false));
+    CHECK(hashDentryName(SEED,"init.elf",8,false) != hashDentryName(SEED,"INIT.ELF",8,false));
+    CHECK(hashDentryName(SEED,"init.elf",8,false) != hashDentryName(SEED + 1,"init.elf",8,false));
+
+    // FAT32 folds these, the cache doesn't, so it mustn't hold them
+    CHECK(!dentryNameCacheable("\xc3\xa9.txt",6,true));
+    CHECK(dentryNameCacheable("\xc3\xa9.txt",6,false));
+    return true;
+}
+
+static bool createInAnotherCase()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+
+    // The lookup that leaves "log.txt" cached as not there
+    CHECK(!found(volume,"log.txt"));
+
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    CHECK(volume->createEntry(volume->rootCluster(),"LOG.TXT",7,ATTRIBUTE_ARCHIVE,0,&entry,
+            &location) == fs::fat32_createResult::SUCCESS);
+    CHECK(volume->flush());
+
+    // Which create() replaces, since the filesystem finds it now
+    CHECK(found(volume,"log.txt") && found(volume,"Log.Txt"));
+    CHECK(sameEntry("log.txt","LOG.TXT") && sameEntry("Log.Txt","LOG.TXT"));
+    return true;
+}
+
+static bool unlinkInAnotherCase()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    CHECK(volume->createEntry(volume->rootCluster(),"INIT.ELF",8,ATTRIBUTE_ARCHIVE,0,&entry,
+            &location) == fs::fat32_createResult::SUCCESS);
+
+    // The lookup that leaves "init.elf" cached as the file
+    fs::fat32_entryLocation looked;
+    CHECK(volume->lookup(volume->rootCluster(),"init.elf",8,&entry,&looked) == 0);
+    CHECK(looked.cluster == location.cluster && looked.index == location.index);
+
+    CHECK(volume->removeEntry(&looked));
+    CHECK(volume->flush());
+
+    // Which unlink("INIT.ELF") has to replace with not there
+    CHECK(!found(volume,"init.elf") && !found(volume,"INIT.ELF"));
+    CHECK(sameEntry("init.elf","INIT.ELF"));
+    return true;
+}
+
+static const testCase tests[] = {
+    {"dcache.names",&names},
+    {"dcache.createInAnotherCase",&createInAnotherCase},
+    {"dcache.unlinkInAnotherCase",&unlinkInAnotherCase},
+};
+
+const host::suite<testCase> dcacheTests = {tests,sizeof(tests) / sizeof(tests[0])};
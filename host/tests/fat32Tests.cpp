@@ -0,0 +1,442 @@
+/**
+ * @file fat32Tests.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Tests of fs::fat32, each on a freshly formatted image
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "tests.hpp"
+#include <fs/fat32.hpp>
+#include <klib/string.h>
+
+using host::testCase;
+
+static const char* const IMAGE =            "fat32Test.img";
+
+// 16 MiB, a cluster per sector: enough clusters for the FAT to span
+// several FAT32_CHECK_ALIGN ranges
+static const uint64_t IMAGE_SECTORS =       32768;
+static const size_t SECTOR_SIZE =           512;
+
+static const uint8_t ATTRIBUTE_ARCHIVE =
+        static_cast<uint8_t>(fs::fat32_dirEntry_attributes::ARCHIVE);
+
+/**
+ * @brief A formatted image, and the volume on it. fs::fat32 has no destructor
+ * yet, so the volumes are never freed; the heap is big enough for that
+ * 
+ */
+static fs::fat32* freshVolume()
+{
+    if (!host::createImage(IMAGE,IMAGE_SECTORS) || !host::formatFAT32(1))
+        return nullptr;
+    fs::fat32* volume = new fs::fat32(&host::readSectors,&host::writeSectors);
+    if (volume == nullptr || volume->init(0) != 0)
+        return nullptr;
+    return volume;
+}
+
+/**
+ * @brief The same image, read again from the disk
+ * 
+ */
+static fs::fat32* reopen()
+{
+    fs::fat32* volume = new fs::fat32(&host::readSectors,&host::writeSectors);
+    if (volume == nullptr || volume->init(0) != 0)
+        return nullptr;
+    return volume;
+}
+
+static bool isClean(const fs::fat32_checkResult* result)
+{
+    return result->lostChains == 0 && result->lostClusters == 0 && result->crossLinks == 0 &&
+            result->sizeMismatches == 0 && result->badLinks == 0 &&
+            result->mirrorMismatches == 0 && result->diskErrors == 0;
+}
+
+/**
+ * @brief A file with some clusters, each sector filled with its number
+ * 
+ */
+static bool makeFile(fs::fat32* volume, const char* name, uint32_t clusters, uint32_t size,
+            fs::fat32_dirEntry* entry, fs::fat32_entryLocation* location)
+{
+    const uint32_t first = volume->allocateClusters(0,clusters);
+    if (first == 0)
+        return false;
+    uint8_t sector[SECTOR_SIZE];
+    uint32_t index = 0;
+    for (uint32_t c = first; !fs::fat32::isChainEnd(c); c = volume->nextCluster(c))
+    {
+        for (size_t s = 0; s < volume->sectorsPerCluster(); s++, index++)
+        {
+            memset(sector,static_cast<int>(index),sizeof(sector));
+            if (!volume->writeSectors(volume->clusterLBA(c) + s,sector,1))
+                return false;
+        }
+    }
+    if (volume->createEntry(volume->rootCluster(),name,strlen(name),ATTRIBUTE_ARCHIVE,first,
+            entry,location) != fs::fat32_createResult::SUCCESS)
+        return false;
+    entry->size = size;
+    return volume->writeEntry(location,entry) && volume->flush();
+}
+
+/**========================================================================
+ *                           Tests
+ *========================================================================**/
+
+static bool formatted()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+    CHECK(volume->rootCluster() == 2);
+    CHECK(volume->clusterSize() == SECTOR_SIZE);
+
+    fs::fat32_checkResult result;
+    CHECK(volume->check(&result));
+    CHECK(isClean(&result));
+    CHECK(result.files == 0);
+    CHECK(result.directories == 1);
+    CHECK(result.usedClusters == 1);
+    return true;
+}
+
+static bool createAndLookup()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    CHECK(volume->createEntry(volume->rootCluster(),"HELLO.TXT",9,ATTRIBUTE_ARCHIVE,0,&entry,
+            &location) == fs::fat32_createResult::SUCCESS);
+    CHECK(volume->createEntry(volume->rootCluster(),"hello.txt",9,ATTRIBUTE_ARCHIVE,0,&entry,
+            &location) == fs::fat32_createResult::EXISTS);
+    CHECK(volume->createEntry(volume->rootCluster(),"TOOLONGNAME.TXT",15,ATTRIBUTE_ARCHIVE,0,
+            &entry,&location) == fs::fat32_createResult::BAD_NAME);
+
+    fs::fat32_dirEntry found;
+    fs::fat32_entryLocation foundAt;
+    CHECK(volume->lookup(volume->rootCluster(),"Hello.Txt",9,&found,&foundAt) == 0);
+    CHECK(foundAt.cluster == location.cluster && foundAt.index == location.index);
+    CHECK(memcmp(found.fileName,"HELLO   ",8) == 0);
+    CHECK(volume->lookup(volume->rootCluster(),"HELLO",5,&found,&foundAt) == 1);
+    return true;
+}
+
+static bool writeAndRead()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+
+    // Five clusters, the last one only partly used
+    const uint32_t size = 4 * SECTOR_SIZE + 100;
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    CHECK(makeFile(volume,"DATA.BIN",5,size,&entry,&location));
+
+    // From the disk, with nothing cached
+    fs::fat32* again = reopen();
+    CHECK(again != nullptr);
+    fs::fat32_dirEntry found;
+    CHECK(again->lookup(again->rootCluster(),"DATA.BIN",8,&found,nullptr) == 0);
+    CHECK(found.size == size);
+
+    uint8_t* data = new uint8_t[size];
+    CHECK(data != nullptr);
+    CHECK(again->readFile(&found,0,data,size) == size);
+    for (uint32_t i = 0; i < size; i++)
+        CHECK(data[i] == static_cast<uint8_t>(i / SECTOR_SIZE));
+
+    // From the middle of a cluster, across the next one
+    CHECK(again->readFile(&found,SECTOR_SIZE + 10,data,SECTOR_SIZE) == SECTOR_SIZE);
+    CHECK(data[0] == 1 && data[SECTOR_SIZE - 11] == 1 && data[SECTOR_SIZE - 10] == 2);
+    CHECK(again->readFile(&found,size,data,1) == 0);
+    delete[] data;
+
+    fs::fat32_checkResult result;
+    CHECK(again->check(&result));
+    CHECK(isClean(&result));
+    CHECK(result.files == 1);
+    CHECK(result.usedClusters == 6);
+    return true;
+}
+
+static bool allocation()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+
+    const uint32_t first = volume->allocateClusters(0,4);
+    CHECK(first != 0);
+    const uint32_t free = volume->freeClusters();
+
+    // Added right after the end of the chain, so it stays in one piece
+    uint32_t last = first;
+    while (!fs::fat32::isChainEnd(volume->nextCluster(last)))
+        last = volume->nextCluster(last);
+    CHECK(last == first + 3);
+    CHECK(volume->allocateClusters(last,2) == last + 1);
+    CHECK(volume->freeClusters() == free - 2);
+
+    volume->truncateChain(first + 1);
+    CHECK(fs::fat32::isChainEnd(volume->nextCluster(first + 1)));
+    CHECK(volume->freeClusters() == free + 2);
+    volume->freeChain(first);
+    CHECK(volume->freeClusters() == free + 4);
+    CHECK(volume->flush());
+
+    // FSInfo got the count
+    fs::fat32* again = reopen();
+    CHECK(again != nullptr);
+    CHECK(again->allocateClusters(0,1) != 0);
+    CHECK(again->freeClusters() == free + 3);
+    return true;
+}
+
+static bool listing()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+
+    // Over several clusters of directory
+    const uint32_t files = 40;
+    char name[] = "FILE00.TXT";
+    for (uint32_t i = 0; i < files; i++)
+    {
+        name[4] = static_cast<char>('0' + i / 10);
+        name[5] = static_cast<char>('0' + i % 10);
+        fs::fat32_dirEntry entry;
+        fs::fat32_entryLocation location;
+        CHECK(volume->createEntry(volume->rootCluster(),name,10,ATTRIBUTE_ARCHIVE,0,&entry,
+                &location) == fs::fat32_createResult::SUCCESS);
+    }
+
+    // A buffer that only takes a record or two, so every call resumes
+    alignas(4) uint8_t buffer[64];
+    uint32_t cursor = FAT32_DIRECTORY_START;
+    uint32_t seen = 0;
+    int filled;
+    while ((filled = volume->readDirectory(volume->rootCluster(),&cursor,buffer,sizeof(buffer))) > 0)
+    {
+        for (int at = 0; at < filled; )
+        {
+            const fs::fat32_dirRecord* record = reinterpret_cast<const fs::fat32_dirRecord*>(buffer + at);
+            const char* recordName = reinterpret_cast<const char*>(record + 1);
+            CHECK(record->nameLength == 10);
+            CHECK(memcmp(recordName,"FILE",4) == 0);
+            const uint32_t number = static_cast<uint32_t>(recordName[4] - '0') * 10 +
+                    static_cast<uint32_t>(recordName[5] - '0');
+            CHECK(number == seen);
+            seen++;
+            at += record->length;
+        }
+    }
+    CHECK(filled == 0);
+    CHECK(seen == files);
+
+    // Too small for even one
+    cursor = FAT32_DIRECTORY_START;
+    CHECK(volume->readDirectory(volume->rootCluster(),&cursor,buffer,8) == -1);
+    return true;
+}
+
+/**
+ * @brief The checksum of a short name that its long name entries carry
+ * 
+ */
+static uint8_t shortNameChecksum(const uint8_t* name)
+{
+    uint8_t sum = 0;
+    for (size_t i = 0; i < 11; i++)
+        sum = static_cast<uint8_t>(((sum & 1) << 7) + (sum >> 1) + name[i]);
+    return sum;
+}
+
+static bool longNames()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+
+    // "A Long Name.txt" takes two entries, the second one holding "xt",
+    // the terminator, and padding. They go before the short entry, last first
+    const char longName[] = "A Long Name.txt";
+    const size_t length = sizeof(longName) - 1;
+    uint8_t sector[SECTOR_SIZE] = {};
+    fs::fat32_dirEntry* shortEntry = reinterpret_cast<fs::fat32_dirEntry*>(sector) + 2;
+    memcpy(shortEntry->fileName,"ALONGN~1TXT",11);
+    shortEntry->attributes = ATTRIBUTE_ARCHIVE;
+    const uint8_t checksum = shortNameChecksum(shortEntry->fileName);
+    for (uint8_t part = 0; part < 2; part++)
+    {
+        fs::fat32_lfnEntry lfn;
+        memset(&lfn,0,sizeof(lfn));
+        lfn.order = static_cast<uint8_t>((part + 1) | (part == 1 ? LFN_LAST_ENTRY : 0));
+        lfn.attributes = static_cast<uint8_t>(fs::fat32_dirEntry_attributes::LFN);
+        lfn.checksum = checksum;
+        uint16_t characters[LFN_CHARACTERS];
+        for (size_t i = 0; i < LFN_CHARACTERS; i++)
+        {
+            const size_t at = part * LFN_CHARACTERS + i;
+            characters[i] = at < length ? static_cast<uint8_t>(longName[at]) :
+                    at == length ? 0 : 0xFFFF;
+        }
+        memcpy(lfn.name1,characters,sizeof(lfn.name1));
+        memcpy(lfn.name2,characters + 5,sizeof(lfn.name2));
+        memcpy(lfn.name3,characters + 11,sizeof(lfn.name3));
+        memcpy(sector + (1 - part) * sizeof(lfn),&lfn,sizeof(lfn));
+    }
+    CHECK(volume->writeSectors(volume->clusterLBA(volume->rootCluster()),sector,1));
+
+    fs::fat32_dirEntry found;
+    fs::fat32_entryLocation location;
+    CHECK(volume->lookup(volume->rootCluster(),"a long NAME.TXT",length,&found,&location) == 0);
+    CHECK(location.index == 2 && location.nameIndex == 0);
+    CHECK(volume->lookup(volume->rootCluster(),"ALONGN~1.TXT",12,&found,&location) == 0);
+
+    alignas(4) uint8_t buffer[128];
+    uint32_t cursor = FAT32_DIRECTORY_START;
+    CHECK(volume->readDirectory(volume->rootCluster(),&cursor,buffer,sizeof(buffer)) > 0);
+    const fs::fat32_dirRecord* record = reinterpret_cast<const fs::fat32_dirRecord*>(buffer);
+    CHECK(record->nameLength == length);
+    CHECK(memcmp(record + 1,longName,length) == 0);
+
+    // A short entry changed by something that doesn't know about long names
+    shortEntry->fileName[0] = 'B';
+    CHECK(volume->writeSectors(volume->clusterLBA(volume->rootCluster()),sector,1));
+    CHECK(volume->lookup(volume->rootCluster(),longName,length,&found,&location) == 1);
+
+    // Removing it takes the long name entries too
+    CHECK(volume->lookup(volume->rootCluster(),"BLONGN~1.TXT",12,&found,&location) == 0);
+    CHECK(location.nameIndex == 2);
+    return true;
+}
+
+static bool removal()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    CHECK(makeFile(volume,"GONE.TXT",3,3 * SECTOR_SIZE,&entry,&location));
+    const uint32_t free = volume->freeClusters();
+
+    CHECK(volume->removeEntry(&location));
+    volume->freeChain(fs::fat32::firstCluster(&entry));
+    CHECK(volume->flush());
+    CHECK(volume->freeClusters() == free + 3);
+    CHECK(volume->lookup(volume->rootCluster(),"GONE.TXT",8,&entry,&location) == 1);
+
+    // The slot is free again
+    fs::fat32_entryLocation reused;
+    CHECK(volume->createEntry(volume->rootCluster(),"NEW.TXT",7,ATTRIBUTE_ARCHIVE,0,&entry,
+            &reused) == fs::fat32_createResult::SUCCESS);
+    CHECK(reused.cluster == location.cluster && reused.index == location.index);
+
+    fs::fat32_checkResult result;
+    CHECK(volume->check(&result));
+    CHECK(isClean(&result));
+    return true;
+}
+
+static bool checkFindsProblems()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    CHECK(makeFile(volume,"OWNER.BIN",3,3 * SECTOR_SIZE,&entry,&location));
+
+    // Claims a file's last cluster, and says it's bigger than its chain
+    fs::fat32_dirEntry other;
+    CHECK(volume->createEntry(volume->rootCluster(),"THIEF.BIN",9,ATTRIBUTE_ARCHIVE,
+            fs::fat32::firstCluster(&entry) + 2,&other,&location) == fs::fat32_createResult::SUCCESS);
+    other.size = 2 * SECTOR_SIZE;
+    CHECK(volume->writeEntry(&location,&other));
+
+    // Allocated, and in no file
+    CHECK(volume->allocateClusters(0,2) != 0);
+    CHECK(volume->flush());
+
+    fs::fat32* again = reopen();
+    CHECK(again != nullptr);
+    fs::fat32_checkResult result;
+    CHECK(again->check(&result));
+    CHECK(result.files == 2);
+    CHECK(result.crossLinks == 1);
+    CHECK(result.lostChains == 1);
+    CHECK(result.lostClusters == 2);
+    CHECK(result.mirrorMismatches == 0);
+
+    // Only the first FAT has the lost chain
+    fs::VBR vbr;
+    CHECK(host::readSectors(0,&vbr,1));
+    uint8_t sector[SECTOR_SIZE];
+    CHECK(host::readSectors(vbr.bpd.reservedSectors,sector,1));
+    sector[4 * 2]++;
+    CHECK(host::writeSectors(vbr.bpd.reservedSectors + vbr.bpd.sectorsPerFAT,sector,1));
+    again = reopen();
+    CHECK(again != nullptr);
+    CHECK(again->check(&result));
+    CHECK(result.mirrorMismatches == 1);
+    return true;
+}
+
+static bool checkInRanges()
+{
+    fs::fat32* volume = freshVolume();
+    CHECK(volume != nullptr);
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    CHECK(makeFile(volume,"ONE.BIN",300,300 * SECTOR_SIZE,&entry,&location));
+    CHECK(volume->allocateClusters(0,5) != 0);
+    CHECK(volume->flush());
+
+    fs::fat32_checkResult whole;
+    CHECK(volume->check(&whole));
+
+    // As the kernel's workers do it, a range at a time
+    fs::fat32_check check;
+    CHECK(volume->checkBegin(&check));
+    uint8_t* scratch = new uint8_t[FAT32_CHECK_SCRATCH_SECTORS * SECTOR_SIZE];
+    CHECK(scratch != nullptr);
+    fs::fat32_checkResult total = {};
+    for (uint32_t first = 0; first < check.clusterEnd; first += FAT32_CHECK_ALIGN)
+    {
+        fs::fat32_checkResult part = {};
+        volume->checkFAT(&check,first,first + FAT32_CHECK_ALIGN,scratch,&part);
+        fs::fat32::addResults(&total,&part);
+    }
+    delete[] scratch;
+    CHECK(volume->checkTree(&check,&total));
+    for (uint32_t first = 0; first < check.clusterEnd; first += FAT32_CHECK_ALIGN)
+        volume->checkLost(&check,first,first + FAT32_CHECK_ALIGN,&total);
+    fs::fat32::checkEnd(&check);
+
+    CHECK(memcmp(&whole,&total,sizeof(whole)) == 0);
+    CHECK(whole.lostChains == 1 && whole.lostClusters == 5);
+    CHECK(whole.usedClusters == 306);
+    return true;
+}
+
+static const testCase tests[] = {
+    {"fat32.formatted",&formatted},
+    {"fat32.createAndLookup",&createAndLookup},
+    {"fat32.writeAndRead",&writeAndRead},
+    {"fat32.allocation",&allocation},
+    {"fat32.listing",&listing},
+    {"fat32.longNames",&longNames},
+    {"fat32.removal",&removal},
+    {"fat32.checkFindsProblems",&checkFindsProblems},
+    {"fat32.checkInRanges",&checkInRanges},
+};
+
+const host::suite<testCase> fat32Tests = {tests,sizeof(tests) / sizeof(tests[0])};
@@ -0,0 +1,157 @@
+/**
+ * @file formatTests.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Tests of klib/format.hpp, against xtoa() where they overlap
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "tests.hpp"
+#include <klib/format.hpp>
+#include <klib/cstdlib.hpp>
+#include <klib/string.h>
+
+using host::testCase;
+
+template<typename T> static bool sameAsXtoa(T value, int base)
+{
+    char expected[MAX_NUM_STR_SIZE];
+    char str[io::FORMAT_NUMBER_SIZE + 1];
+    xtoa(value,expected,base);
+    const size_t length = io::formatNumber(value,str,base);
+    str[length] = '\0';
+    return length == strlen(expected) && strcmp(str,expected) == 0;
+}
+
+static bool numbers()
+{
+    // Around every length the pairs and the 32 bit split change at
+    uint64_t value = 1;
+    for (int digits = 1; digits <= 20; digits++)
+    {
+        CHECK(sameAsXtoa(value - 1,10));
+        CHECK(sameAsXtoa(value,10));
+        CHECK(sameAsXtoa(value + 1,10));
+        CHECK(sameAsXtoa(value - 1,16));
+        value *= 10;
+    }
+    for (uint32_t i = 0; i < 100000; i += 7)
+    {
+        CHECK(sameAsXtoa(i,10));
+        CHECK(sameAsXtoa(i * 2654435761u,16));
+    }
+    CHECK(sameAsXtoa(UINT32_MAX,10));
+    CHECK(sameAsXtoa(UINT64_MAX,10));
+    CHECK(sameAsXtoa(UINT64_MAX,16));
+    CHECK(sameAsXtoa(INT32_MIN,10));
+    CHECK(sameAsXtoa(INT64_MIN,10));
+    CHECK(sameAsXtoa(INT64_MIN,16));
+    CHECK(sameAsXtoa(static_cast<int8_t>(-5),10));
+    CHECK(sameAsXtoa(0x100000000ull,16));
+    return true;
+}
+
+static bool placeholders()
+{
+    char buffer[128];
+    CHECK(io::formatTo(buffer,sizeof(buffer),"no placeholders") == 15);
+    CHECK(strcmp(buffer,"no placeholders") == 0);
+
+    io::formatTo(buffer,sizeof(buffer),"{} {} {}",-42,UINT64_MAX,0u);
+    CHECK(strcmp(buffer,"-42 18446744073709551615 0") == 0);
+
+    io::formatTo(buffer,sizeof(buffer),"{:x} {:X} {:x}",0xBEEFu,0xBEEFu,-255);
+    CHECK(strcmp(buffer,"beef BEEF -ff") == 0);
+
+    io::formatTo(buffer,sizeof(buffer),"{} {:s} {} {:c}",'r',"ainbow",true,'!');
+    CHECK(strcmp(buffer,"r ainbow true !") == 0);
+
+    const char* nothing = nullptr;
+    io::formatTo(buffer,sizeof(buffer),"{} {} {:X}",reinterpret_cast<void*>(0x1234),nothing,
+            reinterpret_cast<int*>(0xabc));
+    CHECK(strcmp(buffer,"0x1234 (null) ABC") == 0);
+
+    CHECK(io::formatTo(buffer,sizeof(buffer),"{{{}}} }}{{",7) == 6);
+    CHECK(strcmp(buffer,"{7} }{") == 0);
+    CHECK(io::formatTo(buffer,sizeof(buffer),"{{}}{{}}{{}}{{}}{{}}{{}}") == 12);
+    CHECK(strcmp(buffer,"{}{}{}{}{}{}") == 0);
+    return true;
+}
+
+static bool widths()
+{
+    char buffer[128];
+    io::formatTo(buffer,sizeof(buffer),"[{:5}.{:06}]",12,345);
+    CHECK(strcmp(buffer,"[   12.000345]") == 0);
+
+    io::formatTo(buffer,sizeof(buffer),"{:6}|{:06}|{:08X}|{:p}|{:010p}",-42,-42,0xBEEFu,
+            reinterpret_cast<void*>(0x10),reinterpret_cast<void*>(0x10));
+    CHECK(strcmp(buffer,"   -42|-00042|0000BEEF|0x10|0x00000010") == 0);
+
+    io::formatTo(buffer,sizeof(buffer),"{:2}|{:4}|{:5}",12345,"ab",false);
+    CHECK(strcmp(buffer,"12345|  ab|false") == 0);
+    return true;
+}
+
+static bool truncates()
+{
+    char buffer[8];
+    CHECK(io::formatTo(buffer,sizeof(buffer),"0123456789{}",42) == 12);
+    CHECK(strcmp(buffer,"0123456") == 0);
+
+    CHECK(io::formatTo(buffer,sizeof(buffer),"{:20}",1) == 20);
+    CHECK(strcmp(buffer,"       ") == 0);
+
+    buffer[0] = 'x';
+    CHECK(io::formatTo(buffer,0,"{}",1) == 1);
+    CHECK(buffer[0] == 'x');
+    return true;
+}
+
+// What a sink with a flush, like out's, wrote out
+static char flushed[256];
+static size_t flushedLength = 0;
+static uint32_t flushCount = 0;
+
+static void collect(io::formatSink* sink)
+{
+    memcpy(flushed + flushedLength,sink->buffer,sink->used);
+    flushedLength += sink->used;
+    sink->used = 0;
+    flushCount++;
+}
+
+static bool flushes()
+{
+    const io::formatString<const char*,int,uint32_t> fmt("{:40}|{:030}|{:X}|end");
+    const io::formatArgument arguments[] = {
+        io::formatting::argumentTraits<const char*>::make("text"),
+        io::formatting::argumentTraits<int>::make(-1),
+        io::formatting::argumentTraits<uint32_t>::make(0xFFFFFFFFu)
+    };
+    char buffer[7];
+    io::formatSink sink = {buffer,sizeof(buffer),0,&collect,nullptr};
+    const size_t length = io::formatWrite(&sink,fmt,arguments);
+    collect(&sink);
+    flushed[flushedLength] = '\0';
+
+    char expected[128];
+    io::formatTo(expected,sizeof(expected),"{:40}|{:030}|{:X}|end","text",-1,0xFFFFFFFFu);
+    CHECK(length == strlen(expected) && flushedLength == length);
+    CHECK(strcmp(flushed,expected) == 0);
+    CHECK(flushCount == (length + sizeof(buffer) - 1) / sizeof(buffer));
+    return true;
+}
+
+static const testCase tests[] = {
+    {"format.numbers",&numbers},
+    {"format.placeholders",&placeholders},
+    {"format.widths",&widths},
+    {"format.truncates",&truncates},
+    {"format.flushes",&flushes},
+};
+
+const host::suite<testCase> formatTests = {tests,sizeof(tests) / sizeof(tests[0])};
@@ -0,0 +1,43 @@
+/**
+ * @file main.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Unit test runner for the host build of lib. Runs every test, or the
+ * ones with the argument in their name, and fails if any of them did
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "tests.hpp"
+
+static const host::suite<host::testCase>* const suites[] = {&dcacheTests,&fat32Tests,&formatTests,&memoryTests,&stringTests};
+
+int main(int argc, char** argv)
+{
+    host::initializeHeap();
+    const char* filter = argc > 1 ? argv[1] : "";
+
+    uint32_t passed = 0;
+    uint32_t failed = 0;
+    for (const host::suite<host::testCase>* suite : suites)
+    {
+        for (size_t i = 0; i < suite->count; i++)
+        {
+            const host::testCase* test = suite->entries + i;
+            if (!host::contains(test->name,filter))
+                continue;
+            const bool ok = test->run();
+            host::print("%s %s\n",ok ? "PASS" : "FAIL",test->name);
+            if (ok)
+                passed++;
+            else
+                failed++;
+        }
+    }
+    host::closeImage();
+
+    host::print("%u passed, %u failed\n",passed,failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file memoryTests.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Tests of the heap in earlyLib/memory.hpp. It's the one new and
+ * delete use here too, so whatever else is allocated is around as well
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "tests.hpp"
+#include <earlyLib/memory.hpp>
+#include <klib/string.h>
+
+using host::testCase;
+
+static bool aligned()
+{
+    void* blocks[16];
+    for (size_t i = 0; i < 16; i++)
+    {
+        blocks[i] = kalloc(i * 3 + 1);
+        CHECK(blocks[i] != nullptr);
+        CHECK(reinterpret_cast<uintptr_t>(blocks[i]) % mem::HEAP_ALIGNMENT == 0);
+    }
+    for (size_t i = 0; i < 16; i++)
+        kfree(blocks[i]);
+    return true;
+}
+
+static bool separate()
+{
+    // Each filled with its own byte, and still holding it after the rest
+    const size_t count = 64;
+    uint8_t* blocks[count];
+    for (size_t i = 0; i < count; i++)
+    {
+        blocks[i] = static_cast<uint8_t*>(kalloc(i + 1));
+        CHECK(blocks[i] != nullptr);
+        memset(blocks[i],static_cast<int>(i),i + 1);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        for (size_t j = 0; j <= i; j++)
+            CHECK(blocks[i][j] == static_cast<uint8_t>(i));
+        kfree(blocks[i]);
+    }
+    return true;
+}
+
+static bool reused()
+{
+    // First fit: what was just freed is where the next one goes
+    void* first = kalloc(256);
+    void* after = kalloc(256);
+    CHECK(first != nullptr && after != nullptr);
+    kfree(first);
+    CHECK(kalloc(200) == first);
+    kfree(first);
+    kfree(after);
+    return true;
+}
+
+static bool merged()
+{
+    // A free block takes in the free ones after it, so two of them make
+    // room for something bigger than either
+    uint8_t* a = static_cast<uint8_t*>(kalloc(64));
+    uint8_t* b = static_cast<uint8_t*>(kalloc(64));
+    void* c = kalloc(64);
+    CHECK(a != nullptr && b != nullptr && c != nullptr);
+    CHECK(b == a + 64 + mem::heapEntry_headerSize);
+    kfree(b);
+    kfree(a);
+    CHECK(kalloc(128 + mem::heapEntry_headerSize) == a);
+    kfree(a);
+    kfree(c);
+    return true;
+}
+
+static bool exhausted()
+{
+    CHECK(kalloc(host::HEAP_SIZE) == nullptr);
+    uint8_t* array = new uint8_t[1000];
+    CHECK(array != nullptr);
+    delete[] array;
+    return true;
+}
+
+static const testCase tests[] = {
+    {"memory.aligned",&aligned},
+    {"memory.separate",&separate},
+    {"memory.reused",&reused},
+    {"memory.merged",&merged},
+    {"memory.exhausted",&exhausted},
+};
+
+const host::suite<testCase> memoryTests = {tests,sizeof(tests) / sizeof(tests[0])};
@@ -0,0 +1,91 @@
+/**
+ * @file stringTests.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Tests of klib/string.h and xtoa() from klib/cstdlib.hpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "tests.hpp"
+#include <klib/cstdlib.hpp>
+#include <klib/string.h>
+
+using host::testCase;
+
+static bool copies()
+{
+    uint8_t source[100];
+    uint8_t destination[100];
+    for (size_t i = 0; i < sizeof(source); i++)
+        source[i] = static_cast<uint8_t>(i * 7);
+    CHECK(memcpy(destination,source,sizeof(source)) == destination);
+    CHECK(memcmp(destination,source,sizeof(source)) == 0);
+
+    CHECK(memset(destination,0xAB,50) == destination);
+    CHECK(destination[0] == 0xAB && destination[49] == 0xAB && destination[50] == source[50]);
+    return true;
+}
+
+static bool moves()
+{
+    uint8_t buffer[32];
+    for (size_t i = 0; i < sizeof(buffer); i++)
+        buffer[i] = static_cast<uint8_t>(i);
+
+    // Forwards over itself, and then back
+    memmove(buffer + 4,buffer,20);
+    for (size_t i = 0; i < 20; i++)
+        CHECK(buffer[i + 4] == i);
+    memmove(buffer,buffer + 4,20);
+    for (size_t i = 0; i < 20; i++)
+        CHECK(buffer[i] == i);
+    return true;
+}
+
+static bool compares()
+{
+    const uint8_t low[] = {1,2,3};
+    const uint8_t high[] = {1,2,200};
+    CHECK(memcmp(low,high,3) < 0);
+    CHECK(memcmp(high,low,3) > 0);
+    CHECK(memcmp(low,high,2) == 0);
+    CHECK(memcmp(low,high,0) == 0);
+
+    CHECK(strlen("") == 0);
+    CHECK(strlen("rainbow") == 7);
+    CHECK(strcmp("abc","abc") == 0);
+    CHECK(strcmp("abc","abd") < 0);
+    CHECK(strcmp("abcd","abc") > 0);
+
+    char copy[8];
+    CHECK(strcpy(copy,"kernel") == copy);
+    CHECK(strcmp(copy,"kernel") == 0);
+    return true;
+}
+
+static bool numbers()
+{
+    char string[MAX_NUM_STR_SIZE];
+    CHECK(strcmp(xtoa(0,string,10),"0") == 0);
+    CHECK(strcmp(xtoa(1234567890,string,10),"1234567890") == 0);
+    CHECK(strcmp(xtoa(-42,string,10),"-42") == 0);
+    CHECK(strcmp(xtoa(INT32_MIN,string,10),"-2147483648") == 0);
+    CHECK(strcmp(xtoa(0xDEADBEEFu,string,16),"DEADBEEF") == 0);
+    CHECK(strcmp(xtoa(UINT64_MAX,string,16),"FFFFFFFFFFFFFFFF") == 0);
+    CHECK(strcmp(xtoa(5u,string,2),"101") == 0);
+    CHECK(xtoa(5,string,1) == nullptr);
+    CHECK(xtoa(5,string,17) == nullptr);
+    return true;
+}
+
+static const testCase tests[] = {
+    {"string.copies",&copies},
+    {"string.moves",&moves},
+    {"string.compares",&compares},
+    {"string.numbers",&numbers},
+};
+
+const host::suite<testCase> stringTests = {tests,sizeof(tests) / sizeof(tests[0])};
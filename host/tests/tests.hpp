@@ -0,0 +1,20 @@
+/**
+ * @file tests.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Every file of unit tests, for main.cpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <hostTest.hpp>
+
+extern const host::suite<host::testCase> dcacheTests;
+extern const host::suite<host::testCase> fat32Tests;
+extern const host::suite<host::testCase> formatTests;
+extern const host::suite<host::testCase> memoryTests;
+extern const host::suite<host::testCase> stringTests;
@@ -24,4 +24,17 @@
 #define CODE32_SEGMENT              0x08
 #define DATA32_SEGMENT              0x10
 #define CODE16_SEGMENT              0x18
-#define DATA16_SEGMENT              0x20
\ No newline at end of file
+#define DATA16_SEGMENT              0x20
+/* Boot progress marks, a byte each written to the 0xE9 debug port, which
+   QEMU's -debugcon and bochs' port_e9_hack hand to the host. Real hardware
+   ignores them. build-scripts/bench-boot.sh times the phases between them */
+#define BOOT_MARK_PORT              0xE9
+#define BOOT_MARK_STAGE0            'a'     /* MBR code running */
+#define BOOT_MARK_STAGE1            'b'     /* stage1 loaded, still real mode */
+#define BOOT_MARK_KERNEL_LOADED     'c'     /* kernel.bin read, about to jump */
+#define BOOT_MARK_KMAIN             'd'     /* kmain() entered */
+#define BOOT_MARK_CPUS_ONLINE       'e'     /* Scheduler up, APs started */
+#define BOOT_MARK_INIT              'f'     /* INIT.ELF spawned, boot is over */
+
+/* QEMU's isa-debug-exit, which bench-boot adds to end a boot once it's over */
+#define BOOT_EXIT_PORT              0xF4
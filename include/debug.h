@@ -11,5 +11,10 @@
 
 #pragma once
 
+#include <bootloader/commonDefines.h>
+
 #define BOCHS_STOP __asm__ __volatile__ ("xchgw %bx, %bx");
 
+
+/* Tell whoever is timing the boot it got to a mark from bootloader/commonDefines.h */
+#define BOOT_MARK(mark) __asm__ __volatile__ ("outb %b0, %w1" : : "a"(mark), "Nd"(BOOT_MARK_PORT));
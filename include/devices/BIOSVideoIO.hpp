@@ -103,7 +103,14 @@ public:
      */
     int putchar(char c);
 
-    
+    /**
+     * @brief Puts a string, a character at a time, without a call for each
+     * 
+     * @param str Characters to put
+     * @param size How many
+     */
+    void write(const char* str, size_t size);
+
 
 private:
     uint16_t _row;
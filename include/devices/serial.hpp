@@ -0,0 +1,147 @@
+/**
+ * @file serial.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief A 16550 UART, as a backend for io::_outstream. Polled until
+ * interrupts are started, then transmission is driven by the UART's interrupt
+ * from a ring buffer
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace io
+{
+
+/* The first serial port, and its ISA interrupt */
+constexpr uint16_t COM1_PORT =              0x3F8;
+constexpr uint8_t COM1_IRQ =                4;
+
+constexpr uint32_t SERIAL_DEFAULT_BAUD =    115200;
+
+/* Bytes the transmitter FIFO of a 16550A takes at once */
+constexpr uint8_t SERIAL_FIFO_SIZE =        16;
+
+/* Bytes waiting for the transmitter once interrupts are on, a power of 2 */
+constexpr uint32_t SERIAL_RING_SIZE =       4096;
+
+static_assert((SERIAL_RING_SIZE & (SERIAL_RING_SIZE - 1)) == 0);
+
+/* Characters write() sends per time it takes the lock, so interrupts aren't
+   off for long while it polls */
+constexpr size_t SERIAL_WRITE_BATCH =       64;
+
+/**
+ * @brief A 16550 UART. Has no constructor, so it can be a global: nothing
+ * works until init()
+ * 
+ */
+class serial_port
+{
+public:
+    /**
+     * @brief Set the UART up, 8N1 with its FIFOs on. Fails if nothing answers
+     * at the port, and then putchar() does nothing
+     * 
+     * @param port First I/O port of the UART
+     * @param baud Baud rate, that 115200 divides
+     * @return true There's a working UART there
+     */
+    bool init(uint16_t port = COM1_PORT, uint32_t baud = SERIAL_DEFAULT_BAUD);
+
+    /**
+     * @brief Whether init() found a UART
+     * 
+     */
+    bool present() { return _present; }
+
+    /**
+     * @brief Clears the terminal on the other side, as ANSI terminals do it
+     * 
+     */
+    void clear();
+
+    /**
+     * @brief Send a character, '\n' as "\r\n". Polled, up to a FIFO full at a
+     * time, before startInterrupts() and whenever interrupts are off (so
+     * panics still get out). Otherwise queued, waiting with the lock dropped
+     * while the queue is full
+     * 
+     * @param c Character to send
+     * @return int 0 for success, 1 if there's no UART
+     */
+    int putchar(char c);
+
+    /**
+     * @brief Send a string, as putchar() does, taking the lock once for
+     * SERIAL_WRITE_BATCH characters rather than once for each
+     * 
+     * @param str Characters to send
+     * @param size How many
+     */
+    void write(const char* str, size_t size);
+
+    /**
+     * @brief Wait until everything queued is in the transmitter
+     * 
+     */
+    void flush();
+
+    /**
+     * @brief Queue output from now on. The UART's interrupt must then call
+     * onInterrupt()
+     * 
+     * @param ring The queue, SERIAL_RING_SIZE bytes. Only the kernel needs one
+     */
+    void startInterrupts(char* ring);
+
+    /**
+     * @brief Refill the transmitter FIFO from the queue, from the UART's
+     * interrupt handler
+     * 
+     */
+    void onInterrupt();
+
+private:
+    uint16_t _port;
+    bool _present;
+    bool _interrupts;
+
+    /* Transmitter FIFO size, 1 without one */
+    uint8_t _fifoSize;
+
+    /* Bytes the FIFO is known to have room for, since it was last empty */
+    uint8_t _fifoRoom;
+
+    /* Whether the transmitter interrupt is enabled, while there's a queue */
+    bool _transmitting;
+
+    /* Between processors, taken with interrupts off */
+    uint32_t _lock;
+
+    /* Queue, from _tail to _head, which only grow */
+    uint32_t _head;
+    uint32_t _tail;
+    char* _ring;
+
+    uint32_t lock();
+    void unlock(uint32_t flags);
+
+    /* Send a byte, polling. With the lock */
+    void send(uint8_t byte);
+
+    /* Move queued bytes to the FIFO, while it's known to have room or, if
+       waiting, all of them. With the lock */
+    void fillFIFO(bool wait);
+
+    /* Queue a byte, which the queue has room for, or send it if it can't be
+       queued. With the lock */
+    void put(uint8_t byte, bool queue);
+};
+
+} // namespace io
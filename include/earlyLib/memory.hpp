@@ -44,6 +44,11 @@ struct heapFlags
 };
 
 extern const size_t heapEntry_headerSize;
+
+/* Alignment of every allocation, must be a power of 2 and a multiple of the size
+   of the header, which is a pointer and the flags (8 bytes here, 16 on a 64 bit
+   host) */
+static const size_t HEAP_ALIGNMENT = 2 * sizeof(void*);
     
 class heapEntry
 {
@@ -56,7 +61,8 @@ public:
     void init(heapEntry* next) { _flags.reserved = next ? false : true; _next = next;}
 
     /**
-     * @brief Attempt to allocate a memory of size size
+     * @brief Attempt to allocate a memory of size size, from this entry or
+     * any after it. Not locked, use kalloc/new
      * 
      * @param size Size of memory to allocate
      * @return void* Pointer to data buffer, if NULL, then there wasn't enough memory
@@ -83,7 +89,7 @@ public:
      * @return void* 
      */
     void *getDataPtr() { return reinterpret_cast<void*>(
-                            reinterpret_cast<uint32_t>(this) + heapEntry_headerSize); }
+                            reinterpret_cast<uintptr_t>(this) + heapEntry_headerSize); }
 
     /**
      * @brief Checks if it's the last entry
@@ -108,7 +114,8 @@ private:
 }; // class heapEntry
 
 /**
- * @brief Initializes the heap
+ * @brief Initializes the heap. kalloc/kfree/new/delete are safe to use from
+ * several processors, and from interrupt handlers
  * 
  * @param ptr Pointer to the heap location
  * @param maxSize Maximum size of the heap
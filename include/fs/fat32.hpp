@@ -161,8 +161,13 @@ struct FAT32FSInfo
     uint8_t         reserved2[12];
 
     /* Trail signature, should be FSINFO_TRAIL_SIGNATURE */
-    uint16_t        trailSignature;
-};
+    uint32_t        trailSignature;
+} __attribute__((packed));
+
+static_assert(sizeof(FAT32FSInfo) == 512);
+
+/* Values of FAT32FSInfo fields that mean nothing is known */
+#define FSINFO_UNKNOWN          0xFFFFFFFF
 
 enum class fat32_dirEntry_attributes
 {
@@ -250,20 +255,53 @@ struct fat32_dirEntry
 
 static_assert(sizeof(fat32_dirEntry) == 32);
 
-struct fat32_internalDirList
+/* The last part of a long name (the first entry of it on the disk) has this
+   set in its order */
+#define LFN_LAST_ENTRY          0x40
+
+/* UTF-16 characters in each entry of a long name */
+#define LFN_CHARACTERS          13
+
+/* Longest long name, in UTF-16 characters, and the entries that takes */
+#define LFN_MAX_LENGTH          255
+#define LFN_MAX_ENTRIES         20
+
+/**
+ * @brief VFAT long file name entry. A long name is kept in up to
+ * LFN_MAX_ENTRIES of these, right before the short entry it goes with, last
+ * part first. The characters are UTF-16, ended by 0 and padded with 0xFFFF
+ * if there's room
+ * 
+ */
+struct fat32_lfnEntry
 {
-    /* 0 for success, 1 for directory not found */
-    int                 returnCode;
+    /* Which part of the name it is, from 1, and maybe LFN_LAST_ENTRY */
+    uint8_t             order;
 
-    /* Number of entries in the directory */
-    size_t              size;
+    /* Characters 1 to 5 of this part */
+    uint16_t            name1[5];
 
-    /* Pointer to list of filenames, all C terminated strings */
-    char**              list;
+    /* Always fat32_dirEntry_attributes::LFN */
+    uint8_t             attributes;
 
-    /* Attributes */
-    fat32_dirEntry_attributes* attr;
-};
+    /* Always 0 */
+    uint8_t             type;
+
+    /* Of the 11 characters of the short name, so a short entry that was
+       changed by something that doesn't know about long names loses it */
+    uint8_t             checksum;
+
+    /* Characters 6 to 11 */
+    uint16_t            name2[6];
+
+    /* Always 0 */
+    uint16_t            cluster;
+
+    /* Characters 12 and 13 */
+    uint16_t            name3[2];
+} __attribute__((packed));
+
+static_assert(sizeof(fat32_lfnEntry) == 32);
 
 struct fat32_fileResult
 {
@@ -278,31 +316,177 @@ struct fat32_fileResult
 };
 
 
+/**
+ * @brief Where a directory entry is on the disk
+ * 
+ */
+struct fat32_entryLocation
+{
+    /* Cluster of the directory it's in */
+    uint32_t            cluster;
+
+    /* Index of the entry in that cluster */
+    uint32_t            index;
+
+    /* Where its long name starts, which can be a cluster or more before.
+       The same as the entry's if it has none */
+    uint32_t            nameCluster;
+    uint32_t            nameIndex;
+};
+
+/* Cursor for readDirectory() to start at the beginning of a directory */
+#define FAT32_DIRECTORY_START   0
+
+/**
+ * @brief What readDirectory() fills its buffer with, one per named entry,
+ * back to back. The name follows each one
+ * 
+ */
+struct fat32_dirRecord
+{
+    /* From the entry */
+    uint32_t            size;
+    uint32_t            cluster;
+
+    /* Cursor to carry on from, right after this entry */
+    uint32_t            next;
+
+    /* Where the entry is, as in fat32_entryLocation */
+    uint32_t            entryCluster;
+
+    /* Bytes from this record to the next, a multiple of 4 */
+    uint16_t            length;
+
+    /* Of the name, in bytes, without its terminator */
+    uint16_t            nameLength;
+
+    uint16_t            entryIndex;
+
+    /* fat32_dirEntry_attributes */
+    uint8_t             attributes;
+
+    uint8_t             reserved;
+};
+
+static_assert(sizeof(fat32_dirRecord) == 24);
+
+/* Clusters a checkFAT() or checkLost() range starts on a multiple of: a
+   sector of the FAT, so each worker compares its own sectors */
+#define FAT32_CHECK_ALIGN       128
+
+/* Sectors of scratch space checkFAT() needs */
+#define FAT32_CHECK_SCRATCH_SECTORS 16
+
+/**
+ * @brief What a check found. Workers each fill their own, which are added
+ * up after
+ * 
+ */
+struct fat32_checkResult
+{
+    /* Reached from the root directory */
+    uint32_t            files;
+    uint32_t            directories;
+
+    /* In use, according to the FAT */
+    uint32_t            usedClusters;
+
+    /* Chains in use that no entry reaches, and how many clusters they have */
+    uint32_t            lostChains;
+    uint32_t            lostClusters;
+
+    /* Clusters more than one chain runs into */
+    uint32_t            crossLinks;
+
+    /* Files whose chain isn't as long as their size says */
+    uint32_t            sizeMismatches;
+
+    /* FAT entries pointing past the end of the volume, or at a free cluster */
+    uint32_t            badLinks;
+
+    /* Sectors where a copy of the FAT differs from the first one */
+    uint32_t            mirrorMismatches;
+
+    /* Sectors that couldn't be read, or a directory that couldn't be
+       listed */
+    uint32_t            diskErrors;
+};
+
+/**
+ * @brief What a check keeps between its steps, from checkBegin() to
+ * checkEnd()
+ * 
+ */
+struct fat32_check
+{
+    /* Clusters go from 2 to this, not included */
+    uint32_t            clusterEnd;
+
+    /* A bit per cluster: some FAT entry points at it, so it doesn't start a
+       chain. Set from any number of workers at once */
+    uint32_t*           linked;
+
+    /* A bit per cluster: a chain from the directory tree went through it */
+    uint32_t*           owned;
+};
+
+/* What createEntry() and createDirectory() return */
+enum class fat32_createResult
+{
+    SUCCESS,
+
+    /* Something already has that name */
+    EXISTS,
+
+    DISK_ERROR,
+
+    /* Not something that fits in 8.3 */
+    BAD_NAME,
+
+    /* No clusters left, or out of memory */
+    NO_SPACE
+};
+
 class fat32
 {
 private: // BUG
     uint32_t *_FATptr;
     int (*_diskReadFunc)( uint64_t LBA, void* buffer, size_t sectors );
+    int (*_diskWriteFunc)( uint64_t LBA, const void* buffer, size_t sectors ) = nullptr;
     VBR *_vbr;
     uint32_t _partitionLBA;
-    //size_t _rootDirSize;
-    //fat32_dirEntry* _rootDir;
 
-    struct readDirResult
-    {
-        /* 0 for success, 1 for no directory */
-        int     returnCode;
+    /* Writing, all in fat32Write.cpp. Nothing here is made until the first
+       cluster is allocated or freed */
+
+    /* A bit per cluster, set if it's free. Built from the FAT */
+    uint32_t* _freeMap = nullptr;
+
+    /* A bit per sector of the FAT, set if it changed since the last flush() */
+    uint32_t* _dirtyFAT = nullptr;
 
-        /* Number of entries */
-        size_t  numEntries;
+    /* The FSInfo sector, nullptr if the volume has none worth trusting */
+    FAT32FSInfo* _FSInfo = nullptr;
+    bool _FSInfoDirty = false;
 
-        /* Entries */
-        fat32_dirEntry* entries;
-    };
+    /* Clusters go from 2 to this, not included */
+    uint32_t _clusterEnd = 0;
+    uint32_t _freeClusters = 0;
 
-    readDirResult* readDir( size_t cluster );
+    /* Where the next search for free clusters starts */
+    uint32_t _nextFree = 2;
+
+    bool buildFreeMap();
+    bool isFree(uint32_t cluster) const;
+    void setNext(uint32_t cluster, uint32_t next);
+    uint32_t freeRun(uint32_t start, uint32_t limit) const;
+    bool findRun(uint32_t count, uint32_t* start) const;
+    void takeRun(uint32_t start, uint32_t count, uint32_t* previous);
+    bool writeCluster(uint32_t cluster, const void* buffer);
+    //size_t _rootDirSize;
+    //fat32_dirEntry* _rootDir;
 
-    const char* nameFromEntry( fat32_dirEntry* ptr );
+    bool readCluster( uint32_t cluster, void* buffer );
 
 
     
@@ -311,14 +495,305 @@ public:
 
     // FIXME Rework constructors
     fat32(int (*diskReadFunc)(uint64_t LBA, void* buffer, size_t sectors)) { _diskReadFunc = diskReadFunc; }
+
+    /* One that can write too */
+    fat32(int (*diskReadFunc)(uint64_t LBA, void* buffer, size_t sectors),
+            int (*diskWriteFunc)(uint64_t LBA, const void* buffer, size_t sectors))
+            : _diskReadFunc(diskReadFunc), _diskWriteFunc(diskWriteFunc) {}
     
     int init( uint32_t partitionLBA );
 
-    fat32_internalDirList* getInternalDirectoryList(const char* directory);
+    /**
+     * @brief List a directory, as many entries as fit in a buffer, from
+     * where the last call stopped. Each is a fat32_dirRecord, with its long
+     * name if it has one, in UTF-8, or its short one. Nothing is allocated:
+     * the directory is read a few sectors at a time, into the stack, and
+     * long names are put together in it too. Deleted entries and the volume
+     * label are skipped, "." and ".." aren't
+     * 
+     * @param directoryCluster First cluster of the directory
+     * @param cursor FAT32_DIRECTORY_START, or what the last call left in it.
+     * Moved past the entries that were put in the buffer
+     * @param buffer Where the records go, 4 byte aligned
+     * @param size Bytes in it
+     * @return int Bytes filled, 0 at the end of the directory, -1 if the next
+     * record doesn't fit, -2 for disk errors
+     */
+    int readDirectory(uint32_t directoryCluster, uint32_t* cursor, void* buffer, size_t size);
 
     // Only works in root directory, with FAT style names
     fat32_fileResult* getRootFile(const char* file);
 
+    /**
+     * @brief Find a file in the root directory, without reading it
+     * 
+     * @param file FAT style name ("INIT.ELF")
+     * @param entry Filled with its directory entry
+     * @return int 0 for success, 1 for file not found
+     */
+    int findRootFile(const char* file, fat32_dirEntry* entry);
+
+    /**
+     * @brief Find a name in any directory, without allocating anything but a
+     * cluster to read it into. It can be the long name of an entry, or its
+     * short one. Long names are put together across clusters, checked
+     * against their short entry, and compared a part at a time as they go
+     * by, without being kept anywhere. Deleted entries and the volume label
+     * never match, and the comparison ignores case (ASCII and Latin-1)
+     * 
+     * @param directoryCluster First cluster of the directory
+     * @param name UTF-8, or a FAT style short name, not terminated
+     * @param length Length of name
+     * @param entry Filled with its directory entry
+     * @param location Filled with where that entry is, if not nullptr
+     * @return int 0 for success, 1 for not found, 2 for disk errors
+     */
+    int lookup(uint32_t directoryCluster, const char* name, size_t length,
+                fat32_dirEntry* entry, fat32_entryLocation* location);
+
+    /**
+     * @brief Read part of a file, whole clusters at a time
+     * 
+     * @param entry Directory entry of the file, from findRootFile()
+     * @param offset Where in the file to start
+     * @param buffer Where to read to
+     * @param size How many bytes to read
+     * @return size_t Bytes read, less than size past the end of the file or
+     * on disk errors
+     */
+    size_t readFile(const fat32_dirEntry* entry, size_t offset, void* buffer, size_t size);
+
+    /**
+     * @brief Follow a cluster chain
+     * 
+     * @param cluster Cluster of the chain
+     * @return uint32_t The one after it. Check it with isChainEnd()
+     */
+    uint32_t nextCluster( uint32_t cluster ) const;
+
+    /* Whether a cluster number is past the end of a chain (or a bad one) */
+    static bool isChainEnd(uint32_t cluster);
+
+    /* First sector of a cluster, from the start of the disk */
+    uint64_t clusterLBA(uint32_t cluster) const;
+
+    /* Clusters go from 2 to this, not included: where the data or the FAT
+       ends, whichever comes first */
+    uint32_t clusterEnd() const;
+
+    /**
+     * @brief Read sectors straight from the disk, with no copying
+     * 
+     * @param LBA First sector, from the start of the disk
+     * @param buffer Where to
+     * @param sectors How many
+     * @return true They were read
+     */
+    bool readSectors(uint64_t LBA, void* buffer, size_t sectors)
+    {
+        return (*_diskReadFunc)(LBA,buffer,sectors);
+    }
+
+    /* Sectors in a cluster */
+    size_t sectorsPerCluster() const { return _vbr->bpd.sectorsPerCluster; }
+
+    /* First cluster of the root directory */
+    uint32_t rootCluster() const { return _vbr->bpd.clusterNumberRoot; }
+
+    /* Bytes in a cluster */
+    size_t clusterSize() const { return static_cast<size_t>(_vbr->bpd.sectorsPerCluster) *
+            _vbr->bpd.bytesPerSector; }
+
+    /* First cluster of what an entry points to, 0 for empty files */
+    static uint32_t firstCluster(const fat32_dirEntry* entry)
+    {
+        return static_cast<uint32_t>(entry->highClusterNumber) << 16 | entry->lowClusterNumber;
+    }
+
+    /* Point an entry at its first cluster */
+    static void setFirstCluster(fat32_dirEntry* entry, uint32_t cluster)
+    {
+        entry->highClusterNumber = static_cast<uint16_t>(cluster >> 16);
+        entry->lowClusterNumber = static_cast<uint16_t>(cluster);
+    }
+
+    /*
+     * Writing. Changes to the FAT stay in memory until flush(), which the
+     * caller does once it's done with a batch of them. None of it is thread
+     * safe
+     */
+
+    /* Whether there's a way to write the disk */
+    bool writable() const { return _diskWriteFunc != nullptr; }
+
+    /**
+     * @brief Write sectors straight to the disk
+     * 
+     * @param LBA First sector, from the start of the disk
+     * @param buffer What to write
+     * @param sectors How many
+     * @return true They were written
+     */
+    bool writeSectors(uint64_t LBA, const void* buffer, size_t sectors)
+    {
+        return (*_diskWriteFunc)(LBA,buffer,sectors);
+    }
+
+    /**
+     * @brief Add clusters to the end of a chain, or start one. They come
+     * right after last if that's free, otherwise from the first free run
+     * long enough for all of them, counting from the FSInfo hint, and only
+     * when there's none, from wherever they're free
+     * 
+     * @param last Last cluster of the chain, 0 for a new one. Whatever came
+     * after it is lost, so it should be the end
+     * @param count How many, more than 0
+     * @return uint32_t The first new one, 0 if there aren't that many free
+     * (or out of memory), and then nothing changed
+     */
+    uint32_t allocateClusters(uint32_t last, uint32_t count);
+
+    /**
+     * @brief Free a chain
+     * 
+     * @param cluster First cluster of it
+     */
+    void freeChain(uint32_t cluster);
+
+    /**
+     * @brief Make a cluster the end of its chain, and free what came after
+     * 
+     * @param cluster
+     */
+    void truncateChain(uint32_t cluster);
+
+    /**
+     * @brief Write every sector of the FAT that changed, to every copy of
+     * it, a run of sectors at a time, and then FSInfo
+     * 
+     * @return true Everything got to the disk
+     */
+    bool flush();
+
+    /* Free clusters, once something was allocated or freed. 0 before */
+    uint32_t freeClusters() const { return _freeClusters; }
+
+    /**
+     * @brief Add an entry to a directory, in the first free slot, or in a
+     * new cluster at its end
+     * 
+     * @param directoryCluster First cluster of the directory
+     * @param name FAT style name, not terminated. Made upper case
+     * @param length Length of name
+     * @param attributes fat32_dirEntry_attributes
+     * @param cluster What it points to, 0 for nothing
+     * @param entry Filled with the new entry
+     * @param location Filled with where it is
+     * @return fat32_createResult
+     */
+    fat32_createResult createEntry(uint32_t directoryCluster, const char* name, size_t length,
+                uint8_t attributes, uint32_t cluster, fat32_dirEntry* entry,
+                fat32_entryLocation* location);
+
+    /**
+     * @brief Make a directory, with "." and ".." in it, and its entry in
+     * another one. Same as createEntry() otherwise
+     * 
+     */
+    fat32_createResult createDirectory(uint32_t directoryCluster, const char* name, size_t length,
+                fat32_dirEntry* entry, fat32_entryLocation* location);
+
+    /**
+     * @brief Write a directory entry back where it came from
+     * 
+     * @param location From lookup() or createEntry()
+     * @param entry
+     * @return true It was written
+     */
+    bool writeEntry(const fat32_entryLocation* location, const fat32_dirEntry* entry);
+
+    /**
+     * @brief Mark an entry deleted, and the long name entries before it,
+     * wherever they start. Its clusters are left alone, for whoever still
+     * has the file open
+     * 
+     * @param location From lookup() or createEntry()
+     * @return true It was written
+     */
+    bool removeEntry(const fat32_entryLocation* location);
+
+    /*
+     * Checking, all in fat32Check.cpp. checkBegin(), then checkFAT() over
+     * every cluster, checkTree(), checkLost() over every cluster, and
+     * checkEnd(). The FAT and lost cluster scans can be split in ranges
+     * across workers, which run at the same time. Nothing may write the
+     * volume meanwhile
+     */
+
+    /**
+     * @brief Get a check going
+     * 
+     * @param check Filled in
+     * @return true false if out of memory
+     */
+    bool checkBegin(fat32_check* check) const;
+
+    /**
+     * @brief Check the FAT entries of a range of clusters: where they point,
+     * and that every other copy of the FAT has the same ones
+     * 
+     * @param check From checkBegin()
+     * @param first First cluster, a multiple of FAT32_CHECK_ALIGN (or 0)
+     * @param end Where the range ends, a multiple of FAT32_CHECK_ALIGN or
+     * the end of the clusters
+     * @param scratch FAT32_CHECK_SCRATCH_SECTORS sectors, the worker's own
+     * @param result Added to
+     */
+    void checkFAT(const fat32_check* check, uint32_t first, uint32_t end, void* scratch,
+                fat32_checkResult* result) const;
+
+    /**
+     * @brief Walk the directory tree from the root, following every chain
+     * in it. Once every checkFAT() is done
+     * 
+     * @param check From checkBegin()
+     * @param result Added to
+     * @return true false if out of memory
+     */
+    bool checkTree(const fat32_check* check, fat32_checkResult* result);
+
+    /**
+     * @brief Count the clusters in a range that are in use but no chain
+     * from the tree went through. Once checkTree() is done
+     * 
+     * @param check From checkBegin()
+     * @param first Same as for checkFAT()
+     * @param end Same as for checkFAT()
+     * @param result Added to
+     */
+    void checkLost(const fat32_check* check, uint32_t first, uint32_t end,
+                fat32_checkResult* result) const;
+
+    /**
+     * @brief Free what checkBegin() allocated
+     * 
+     */
+    static void checkEnd(fat32_check* check);
+
+    /**
+     * @brief Add one worker's counters to another's
+     * 
+     */
+    static void addResults(fat32_checkResult* total, const fat32_checkResult* result);
+
+    /**
+     * @brief All of the steps, on this thread
+     * 
+     * @param result Filled in
+     * @return true false if out of memory
+     */
+    bool check(fat32_checkResult* result);
+
     // FIXME This should be done with file descriptors and shit
 
     // FIXME Add destructor
@@ -12,6 +12,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 namespace kernel::acpi
 {
@@ -78,6 +79,10 @@ struct madt_entry_header
     uint8_t         record_length;
 }__attribute__((packed));
 
+/* Flags of a madt_entry_type0 */
+static const uint32_t MADT_LAPIC_ENABLED =          0x1;
+static const uint32_t MADT_LAPIC_ONLINE_CAPABLE =   0x2;
+
 struct madt_entry_type0
 {
     madt_entry_header       header;
@@ -86,6 +91,17 @@ struct madt_entry_type0
     uint32_t                flags;
 }__attribute__((packed));
 
+/* Processor local x2APIC, for APIC IDs that don't fit in a type 0 entry */
+struct madt_entry_type9
+{
+    madt_entry_header       header;
+    uint16_t                reserved;
+    uint32_t                x2apic_id;
+    /* Same as madt_entry_type0 flags */
+    uint32_t                flags;
+    uint32_t                acpi_processor_uid;
+}__attribute__((packed));
+
 struct madt_entry_type1
 {
     madt_entry_header       header;
@@ -95,6 +111,22 @@ struct madt_entry_type1
     uint32_t                global_system_interrupt_base;
 }__attribute__((packed));
 
+/* Flags of a madt_entry_type2 */
+static const uint16_t MADT_POLARITY_MASK =          0x3;
+static const uint16_t MADT_POLARITY_ACTIVE_LOW =    0x3;
+static const uint16_t MADT_TRIGGER_MASK =           0xC;
+static const uint16_t MADT_TRIGGER_LEVEL =          0xC;
+
+/* Interrupt source override, for an ISA IRQ that isn't on the GSI of its number */
+struct madt_entry_type2
+{
+    madt_entry_header       header;
+    uint8_t                 bus_source;
+    uint8_t                 irq_source;
+    uint32_t                global_system_interrupt;
+    uint16_t                flags;
+}__attribute__((packed));
+
 class acpi_header
 {
 private:
@@ -123,7 +155,22 @@ public:
 //public:
     acpi_madt(acpi_header*);
 
-    void* getEntry(int type);
+    /**
+     * @brief Get the index-th MADT entry of a given type
+     * 
+     * @param type Entry type to look for
+     * @param index Which of the entries of that type to return (0 is the first)
+     * @return void* Pointer to the entry, nullptr if there is no such entry
+     */
+    void* getEntry(int type, size_t index = 0);
+
+    /**
+     * @brief Count the MADT entries of a given type
+     * 
+     * @param type Entry type to count
+     * @return size_t Number of entries of that type
+     */
+    size_t getEntryCount(int type);
 
     //size_t getNumberInputs();
 };
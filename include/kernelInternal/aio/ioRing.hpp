@@ -0,0 +1,141 @@
+/**
+ * @file ioRing.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Asynchronous I/O through submission and completion rings in memory
+ * a process shares with the kernel (layout in sys/ioring.h). A batch of
+ * operations costs one system call, or none with a polling thread
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/sched/waitQueue.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <sys/ioring.h>
+
+namespace kernel::proc { struct process; }
+
+namespace kernel::aio
+{
+
+/* How long the polling thread keeps looking at an empty ring before it goes
+   to sleep */
+static const uint64_t SQPOLL_IDLE_NS =      2000000;
+
+/*
+ * Operations run one after the other, in submission order, on whoever takes
+ * them off the ring: the thread entering it, or the polling thread. One that
+ * has to wait (a read of an empty pipe, a poll) holds up the ones behind it.
+ * Buffers are in the process' address space, and are checked like system
+ * call arguments
+ */
+
+class ioRing
+{
+private:
+    uint32_t _references;
+
+    /* The shared pages. The kernel goes at them through the direct map */
+    mm::memoryObject* _memory;
+    uint32_t _address;
+    uint32_t _sqEntries;
+    uint32_t _cqEntries;
+
+    /* IORING_SETUP_* */
+    uint32_t _flags;
+
+    /* The kernel's own copies of the indices it moves, the shared ones are
+       only published to */
+    volatile uint32_t _sqHead;
+    uint32_t _cqTail;
+
+    /* Set while a thread is taking submissions, without a polling thread */
+    volatile uint32_t _submitting;
+
+    /* Set from taking a submission until its completion is posted */
+    volatile uint32_t _executing;
+
+    /* Covers _cqTail and _completionWait */
+    kernel::sync::spinlock _completionLock;
+    sched::waitQueue _completionWait;
+
+    /* Whose descriptors and address space operations use */
+    proc::process* _owner;
+    mm::addressSpace* _space;
+
+    /* Polling thread, nullptr once it's gone. _pollerLock keeps it from
+       going while someone wakes it */
+    sched::thread* _poller;
+    kernel::sync::spinlock _pollerLock;
+    volatile bool _stopping;
+    sched::thread* _stopper;
+    volatile uint32_t _pollerState;
+
+    ioRing();
+    io_ring_header* header() const;
+    void* at(uint32_t offset) const;
+    uint32_t completionRoom() const;
+    bool canSubmit() const;
+    size_t submit(size_t limit);
+    int32_t execute(const io_sqe* sqe);
+    void complete(uint64_t userData, int32_t result);
+    void waitCompletions(uint32_t count);
+    static void pollerThread(void* arg);
+public:
+    /**
+     * @brief Create a ring, map it into the current process, and give it a
+     * descriptor there
+     * 
+     * @param params What to set up, filled in with what was (see
+     * sys/ioring.h)
+     * @return int32_t The descriptor, or a negative error
+     */
+    static int32_t setup(io_ring_params* params);
+
+    /**
+     * @brief Take a reference
+     * 
+     */
+    void get() { __atomic_fetch_add(&_references,1,__ATOMIC_RELAXED); }
+
+    /**
+     * @brief Drop a reference. The last one frees the ring
+     * 
+     */
+    void put();
+
+    /**
+     * @brief Stop the polling thread, if there's one, and wait for it to be
+     * done with the process. Called when the descriptor is closed
+     * 
+     */
+    void shutdown();
+
+    /**
+     * @brief Take submissions, and wait for completions
+     * 
+     * @param toSubmit Submissions to take at most. Ignored with a polling
+     * thread, which takes them by itself
+     * @param minComplete With IORING_ENTER_GETEVENTS, wait until there are
+     * this many completions to consume, or nothing left in flight
+     * @param flags IORING_ENTER_*
+     * @return int32_t Submissions taken (with a polling thread, toSubmit), or
+     * a negative error
+     */
+    int32_t enter(uint32_t toSubmit, uint32_t minComplete, uint32_t flags);
+};
+
+/**
+ * @brief Register the ring system calls. Needs syscall::init()
+ * 
+ */
+void init();
+
+} // namespace kernel::aio
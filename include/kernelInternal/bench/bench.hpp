@@ -0,0 +1,126 @@
+/**
+ * @file bench.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief In-kernel benchmarks, run at boot when built with KERNEL_BENCHMARKS
+ * @version 0.1
+ * @date 2025-03-08
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <kernelInternal/sched/scheduler.hpp>
+
+namespace kernel::bench
+{
+
+/**
+ * @brief Threads a benchmark started, and waits for. Lives on the waiting
+ * thread's stack
+ * 
+ */
+struct threadGroup
+{
+    sched::thread*      waiter;
+    uint32_t            threads;
+    volatile uint32_t   finished;
+};
+
+/**
+ * @brief Set a group up for the current thread to wait on
+ * 
+ * @param group
+ * @param threads How many it'll wait for. Can be counted up until the
+ * first one leaves
+ */
+static inline void initGroup(threadGroup* group, uint32_t threads)
+{
+    group->waiter = sched::currentThread();
+    group->threads = threads;
+    group->finished = 0;
+}
+
+/**
+ * @brief Count a thread of the group as done. The last thing it does with
+ * the group, or anything else on the waiter's stack
+ * 
+ * @param group
+ */
+static inline void leaveGroup(threadGroup* group)
+{
+    // The group can be gone as soon as the last one is counted
+    sched::thread* waiter = group->waiter;
+    const uint32_t threads = group->threads;
+    if (__atomic_add_fetch(&group->finished,1,__ATOMIC_ACQ_REL) == threads)
+        sched::wake(waiter);
+}
+
+/**
+ * @brief Wait until every thread of the group left it
+ * 
+ * @param group
+ */
+static inline void joinGroup(threadGroup* group)
+{
+    while (__atomic_load_n(&group->finished,__ATOMIC_ACQUIRE) != group->threads)
+        sched::block();
+}
+
+/**
+ * @brief Context switch latency (ping-pong between two threads, on the same
+ * processor and across processors) and yield throughput with many threads.
+ * Must run in a thread, after sched::init() and smp::startAPs()
+ * 
+ */
+void runSchedulerBenchmarks();
+
+/**
+ * @brief Ticket and MCS spinlocks under contention from 1 to N processors
+ * (run QEMU with -smp N). Same requirements as runSchedulerBenchmarks()
+ * 
+ */
+void runSyncBenchmarks();
+
+/**
+ * @brief Null system call round trip from ring 3, through SYSENTER and
+ * int 0x80. Same requirements as runSchedulerBenchmarks(), plus syscall::init()
+ * 
+ */
+void runSyscallBenchmarks();
+
+/**
+ * @brief Pipe throughput with copies and with page remapping, for a few
+ * message sizes. Same requirements as runSchedulerBenchmarks(), plus mm::init()
+ * 
+ */
+void runIPCBenchmarks();
+
+/**
+ * @brief Futex mutex: uncontended lock/unlock, and how long a sleeping waiter
+ * takes to get it after an unlock, on the same processor and across. Same
+ * requirements as runIPCBenchmarks()
+ * 
+ */
+void runFutexBenchmarks();
+
+/**
+ * @brief 4 KiB reads of the disk, warm in the buffer cache: one at a time,
+ * through an I/O ring in batches, and through a ring with a polling thread.
+ * Same requirements as runIPCBenchmarks(), plus proc::init()
+ * 
+ */
+void runIORingBenchmarks();
+
+/**
+ * @brief Path walks, the first time and from the dentry cache, for names
+ * that are there and names that aren't, and the cache's hit rate. Then a
+ * file read from the disk and from the page cache. Same requirements as
+ * runIORingBenchmarks(), plus vfs::init()
+ * 
+ */
+void runVFSBenchmarks();
+
+} // namespace kernel::bench
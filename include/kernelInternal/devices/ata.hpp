@@ -0,0 +1,61 @@
+/**
+ * @file ata.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief ATA disk driver, PIO mode, primary master only. Polls, no interrupts
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace kernel::ata
+{
+
+static const size_t SECTOR_SIZE =           512;
+
+/**
+ * @brief Look for the primary master, identify it, and register it with the
+ * block layer as "ata0"
+ * 
+ * @return true There's an ATA disk there
+ * @return false There isn't, or it's something else (ATAPI, ...)
+ */
+bool init();
+
+/**
+ * @brief Size of the disk
+ * 
+ * @return uint64_t Number of sectors, 0 before init() found the disk
+ */
+uint64_t sectorCount();
+
+/**
+ * @brief Read sectors from the disk. Same signature as the fat32 disk read
+ * callback
+ * 
+ * @param lba First sector
+ * @param buffer Where to read to, SECTOR_SIZE * sectors bytes
+ * @param sectors Number of sectors
+ * @return int Nonzero on success, 0 on error or if the range is past the end
+ * of the disk
+ */
+int readSectors(uint64_t lba, void* buffer, size_t sectors);
+
+/**
+ * @brief Write sectors to the disk, and flush its write cache
+ * 
+ * @param lba First sector
+ * @param buffer What to write, SECTOR_SIZE * sectors bytes
+ * @param sectors Number of sectors
+ * @return int Nonzero on success, 0 on error or if the range is past the end
+ * of the disk
+ */
+int writeSectors(uint64_t lba, const void* buffer, size_t sectors);
+
+} // namespace kernel::ata
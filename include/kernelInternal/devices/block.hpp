@@ -0,0 +1,65 @@
+/**
+ * @file block.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Block devices. Drivers register what they found here, and everything
+ * above them (the buffer cache, descriptors) goes by name
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace kernel::block
+{
+
+/* Devices that can be registered */
+static const size_t MAX_BLOCK_DEVICES =     8;
+
+/* Longest device name, without the terminator */
+static const size_t DEVICE_NAME_LENGTH =    7;
+
+/**
+ * @brief A disk, or anything that reads and writes whole sectors
+ * 
+ */
+struct blockDevice
+{
+    char                name[DEVICE_NAME_LENGTH + 1];
+    uint32_t            sectorSize;
+    uint64_t            sectorCount;
+
+    /* Nonzero on success, like ata::readSectors */
+    int                 (*read)(uint64_t lba, void* buffer, size_t sectors);
+    int                 (*write)(uint64_t lba, const void* buffer, size_t sectors);
+
+    /* Make what was written stick, nullptr if writes already do. True on
+       success */
+    bool                (*flush)();
+};
+
+/**
+ * @brief Add a device
+ * 
+ * @param device Must stay around forever. Its sector size must divide the
+ * page size
+ * @return true It was added
+ * @return false The table is full, the name is taken, or the device is
+ * malformed
+ */
+bool registerDevice(const blockDevice* device);
+
+/**
+ * @brief Find a device by name
+ * 
+ * @param name Name ("ata0", ...)
+ * @return const blockDevice* nullptr if there's none
+ */
+const blockDevice* findDevice(const char* name);
+
+} // namespace kernel::block
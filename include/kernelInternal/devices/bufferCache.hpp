@@ -0,0 +1,117 @@
+/**
+ * @file bufferCache.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Cache of block device contents, a page at a time. Reads fill it,
+ * writes stay in it until they're synced or their buffer is reused
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/devices/block.hpp>
+
+namespace kernel::block
+{
+
+/* Bytes per buffer. Each one caches this much of a device, aligned */
+static const size_t BLOCK_SIZE =            4096;
+
+/* Buffers in the cache */
+static const size_t CACHE_BUFFERS =         256;
+
+struct buffer;
+
+/**
+ * @brief Cache counters
+ * 
+ */
+struct cacheStats
+{
+    /* Lookups that found the block */
+    uint64_t            hits;
+
+    /* Lookups that had to read it */
+    uint64_t            misses;
+
+    /* Dirty buffers written back */
+    uint64_t            writebacks;
+};
+
+/**
+ * @brief Get a block, reading it if it isn't cached. Sleeps
+ * 
+ * @param device Device
+ * @param block Block number, in BLOCK_SIZE units. Whatever of it is past the
+ * end of the device reads as zeroes
+ * @return buffer* With a reference for the caller, nullptr on a read error
+ * or if every buffer is in use
+ */
+buffer* getBuffer(const blockDevice* device, uint64_t block);
+
+/**
+ * @brief Contents of a buffer, BLOCK_SIZE bytes
+ * 
+ * @param b Buffer the caller has a reference on
+ * @return uint8_t* 
+ */
+uint8_t* bufferData(buffer* b);
+
+/**
+ * @brief Say a buffer was written to, so it gets written back
+ * 
+ * @param b Buffer the caller has a reference on
+ */
+void markDirty(buffer* b);
+
+/**
+ * @brief Drop a reference from getBuffer()
+ * 
+ * @param b Buffer
+ */
+void putBuffer(buffer* b);
+
+/**
+ * @brief Read bytes from a device, through the cache
+ * 
+ * @param device Device
+ * @param offset Byte offset
+ * @param destination Where to, kernel or current user memory
+ * @param length Bytes
+ * @return int32_t Bytes read (short at the end of the device), or -EIO
+ */
+int32_t readDevice(const blockDevice* device, uint64_t offset, void* destination, size_t length);
+
+/**
+ * @brief Write bytes to a device, through the cache. They reach the device
+ * on syncDevice(), or when their buffer gets reused
+ * 
+ * @param device Device
+ * @param offset Byte offset
+ * @param source What to write, kernel or current user memory
+ * @param length Bytes
+ * @return int32_t Bytes written (short at the end of the device), or -EIO
+ */
+int32_t writeDevice(const blockDevice* device, uint64_t offset, const void* source, size_t length);
+
+/**
+ * @brief Write back every dirty buffer of a device, and flush it. Sleeps
+ * 
+ * @param device Device
+ * @return int32_t 0, or -EIO
+ */
+int32_t syncDevice(const blockDevice* device);
+
+/**
+ * @brief Get the cache counters
+ * 
+ * @return cacheStats 
+ */
+cacheStats getCacheStats();
+
+} // namespace kernel::block
@@ -14,6 +14,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <kernelInternal/acpi.hpp>
+#include <kernelInternal/devices/cpu/msr.hpp>
 
 namespace kernel::cpu
 {
@@ -76,7 +77,8 @@ namespace kernel::cpu
         INTERRUPT_REQUEST = 0x200, // Range 0x200 - 0x270
         ERROR_STATUS = 0x280,
         LVT_CMCI = 0x2F0,
-        INTERRUPT_COMMAND = 0x300, // Range 0x300 - 0x310
+        INTERRUPT_COMMAND = 0x300, // Range 0x300 - 0x310 (one 64-bit MSR on x2APIC)
+        INTERRUPT_COMMAND_HIGH = 0x310, // Not there on x2APIC
         LVT_TIMER = 0x320,
         LVT_THERMAL_SENSOR = 0x330,
         LVT_PERF_MONITORING = 0x340,
@@ -85,7 +87,8 @@ namespace kernel::cpu
         LVT_ERROR = 0x370,
         INITIAL_COUNT = 0x380,
         CURRENT_COUNT = 0x390,
-        DIVIDE_CONFIGURATION = 0x3E0
+        DIVIDE_CONFIGURATION = 0x3E0,
+        SELF_IPI = 0x3F0 // x2APIC only
     };
 
     enum class ioapic_register_offset : uint32_t
@@ -106,20 +109,197 @@ namespace kernel::cpu
     {
     private:
         kernel::acpi::madt_entry_type1* _ptr;
+        kernel::acpi::acpi_madt* _madt;
     public:
         io_apic(kernel::acpi::acpi_madt* ptr);
         uint32_t read(ioapic_mm_register reg);
         void write(ioapic_mm_register reg, uint32_t value);
+
+        /**
+         * @brief Deliver an ISA IRQ to a processor, as a fixed interrupt.
+         * Follows the MADT's source overrides for where the IRQ is, and its
+         * polarity and trigger mode
+         * 
+         * @param irq ISA IRQ number
+         * @param vector Vector to raise
+         * @param apicID APIC ID of the processor that gets it
+         * @return true If the IRQ is on this IO APIC, and now unmasked
+         */
+        bool routeIRQ(uint8_t irq, uint8_t vector, uint32_t apicID);
     };
+
+    // IO APIC redirection entry fields
+    static const uint32_t IOREDTBL_FIRST =          0x10; // Two registers per entry
+    static const uint32_t IOREDTBL_ACTIVE_LOW =     1 << 13;
+    static const uint32_t IOREDTBL_TRIGGER_LEVEL =  1 << 15;
+    static const uint32_t IOREDTBL_MASKED =         1 << 16;
+    static const uint32_t IOREDTBL_DEST_SHIFT =     24;
     
+    // Interrupt Command Register fields
+    static const uint32_t ICR_DELIVERY_FIXED =      0x000;
+    static const uint32_t ICR_DELIVERY_INIT =       0x500;
+    static const uint32_t ICR_DELIVERY_STARTUP =    0x600;
+    static const uint32_t ICR_DELIVERY_PENDING =    1 << 12;
+    static const uint32_t ICR_LEVEL_ASSERT =        1 << 14;
+    static const uint32_t ICR_TRIGGER_LEVEL =       1 << 15;
+    static const uint32_t ICR_DEST_SELF =           1 << 18;
+    static const uint32_t ICR_DEST_ALL =            2 << 18;
+    static const uint32_t ICR_DEST_ALL_BUT_SELF =   3 << 18;
+
+    // LVT timer fields
+    static const uint32_t LVT_TIMER_PERIODIC =      1 << 17;
+    static const uint32_t LVT_MASKED =              1 << 16;
+    static const uint32_t TIMER_DIVIDE_BY_16 =      0x3;
+
     class l_apic
     {
     private:
-        lapic_base_register* _reg;
+        /* MMIO registers, only used in xAPIC mode */
+        uint32_t volatile* _base;
+
+        /* In x2APIC mode, registers are MSRs (X2APIC_MSR_BASE + offset >> 4) */
+        bool _x2apic;
+
+        /**
+         * @brief Wait for the previous IPI to be accepted by its target
+         * 
+         */
+        void waitICRIdle();
+
+        /**
+         * @brief Write an IPI command to the Interrupt Command Register
+         * 
+         * @param apicID Destination APIC ID
+         * @param command Low dword of the ICR (vector, delivery mode, etc)
+         */
+        void writeICR(uint32_t apicID, uint32_t command);
     public:
         l_apic();
+
+        /**
+         * @brief Enable the local APIC of the processor running this, in
+         * x2APIC mode if the processor supports it
+         * 
+         */
         void enable();
+
+        /**
+         * @brief Whether registers are accessed through MSRs (x2APIC)
+         * 
+         */
+        bool isX2APIC() { return _x2apic; }
+
+        /**
+         * @brief Read a LAPIC register
+         * 
+         * @param reg Register to read
+         * @return uint32_t Value of the register
+         */
+        uint32_t read(lapic_registers reg)
+        {
+            if (_x2apic)
+            {
+                uint32_t low,high;
+                getMSR(X2APIC_MSR_BASE + (static_cast<uint32_t>(reg) >> 4),&low,&high);
+                return low;
+            }
+            return _base[static_cast<uint32_t>(reg) / 4];
+        }
+
+        /**
+         * @brief Write to a LAPIC register
+         * 
+         * @param reg Register to write
+         * @param value Value to write
+         */
+        void write(lapic_registers reg, uint32_t value)
+        {
+            if (_x2apic)
+                setMSR(X2APIC_MSR_BASE + (static_cast<uint32_t>(reg) >> 4),value,0);
+            else
+                _base[static_cast<uint32_t>(reg) / 4] = value;
+        }
+
+        /**
+         * @brief Get the APIC ID of the processor running this code
+         * 
+         * @return uint32_t APIC ID (32 bits in x2APIC mode, 8 otherwise)
+         */
+        uint32_t id()
+        {
+            const uint32_t value = read(lapic_registers::LAPIC_ID);
+            return _x2apic ? value : value >> 24;
+        }
+
+        /**
+         * @brief Signal the end of an interrupt
+         * 
+         */
+        void eoi() { write(lapic_registers::EOI, 0); }
+
+        /**
+         * @brief Send an INIT IPI (assert, then de-assert) to a processor
+         * 
+         * @param apicID APIC ID of the target processor
+         */
+        void sendInitIPI(uint32_t apicID);
+
+        /**
+         * @brief Send a Startup IPI to a processor
+         * 
+         * @param apicID APIC ID of the target processor
+         * @param vector Page number (below 1 MiB) where the processor starts
+         * executing in real mode
+         */
+        void sendStartupIPI(uint32_t apicID, uint8_t vector);
+
+        /**
+         * @brief Send a fixed interrupt to one processor
+         * 
+         * @param apicID APIC ID of the target processor
+         * @param vector Interrupt vector to raise on the target
+         */
+        void sendIPI(uint32_t apicID, uint8_t vector);
+
+        /**
+         * @brief Send a fixed interrupt to every processor with a single ICR
+         * write (destination shorthand)
+         * 
+         * @param vector Interrupt vector to raise
+         * @param includeSelf Whether the sender also gets it
+         */
+        void broadcastIPI(uint8_t vector, bool includeSelf);
+
+        /**
+         * @brief Start the local APIC timer (input clock divided by 16)
+         * 
+         * @param vector Vector the timer raises
+         * @param initialCount Count to start from
+         * @param periodic Reload when it reaches zero, or fire once
+         */
+        void startTimer(uint8_t vector, uint32_t initialCount, bool periodic);
+
+        /**
+         * @brief Stop and mask the local APIC timer
+         * 
+         */
+        void stopTimer();
+
+        /**
+         * @brief Get the current count of the timer
+         * 
+         * @return uint32_t 
+         */
+        uint32_t timerCount() { return read(lapic_registers::CURRENT_COUNT); }
     };
+
+    /**
+     * @brief Get the local APIC object that was last enabled (every processor
+     * has its registers at the same address, so one object serves them all)
+     * 
+     * @return l_apic* nullptr if no local APIC was enabled yet
+     */
+    l_apic* getLocalAPIC();
     
     // TODO change lapic to class
     /**
@@ -129,6 +309,14 @@ namespace kernel::cpu
      * @return false If it's not present
      */
     bool checkApic(void);
+
+    /**
+     * @brief Checks if the APIC supports x2APIC mode
+     * 
+     * @return true If it does
+     * @return false If it doesn't
+     */
+    bool checkX2Apic(void);
     
 } // namespace kernel::cpu
 
@@ -17,8 +17,17 @@ namespace kernel::cpu
 {
     static const int IA32_APIC_BASE_MSR =       0x1b;
     static const int IA32_APIC_BASE_MSR_BPS =   0x100; // Processor is bootstrap
+    static const int IA32_APIC_BASE_MSR_X2APIC =0x400; // x2APIC mode
     static const int IA32_APIC_BASE_MSR_ENABLE =0x800;
 
+    // First MSR of the x2APIC register space (xAPIC offset >> 4 is added)
+    static const uint32_t X2APIC_MSR_BASE =     0x800;
+
+    // SYSENTER targets. SS is CS + 8, and SYSEXIT uses CS + 16 and CS + 24
+    static const uint32_t IA32_SYSENTER_CS =    0x174;
+    static const uint32_t IA32_SYSENTER_ESP =   0x175;
+    static const uint32_t IA32_SYSENTER_EIP =   0x176;
+
     /**
      * @brief Check if MSR is there (using CPUID)
      * 
@@ -28,6 +37,8 @@ namespace kernel::cpu
     bool checkMSR();
 
     //TODO Maybe change low and high to only one, combine in function?
+    // These are inline, since x2APIC register accesses (EOI, IPIs) go
+    // through them
     /**
      * @brief Get the MSR
      * 
@@ -35,7 +46,14 @@ namespace kernel::cpu
      * @param low Low part
      * @param high High part
      */
-    void getMSR(uint32_t msr, uint32_t *low, uint32_t *high);
+    inline void getMSR(uint32_t msr, uint32_t *low, uint32_t *high)
+    {
+        __asm__ volatile(
+            "rdmsr"
+            : "=a"(*low), "=d"(*high)
+            : "c"(msr)
+        );
+    }
 
     /**
      * @brief Set the MSR
@@ -44,5 +62,12 @@ namespace kernel::cpu
      * @param low Low part
      * @param high High part
      */
-    void setMSR(uint32_t msr, uint32_t low, uint32_t high);
+    inline void setMSR(uint32_t msr, uint32_t low, uint32_t high)
+    {
+        __asm__ volatile(
+            "wrmsr"
+            : : "a"(low), "d"(high), "c"(msr)
+            : "memory"
+        );
+    }
 } // namespace kernel::cpu
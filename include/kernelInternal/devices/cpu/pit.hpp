@@ -0,0 +1,40 @@
+/**
+ * @file pit.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions for the legacy PIT (8253/8254), only used for delays and
+ * calibration
+ * @version 0.1
+ * @date 2025-03-02
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace kernel::cpu
+{
+    // Ports
+    static const uint8_t PIT_CHANNEL2_DATA =    0x42;
+    static const uint8_t PIT_COMMAND =          0x43;
+    static const uint8_t PIT_CHANNEL2_GATE =    0x61; // Keyboard controller port B
+
+    // Channel 2, lobyte/hibyte, mode 0 (interrupt on terminal count)
+    static const uint8_t PIT_CH2_ONESHOT =      0xb0;
+
+    static const uint8_t PIT_GATE_BIT =         0x01;
+    static const uint8_t PIT_SPEAKER_BIT =      0x02;
+    static const uint8_t PIT_OUT2_BIT =         0x20;
+
+    /* Input frequency of the PIT, in Hz */
+    static const uint32_t PIT_FREQUENCY =       1193182;
+
+    /**
+     * @brief Busy wait using PIT channel 2 (doesn't need interrupts)
+     * 
+     * @param microseconds Time to wait
+     */
+    void pitBusyWait(uint32_t microseconds);
+} // namespace kernel::cpu
@@ -0,0 +1,47 @@
+/**
+ * @file serial.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief The kernel's serial console on COM1, which mirrors out. Polled until
+ * the IO APIC routes its interrupt, then interrupt driven
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <devices/serial.hpp>
+#include <kernelInternal/devices/cpu/apic.hpp>
+
+namespace kernel::serial
+{
+
+/**
+ * @brief Set COM1 up, and have out write to it as well as to the screen
+ * 
+ * @return true There's a UART there
+ */
+bool init();
+
+/**
+ * @brief Route COM1's interrupt to a processor, and queue output from then on.
+ * After the IDT is up
+ * 
+ * @param ioAPIC IO APIC with the ISA interrupts
+ * @param apicID Processor that handles it
+ * @return true Output is interrupt driven now
+ */
+bool startInterrupts(cpu::io_apic* ioAPIC, uint32_t apicID);
+
+/**
+ * @brief The UART, for whatever else wants to write to it
+ * 
+ * @return io::serial_port* nullptr if init() didn't find one
+ */
+io::serial_port* port();
+
+} // namespace kernel::serial
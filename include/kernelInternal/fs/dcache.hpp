@@ -0,0 +1,72 @@
+/**
+ * @file dcache.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Dentry cache: what a name in a directory turned out to be, the vnode
+ * or that it isn't there, so walking a path seldom asks the filesystem
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/fs/vfs.hpp>
+
+namespace kernel::vfs
+{
+
+/* Entries in the cache. When it's full, a clock hand picks which goes */
+static const size_t DCACHE_ENTRIES =        256;
+
+/* Longer names are always looked up in the filesystem */
+static const size_t DENTRY_NAME_LENGTH =    27;
+
+enum class dentryResult : uint8_t
+{
+    /* Nothing cached, ask the filesystem */
+    MISS,
+
+    /* It's there */
+    FOUND,
+
+    /* It isn't there */
+    NOT_FOUND
+};
+
+/**
+ * @brief Look a name up in the cache
+ * 
+ * @param directory
+ * @param name Not terminated
+ * @param length
+ * @param result Set to the vnode, with a reference, if it's FOUND
+ * @return dentryResult
+ */
+dentryResult dcacheLookup(vnode* directory, const char* name, size_t length, vnode** result);
+
+/**
+ * @brief Remember what a name is, replacing whatever was cached for it
+ * 
+ * @param directory
+ * @param name Not terminated
+ * @param length
+ * @param node What it is, nullptr if it isn't there. The cache takes its own
+ * references
+ */
+void dcacheInsert(vnode* directory, const char* name, size_t length, vnode* node);
+
+/**
+ * @brief Forget a name, for filesystems that change it behind the cache's
+ * back
+ * 
+ * @param directory
+ * @param name Not terminated
+ * @param length
+ */
+void dcacheInvalidate(vnode* directory, const char* name, size_t length);
+
+} // namespace kernel::vfs
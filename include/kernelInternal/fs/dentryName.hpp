@@ -0,0 +1,85 @@
+/**
+ * @file dentryName.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief How the dentry cache tells names apart: byte for byte, or with the
+ * case of ASCII letters folded on filesystems that ignore case. Nothing in
+ * here needs the rest of the kernel, so the host tests check it against
+ * fs::fat32
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <klib/string.h>
+
+namespace kernel::vfs
+{
+
+static inline char foldDentryCase(char c)
+{
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+/**
+ * @brief Whether the cache can hold a name. On filesystems that ignore case,
+ * only ASCII ones: FAT32 folds Latin-1 in long names too, which this doesn't
+ * 
+ * @param name Not terminated
+ * @param length
+ * @param caseInsensitive The filesystem's
+ */
+static inline bool dentryNameCacheable(const char* name, size_t length, bool caseInsensitive)
+{
+    if (!caseInsensitive)
+        return true;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (static_cast<uint8_t>(name[i]) >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief FNV-1a of a name, folded if the filesystem ignores case
+ * 
+ * @param seed Mixed in first, the directory for the cache
+ * @param name Not terminated
+ * @param length
+ * @param fold
+ * @return uint32_t
+ */
+static inline uint32_t hashDentryName(uint32_t seed, const char* name, size_t length, bool fold)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= static_cast<uint8_t>(fold ? foldDentryCase(name[i]) : name[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Whether two names of the same length are the same one
+ * 
+ */
+static inline bool sameDentryName(const char* a, const char* b, size_t length, bool fold)
+{
+    if (!fold)
+        return memcmp(a,b,length) == 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (foldDentryCase(a[i]) != foldDentryCase(b[i]))
+            return false;
+    }
+    return true;
+}
+
+} // namespace kernel::vfs
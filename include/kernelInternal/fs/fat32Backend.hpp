@@ -0,0 +1,43 @@
+/**
+ * @file fat32Backend.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief FAT32 volumes, through fs::fat32, as a filesystem for the vfs.
+ * Files can be made, written, cut short and unlinked; their clusters are
+ * only allocated on writeback
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/fs/vfs.hpp>
+
+namespace kernel::vfs
+{
+
+/**
+ * @brief Open a FAT32 volume, to mount somewhere
+ * 
+ * @param diskRead Reads sectors of the disk it's on
+ * @param diskWrite Writes them, nullptr to mount it read-only
+ * @param partitionLBA First sector of the partition
+ * @return filesystem* nullptr if it can't be read, or out of memory
+ */
+filesystem* openFAT32(int (*diskRead)(uint64_t LBA, void* buffer, size_t sectors),
+            int (*diskWrite)(uint64_t LBA, const void* buffer, size_t sectors), uint32_t partitionLBA);
+
+/**
+ * @brief Check a volume openFAT32() gave, before it's mounted: nothing else
+ * may be using it. The FAT is gone over by a thread on each processor, and
+ * what's wrong is said on the console. Nothing is repaired
+ * 
+ * @return true Nothing was wrong
+ */
+bool checkFAT32(filesystem* volume);
+
+} // namespace kernel::vfs
@@ -0,0 +1,174 @@
+/**
+ * @file pageCache.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Page cache: the contents of files, a page frame per page, kept per
+ * vnode by offset. read() copies out of it, mmap() maps its frames straight
+ * into processes, and a clock goes round the pages that can be read back to
+ * give frames back when the frame allocator runs low. Written pages stay
+ * dirty until writeback sends them, a file at a time, to filesystems that
+ * take them
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/fs/vfs.hpp>
+
+namespace kernel::vfs
+{
+
+/* Flags in vnode::pages. Used since the clock hand last went by */
+static const uint32_t PAGE_REFERENCED =     0x1;
+
+/* Newer than where the file lives, or the only copy there is, so it can't
+   be reclaimed until it's written back (never, without writepage) */
+static const uint32_t PAGE_DIRTY =          0x2;
+
+/* Pages read on a miss: the one that missed and the ones after it that
+   aren't cached, if the file goes that far */
+static const size_t READAHEAD_PAGES =       8;
+
+/* Reclaim starts when less than this fraction of all frames is free, and
+   stops at twice as much */
+static const size_t RECLAIM_LOW_DIVISOR =   32;
+
+/* Dirty pages waiting for writeback before the writeback thread is woken */
+static const uint32_t WRITEBACK_PAGES =     256;
+
+/**
+ * @brief Page cache counters, over every processor
+ * 
+ */
+struct pageCacheStats
+{
+    /* Pages found in the cache */
+    uint32_t            hits;
+
+    /* Pages that had to be read */
+    uint32_t            misses;
+
+    /* Pages read along with a miss */
+    uint32_t            readahead;
+
+    /* Pages given back to the frame allocator */
+    uint32_t            reclaimed;
+
+    /* Pages written back */
+    uint32_t            written;
+
+    /* Pages waiting to be */
+    uint32_t            dirty;
+};
+
+/**
+ * @brief Frame of a page, if it's cached. Never sleeps or reads anything
+ * 
+ * @param node File
+ * @param index Page of the file
+ * @return uint32_t With a reference for the caller, 0 if it isn't cached
+ */
+uint32_t findPage(vnode* node, uint32_t index);
+
+/**
+ * @brief Frame of a page, reading it and the ones after it in if it isn't
+ * cached
+ * 
+ * @param node File
+ * @param index Page of the file, before its end
+ * @param error Set on failure to -EINVAL past the end, -EIO or -ENOMEM
+ * @return uint32_t With a reference for the caller, 0 on failure
+ */
+uint32_t getPage(vnode* node, uint32_t index, int32_t* error);
+
+/**
+ * @brief Read a file through the cache
+ * 
+ * @param node File
+ * @param offset Where from
+ * @param buffer Kernel memory, or user memory of the current thread,
+ * already checked
+ * @param length Bytes, at most INT32_MAX
+ * @return int32_t Bytes read, 0 at the end, or -EIO, -ENOMEM
+ */
+int32_t readPages(vnode* node, uint64_t offset, void* buffer, size_t length);
+
+/**
+ * @brief Write a file through the cache, growing it if needed
+ * 
+ * @param node File
+ * @param offset Where to
+ * @param buffer Same as for readPages()
+ * @param length Bytes, at most INT32_MAX
+ * @return int32_t Bytes written, or -EFBIG, -EIO, -ENOMEM
+ */
+int32_t writePages(vnode* node, uint64_t offset, const void* buffer, size_t length);
+
+/**
+ * @brief Make a file a size: the cached pages past it go, the part of the
+ * last one past it is zeroed, and writeback tells the filesystem
+ * 
+ * @param node File
+ * @param size In bytes
+ */
+void truncatePages(vnode* node, uint32_t size);
+
+/**
+ * @brief Write back a file's dirty pages, and its size first, now
+ * 
+ * @param node File
+ * @return int32_t 0, or the first error from the filesystem. What didn't
+ * make it stays dirty
+ */
+int32_t writebackPages(vnode* node);
+
+/**
+ * @brief Write back every file with dirty pages
+ * 
+ */
+void writebackAll();
+
+/**
+ * @brief An object whose pages are the file's cached ones, for fileObject()
+ * 
+ * @param node File. The object keeps a reference on it
+ * @return mm::memoryObject* With a reference, nullptr if out of memory
+ */
+mm::memoryObject* cacheObject(vnode* node);
+
+/**
+ * @brief Throw every page of a vnode away. Its last reference is gone
+ * 
+ * @param node Vnode
+ */
+void dropPages(vnode* node);
+
+/**
+ * @brief Go round the clock, giving back pages nobody used since the last
+ * time round, that aren't mapped anywhere and can be read again
+ * 
+ * @param target How many to give back
+ * @return size_t How many were given back
+ */
+size_t reclaimPages(size_t target);
+
+/**
+ * @brief Get the counters
+ * 
+ * @return pageCacheStats
+ */
+pageCacheStats getPageCacheStats();
+
+/**
+ * @brief Start the reclaim and writeback threads, and have the frame
+ * allocator wake the first. Needs the scheduler
+ * 
+ */
+void initPageCache();
+
+} // namespace kernel::vfs
@@ -0,0 +1,30 @@
+/**
+ * @file ramfs.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Filesystem that only lives in memory: directories are lists of
+ * names, files are whatever the page cache holds for them. The root
+ * filesystem, and /tmp
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/fs/vfs.hpp>
+
+namespace kernel::vfs
+{
+
+/**
+ * @brief Make an empty RAM filesystem, to mount somewhere
+ * 
+ * @return filesystem* nullptr if out of memory
+ */
+filesystem* createRamfs();
+
+} // namespace kernel::vfs
@@ -0,0 +1,430 @@
+/**
+ * @file vfs.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Virtual filesystem. Every filesystem hands out vnodes, one per file
+ * or directory, kept unique by the inode cache. Paths are walked a component
+ * at a time through the dentry cache, which also remembers names that
+ * aren't there, and filesystems are mounted on directories of each other.
+ * File contents live in the page cache (pageCache.hpp)
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/mm/addressSpace.hpp>
+
+namespace kernel::vfs
+{
+
+/* Longest path, without the terminator */
+static const size_t MAX_PATH_LENGTH =       127;
+
+/* Longest name in a directory */
+static const size_t MAX_NAME_LENGTH =       255;
+
+/* Filesystems mounted at once, the root one included */
+static const size_t MAX_MOUNTS =            8;
+
+/* Directories deep a path can go, for ".." */
+static const size_t MAX_WALK_DEPTH =        16;
+
+/* Where executables named without a path are looked for */
+static const char BOOT_DIRECTORY[] =        "/boot";
+
+enum class vnodeType : uint8_t
+{
+    FILE,
+    DIRECTORY
+};
+
+struct vnode;
+struct filesystem;
+
+/**
+ * @brief What a filesystem does for its vnodes. Anything it can't do is
+ * nullptr. None of them are called with a lock held. File contents only go
+ * through the page cache, which asks for them a page at a time
+ * 
+ */
+struct vnodeOps
+{
+    /**
+     * @brief Find a name in a directory. "." and ".." never get here
+     *
+     * @return int32_t 0 with a referenced vnode in result, -ENOENT, or
+     * another negative error
+     */
+    int32_t (*lookup)(vnode* directory, const char* name, size_t length, vnode** result);
+
+    /**
+     * @brief Add a name to a directory
+     *
+     * @return int32_t 0 with a referenced vnode in result, -EEXIST, or
+     * another negative error
+     */
+    int32_t (*create)(vnode* directory, const char* name, size_t length, vnodeType type,
+                vnode** result);
+
+    /**
+     * @brief Take a name out of a directory. What it names stays usable
+     * through the references there are on it, and goes with the last one
+     *
+     * @param directory
+     * @param name
+     * @param length
+     * @param node What the name is, a file, referenced by the caller
+     * @return int32_t 0, or a negative error
+     */
+    int32_t (*unlink)(vnode* directory, const char* name, size_t length, vnode* node);
+
+    /**
+     * @brief List a directory from a cursor, as dirent records (see
+     * sys/dirent.h), as many as fit. Never "." or ".."
+     *
+     * @param directory
+     * @param cursor 0 for the start, or a d_off it gave. Moved past what was
+     * filled
+     * @param buffer Kernel memory, 4 byte aligned
+     * @param size Bytes in it
+     * @return int32_t Bytes filled, 0 at the end, -EINVAL if the next record
+     * doesn't fit, or another negative error
+     */
+    int32_t (*readdir)(vnode* directory, uint32_t* cursor, void* buffer, size_t size);
+
+    /**
+     * @brief Fill a page of the page cache from wherever the file lives,
+     * with zeroes past its end. It's called from the page fault handler too,
+     * so it can't sleep. nullptr when the cache is all there is (ramfs): then
+     * pages that were never written are zeroes, they're never reclaimed, and
+     * the file can be written to
+     * 
+     * @param node File
+     * @param index Page of the file, before its end
+     * @param frame Where to
+     * @return int32_t 0, or a negative error
+     */
+    int32_t (*readpage)(vnode* node, uint32_t index, uint32_t frame);
+
+    /**
+     * @brief Write a page of the page cache back where the file lives. Only
+     * the part before the size setSize() was last given matters. nullptr if
+     * the filesystem can't be written to
+     * 
+     * @param node File
+     * @param index Page of the file
+     * @param frame Where from
+     * @return int32_t 0, or a negative error
+     */
+    int32_t (*writepage)(vnode* node, uint32_t index, uint32_t frame);
+
+    /**
+     * @brief Make the file take size bytes where it lives, and say so there.
+     * Writeback calls it before the dirty pages go out, with all of them
+     * counted, so whatever has to be allocated can be, in one go
+     * 
+     * @param node File
+     * @param size In bytes
+     * @return int32_t 0, -ENOSPC, or another negative error
+     */
+    int32_t (*setSize)(vnode* node, uint32_t size);
+
+    /**
+     * @brief Free what the filesystem keeps for a vnode, whose last
+     * reference is gone
+     *
+     */
+    void (*release)(vnode* node);
+};
+
+/**
+ * @brief A file or directory of some filesystem. Only ever one per inode,
+ * while anyone has a reference on it
+ * 
+ */
+struct vnode
+{
+    uint32_t            references;
+    vnodeType           type;
+
+    /* Something is mounted on it */
+    volatile bool       covered;
+
+    /* Inode number, unique in its filesystem */
+    uint32_t            id;
+
+    /* In bytes. FAT32 can't go past 4 GiB either */
+    volatile uint32_t   size;
+
+    filesystem*         fs;
+    const vnodeOps*     ops;
+
+    /* The filesystem's own */
+    void*               data;
+
+    /* Page cache: a frame for each page of the file, with PAGE_* flags in
+       the low bits, 0 where nothing is cached. Grows as pages come in */
+    kernel::sync::spinlock pagesLock;
+    uint32_t*           pages;
+    uint32_t            pageSlots;
+    uint32_t            cachedPages;
+
+    /* In the ring the reclaim clock goes round, while it has pages that can
+       be reclaimed. nullptr if not */
+    vnode*              clockNext;
+    vnode*              clockPrev;
+
+    /* Waiting for writeback, which holds a reference on it meanwhile */
+    bool                dirty;
+    vnode*              dirtyNext;
+
+    /* Someone is writing it back */
+    bool                writingBack;
+
+    /* Next in its inode cache bucket */
+    vnode*              hashNext;
+};
+
+/**
+ * @brief A mounted filesystem
+ * 
+ */
+struct filesystem
+{
+    /* "fat32", "ramfs" */
+    const char*         type;
+
+    /* With a reference, for as long as it's mounted */
+    vnode*              root;
+
+    /* The filesystem's own */
+    void*               data;
+
+    /* Names that differ only in case are the same one (FAT32). The dentry
+       cache folds ASCII letters, and doesn't cache names with anything else */
+    bool                caseInsensitive;
+};
+
+/**
+ * @brief How path lookups went, over every processor
+ * 
+ */
+struct vfsStats
+{
+    /* Components found in the dentry cache */
+    uint32_t            hits;
+
+    /* Components the dentry cache knew weren't there */
+    uint32_t            negativeHits;
+
+    /* Components the filesystem had to look up */
+    uint32_t            misses;
+};
+
+/**
+ * @brief Whether a file can be written to: if everything it holds is in the
+ * page cache, or its pages can be written back
+ * 
+ */
+static inline bool writable(const vnode* node)
+{
+    return node->type == vnodeType::FILE &&
+            (node->ops->readpage == nullptr || node->ops->writepage != nullptr);
+}
+
+/**
+ * @brief Take a reference on a vnode
+ * 
+ * @param node
+ */
+static inline void getVnode(vnode* node)
+{
+    __atomic_fetch_add(&node->references,1,__ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Drop a reference on a vnode. The last one takes it out of the inode
+ * cache and frees it
+ * 
+ * @param node
+ */
+void putVnode(vnode* node);
+
+/**
+ * @brief Make a vnode with one reference. Filesystems fill in the rest
+ * 
+ * @param fs Filesystem it belongs to
+ * @param id Inode number
+ * @param type
+ * @param ops
+ * @return vnode* nullptr if out of memory
+ */
+vnode* allocateVnode(filesystem* fs, uint32_t id, vnodeType type, const vnodeOps* ops);
+
+/**
+ * @brief Add a vnode a filesystem just made to the inode cache, unless
+ * someone beat it to the same inode. Filesystems that read their inodes from
+ * the disk call this before handing a vnode out
+ * 
+ * @param node Fresh vnode, from allocateVnode()
+ * @return vnode* node, or the one that was already there, with a reference.
+ * In that case node has been released
+ */
+vnode* internVnode(vnode* node);
+
+/**
+ * @brief Write a dirent record (see sys/dirent.h), for readdir()
+ * 
+ * @param buffer Where, 4 byte aligned
+ * @param size Room there
+ * @param id Inode number
+ * @param next Cursor right after it
+ * @param type
+ * @param name Not terminated, at most DIRENT_NAME_MAX bytes. It can be in
+ * the buffer, past where the record starts
+ * @param length
+ * @return size_t Bytes the record took, 0 if it doesn't fit
+ */
+size_t putDirent(void* buffer, size_t size, uint32_t id, uint32_t next, vnodeType type,
+            const char* name, size_t length);
+
+/**
+ * @brief Find a path
+ * 
+ * @param path Absolute, or relative to the root, which is the same for now
+ * @param result Set to the vnode, with a reference
+ * @return int32_t 0, -ENOENT, -ENOTDIR, -ENAMETOOLONG, or an error from the
+ * filesystem
+ */
+int32_t walk(const char* path, vnode** result);
+
+/**
+ * @brief Add a file or directory
+ * 
+ * @param path Where. Everything up to the last component must be there
+ * @param type
+ * @param result Set to the new vnode, with a reference
+ * @return int32_t 0, -EEXIST, -EROFS, or an error from walk()
+ */
+int32_t create(const char* path, vnodeType type, vnode** result);
+
+/**
+ * @brief Put a filesystem at a path, which hides whatever the directory had
+ * 
+ * @param path Directory, or "/" for the first one
+ * @param fs Filesystem. Its root reference now belongs to the mount table
+ * @return int32_t 0, -ENOTDIR, -EBUSY if something's already there,
+ * -ENOMEM, or an error from walk()
+ */
+int32_t mount(const char* path, filesystem* fs);
+
+/**
+ * @brief Take a file's name away. Whoever has it open can keep using it
+ * 
+ * @param path
+ * @return int32_t 0, -EISDIR, -EROFS, or an error from walk() or the
+ * filesystem
+ */
+int32_t unlink(const char* path);
+
+/**
+ * @brief Read from a file
+ * 
+ * @param node
+ * @param offset
+ * @param buffer Kernel memory, or user memory of the current thread,
+ * already checked
+ * @param length
+ * @return int32_t Bytes read, 0 at the end, or -EISDIR, -EIO, ...
+ */
+int32_t read(vnode* node, uint64_t offset, void* buffer, size_t length);
+
+/**
+ * @brief Write to a file
+ * 
+ * @param node
+ * @param offset
+ * @param buffer Same as for read()
+ * @param length
+ * @return int32_t Bytes written, or -EISDIR, -EROFS, -EFBIG, -ENOMEM
+ */
+int32_t write(vnode* node, uint64_t offset, const void* buffer, size_t length);
+
+/**
+ * @brief List a directory, as many dirent records (see sys/dirent.h) as fit
+ * 
+ * @param node
+ * @param cursor 0 for the start, or a d_off from before. Moved past what
+ * was listed
+ * @param buffer Same as for read(), 4 byte aligned
+ * @param length
+ * @return int32_t Bytes filled, 0 at the end, or -ENOTDIR, -EINVAL if not
+ * even one record fits, -EIO, ...
+ */
+int32_t readDirectory(vnode* node, uint32_t* cursor, void* buffer, size_t length);
+
+/**
+ * @brief Make a file a size, dropping what's past it or adding zeroes
+ * 
+ * @param node
+ * @param size
+ * @return int32_t 0, -EISDIR, -EROFS, -EFBIG
+ */
+int32_t truncate(vnode* node, uint64_t size);
+
+/**
+ * @brief Write everything a file holds back to where it lives
+ * 
+ * @param node
+ * @return int32_t 0, or -EIO, -ENOSPC
+ */
+int32_t sync(vnode* node);
+
+/**
+ * @brief A file as something processes can map: its pages come from the page
+ * cache, and stay shared with it until they're written to
+ * 
+ * @param node File
+ * @param error Set on failure to -EISDIR or -ENOMEM
+ * @return mm::memoryObject* With a reference, nullptr on failure. As big as
+ * the file is now
+ */
+mm::memoryObject* fileObject(vnode* node, int32_t* error);
+
+/**
+ * @brief Map part of a file into the current process. Until a page is
+ * written to, it's the page cache's own, so later changes to the file show
+ * through. Writes to the mapping are private to it
+ * 
+ * @param node File
+ * @param offset Where in the file, page aligned
+ * @param length Bytes, rounded up to pages. Past the end of the file it's
+ * zero filled
+ * @param flags mm::REGION_READ, WRITE and EXEC
+ * @param address Set to where it got mapped
+ * @return int32_t 0, or -EINVAL, -EISDIR, -EIO, -ENOMEM
+ */
+int32_t mapFile(vnode* node, uint32_t offset, size_t length, uint32_t flags, uint32_t* address);
+
+/**
+ * @brief Get the dentry cache counters
+ * 
+ * @return vfsStats
+ */
+vfsStats getStats();
+
+/**
+ * @brief Mount a RAM filesystem as the root, with empty BOOT_DIRECTORY and
+ * /tmp in it, start the page cache and writeback, and add the file system
+ * calls. Needs
+ * syscall::init() and the scheduler
+ * 
+ */
+void init();
+
+} // namespace kernel::vfs
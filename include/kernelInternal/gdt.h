@@ -20,6 +20,11 @@ extern "C" {
 #define DATA32_KSEGMENT              0x10
 #define CODE32_USEGMENT              0x18
 #define DATA32_USEGMENT              0x20
+#define TSS_KSEGMENT                 0x28
+#define PERCPU_KSEGMENT              0x30
+
+// Number of entries in each processor's GDT
+#define GDT_ENTRIES                  7
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,69 @@
+/**
+ * @file futex.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Futexes: sleeping and waking on a user word, so user locks only
+ * enter the kernel when there's contention. Waiters are kept in a hash table
+ * of queues keyed by the word's physical address, which is the same in every
+ * process that maps it
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace kernel::ipc
+{
+
+/* Operations of SYS_FUTEX */
+static const uint32_t FUTEX_WAIT =          0;
+static const uint32_t FUTEX_WAKE =          1;
+static const uint32_t FUTEX_REQUEUE =       2;
+
+/* Queues in the hash table */
+static const size_t FUTEX_BUCKETS =         64;
+
+/**
+ * @brief Sleep until futexWake() on a word, unless it doesn't hold expected.
+ * Checking it and going to sleep are atomic against futexWake()
+ * 
+ * @param address User address of the word, 4 byte aligned, in the current
+ * thread's address space
+ * @param expected What it must hold to go to sleep
+ * @return int32_t 0 once woken, -EAGAIN if it didn't hold expected, -EINVAL
+ * (-EFAULT if it isn't mapped)
+ */
+int32_t futexWait(uint32_t address, uint32_t expected);
+
+/**
+ * @brief Wake threads sleeping on a word, in any process
+ * 
+ * @param address User address of the word
+ * @param count How many, at most, oldest first
+ * @return int32_t How many were woken, or a negative error
+ */
+int32_t futexWake(uint32_t address, uint32_t count);
+
+/**
+ * @brief Wake some threads sleeping on a word, and move others to sleep on
+ * another one instead. A condition variable broadcast wakes one, and moves
+ * the rest to the mutex, where they'll be woken one at a time by unlocks
+ * rather than all at once to fight over it
+ * 
+ * @param address User address of the word
+ * @param wakeCount How many to wake
+ * @param target User address of the word the rest go to
+ * @param requeueCount How many to move, at most
+ * @param expected What address must still hold, or nothing is done
+ * @return int32_t How many were woken or moved, -EAGAIN if address didn't
+ * hold expected, or another negative error
+ */
+int32_t futexRequeue(uint32_t address, uint32_t wakeCount, uint32_t target,
+            uint32_t requeueCount, uint32_t expected);
+
+} // namespace kernel::ipc
@@ -0,0 +1,29 @@
+/**
+ * @file ipc.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Inter-process communication: pipes (pipe.hpp), shared memory
+ * (shm.hpp) and futexes (futex.hpp), and the system calls that get at them
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <kernelInternal/ipc/futex.hpp>
+#include <kernelInternal/ipc/pipe.hpp>
+#include <kernelInternal/ipc/shm.hpp>
+
+namespace kernel::ipc
+{
+
+/**
+ * @brief Register the pipe, shared memory and futex system calls. Needs
+ * syscall::init()
+ * 
+ */
+void init();
+
+} // namespace kernel::ipc
@@ -0,0 +1,136 @@
+/**
+ * @file pipe.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Pipes: a ring of pages between writers and readers. Whole, page
+ * aligned pages move through without being copied: the writer lends its page
+ * (copy-on-write from then on) and the reader gets it mapped in place of its
+ * own. Anything else is copied in and out
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/sched/waitQueue.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+
+namespace kernel::ipc
+{
+
+/* Pages a pipe holds before writers have to wait */
+static const size_t PIPE_PAGES =            16;
+
+/* Longest name of a named pipe, without the terminator */
+static const size_t PIPE_NAME_LENGTH =      15;
+
+/* Flags, for pipes and their ends */
+static const uint32_t PIPE_WRITE =          0x1;    // Open the write end of a named pipe
+static const uint32_t PIPE_COPY =           0x2;    // Never remap pages, copy everything
+
+class pipe
+{
+private:
+    /**
+     * @brief A page in the ring, and which part of it has data
+     * 
+     */
+    struct slot
+    {
+        uint32_t        frame;
+        uint16_t        offset;
+        uint16_t        length;
+
+        /* Someone else maps it, it can't be written to */
+        bool            lent;
+    };
+
+    kernel::sync::spinlock _lock;
+    slot _slots[PIPE_PAGES];
+    size_t _first;
+    size_t _count;
+    uint32_t _readers;
+    uint32_t _writers;
+    uint32_t _flags;
+    sched::waitQueue _readWait;
+    sched::waitQueue _writeWait;
+
+    /* Named pipes are in a list while they have ends open */
+    char _name[PIPE_NAME_LENGTH + 1];
+    pipe* _next;
+
+    pipe() : _first(0), _count(0), _readers(0), _writers(0), _flags(0), _next(nullptr) {}
+    void sleepOn(sched::waitQueue* queue);
+    void push(uint32_t frame, uint16_t length, bool lent);
+    void pop();
+public:
+    /**
+     * @brief Create an anonymous pipe, with one read and one write end open
+     * 
+     * @param flags PIPE_COPY, or 0
+     * @return pipe* nullptr if out of memory
+     */
+    static pipe* create(uint32_t flags);
+
+    /**
+     * @brief Open an end of a named pipe, creating it if nobody has it open
+     * 
+     * @param name Name, up to PIPE_NAME_LENGTH characters
+     * @param flags PIPE_WRITE for the write end, PIPE_COPY (only used when
+     * it's created)
+     * @return pipe* nullptr if the name is bad, or out of memory
+     */
+    static pipe* open(const char* name, uint32_t flags);
+
+    /**
+     * @brief Open another reference to an end the caller already has open.
+     * close() it as usual
+     * 
+     * @param writeEnd Which end
+     */
+    void reference(bool writeEnd);
+
+    /**
+     * @brief Close an end. Closing the last one frees the pipe
+     * 
+     * @param writeEnd Which end
+     */
+    void close(bool writeEnd);
+
+    /**
+     * @brief Read, waiting for data if there's none and there are still
+     * writers
+     * 
+     * @param buffer Buffer in the current thread's address space
+     * @param length Size of the buffer
+     * @return int32_t Bytes read, 0 once every writer is gone
+     */
+    int32_t read(void* buffer, size_t length);
+
+    /**
+     * @brief Write everything, waiting for readers to make room
+     * 
+     * @param buffer Buffer in the current thread's address space
+     * @param length Bytes to write
+     * @return int32_t Bytes written, -EPIPE if there are no readers, or
+     * -ENOMEM
+     */
+    int32_t write(const void* buffer, size_t length);
+
+    /**
+     * @brief Check whether a read or a write would go through without
+     * waiting
+     * 
+     * @param events POLLIN, POLLOUT (see sys/ioring.h)
+     * @param wait Sleep until one of them is ready
+     * @return uint32_t The ready ones. POLLHUP too if every writer is gone
+     * (every reader, for POLLOUT)
+     */
+    uint32_t poll(uint32_t events, bool wait);
+};
+
+} // namespace kernel::ipc
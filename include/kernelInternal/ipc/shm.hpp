@@ -0,0 +1,72 @@
+/**
+ * @file shm.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Named shared memory segments, mapped into any number of processes,
+ * and wait/wake on words inside them so processes can sleep on each other
+ * instead of spinning
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace kernel::ipc
+{
+
+/* Longest segment name, without the terminator */
+static const size_t SHM_NAME_LENGTH =       15;
+
+/* Named segments there can be at once */
+static const size_t MAX_SHM_SEGMENTS =      32;
+
+/* Biggest segment */
+static const size_t MAX_SHM_SIZE =          0x1000000;
+
+/**
+ * @brief Map a segment into the current process, creating it if the name
+ * isn't taken. New segments are zero filled
+ * 
+ * @param name Name, up to SHM_NAME_LENGTH characters
+ * @param size Size, rounded up to pages. 0 maps the whole of an existing one
+ * @param address Set to where it got mapped
+ * @return int32_t 0, or -EINVAL (bad name or size, or bigger than the
+ * existing segment), -ENOENT (size 0, and no segment), -ENOMEM
+ */
+int32_t shmOpen(const char* name, size_t size, uint32_t* address);
+
+/**
+ * @brief Remove the name of a segment. Processes that have it mapped keep it
+ * 
+ * @param name Name
+ * @return int32_t 0, or -ENOENT
+ */
+int32_t shmUnlink(const char* name);
+
+/**
+ * @brief Sleep until shmWake() on a word, unless it has changed already.
+ * The check and going to sleep are atomic against shmWake(). Same as
+ * futexWait(), for words that must be in a segment
+ * 
+ * @param address User address of the word, 4 byte aligned, in a segment
+ * @param expected What it must hold to go to sleep
+ * @return int32_t 0 once woken, -EAGAIN if it didn't hold expected, -EINVAL
+ * if it's not in a segment
+ */
+int32_t shmWait(uint32_t address, uint32_t expected);
+
+/**
+ * @brief Wake threads sleeping on a word, in any process
+ * 
+ * @param address User address of the word, in a segment
+ * @param count How many, at most
+ * @return int32_t How many were woken, or -EINVAL
+ */
+int32_t shmWake(uint32_t address, uint32_t count);
+
+} // namespace kernel::ipc
@@ -0,0 +1,321 @@
+/**
+ * @file addressSpace.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief User address spaces. Nothing is mapped up front: an address space
+ * is a list of regions, and the page fault handler maps pages in as they're
+ * touched. File-backed pages are shared, read-only, with every other address
+ * space mapping the same memory object (and, for files, with the page cache),
+ * and copied the first time they're written to
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/mm/paging.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+
+namespace kernel::mm
+{
+
+/* What a region allows. There's no execute-disable without PAE, so
+   REGION_EXEC is only recorded */
+static const uint32_t REGION_READ =         0x1;
+static const uint32_t REGION_WRITE =        0x2;
+static const uint32_t REGION_EXEC =         0x4;
+
+/* Writes go to the object's pages, which every address space mapping them
+   sees, instead of to a private copy */
+static const uint32_t REGION_SHARED =       0x8;
+
+/**
+ * @brief Where the pages of an object come from, for objects that don't
+ * have them all up front (files, through the page cache)
+ * 
+ */
+struct pager
+{
+    /* Frame of a page, with a reference, if it's there, 0 if not. Called
+       with spinlocks held */
+    uint32_t            (*find)(void* owner, size_t index);
+
+    /* Bring a page in, and return it like find(). Called from the page
+       fault handler, with no locks held but interrupts maybe disabled, so it
+       can take long, but not sleep. 0 on failure */
+    uint32_t            (*load)(void* owner, size_t index);
+
+    /* The object's last reference is gone */
+    void                (*release)(void* owner);
+};
+
+/**
+ * @brief Reference counted set of frames, that regions of any number of
+ * address spaces can map
+ * 
+ */
+class memoryObject
+{
+private:
+    uint32_t _references;
+    size_t _pages;
+    uint32_t* _frames;
+
+    /* Where the pages come from instead, if not nullptr */
+    const pager* _pager;
+    void* _owner;
+
+    memoryObject() : _references(1), _pages(0), _frames(nullptr), _pager(nullptr),
+            _owner(nullptr) {}
+public:
+    /**
+     * @brief Create an object, with one reference
+     * 
+     * @param pages Size, in pages. They're allocated and zeroed right away
+     * @return memoryObject* nullptr if out of memory
+     */
+    static memoryObject* create(size_t pages);
+
+    /**
+     * @brief Create an object whose pages are somebody else's, brought in
+     * as they're faulted on, with one reference
+     * 
+     * @param pages Size, in pages
+     * @param source Where they come from
+     * @param owner Passed to source's functions
+     * @return memoryObject* nullptr if out of memory
+     */
+    static memoryObject* createPaged(size_t pages, const pager* source, void* owner);
+
+    /**
+     * @brief Take a reference
+     * 
+     */
+    void get() { __atomic_fetch_add(&_references,1,__ATOMIC_RELAXED); }
+
+    /**
+     * @brief Drop a reference. The last one frees the object, and its frames
+     * (frames still mapped somewhere stay around until they're unmapped)
+     * 
+     */
+    void put();
+
+    size_t pages() const { return _pages; }
+
+    /**
+     * @brief Physical address of one of the pages, of an object from
+     * create()
+     * 
+     * @param index Page, less than pages()
+     * @return uint32_t 
+     */
+    uint32_t frame(size_t index) const { return _frames[index]; }
+
+    /**
+     * @brief Frame of a page, if it's there
+     * 
+     * @param index Page, less than pages()
+     * @return uint32_t With a reference for the caller, 0 if it has to be
+     * brought in with loadPage() first
+     */
+    uint32_t findPage(size_t index)
+    {
+        if (_pager != nullptr)
+            return _pager->find(_owner,index);
+        getFrame(_frames[index]);
+        return _frames[index];
+    }
+
+    /**
+     * @brief Bring a page in. No locks may be held
+     * 
+     * @param index Page, less than pages()
+     * @return uint32_t Same as findPage(), 0 on failure
+     */
+    uint32_t loadPage(size_t index)
+    {
+        if (_pager != nullptr)
+            return _pager->load(_owner,index);
+        return findPage(index);
+    }
+};
+
+/**
+ * @brief Range of an address space, and where its pages come from
+ * 
+ */
+struct region
+{
+    /* Page aligned bounds, end excluded */
+    uint32_t            start;
+    uint32_t            end;
+
+    /* REGION_* */
+    uint32_t            flags;
+
+    /* Backing object, nullptr for zero filled memory */
+    memoryObject*       object;
+
+    /* Byte offset in the object of the page at start, page aligned */
+    uint32_t            objectOffset;
+
+    /* Past this address the region is zero filled, even with an object */
+    uint32_t            backedEnd;
+
+    region*             next;
+};
+
+/**
+ * @brief A page directory, and the regions that say how to fill it
+ * 
+ */
+class addressSpace
+{
+private:
+    kernel::sync::spinlock _lock;
+
+    /* Physical address of the page directory */
+    uint32_t _directory;
+
+    /* Sorted by address, never overlapping */
+    region* _regions;
+
+    addressSpace() : _directory(0), _regions(nullptr) {}
+
+    region* find(uint32_t address);
+    uint32_t* walk(uint32_t address, bool create);
+    void unmapRange(uint32_t start, uint32_t end);
+public:
+    /**
+     * @brief Create an empty address space. It already has the kernel
+     * mappings
+     * 
+     * @return addressSpace* nullptr if out of memory
+     */
+    static addressSpace* create();
+
+    /**
+     * @brief Unmap everything, and free the address space. It can't be
+     * active on any processor
+     * 
+     */
+    void destroy();
+
+    /**
+     * @brief Physical address of the page directory, what goes in CR3
+     * 
+     * @return uint32_t 
+     */
+    uint32_t directory() const { return _directory; }
+
+    /**
+     * @brief Add a region. Nothing gets mapped until it's touched
+     * 
+     * @param start Start address, page aligned
+     * @param end End address, page aligned, excluded
+     * @param flags REGION_*
+     * @param object Backing object, or nullptr. The region takes its own
+     * reference on it
+     * @param objectOffset Byte offset in the object of the page at start,
+     * page aligned
+     * @param backedEnd Past this address the region is zero filled. Ignored
+     * without an object
+     * @return true It was added
+     * @return false Bad arguments, it overlaps another region, it's outside
+     * user space, or the object is too small
+     */
+    bool addRegion(uint32_t start, uint32_t end, uint32_t flags,
+                memoryObject* object = nullptr, uint32_t objectOffset = 0,
+                uint32_t backedEnd = 0);
+
+    /**
+     * @brief Remove the region that starts at start, and unmap its pages
+     * 
+     * @param start Start address of the region
+     * @return true It was there
+     */
+    bool removeRegion(uint32_t start);
+
+    /**
+     * @brief Resolve a page fault
+     * 
+     * @param address Faulting address
+     * @param write Whether it was a write
+     * @return true The page is mapped now, retry the access
+     * @return false It's outside every region, the region doesn't allow
+     * the access, or we're out of memory
+     */
+    bool handleFault(uint32_t address, bool write);
+
+    /**
+     * @brief Check that touching a range won't fault fatally, so the kernel
+     * can use user pointers
+     * 
+     * @param address Start of the range
+     * @param length Size, in bytes
+     * @param write Whether it's going to be written to
+     * @return true Every page is in a region that allows the access
+     */
+    bool checkRange(uint32_t address, size_t length, bool write);
+
+    /**
+     * @brief Lend out the frame of a page without copying it: take a
+     * reference on it, and make the page copy-on-write, so neither side sees
+     * what the other writes. Faults the page in if it isn't there
+     * 
+     * @param address Page aligned address
+     * @return uint32_t The frame, with a reference for the caller. 0 if it
+     * isn't in a region, is in a REGION_SHARED one, or we're out of memory
+     */
+    uint32_t lendPage(uint32_t address);
+
+    /**
+     * @brief Map a frame at a page, in place of whatever was there. The page
+     * is copy-on-write if anyone else has the frame
+     * 
+     * @param address Page aligned address
+     * @param frame Frame to map. The mapping takes over the caller's
+     * reference, if this succeeds
+     * @return true It's mapped
+     * @return false It isn't in a writable, private region, or we're out of
+     * memory
+     */
+    bool insertPage(uint32_t address, uint32_t frame);
+
+    /**
+     * @brief Find a range no region is in
+     * 
+     * @param length Size, page aligned
+     * @param from Lowest address it can start at, page aligned
+     * @param to Highest address it can end at
+     * @return uint32_t Start of the range, 0 if there's none
+     */
+    uint32_t findFreeRange(size_t length, uint32_t from, uint32_t to);
+
+    /**
+     * @brief Find the object behind an address of a REGION_SHARED region
+     * 
+     * @param address Address in the region
+     * @param offset Set to the byte offset of address in the object
+     * @return memoryObject* With a reference for the caller, nullptr if the
+     * address isn't in a REGION_SHARED region
+     */
+    memoryObject* sharedObject(uint32_t address, uint32_t* offset);
+
+    /**
+     * @brief Find the physical address behind a user address, faulting it
+     * in first. It's faulted in for writing if the region allows it, so a
+     * copy-on-write page gets its own frame before anyone goes by its address
+     * 
+     * @param address User address
+     * @return uint32_t Physical address, with a reference on its frame for
+     * the caller. 0 if it isn't in a region, or we're out of memory
+     */
+    uint32_t physicalAddress(uint32_t address);
+};
+
+} // namespace kernel::mm
@@ -0,0 +1,112 @@
+/**
+ * @file frames.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Physical page frame allocator. Frames are reference counted, so a
+ * frame can be mapped in several address spaces at once, and goes back to the
+ * free list when the last mapping lets go of it
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace kernel::mm
+{
+
+static const uint32_t PAGE_SIZE =           4096;
+static const uint32_t PAGE_MASK =           ~(PAGE_SIZE - 1);
+
+/* The kernel reaches physical memory through the identity map, which stops
+   here, so frames must come from below it */
+static const uint32_t DIRECT_MAP_END =      0x40000000;
+
+/**
+ * @brief Hand the frame allocator a range of physical memory. Part of it
+ * becomes the reference count array. Call once, on the BSP
+ * 
+ * @param start Start of the range, rounded up to a page
+ * @param end End of the range, rounded down to a page, and capped at
+ * DIRECT_MAP_END
+ */
+void initFrames(uint32_t start, uint32_t end);
+
+/**
+ * @brief Allocate a frame, with one reference
+ * 
+ * @return uint32_t Physical address, 0 if there's no memory left. The
+ * contents are whatever was there
+ */
+uint32_t allocateFrame();
+
+/**
+ * @brief Same as allocateFrame(), but the frame is zeroed
+ * 
+ * @return uint32_t Physical address, 0 if there's no memory left
+ */
+uint32_t allocateZeroedFrame();
+
+/**
+ * @brief Take another reference on a frame
+ * 
+ * @param frame Physical address of the frame
+ */
+void getFrame(uint32_t frame);
+
+/**
+ * @brief Drop a reference on a frame, freeing it if it was the last
+ * 
+ * @param frame Physical address of the frame
+ */
+void putFrame(uint32_t frame);
+
+/**
+ * @brief Number of references on a frame, for copy-on-write decisions
+ * 
+ * @param frame Physical address of the frame
+ * @return uint32_t 
+ */
+uint32_t frameReferences(uint32_t frame);
+
+/**
+ * @brief Frames in the free list
+ * 
+ * @return size_t 
+ */
+size_t freeFrames();
+
+/**
+ * @brief Frames the allocator manages, free or not
+ * 
+ * @return size_t 
+ */
+size_t totalFrames();
+
+/**
+ * @brief Have a function called whenever an allocation leaves fewer than
+ * lowWater frames free, so caches can give some back. It runs wherever the
+ * allocation was, maybe with locks held and interrupts disabled, so all it
+ * should do is wake whoever does the work
+ * 
+ * @param lowWater Free frames below which it's called
+ * @param handler Function to call
+ */
+void setLowMemoryHandler(size_t lowWater, void (*handler)());
+
+/**
+ * @brief Get at the contents of a frame, through the identity map
+ * 
+ * @param frame Physical address of the frame
+ * @return void* 
+ */
+static inline void* frameAddress(uint32_t frame)
+{
+    return reinterpret_cast<void*>(frame);
+}
+
+} // namespace kernel::mm
@@ -0,0 +1,95 @@
+/**
+ * @file paging.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Paging. The kernel identity maps the first GiB of physical memory
+ * (and MMIO above 3 GiB) with 4 MiB pages, the same in every address space.
+ * The 2 GiB in between belong to user space, and are different in each one
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/mm/frames.hpp>
+
+namespace kernel::mm
+{
+
+/* Page directory and page table entry bits */
+static const uint32_t PTE_PRESENT =         0x001;
+static const uint32_t PTE_WRITE =           0x002;
+static const uint32_t PTE_USER =            0x004;
+static const uint32_t PTE_WRITE_THROUGH =   0x008;
+static const uint32_t PTE_CACHE_DISABLE =   0x010;
+static const uint32_t PTE_ACCESSED =        0x020;
+static const uint32_t PTE_DIRTY =           0x040;
+static const uint32_t PTE_LARGE =           0x080; // 4 MiB page, directory entries only
+static const uint32_t PTE_GLOBAL =          0x100;
+
+static const uint32_t ENTRIES_PER_TABLE =   1024;
+static const uint32_t LARGE_PAGE_SIZE =     0x400000;
+
+/* User part of every address space. Directory entries in here are private,
+   the rest are copied from the kernel directory */
+static const uint32_t USER_SPACE_START =    0x40000000;
+static const uint32_t USER_SPACE_END =      0xc0000000;
+
+class addressSpace;
+
+/**
+ * @brief Build the kernel page directory, set up the frame allocator, and
+ * turn paging on on the BSP. Needs smp::init()
+ * 
+ * @param framesStart Start of the physical memory for frames (end of the heap)
+ * @param framesEnd End of physical memory
+ */
+void init(uint32_t framesStart, uint32_t framesEnd);
+
+/**
+ * @brief Turn paging on on an AP, with the kernel page directory
+ * 
+ */
+void initCPU();
+
+/**
+ * @brief Physical address of the kernel page directory
+ * 
+ * @return uint32_t 
+ */
+uint32_t kernelDirectory();
+
+/**
+ * @brief Switch this processor to an address space, if it isn't on it yet.
+ * Preemption (or interrupts) must be disabled
+ * 
+ * @param space Address space, nullptr for the kernel directory
+ */
+void activate(addressSpace* space);
+
+/**
+ * @brief Address that caused the last page fault on this processor
+ * 
+ * @return uint32_t 
+ */
+static inline uint32_t faultAddress()
+{
+    uint32_t cr2;
+    __asm__ __volatile__ ("mov %%cr2, %0" : "=r"(cr2));
+    return cr2;
+}
+
+} // namespace kernel::mm
+
+extern "C" {
+    /* Pages of the kernel binary ring 3 may run (.usertext) and write
+       (.userdata), see kernel.ld */
+    extern uint8_t __usertext_start[];
+    extern uint8_t __usertext_end[];
+    extern uint8_t __userdata_start[];
+    extern uint8_t __userdata_end[];
+}
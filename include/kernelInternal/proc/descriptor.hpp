@@ -0,0 +1,198 @@
+/**
+ * @file descriptor.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief File descriptors: what the numbers user programs read from and
+ * write to stand for
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace kernel::proc
+{
+
+struct process;
+
+/* Descriptors a process can have open */
+static const size_t MAX_DESCRIPTORS =       16;
+
+/* What every process starts with */
+static const int32_t STDIN =                0;
+static const int32_t STDOUT =               1;
+static const int32_t STDERR =               2;
+
+enum class descriptorType : uint8_t
+{
+    NONE,
+
+    /* Writes go to the console, reads get nothing */
+    CONSOLE,
+
+    /* Ends of an ipc::pipe */
+    PIPE_READ,
+    PIPE_WRITE,
+
+    /* A block::blockDevice, read and written through the buffer cache */
+    BLOCK_DEVICE,
+
+    /* An aio::ioRing */
+    IO_RING,
+
+    /* A vfs::vnode, file or directory */
+    FILE
+};
+
+struct descriptor
+{
+    descriptorType      type;
+    void*               object;
+
+    /* Where reads and writes without an offset go, for block devices and
+       files */
+    uint64_t            position;
+
+    /* O_* (see sys/fcntl.h) it was opened with, for files */
+    uint32_t            flags;
+};
+
+/**
+ * @brief Give a new process its standard descriptors
+ * 
+ * @param p Process
+ */
+void initDescriptors(process* p);
+
+/**
+ * @brief Close every descriptor of a process that's going away
+ * 
+ * @param p Process
+ */
+void closeDescriptors(process* p);
+
+/**
+ * @brief Add a descriptor to the current process
+ * 
+ * @param type What it is
+ * @param object What it refers to. The descriptor now owns whatever
+ * reference the caller had on it
+ * @param flags O_* it was opened with
+ * @return int32_t The lowest free number, or -EMFILE (-EBADF for threads
+ * without a process)
+ */
+int32_t openDescriptor(descriptorType type, void* object, uint32_t flags = 0);
+
+/**
+ * @brief Close a descriptor of the current process. Whoever got it with
+ * getDescriptor() can still use it until they put it
+ * 
+ * @param fd Descriptor
+ * @return int32_t 0, or -EBADF
+ */
+int32_t closeDescriptor(int32_t fd);
+
+/**
+ * @brief Get a descriptor of the current process, with a reference on what
+ * it refers to, so closing it meanwhile doesn't pull it from under the caller
+ * 
+ * @param fd Descriptor
+ * @param d Filled with a copy of it
+ * @return true It's open
+ */
+bool getDescriptor(int32_t fd, descriptor* d);
+
+/**
+ * @brief Drop the reference from getDescriptor()
+ * 
+ * @param d Copy from getDescriptor()
+ */
+void putDescriptor(const descriptor* d);
+
+/**
+ * @brief Read from a descriptor, into the current thread's user memory
+ * 
+ * @param d Descriptor, from getDescriptor()
+ * @param buffer User buffer
+ * @param length Size of the buffer
+ * @param offset Where to read from, for descriptors that aren't streams
+ * @return int32_t Bytes read (0 at the end), or a negative error
+ */
+int32_t descriptorRead(const descriptor* d, uint32_t buffer, size_t length, uint64_t offset);
+
+/**
+ * @brief Write to a descriptor, from the current thread's user memory
+ * 
+ * @param d Descriptor, from getDescriptor()
+ * @param buffer User buffer
+ * @param length Bytes to write
+ * @param offset Where to write to, for descriptors that aren't streams
+ * @return int32_t Bytes written, or a negative error
+ */
+int32_t descriptorWrite(const descriptor* d, uint32_t buffer, size_t length, uint64_t offset);
+
+/**
+ * @brief Make what was written to a descriptor stick
+ * 
+ * @param d Descriptor, from getDescriptor()
+ * @return int32_t 0, or a negative error
+ */
+int32_t descriptorSync(const descriptor* d);
+
+/**
+ * @brief Check which events a descriptor is ready for
+ * 
+ * @param d Descriptor, from getDescriptor()
+ * @param events POLL* (see sys/ioring.h) the caller cares about
+ * @param wait Sleep until at least one of them is ready
+ * @return uint32_t The ready ones, POLLHUP if the other end is gone
+ */
+uint32_t descriptorPoll(const descriptor* d, uint32_t events, bool wait);
+
+/**
+ * @brief Read from a descriptor of the current process, into user memory,
+ * at its position
+ * 
+ * @param fd Descriptor
+ * @param buffer User buffer
+ * @param length Size of the buffer
+ * @return int32_t Bytes read (0 at the end), or a negative error
+ */
+int32_t readDescriptor(int32_t fd, uint32_t buffer, size_t length);
+
+/**
+ * @brief Write to a descriptor of the current process, from user memory, at
+ * its position
+ * 
+ * @param fd Descriptor
+ * @param buffer User buffer
+ * @param length Bytes to write
+ * @return int32_t Bytes written, or a negative error
+ */
+int32_t writeDescriptor(int32_t fd, uint32_t buffer, size_t length);
+
+/**
+ * @brief List a directory open in the current process, into user memory,
+ * from its position, which is left after the last record listed
+ * 
+ * @param fd Directory
+ * @param buffer User buffer
+ * @param length Size of the buffer
+ * @return int32_t Bytes filled (0 at the end), or a negative error
+ */
+int32_t readDirectoryDescriptor(int32_t fd, uint32_t buffer, size_t length);
+
+/**
+ * @brief descriptorSync() on a descriptor of the current process
+ * 
+ * @param fd Descriptor
+ * @return int32_t 0, or a negative error
+ */
+int32_t syncDescriptor(int32_t fd);
+
+} // namespace kernel::proc
@@ -0,0 +1,121 @@
+/**
+ * @file elf.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief ELF executables. Each file is read once into a memory object, that
+ * every process running it maps (mmap() of the same file too), and kept
+ * while any of them is alive
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/fs/vfs.hpp>
+
+namespace kernel::proc
+{
+
+/* Loadable segments an executable can have */
+static const size_t MAX_SEGMENTS =          8;
+
+/* Program headers of any kind an executable can have */
+static const size_t MAX_PROGRAM_HEADERS =   16;
+
+/* Names of executables, the last component of their path cut down to size,
+   with the terminator */
+static const size_t IMAGE_NAME_SIZE =       13;
+
+enum class loadError : uint8_t
+{
+    NONE,
+    NOT_FOUND,
+    IO_ERROR,
+    NOT_AN_EXECUTABLE,
+    BAD_SEGMENTS,
+    OUT_OF_MEMORY
+};
+
+/**
+ * @brief A PT_LOAD segment, already checked
+ * 
+ */
+struct segment
+{
+    uint32_t            vaddr;
+    uint32_t            memorySize;
+    uint32_t            offset;
+    uint32_t            fileSize;
+
+    /* mm::REGION_* */
+    uint32_t            flags;
+};
+
+/**
+ * @brief Executable loaded in memory
+ * 
+ */
+struct image
+{
+    char                name[IMAGE_NAME_SIZE];
+
+    /* The file it came from, with a reference. What the cache goes by */
+    vfs::vnode*         node;
+
+    /* Processes running it */
+    uint32_t            references;
+
+    /* The whole file, page by page */
+    mm::memoryObject*   file;
+
+    uint32_t            entry;
+    size_t              segmentCount;
+    segment             segments[MAX_SEGMENTS];
+
+    /* Next in the cache */
+    image*              next;
+};
+
+/**
+ * @brief Get an executable, from the cache or from the disk. Everything the
+ * file says is checked before it's believed
+ * 
+ * @param path Path of the file, or just its name if it's in
+ * vfs::BOOT_DIRECTORY
+ * @param error Why it failed, if it did
+ * @return image* With a reference taken, nullptr on failure
+ */
+image* getImage(const char* path, loadError* error);
+
+/**
+ * @brief Drop a reference on an executable. The last one frees it
+ * 
+ * @param program Executable
+ */
+void putImage(image* program);
+
+/**
+ * @brief Add an executable's segments to an address space. Their pages are
+ * only mapped when touched
+ * 
+ * @param program Executable
+ * @param space Address space, with nothing where the segments go
+ * @return true 
+ * @return false Out of memory, or something was in the way
+ */
+bool mapImage(const image* program, mm::addressSpace* space);
+
+/**
+ * @brief Describe a loadError
+ * 
+ * @param error 
+ * @return const char* 
+ */
+const char* errorString(loadError error);
+
+} // namespace kernel::proc
@@ -0,0 +1,85 @@
+/**
+ * @file process.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief User processes: an address space with an executable in it, and a
+ * thread running it in ring 3
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/proc/elf.hpp>
+#include <kernelInternal/proc/descriptor.hpp>
+#include <kernelInternal/sched/thread.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <sys/vdso.h>
+
+namespace kernel::proc
+{
+
+/* User stack, at the very top of user space, filled in as it grows */
+static const uint32_t USER_STACK_TOP =      mm::USER_SPACE_END;
+static const uint32_t USER_STACK_SIZE =     0x100000;
+
+/* The vdso page (see sys/vdso.h), a guard page under the stack */
+static const uint32_t USER_VDSO_ADDRESS =   USER_STACK_TOP - USER_STACK_SIZE - 2 * mm::PAGE_SIZE;
+static_assert(USER_VDSO_ADDRESS == VDSO_DATA_ADDRESS, "VDSO_DATA_ADDRESS doesn't match the layout");
+
+/* Executables must end below this */
+static const uint32_t USER_IMAGE_END =      USER_VDSO_ADDRESS;
+
+/* Where the kernel looks for room for shared memory, up to USER_IMAGE_END */
+static const uint32_t USER_MAP_START =      0x80000000;
+
+/**
+ * @brief Process control block
+ * 
+ */
+struct process
+{
+    uint32_t            id;
+    char                name[IMAGE_NAME_SIZE];
+    mm::addressSpace*   space;
+    image*              program;
+
+    /* The only thread, for now */
+    sched::thread*      mainThread;
+
+    /* Indexed by descriptor number. Kernel threads working for the process
+       (see aio/ioRing.hpp) use it too, so it's under descriptorLock */
+    descriptor          descriptors[MAX_DESCRIPTORS];
+    sync::spinlock      descriptorLock;
+};
+
+/**
+ * @brief Find the disk, and mount the boot partition on
+ * vfs::BOOT_DIRECTORY to load executables from. Needs the scheduler and
+ * vfs::init()
+ * 
+ * @return true There's somewhere to load executables from
+ */
+bool init();
+
+/**
+ * @brief Start a process
+ * 
+ * @param path Executable: a path, or just a name in vfs::BOOT_DIRECTORY
+ * @return int32_t Process ID, or a negative error (-ENOENT, -ENOEXEC, -ENOMEM)
+ */
+int32_t spawn(const char* path);
+
+/**
+ * @brief Terminate the calling thread, and its process with it. Threads
+ * without one (kernel threads that dropped to ring 3) just exit
+ * 
+ * @param status Exit status
+ */
+[[noreturn]] void exit(int32_t status);
+
+} // namespace kernel::proc
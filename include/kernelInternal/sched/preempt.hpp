@@ -0,0 +1,65 @@
+/**
+ * @file preempt.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Current thread, and turning preemption off and on
+ * @version 0.1
+ * @date 2025-03-12
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <kernelInternal/sched/thread.hpp>
+#include <kernelInternal/system/smp.hpp>
+
+namespace kernel::sched
+{
+
+/* Thread running on each processor */
+DECLARE_PER_CPU(thread*, runningThread);
+
+/**
+ * @brief Get the thread running on this processor
+ * 
+ * @return thread* nullptr before sched::init()
+ */
+static inline thread* currentThread()
+{
+    return smp::thisCPURead(runningThread);
+}
+
+/**
+ * @brief Reschedule if the current thread was asked to, called when
+ * preemption is enabled again
+ * 
+ */
+void preemptCheck();
+
+/**
+ * @brief Keep the current thread on this processor until preemptEnable().
+ * Nests. Only valid after sched::init()
+ * 
+ */
+static inline void preemptDisable()
+{
+    currentThread()->preemptCount++;
+    __asm__ __volatile__ ("" : : : "memory");
+}
+
+/**
+ * @brief Undo a preemptDisable(), and reschedule if a preemption was missed in
+ * the meantime
+ * 
+ */
+static inline void preemptEnable()
+{
+    __asm__ __volatile__ ("" : : : "memory");
+    thread* t = currentThread();
+    if (--t->preemptCount == 0 && t->needResched)
+        preemptCheck();
+}
+
+} // namespace kernel::sched
@@ -0,0 +1,126 @@
+/**
+ * @file scheduler.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Preemptive kernel thread scheduler. Every processor has its own run
+ * queue, idle processors steal work from busy ones
+ * @version 0.1
+ * @date 2025-03-08
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/sched/thread.hpp>
+#include <kernelInternal/sched/preempt.hpp>
+#include <kernelInternal/system/smp.hpp>
+
+namespace kernel::sched
+{
+
+/* Scheduler tick frequency, in Hz */
+static const uint32_t TICK_HZ =             1000;
+
+/* Ticks a thread runs before it's preempted by one of the same priority */
+static const uint32_t TIMESLICE_TICKS =     10;
+
+/* Let the scheduler pick the processor */
+static const int ANY_CPU =                  -1;
+
+/**
+ * @brief Per-processor scheduler counters
+ * 
+ */
+struct schedulerStats
+{
+    /* Context switches done on this processor */
+    uint64_t    switches;
+
+    /* Threads this processor took from other run queues */
+    uint64_t    steals;
+
+    /* Timer ticks */
+    uint64_t    ticks;
+};
+
+/**
+ * @brief Set up the scheduler on the BSP: calibrate and start the local APIC
+ * timer, and turn the calling context into a thread. Needs smp::init() and
+ * clock::init() first, and must run before smp::startAPs()
+ * 
+ * @param lapic Local APIC of the BSP
+ */
+void init(cpu::l_apic* lapic);
+
+/**
+ * @brief Set up the scheduler on an AP: the calling context becomes its idle
+ * thread. Call idle() next
+ * 
+ */
+void initCPU();
+
+/**
+ * @brief Idle loop: run whatever can be found, halt otherwise
+ * 
+ */
+[[noreturn]] void idle();
+
+/**
+ * @brief Create a thread, and make it runnable
+ * 
+ * @param entry Function the thread runs. Returning from it exits the thread
+ * @param arg Argument passed to entry
+ * @param priority Priority, from 0 to PRIORITY_MAX
+ * @param name Name, for debugging
+ * @param cpu Processor to pin it to, or ANY_CPU
+ * @return thread* nullptr if out of memory
+ */
+thread* createThread(threadEntry entry, void* arg, uint8_t priority,
+            const char* name, int cpu = ANY_CPU);
+
+/**
+ * @brief Give up the processor to any thread of the same or higher priority
+ * 
+ */
+void yield();
+
+/**
+ * @brief Sleep until someone calls wake() on this thread. Returns right away if
+ * a wake() came since the last block(), so callers should re-check their
+ * condition in a loop
+ * 
+ */
+void block();
+
+/**
+ * @brief Make a blocked thread runnable again
+ * 
+ * @param t Thread to wake up
+ */
+void wake(thread* t);
+
+/**
+ * @brief Terminate the current thread
+ * 
+ */
+[[noreturn]] void exitThread();
+
+/**
+ * @brief Called by the interrupt dispatcher on the way out of an interrupt,
+ * with interrupts disabled. Switches threads if a preemption is due
+ * 
+ */
+void onInterruptExit();
+
+/**
+ * @brief Get the counters of a processor
+ * 
+ * @param cpu Index of the processor
+ * @return const schedulerStats* nullptr if it's out of range
+ */
+const schedulerStats* getStats(size_t cpu);
+
+} // namespace kernel::sched
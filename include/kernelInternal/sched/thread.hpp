@@ -0,0 +1,125 @@
+/**
+ * @file thread.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Kernel thread control block
+ * @version 0.1
+ * @date 2025-03-08
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/devices/cpu/cpu.hpp>
+
+namespace kernel::mm { class addressSpace; }
+namespace kernel::proc { struct process; }
+
+namespace kernel::sched
+{
+
+/* Priority levels, higher runs first */
+static const size_t NUM_PRIORITIES =        8;
+static const uint8_t PRIORITY_LOW =         1;
+static const uint8_t PRIORITY_NORMAL =      3;
+static const uint8_t PRIORITY_HIGH =        6;
+static const uint8_t PRIORITY_MAX =         NUM_PRIORITIES - 1;
+
+/* Kernel stack of every thread */
+static const size_t THREAD_STACK_SIZE =     16384;
+
+typedef void (*threadEntry)(void* arg);
+
+enum class threadState : uint8_t
+{
+    READY,
+    RUNNING,
+    BLOCKED,
+    DEAD
+};
+
+/**
+ * @brief What contextSwitch leaves on top of the stack of a thread that isn't
+ * running: the registers in pushad order, EFLAGS, and where to return to
+ * 
+ */
+struct switchFrame
+{
+    cpu::pushad_frame   regs;
+    uint32_t            eflags;
+    uint32_t            eip;
+}__attribute__((packed));
+
+static_assert(sizeof(switchFrame) == 40);
+
+/**
+ * @brief Thread control block
+ * 
+ */
+struct thread
+{
+    /* Saved stack pointer, points to a switchFrame while not running */
+    uint32_t            esp;
+
+    uint32_t            id;
+    const char*         name;
+
+    volatile threadState state;
+    uint8_t             priority;
+
+    /* Can't be moved to another processor by work stealing */
+    bool                pinned;
+
+    /* Set from the moment it's switched in, until it's completely switched
+       out (its registers are saved). Nobody else can run it until then */
+    volatile bool       onCPU;
+
+    /* A wake() came while it wasn't blocked, so the next block() returns
+       immediately */
+    bool                wakePending;
+
+    /* Should give up the processor as soon as it can */
+    volatile bool       needResched;
+
+    /* Processor it's queued on, or last ran on */
+    volatile uint32_t   cpu;
+
+    /* Ticks left until it gets preempted */
+    uint32_t            timeslice;
+
+    /* Preemption is disabled while this isn't 0 */
+    uint32_t            preemptCount;
+
+    /* Protects state and wakePending against concurrent wakers */
+    volatile uint32_t   lock;
+
+    /* Next in the run queue */
+    thread*             next;
+
+    /* Stack, nullptr for threads that came from a boot stack */
+    uint8_t*            stack;
+    uint32_t            kernelStackTop;
+
+    threadEntry         entry;
+    void*               arg;
+
+    /* Address space it runs in, nullptr for kernel only threads */
+    mm::addressSpace*   space;
+
+    /* Process it belongs to, nullptr for kernel threads */
+    proc::process*      process;
+};
+
+} // namespace kernel::sched
+
+/**
+ * @brief Save the current context on the stack, store the stack pointer in
+ * oldESP, and continue from the context saved in newESP
+ * 
+ * @param oldESP Where to save the stack pointer of the current thread
+ * @param newESP Stack pointer of the thread to switch to
+ */
+extern "C" void contextSwitch(uint32_t* oldESP, uint32_t newESP);
@@ -0,0 +1,113 @@
+/**
+ * @file waitQueue.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Queues of sleeping threads, for whatever has to wait on a condition
+ * some other thread makes true. The queue doesn't lock itself: it's protected
+ * by the lock of whatever owns the condition
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/sched/thread.hpp>
+
+/*
+ * Use, with the condition protected by lock:
+ *     lock.lock();
+ *     while (!condition)
+ *     {
+ *         sched::waiter w;
+ *         queue.add(&w);
+ *         lock.unlock();
+ *         sched::sleep(&w);
+ *         lock.lock();
+ *     }
+ * The waker makes the condition true and calls wake() with the lock held. No
+ * wakeup gets lost: a wake() between unlock() and sleep() makes it return
+ * right away
+ */
+
+namespace kernel::sched
+{
+
+/* Count for wake(): every waiter with the key */
+static const size_t WAKE_ALL =              ~size_t(0);
+
+/**
+ * @brief A thread waiting on a queue. Lives on the waiting thread's stack
+ * 
+ */
+struct waiter
+{
+    thread*             owner;
+    waiter*             next;
+
+    /* What it's waiting on, for queues shared by several conditions */
+    uint32_t            key;
+
+    /* 1 once it's off the queue, 2 once the waker is done with it */
+    volatile uint32_t   state;
+};
+
+class waitQueue
+{
+private:
+    waiter* _head;
+    waiter* _tail;
+public:
+    constexpr waitQueue() : _head(nullptr), _tail(nullptr) {}
+
+    /**
+     * @brief Queue the current thread, at the back. Call sleep() once the
+     * lock is dropped
+     * 
+     * @param w Waiter, on the caller's stack
+     * @param key What it waits on
+     */
+    void add(waiter* w, uint32_t key = 0);
+
+    /**
+     * @brief Wake waiters, oldest first
+     * 
+     * @param count How many, at most
+     * @param key Only the ones waiting on this
+     * @return size_t How many were woken
+     */
+    size_t wake(size_t count, uint32_t key = 0);
+
+    /**
+     * @brief Wake every waiter, whatever its key
+     * 
+     * @return size_t How many were woken
+     */
+    size_t wakeAll();
+
+    /**
+     * @brief Move waiters to another queue, without waking them. Both
+     * queues' locks must be held
+     * 
+     * @param target Where they go. Can be this queue, to change their key
+     * @param count How many, at most, oldest first
+     * @param key Only the ones waiting on this
+     * @param newKey What they wait on from now on
+     * @return size_t How many were moved
+     */
+    size_t requeue(waitQueue* target, size_t count, uint32_t key, uint32_t newKey);
+
+    bool empty() const { return _head == nullptr; }
+};
+
+/**
+ * @brief Sleep until a waiter is woken. No locks may be held
+ * 
+ * @param w Waiter passed to waitQueue::add()
+ */
+void sleep(waiter* w);
+
+} // namespace kernel::sched
@@ -0,0 +1,71 @@
+/**
+ * @file lockstat.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Lock contention profiler. Locks that belong to a lockClass record how
+ * long they're waited on and held, when built with LOCK_PROFILING
+ * @version 0.1
+ * @date 2025-03-12
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace kernel::sync
+{
+
+/**
+ * @brief Counters shared by every lock of one kind (e.g. all run queue locks).
+ * Times are in TSC cycles. Must be a global, it's linked into a list the
+ * first time it's used
+ * 
+ */
+struct lockClass
+{
+    const char*         name;
+
+    /* Times it was taken, and how many of those had to wait */
+    volatile uint32_t   acquisitions;
+    volatile uint32_t   contended;
+
+    uint64_t            waitCycles;
+    uint64_t            maxWait;
+    uint64_t            holdCycles;
+    uint64_t            maxHold;
+
+    /* Next registered class */
+    lockClass*          next;
+    volatile bool       registered;
+
+    constexpr lockClass(const char* className) : name(className), acquisitions(0),
+            contended(0), waitCycles(0), maxWait(0), holdCycles(0), maxHold(0),
+            next(nullptr), registered(false) {}
+};
+
+/**
+ * @brief Record an acquisition
+ * 
+ * @param lc Class of the lock
+ * @param waited Cycles spent waiting for it
+ * @param contended Whether it was held by someone else when we got there
+ */
+void recordAcquire(lockClass* lc, uint64_t waited, bool contended);
+
+/**
+ * @brief Record a release
+ * 
+ * @param lc Class of the lock
+ * @param held Cycles it was held for
+ */
+void recordRelease(lockClass* lc, uint64_t held);
+
+/**
+ * @brief Print the counters of every class used so far
+ * 
+ */
+void printLockStats();
+
+} // namespace kernel::sync
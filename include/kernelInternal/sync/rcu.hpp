@@ -0,0 +1,115 @@
+/**
+ * @file rcu.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Quiescent-state-based read-copy-update. Readers of read-mostly data
+ * take no locks and do no atomics; writers publish a new copy and free the old
+ * one once every processor has gone through a quiescent state (a context
+ * switch, idle, or a tick outside any read section)
+ * @version 0.1
+ * @date 2025-03-14
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <kernelInternal/sched/preempt.hpp>
+
+namespace kernel::rcu
+{
+
+struct rcuHead;
+typedef void (*rcuCallback)(rcuHead* head);
+
+/**
+ * @brief Embed in whatever has to be freed after a grace period
+ * 
+ */
+struct rcuHead
+{
+    rcuHead*        next;
+    rcuCallback     function;
+};
+
+/**
+ * @brief Start a read section. Read sections can't sleep. Interrupt handlers
+ * are read sections already, and don't need this.
+ * A context switch is a quiescent state, so all this has to do is stop them:
+ * it's the (plain, per-thread) preemption count, and would be nothing at all
+ * in a kernel without preemption
+ * 
+ */
+static inline void readLock() { sched::preemptDisable(); }
+
+/**
+ * @brief End a read section
+ * 
+ */
+static inline void readUnlock() { sched::preemptEnable(); }
+
+/**
+ * @brief Read an RCU protected pointer, inside a read section
+ * 
+ * @tparam T 
+ * @param pointer Pointer to read
+ * @return T* 
+ */
+template<typename T> static inline T* dereference(T* const& pointer)
+{
+    // x86 doesn't reorder dependent loads, this only has to stop the compiler
+    return __atomic_load_n(&pointer,__ATOMIC_CONSUME);
+}
+
+/**
+ * @brief Publish a new version of an RCU protected pointer. Everything
+ * written to the new version before this is visible to readers who see it
+ * 
+ * @tparam T 
+ * @param pointer Pointer to update
+ * @param value New version
+ */
+template<typename T> static inline void assignPointer(T*& pointer, T* value)
+{
+    __atomic_store_n(&pointer,value,__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Set up the per-cpu state. Run after smp::init() and before
+ * sched::init()
+ * 
+ */
+void init();
+
+/**
+ * @brief Run function(head) after a grace period: once every read section
+ * that might see the old data is done. Callbacks run in deferred work (not in
+ * interrupt context), on the processor that queued them
+ * 
+ * @param head Head embedded in the old data
+ * @param function Usually frees the old data
+ */
+void callRCU(rcuHead* head, rcuCallback function);
+
+/**
+ * @brief Wait for a grace period. Sleeps, so it must be called from a thread
+ * 
+ */
+void synchronize();
+
+/**
+ * @brief Report a quiescent state for this processor. Called by the scheduler
+ * on every context switch, with interrupts disabled
+ * 
+ */
+void quiescentState();
+
+/**
+ * @brief Called on every scheduler tick, with interrupts disabled
+ * 
+ * @param inReadSection Whether the interrupted code might be in a read section
+ */
+void onTick(bool inReadSection);
+
+} // namespace kernel::rcu
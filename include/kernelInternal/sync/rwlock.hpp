@@ -0,0 +1,100 @@
+/**
+ * @file rwlock.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Reader-writer spinlock. Any number of readers, or one writer. Waiting
+ * writers keep new readers out, so they can't be starved
+ * @version 0.1
+ * @date 2025-03-12
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <kernelInternal/sync/spinlock.hpp>
+
+namespace kernel::sync
+{
+
+class rwSpinlock
+{
+private:
+    /* Readers in the low 16 bits, waiting writers in the next 15, and the
+       top bit set while a writer holds it */
+    volatile uint32_t   _state;
+
+    static const uint32_t READER_MASK =     0x0000ffff;
+    static const uint32_t WRITER_WAITING =  0x00010000;
+    static const uint32_t WAITING_MASK =    0x7fff0000;
+    static const uint32_t WRITER =          0x80000000;
+
+public:
+    constexpr rwSpinlock() : _state(0) {}
+
+    void readLockRaw()
+    {
+        uint32_t state = __atomic_load_n(&_state,__ATOMIC_RELAXED);
+        while (true)
+        {
+            if ((state & (WRITER | WAITING_MASK)) == 0)
+            {
+                if (__atomic_compare_exchange_n(&_state,&state,state + 1,true,
+                        __ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+                    return;
+                continue; // state was reloaded
+            }
+            cpuRelax();
+            state = __atomic_load_n(&_state,__ATOMIC_RELAXED);
+        }
+    }
+
+    void readUnlockRaw() { __atomic_sub_fetch(&_state,1,__ATOMIC_RELEASE); }
+
+    void writeLockRaw()
+    {
+        // Announce ourselves, so no new readers come in
+        uint32_t state = __atomic_add_fetch(&_state,WRITER_WAITING,__ATOMIC_RELAXED);
+        while (true)
+        {
+            if ((state & (WRITER | READER_MASK)) == 0)
+            {
+                if (__atomic_compare_exchange_n(&_state,&state,
+                        (state - WRITER_WAITING) | WRITER,true,
+                        __ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+                    return;
+                continue;
+            }
+            cpuRelax();
+            state = __atomic_load_n(&_state,__ATOMIC_RELAXED);
+        }
+    }
+
+    void writeUnlockRaw() { __atomic_and_fetch(&_state,~WRITER,__ATOMIC_RELEASE); }
+
+    void readLock() { sched::preemptDisable(); readLockRaw(); }
+    void readUnlock() { readUnlockRaw(); sched::preemptEnable(); }
+    void writeLock() { sched::preemptDisable(); writeLockRaw(); }
+    void writeUnlock() { writeUnlockRaw(); sched::preemptEnable(); }
+
+    uint32_t readLockIrqSave()
+    {
+        const uint32_t flags = saveAndDisableInterrupts();
+        readLockRaw();
+        return flags;
+    }
+
+    void readUnlockIrqRestore(uint32_t flags) { readUnlockRaw(); restoreInterrupts(flags); }
+
+    uint32_t writeLockIrqSave()
+    {
+        const uint32_t flags = saveAndDisableInterrupts();
+        writeLockRaw();
+        return flags;
+    }
+
+    void writeUnlockIrqRestore(uint32_t flags) { writeUnlockRaw(); restoreInterrupts(flags); }
+};
+
+} // namespace kernel::sync
@@ -0,0 +1,92 @@
+/**
+ * @file seqlock.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Sequence lock, for small read-mostly data. Readers never write
+ * anything, they just retry if a writer got in the way
+ * @version 0.1
+ * @date 2025-03-12
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <kernelInternal/sync/spinlock.hpp>
+
+/*
+ * Reading:
+ *     uint32_t sequence;
+ *     do {
+ *         sequence = lock.readBegin();
+ *         ... copy the data ...
+ *     } while (lock.readRetry(sequence));
+ * 
+ * Writers are serialized by a spinlock. If readers run in interrupt handlers,
+ * writers must use the IrqSave variant, or a reader could spin forever on the
+ * processor the writer was interrupted on.
+ */
+
+namespace kernel::sync
+{
+
+class seqlock
+{
+private:
+    /* Odd while a write is in progress */
+    volatile uint32_t   _sequence;
+    spinlock            _writer;
+
+public:
+    constexpr seqlock() : _sequence(0), _writer() {}
+
+    uint32_t readBegin()
+    {
+        uint32_t sequence;
+        while ((sequence = __atomic_load_n(&_sequence,__ATOMIC_ACQUIRE)) & 1)
+            cpuRelax();
+        return sequence;
+    }
+
+    /**
+     * @brief Did a write happen since readBegin()?
+     * 
+     * @param sequence Value returned by readBegin()
+     * @return true The data read might be torn, read it again
+     */
+    bool readRetry(uint32_t sequence)
+    {
+        // Data reads can't move below the sequence check
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return __atomic_load_n(&_sequence,__ATOMIC_RELAXED) != sequence;
+    }
+
+    void writeBeginRaw()
+    {
+        _writer.lockRaw();
+        __atomic_store_n(&_sequence,_sequence + 1,__ATOMIC_RELAXED);
+        // Odd sequence is visible before any of the data changes
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
+    void writeEndRaw()
+    {
+        __atomic_store_n(&_sequence,_sequence + 1,__ATOMIC_RELEASE);
+        _writer.unlockRaw();
+    }
+
+    void writeBegin() { sched::preemptDisable(); writeBeginRaw(); }
+    void writeEnd() { writeEndRaw(); sched::preemptEnable(); }
+
+    uint32_t writeBeginIrqSave()
+    {
+        const uint32_t flags = saveAndDisableInterrupts();
+        writeBeginRaw();
+        return flags;
+    }
+
+    void writeEndIrqRestore(uint32_t flags) { writeEndRaw(); restoreInterrupts(flags); }
+};
+
+} // namespace kernel::sync
@@ -0,0 +1,274 @@
+/**
+ * @file spinlock.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Spinlocks: ticket locks (fair, one word), and MCS queue locks (every
+ * waiter spins on its own cache line)
+ * @version 0.1
+ * @date 2025-03-12
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <kernelInternal/sync/lockstat.hpp>
+#include <kernelInternal/sched/preempt.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/system/clock.hpp>
+
+/*
+ * Every lock comes in three flavours:
+ *  - lock()/unlock(): preemption is disabled while it's held. Only after
+ *    sched::init(), and never for locks also taken by interrupt handlers
+ *  - lockIrqSave()/unlockIrqRestore(): interrupts are disabled while it's held
+ *  - lockRaw()/unlockRaw(): nothing, the caller already has interrupts or
+ *    preemption disabled
+ */
+
+namespace kernel::sync
+{
+
+static inline void cpuRelax() { __asm__ __volatile__ ("pause" : : : "memory"); }
+
+/**
+ * @brief Ticket spinlock: waiters take a ticket and get the lock in order
+ * 
+ */
+class ticketSpinlock
+{
+private:
+    volatile uint16_t   _owner;
+    volatile uint16_t   _next;
+    lockClass*          _class;
+#ifdef LOCK_PROFILING
+    uint64_t            _acquiredAt;
+#endif
+
+public:
+    constexpr ticketSpinlock(lockClass* lc = nullptr) : _owner(0), _next(0), _class(lc)
+#ifdef LOCK_PROFILING
+            , _acquiredAt(0)
+#endif
+            {}
+
+    void lockRaw()
+    {
+#ifdef LOCK_PROFILING
+        const uint64_t start = _class ? clock::readTSC() : 0;
+#endif
+        const uint16_t ticket = __atomic_fetch_add(&_next,1,__ATOMIC_RELAXED);
+#ifdef LOCK_PROFILING
+        const bool contended = __atomic_load_n(&_owner,__ATOMIC_RELAXED) != ticket;
+#endif
+        while (__atomic_load_n(&_owner,__ATOMIC_ACQUIRE) != ticket)
+            cpuRelax();
+#ifdef LOCK_PROFILING
+        if (_class)
+        {
+            _acquiredAt = clock::readTSC();
+            recordAcquire(_class,_acquiredAt - start,contended);
+        }
+#endif
+    }
+
+    /**
+     * @brief Take the lock only if it's free
+     * 
+     * @return true We have it
+     */
+    bool tryLockRaw()
+    {
+        // If next == owner nobody holds it or waits for it, and owner can't
+        // move while that's true
+        uint16_t ticket = __atomic_load_n(&_owner,__ATOMIC_RELAXED);
+        const bool taken = __atomic_compare_exchange_n(&_next,&ticket,
+                static_cast<uint16_t>(ticket + 1),false,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED);
+#ifdef LOCK_PROFILING
+        if (taken && _class)
+        {
+            _acquiredAt = clock::readTSC();
+            recordAcquire(_class,0,false);
+        }
+#endif
+        return taken;
+    }
+
+    void unlockRaw()
+    {
+#ifdef LOCK_PROFILING
+        if (_class)
+            recordRelease(_class,clock::readTSC() - _acquiredAt);
+#endif
+        // Only the holder writes owner
+        __atomic_store_n(&_owner,static_cast<uint16_t>(_owner + 1),__ATOMIC_RELEASE);
+    }
+
+    void lock() { sched::preemptDisable(); lockRaw(); }
+
+    bool tryLock()
+    {
+        sched::preemptDisable();
+        if (tryLockRaw())
+            return true;
+        sched::preemptEnable();
+        return false;
+    }
+
+    void unlock() { unlockRaw(); sched::preemptEnable(); }
+
+    /**
+     * @brief Disable interrupts and take the lock
+     * 
+     * @return uint32_t Flags to pass to unlockIrqRestore()
+     */
+    uint32_t lockIrqSave()
+    {
+        const uint32_t flags = saveAndDisableInterrupts();
+        lockRaw();
+        return flags;
+    }
+
+    void unlockIrqRestore(uint32_t flags) { unlockRaw(); restoreInterrupts(flags); }
+
+    bool isLocked() { return __atomic_load_n(&_owner,__ATOMIC_RELAXED) !=
+                             __atomic_load_n(&_next,__ATOMIC_RELAXED); }
+
+    /**
+     * @brief Put a lock that wasn't constructed with a class in one. Only
+     * while nobody is using it
+     * 
+     * @param lc Class it belongs to
+     */
+    void setClass(lockClass* lc) { _class = lc; }
+};
+
+/* Default kernel spinlock */
+typedef ticketSpinlock spinlock;
+
+/**
+ * @brief Queue entry of an MCS lock, one per acquisition. Usually lives on the
+ * stack of whoever takes the lock, and must stay there until the unlock
+ * 
+ */
+struct alignas(64) mcsNode
+{
+    mcsNode* volatile   next;
+    volatile bool       locked;
+};
+
+/**
+ * @brief MCS queue spinlock: waiters form a queue, and each one spins on the
+ * flag in its own node, so a release only touches the next waiter's cache line
+ * 
+ */
+class mcsSpinlock
+{
+private:
+    mcsNode*            _tail;
+    lockClass*          _class;
+#ifdef LOCK_PROFILING
+    uint64_t            _acquiredAt;
+#endif
+
+public:
+    constexpr mcsSpinlock(lockClass* lc = nullptr) : _tail(nullptr), _class(lc)
+#ifdef LOCK_PROFILING
+            , _acquiredAt(0)
+#endif
+            {}
+
+    void lockRaw(mcsNode* node)
+    {
+#ifdef LOCK_PROFILING
+        const uint64_t start = _class ? clock::readTSC() : 0;
+#endif
+        node->next = nullptr;
+        node->locked = true;
+
+        mcsNode* previous = __atomic_exchange_n(&_tail,node,__ATOMIC_ACQ_REL);
+        if (previous != nullptr)
+        {
+            __atomic_store_n(&previous->next,node,__ATOMIC_RELEASE);
+            while (__atomic_load_n(&node->locked,__ATOMIC_ACQUIRE))
+                cpuRelax();
+        }
+#ifdef LOCK_PROFILING
+        if (_class)
+        {
+            _acquiredAt = clock::readTSC();
+            recordAcquire(_class,_acquiredAt - start,previous != nullptr);
+        }
+#endif
+    }
+
+    bool tryLockRaw(mcsNode* node)
+    {
+        node->next = nullptr;
+        node->locked = false;
+        mcsNode* expected = nullptr;
+        const bool taken = __atomic_compare_exchange_n(&_tail,&expected,node,false,
+                __ATOMIC_ACQUIRE,__ATOMIC_RELAXED);
+#ifdef LOCK_PROFILING
+        if (taken && _class)
+        {
+            _acquiredAt = clock::readTSC();
+            recordAcquire(_class,0,false);
+        }
+#endif
+        return taken;
+    }
+
+    void unlockRaw(mcsNode* node)
+    {
+#ifdef LOCK_PROFILING
+        if (_class)
+            recordRelease(_class,clock::readTSC() - _acquiredAt);
+#endif
+        mcsNode* next = __atomic_load_n(&node->next,__ATOMIC_ACQUIRE);
+        if (next == nullptr)
+        {
+            // Nobody behind us, unless someone is halfway through joining
+            mcsNode* expected = node;
+            if (__atomic_compare_exchange_n(&_tail,&expected,nullptr,false,
+                    __ATOMIC_RELEASE,__ATOMIC_RELAXED))
+                return;
+            while ((next = __atomic_load_n(&node->next,__ATOMIC_ACQUIRE)) == nullptr)
+                cpuRelax();
+        }
+        __atomic_store_n(&next->locked,false,__ATOMIC_RELEASE);
+    }
+
+    void lock(mcsNode* node) { sched::preemptDisable(); lockRaw(node); }
+
+    bool tryLock(mcsNode* node)
+    {
+        sched::preemptDisable();
+        if (tryLockRaw(node))
+            return true;
+        sched::preemptEnable();
+        return false;
+    }
+
+    void unlock(mcsNode* node) { unlockRaw(node); sched::preemptEnable(); }
+
+    uint32_t lockIrqSave(mcsNode* node)
+    {
+        const uint32_t flags = saveAndDisableInterrupts();
+        lockRaw(node);
+        return flags;
+    }
+
+    void unlockIrqRestore(mcsNode* node, uint32_t flags)
+    {
+        unlockRaw(node);
+        restoreInterrupts(flags);
+    }
+
+    bool isLocked() { return __atomic_load_n(&_tail,__ATOMIC_RELAXED) != nullptr; }
+
+    void setClass(lockClass* lc) { _class = lc; }
+};
+
+} // namespace kernel::sync
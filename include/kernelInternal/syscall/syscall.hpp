@@ -0,0 +1,290 @@
+/**
+ * @file syscall.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief System calls. Ring 3 comes in through SYSENTER when the processor has
+ * it, or int 0x80 otherwise, and both end up in the same table-driven
+ * dispatcher
+ * @version 0.1
+ * @date 2025-03-18
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/devices/cpu/cpu.hpp>
+
+/*
+ * Calling convention, the same for both paths:
+ *  - eax: system call number, and the result on the way back. Negative
+ *    results are errors (-ENOSYS, ...)
+ *  - ebx, ecx, edx, esi, edi: arguments, in that order
+ *  - int $0x80 keeps every other register
+ *  - SYSENTER goes through sysenterCall (call it, don't jump to it), and
+ *    clobbers ecx and edx
+ */
+
+/* Kernel code and data ring 3 can get at, without a process (see kernel.ld).
+   Code in USER_TEXT can't call anything outside it */
+#define USER_TEXT __attribute__((section(".usertext")))
+#define USER_DATA __attribute__((section(".userdata")))
+
+namespace kernel::syscall
+{
+
+/* Size of the system call table */
+static const uint32_t NUM_SYSCALLS =        64;
+
+/* Arguments a system call can take */
+static const size_t MAX_SYSCALL_ARGS =      5;
+
+/* Where user pointers must point to */
+static const uint32_t USER_SPACE_START =    0x40000000;
+static const uint32_t USER_SPACE_END =      0xc0000000;
+
+/* System call numbers. Never renumber these, user programs depend on them */
+enum syscallNumber : uint32_t
+{
+    SYS_NULL =      0,  // Does nothing, for benchmarks
+    SYS_EXIT =      1,  // Terminate the calling thread (and its process), ebx = status
+    SYS_YIELD =     2,  // Give up the processor
+    SYS_GETCPU =    3,  // Index of the processor we're running on
+    SYS_WRITE =     4,  // Write to a descriptor: ebx = fd, ecx = buffer, edx = length
+    SYS_READ =      5,  // Read from a descriptor: ebx = fd, ecx = buffer, edx = length
+    SYS_CLOSE =     6,  // Close a descriptor: ebx = fd
+    SYS_SPAWN =     7,  // Start a process: ebx = path of the executable, or its name in
+                        // /boot, ecx = its length
+    SYS_PIPE =      8,  // ebx = int[2] for the read and write ends, ecx = 8, edx = PIPE_* flags
+    SYS_PIPE_OPEN = 9,  // Open a named pipe: ebx = name, ecx = its length, edx = PIPE_* flags
+    SYS_SHM_OPEN =  10, // Map a named shared memory segment: ebx = name, ecx = its length,
+                        // edx = size (0 for an existing one). Returns the address
+    SYS_SHM_UNLINK = 11, // Remove the name of a segment: ebx = name, ecx = its length
+    SYS_SHM_WAIT =  12, // Sleep while the word at ebx in a segment is ecx
+    SYS_SHM_WAKE =  13, // Wake up to ecx threads sleeping on the word at ebx
+    SYS_FUTEX =     14, // ebx = FUTEX_* operation, ecx = word, edx = value, esi = second
+                        // word, edi = second value (see ipc/futex.hpp)
+    SYS_OPEN_DEVICE = 15, // Open a block device: ebx = name, ecx = its length
+    SYS_FSYNC =     16, // Make writes to a descriptor stick: ebx = fd
+    SYS_IORING_SETUP = 17, // ebx = io_ring_params (see sys/ioring.h), ecx = its size
+    SYS_IORING_ENTER = 18, // ebx = ring fd, ecx = submissions, edx = completions to
+                        // wait for, esi = IORING_ENTER_* flags
+    SYS_OPEN =      19, // ebx = path, ecx = its length, edx = O_* flags (see sys/fcntl.h)
+    SYS_PREAD =     20, // Read at an offset: ebx = fd, ecx = buffer, edx = length,
+                        // esi = low half of the offset, edi = high half
+    SYS_MMAP =      21, // Map a file: ebx = fd, ecx = length, edx = offset, esi = PROT_*
+                        // flags (see sys/mman.h). Returns the address
+    SYS_MUNMAP =    22, // Remove a mapping: ebx = its address
+    SYS_UNLINK =    23, // Remove a file's name: ebx = path, ecx = its length
+    SYS_FTRUNCATE = 24, // Make a file a size: ebx = fd, ecx = size
+    SYS_GETDENTS =  25, // List a directory from the descriptor's position: ebx = fd,
+                        // ecx = buffer for dirent records (see sys/dirent.h), edx = length
+};
+
+/* Results from -4095 to -1 are errors, anything else (addresses too) isn't */
+static const uint32_t MAX_ERROR =           4095;
+
+/* Error numbers, returned negated. Same values as Linux */
+static const int32_t ENOENT =               2;
+static const int32_t EIO =                  5;
+static const int32_t ENOEXEC =              8;
+static const int32_t EBADF =                9;
+static const int32_t EAGAIN =               11;
+static const int32_t ENOMEM =               12;
+static const int32_t EFAULT =               14;
+static const int32_t EBUSY =                16;
+static const int32_t EEXIST =               17;
+static const int32_t ENOTDIR =              20;
+static const int32_t EISDIR =               21;
+static const int32_t EINVAL =               22;
+static const int32_t EMFILE =               24;
+static const int32_t EFBIG =                27;
+static const int32_t ENOSPC =               28;
+static const int32_t ESPIPE =               29;
+static const int32_t EROFS =                30;
+static const int32_t EPIPE =                32;
+static const int32_t ENAMETOOLONG =         36;
+static const int32_t ENOSYS =               38;
+
+/**
+ * @brief Registers saved on entry, from both paths. Whatever is in eax when
+ * the dispatcher returns is the result
+ * 
+ */
+struct syscallFrame
+{
+    uint32_t            gs, fs, es, ds;
+    cpu::pushad_frame   regs;
+
+    /* What the processor pushes on an int from ring 3 */
+    uint32_t            eip, cs, eflags, userESP, userSS;
+};
+
+/**
+ * @brief What an argument is, so the dispatcher can check it before the
+ * system call sees it
+ * 
+ */
+enum class argKind : uint8_t
+{
+    /* Anything goes */
+    VALUE,
+
+    /* Pointer to user memory. The next argument must be its LENGTH */
+    USER_POINTER,
+
+    /* Size in bytes of the USER_POINTER before it */
+    LENGTH
+};
+
+/**
+ * @brief System call implementation. Arguments past argCount are 0
+ * 
+ */
+typedef int32_t (*syscallFunction)(const uint32_t* args);
+
+/**
+ * @brief Entry of the system call table
+ * 
+ */
+struct syscallDescriptor
+{
+    const char*         name;
+    syscallFunction     function;
+    uint8_t             argCount;
+    argKind             args[MAX_SYSCALL_ARGS];
+};
+
+/**
+ * @brief Counters of a system call, over every processor
+ * 
+ */
+struct syscallStats
+{
+    /* Times it ran */
+    uint32_t            calls;
+
+    /* Times its arguments were bad, and it didn't run */
+    uint32_t            rejected;
+};
+
+/**
+ * @brief Add a system call to the table
+ * 
+ * @param number System call number
+ * @param descriptor What to call and how to check the arguments. Must stay
+ * around forever
+ * @return true It was added
+ * @return false The number is out of range or taken, or the descriptor is
+ * malformed
+ */
+bool registerSyscall(uint32_t number, const syscallDescriptor* descriptor);
+
+/**
+ * @brief Check that a range of memory is all user memory
+ * 
+ * @param address Start of the range
+ * @param length Size, in bytes
+ * @return true The whole range is between USER_SPACE_START and USER_SPACE_END
+ */
+bool isUserRange(uint32_t address, size_t length);
+
+/**
+ * @brief Copy from the current thread's user memory, checking that it's all
+ * there first. Pages that aren't in yet are faulted in as it goes
+ * 
+ * @param destination Kernel buffer
+ * @param source User address
+ * @param length Bytes to copy
+ * @return true It was copied
+ * @return false Part of the range isn't mapped for reading, or a page
+ * couldn't be brought in (out of memory, disk error)
+ */
+bool copyFromUser(void* destination, uint32_t source, size_t length);
+
+/**
+ * @brief Copy to the current thread's user memory, checking that it's all
+ * there and writable first. Pages that aren't in yet are faulted in as it goes
+ * 
+ * @param destination User address
+ * @param source Kernel buffer
+ * @param length Bytes to copy
+ * @return true It was copied
+ * @return false Part of the range isn't mapped for writing, or a page
+ * couldn't be brought in
+ */
+bool copyToUser(uint32_t destination, const void* source, size_t length);
+
+/**
+ * @brief Install the int 0x80 gate, the built-in system calls and, if the
+ * processor has it, SYSENTER on the BSP. Needs smp::init()
+ * 
+ */
+void init();
+
+/**
+ * @brief Set up SYSENTER on this processor, if it's there. The APs call it
+ * on their way up
+ * 
+ */
+void initCPU();
+
+/**
+ * @brief Whether user code can use sysenterCall. If it can't, it must use
+ * int 0x80
+ * 
+ * @return true
+ */
+bool hasSysenter();
+
+/**
+ * @brief Get the counters of a system call
+ * 
+ * @param number System call number
+ * @return syscallStats All zero for out of range numbers
+ */
+syscallStats getStats(uint32_t number);
+
+} // namespace kernel::syscall
+
+extern "C" {
+    /**
+     * @brief C++ side of both entry paths. Runs with interrupts enabled
+     * 
+     * @param frame Saved user registers
+     */
+    void syscallDispatch(kernel::syscall::syscallFrame* frame);
+
+    /**
+     * @brief Drop to ring 3, never to come back except through system calls
+     * and interrupts. Those start again at the top of the thread's kernel
+     * stack, so whatever the caller had on it is gone
+     * 
+     * @param eip Where to start running
+     * @param esp User stack
+     */
+    [[noreturn]] void enterUserMode(uint32_t eip, uint32_t esp);
+
+    /* User side of the SYSENTER path. Not a C function, see the top */
+    extern uint8_t sysenterCall[];
+
+    /* Ring 3 code that exits with -EFAULT, for threads killed by a fault */
+    extern uint8_t userFaultExit[];
+
+    /**
+     * @brief memcpy() that survives faults on user memory: the page fault
+     * handler sends the ones it can't resolve to userCopyFault, which stops
+     * the copy there. Only for ranges isUserRange() said yes to on the user
+     * side
+     * 
+     * @return size_t Bytes not copied, 0 if it all was
+     */
+    size_t userCopy(void* destination, const void* source, size_t length);
+
+    /* The instruction in userCopy() that touches memory, and where it goes on
+       a fault there that can't be resolved */
+    extern uint8_t userCopyAccess[];
+    extern uint8_t userCopyFault[];
+}
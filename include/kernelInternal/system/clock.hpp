@@ -0,0 +1,97 @@
+/**
+ * @file clock.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief TSC based clocksource, calibrated against the PIT
+ * @version 0.1
+ * @date 2025-03-08
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace kernel::clock
+{
+
+/**
+ * @brief Parameters to convert TSC cycles to nanoseconds:
+ * ns = ((tsc - tscBase) * mult) >> shift
+ * 
+ */
+struct clockParameters
+{
+    /* TSC value at nanosecond 0 */
+    uint64_t        tscBase;
+
+    /* Multiplier and shift, chosen so mult fits in 32 bits */
+    uint32_t        mult;
+    uint32_t        shift;
+
+    /* TSC frequency, in Hz */
+    uint64_t        tscFrequency;
+};
+
+/**
+ * @brief Read the time stamp counter
+ * 
+ * @return uint64_t 
+ */
+static inline uint64_t readTSC()
+{
+    uint32_t low,high;
+    __asm__ __volatile__ ("rdtsc" : "=a"(low), "=d"(high));
+    return static_cast<uint64_t>(high) << 32 | low;
+}
+
+/**
+ * @brief Multiply a 64-bit value by a 32-bit one and shift the (96-bit) result
+ * right, without needing 64-bit division or 128-bit types
+ * 
+ * @param value 64-bit value
+ * @param mult 32-bit multiplier
+ * @param shift Right shift, at most 32
+ * @return uint64_t (value * mult) >> shift
+ */
+static inline uint64_t mulShift(uint64_t value, uint32_t mult, uint32_t shift)
+{
+    const uint32_t low = static_cast<uint32_t>(value);
+    const uint32_t high = static_cast<uint32_t>(value >> 32);
+    uint64_t result = (static_cast<uint64_t>(low) * mult) >> shift;
+    if (high != 0)
+        result += (static_cast<uint64_t>(high) * mult) << (32 - shift);
+    return result;
+}
+
+/**
+ * @brief Calibrate the TSC against the PIT. Must be run before anything else
+ * in here
+ * 
+ */
+void init();
+
+/**
+ * @brief Get a consistent copy of the current conversion parameters
+ * 
+ * @return clockParameters 
+ */
+clockParameters getParameters();
+
+/**
+ * @brief Nanoseconds since init()
+ * 
+ * @return uint64_t 
+ */
+uint64_t nanoseconds();
+
+/**
+ * @brief Convert a number of TSC cycles to nanoseconds
+ * 
+ * @param cycles Cycles to convert
+ * @return uint64_t 
+ */
+uint64_t cyclesToNanoseconds(uint64_t cycles);
+
+} // namespace kernel::clock
@@ -0,0 +1,142 @@
+/**
+ * @file deferred.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Deferred interrupt work (bottom halves). Interrupt handlers queue work
+ * items on a per-cpu lock-free queue, which run later with interrupts enabled,
+ * either on the way out of the interrupt or in the processor's worker thread
+ * @version 0.1
+ * @date 2025-03-10
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace kernel::deferred
+{
+
+/**
+ * @brief Work priorities, like softirqs. Higher ones always run first
+ * 
+ */
+enum class workPriority : uint8_t
+{
+    HIGH =      0,
+    TIMER =     1,
+    BLOCK =     2,
+    NET =       3,
+    NORMAL =    4
+};
+
+static const size_t NUM_WORK_PRIORITIES =   5;
+
+/* Items run on the way out of an interrupt, the rest is left to the worker */
+static const uint32_t IRQ_EXIT_BUDGET =     16;
+
+/* Items the worker runs before it lets others have the processor */
+static const uint32_t WORKER_BUDGET =       64;
+
+struct workItem;
+typedef void (*workFunction)(workItem* item);
+
+/**
+ * @brief A piece of deferred work. Embed it in whatever the function needs to
+ * get at, and queue the same item again whenever there's more to do
+ * 
+ */
+struct workItem
+{
+    /* Next in the queue */
+    workItem*           next;
+
+    workFunction        function;
+    workPriority        priority;
+
+    /* Set while it's queued, so it isn't queued twice */
+    volatile bool       pending;
+
+    /* TSC when it was queued, for the latency counters */
+    uint64_t            queuedAt;
+};
+
+/**
+ * @brief Counters of one priority on one processor. Latencies are in TSC
+ * cycles, from queueing to the start of the function
+ * 
+ */
+struct workStats
+{
+    /* Items queued, and items run */
+    volatile uint32_t   queued;
+    uint32_t            executed;
+
+    /* Items waiting right now, and the most there ever were */
+    volatile uint32_t   depth;
+    volatile uint32_t   maxDepth;
+
+    uint64_t            totalLatency;
+    uint64_t            maxLatency;
+};
+
+/**
+ * @brief Set up an item
+ * 
+ * @param item Item to set up
+ * @param function Function to run
+ * @param priority Priority it runs at
+ */
+void initItem(workItem* item, workFunction function, workPriority priority);
+
+/**
+ * @brief Queue an item on this processor. Safe from interrupt handlers
+ * 
+ * @param item Item to queue
+ * @return true It was queued
+ * @return false It was queued already, and hasn't run yet
+ */
+bool queueWork(workItem* item);
+
+/**
+ * @brief Queue an item on some processor
+ * 
+ * @param cpu Index of the processor
+ * @param item Item to queue
+ * @return true It was queued
+ * @return false It was queued already, or there's no such processor
+ */
+bool queueWorkOn(size_t cpu, workItem* item);
+
+/**
+ * @brief Start a worker thread on every processor that's online. Must run
+ * after smp::startAPs(). Items queued before this run once it's done
+ * 
+ */
+void init();
+
+/**
+ * @brief Called by the interrupt dispatcher before running a handler
+ * 
+ */
+void interruptEnter();
+
+/**
+ * @brief Called by the interrupt dispatcher after the EOI, runs some of the
+ * pending work
+ * 
+ */
+void interruptExit();
+
+/**
+ * @brief Get the counters of a priority on a processor
+ * 
+ * @param cpu Index of the processor
+ * @param priority Priority
+ * @return const workStats* nullptr if the processor is out of range
+ */
+const workStats* getStats(size_t cpu, workPriority priority);
+
+} // namespace kernel::deferred
@@ -0,0 +1,136 @@
+/**
+ * @file gdt.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Per-processor GDT and TSS
+ * @version 0.1
+ * @date 2025-03-02
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/gdt.h>
+
+namespace kernel
+{
+
+/**
+ * @brief Segment descriptor, as the processor wants it
+ * 
+ */
+struct segmentDescriptor
+{
+    uint16_t        limit_low;
+    uint16_t        base_low;
+    uint8_t         base_mid;
+
+    /* Present, DPL, type */
+    uint8_t         access;
+
+    /* Granularity and size flags on the high nibble, limit[16:19] on the low */
+    uint8_t         flags_limit_high;
+    uint8_t         base_high;
+}__attribute__((packed));
+
+static_assert(sizeof(segmentDescriptor) == 8);
+
+/**
+ * @brief 32-bit Task State Segment. We don't do hardware task switching, it's
+ * only here so the processor knows which stack to use when coming from ring 3
+ * 
+ */
+struct taskStateSegment
+{
+    uint32_t        prev_task;
+
+    /* Stack used when entering ring 0 */
+    uint32_t        esp0;
+    uint32_t        ss0;
+
+    uint32_t        esp1, ss1, esp2, ss2;
+    uint32_t        cr3, eip, eflags;
+    uint32_t        eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t        es, cs, ss, ds, fs, gs, ldt;
+    uint16_t        trap;
+
+    /* Offset of the I/O permission bitmap, past the limit means no bitmap */
+    uint16_t        iomap_base;
+}__attribute__((packed));
+
+static_assert(sizeof(taskStateSegment) == 104);
+
+struct globalDescriptorTableRegister
+{
+    /* Size is one less than the GDT in bytes */
+    uint16_t            size;
+
+    /* Linear address of the GDT */
+    uint32_t            address;
+}__attribute__((packed));
+
+static_assert(sizeof(globalDescriptorTableRegister) == 6);
+
+/**
+ * @brief GDT of one processor. Every processor gets its own copy, so that the
+ * TSS and per-cpu (%gs) selectors are the same everywhere, but point to
+ * different places
+ * 
+ */
+class globalDescriptorTable
+{
+private:
+    __attribute__((aligned(8)))
+    segmentDescriptor _table[GDT_ENTRIES];
+    taskStateSegment _tss;
+
+    void setEntry(uint16_t selector, uint32_t base, uint32_t limit,
+            uint8_t access, uint8_t flags);
+public:
+    /**
+     * @brief Fill the table with the flat kernel/user segments, the TSS and
+     * the per-cpu segment
+     * 
+     * @param perCPUBase Base of the %gs segment. It covers the whole address
+     * space, so that %gs:address lands address + perCPUBase (mod 4 GiB)
+     * @param kernelStack Stack to load when coming from ring 3
+     */
+    void init(uint32_t perCPUBase, uint32_t kernelStack);
+
+    /**
+     * @brief Change the ring 0 stack in the TSS
+     * 
+     * @param kernelStack Top of the new stack
+     */
+    void setKernelStack(uint32_t kernelStack) { _tss.esp0 = kernelStack; }
+
+    /**
+     * @brief Where the TSS keeps the ring 0 stack. SYSENTER loads %esp from
+     * this, and the entry code takes the real stack from there
+     * 
+     * @return uint32_t Linear address of esp0
+     */
+    uint32_t kernelStackSlot()
+    {
+        return reinterpret_cast<uint32_t>(&_tss) + offsetof(taskStateSegment,esp0);
+    }
+
+    /**
+     * @brief Get a GDTR value pointing to this table
+     * 
+     * @return globalDescriptorTableRegister 
+     */
+    globalDescriptorTableRegister getRegister();
+
+    /**
+     * @brief Load this table with LGDT, reload every segment register and
+     * load the task register. Must be run on the processor that owns it
+     * 
+     */
+    void load();
+};
+
+} // namespace kernel
@@ -23,6 +23,26 @@ namespace kernel
 static const int MASTER_PIC_VECTOR_OFFSET = 0xfe;
 static const int SLAVE_PIC_VECTOR_OFFSET = 0xfe;
 
+// Page fault exception, with the faulting address in CR2
+static const uint8_t PAGE_FAULT_VECTOR = 0x0e;
+
+// Local APIC timer, drives preemption
+static const uint8_t LAPIC_TIMER_VECTOR = 0x20;
+
+// COM1, through the IO APIC
+static const uint8_t SERIAL_VECTOR = 0x24;
+
+// Vectors used for inter-processor interrupts
+static const uint8_t IPI_TLB_SHOOTDOWN_VECTOR = 0xf0;
+static const uint8_t IPI_RESCHEDULE_VECTOR = 0xf1;
+
+// System calls with int, callable from ring 3
+static const uint8_t SYSCALL_VECTOR = 0x80;
+
+// First vector that comes from the local APIC (and so needs an EOI)
+static const uint8_t FIRST_EXTERNAL_VECTOR = 32;
+static const uint8_t SPURIOUS_VECTOR = 0xff;
+
 /**
  * @brief Flag field of the interrupt descriptor
  * 
@@ -84,13 +104,17 @@ static_assert(sizeof(interruptDescriptorTableRegister) == 6);
 
 struct isr_frame_t
 {
+    /* Data segments of the interrupted code */
+    uint32_t            gs, fs, es, ds;
+
     cpu::pushad_frame   pFrame;
 
     uint32_t intNumber, errorCode, eip, cs, eflags;
 };
 
+// Inline, so that every processor (and translation unit) sees the same table
 __attribute__((aligned(0x10)))
-static interruptDescriptor __idt_table[256];
+inline interruptDescriptor __idt_table[256];
 
 /**
  * @brief Class 
@@ -155,6 +179,25 @@ public:
     bool init();
 };
 
+/**
+ * @brief C++ handler for an interrupt vector. It may modify the frame, which is
+ * restored on return
+ * 
+ */
+typedef void (*interruptHandler_t)(isr_frame_t* frame);
+
+/**
+ * @brief Register the C++ handler for an interrupt vector. The EOI is taken
+ * care of by the dispatcher. The old handler may still be running on other
+ * processors until rcu::synchronize() returns
+ * 
+ * @param vector Vector to handle
+ * @param handler Handler to call, nullptr to remove it
+ * @return true If the handler was installed
+ * @return false If the vector is reserved (the spurious vector)
+ */
+bool setInterruptHandler(uint8_t vector, interruptHandler_t handler);
+
 /**
  * @brief Set the interrupt flag
  * 
@@ -167,6 +210,29 @@ static inline void enableInterrupts(void) { __asm__ __volatile__ ("sti"); }
  */
 static inline void disableInterrupts(void) { __asm__ __volatile__ ("cli"); }
 
+/**
+ * @brief Disable interrupts, returning the previous state of EFLAGS
+ * 
+ * @return uint32_t EFLAGS, to pass to restoreInterrupts()
+ */
+static inline uint32_t saveAndDisableInterrupts(void)
+{
+    uint32_t flags;
+    __asm__ __volatile__ ("pushfl\n\tpopl %0\n\tcli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+/**
+ * @brief Restore the interrupt flag saved by saveAndDisableInterrupts()
+ * 
+ * @param flags EFLAGS returned by saveAndDisableInterrupts()
+ */
+static inline void restoreInterrupts(uint32_t flags)
+{
+    if (flags & (1 << 9)) // IF
+        __asm__ __volatile__ ("sti" : : : "memory");
+}
+
 /**
  * @brief Disable the PIC
  * 
@@ -0,0 +1,208 @@
+/**
+ * @file log.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Kernel log. Each processor appends records to its own ring, without
+ * locks, and a low priority thread merges them by time and writes them to out
+ * (the screen, and whatever mirrors it). Levels above KERNEL_LOG_LEVEL aren't
+ * compiled in at all
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <klib/format.hpp>
+#include <klib/string.h>
+
+/*
+ * Use:
+ *     LOG_INFO << "Mounted " << name << " at " << path;
+ *     LOG_TRACE << "Cluster 0x" << kernel::log::hex << cluster;
+ * One statement is one line, no '\n' needed. With the level compiled out, the
+ * operands aren't even evaluated
+ */
+
+/* Most verbose level compiled in: 0 errors, 1 warnings, 2 info, 3 debug,
+   4 traces. The build sets it from the build type */
+#ifndef KERNEL_LOG_LEVEL
+#define KERNEL_LOG_LEVEL 2
+#endif
+
+namespace kernel::log
+{
+
+enum class level : uint8_t
+{
+    ERROR =     0,
+    WARNING =   1,
+    INFO =      2,
+    DEBUG =     3,
+    TRACE =     4
+};
+
+/* Records in each processor's ring, a power of 2 */
+static const uint32_t RING_RECORDS =        128;
+
+/* Text a record holds, longer lines are cut */
+static const size_t RECORD_TEXT_SIZE =      112;
+
+static_assert((RING_RECORDS & (RING_RECORDS - 1)) == 0);
+
+/**
+ * @brief Whether a level is compiled in
+ * 
+ */
+constexpr bool enabled(level l)
+{
+    return static_cast<int>(l) <= KERNEL_LOG_LEVEL;
+}
+
+/**
+ * @brief Number base for the numbers after it in a line, hex or dec
+ * 
+ */
+struct numberBase
+{
+    int         value;
+};
+
+inline constexpr numberBase hex = {16};
+inline constexpr numberBase dec = {10};
+
+/**
+ * @brief Counters of one processor's ring
+ * 
+ */
+struct logStats
+{
+    /* Records written to the ring */
+    uint32_t    written;
+
+    /* Records lost because the ring was full */
+    uint32_t    dropped;
+};
+
+/**
+ * @brief Append a line to this processor's ring, and get the thread to write
+ * it out. Safe from interrupt handlers, but not with scheduler locks held.
+ * Before init(), the line is written out straight away
+ * 
+ * @param l Level of the line
+ * @param text Text, without a '\n'
+ * @param length Length of the text
+ */
+void write(level l, const char* text, size_t length);
+
+/**
+ * @brief Give every processor a ring, and start the thread that writes them
+ * out. After smp::startAPs()
+ * 
+ */
+void init();
+
+/**
+ * @brief Write out everything in the rings now, from a thread
+ * 
+ */
+void flush();
+
+/**
+ * @brief Get the counters of a processor's ring
+ * 
+ * @param cpu Index of the processor
+ * @return logStats Zeros if it's out of range, or before init()
+ */
+logStats getStats(size_t cpu);
+
+/**
+ * @brief One line being put together, which goes to write() at the end of the
+ * statement. Use the LOG_ macros, not this
+ * 
+ */
+class line
+{
+public:
+    explicit line(level l) : _level(l), _base(10), _length(0) {}
+    ~line() { write(_level,_text,_length); }
+
+    line(const line&) = delete;
+    line& operator=(const line&) = delete;
+
+    line& operator<<(const char* str)
+    {
+        while (*str != '\0' && _length < RECORD_TEXT_SIZE)
+            _text[_length++] = *str++;
+        return *this;
+    }
+
+    line& operator<<(char* str) { return *this << static_cast<const char*>(str); }
+
+    line& operator<<(char c)
+    {
+        if (_length < RECORD_TEXT_SIZE)
+            _text[_length++] = c;
+        return *this;
+    }
+
+    line& operator<<(numberBase b)
+    {
+        _base = b.value;
+        return *this;
+    }
+
+    template<typename T> line& operator<<(T num)
+    {
+        char str[io::FORMAT_NUMBER_SIZE];
+        return append(str,io::formatNumber(num,str,_base));
+    }
+
+    template<typename T> line& operator<<(T* ptr)
+    {
+        char str[io::FORMAT_NUMBER_SIZE];
+        return append(str,io::formatHex(reinterpret_cast<uint32_t>(ptr),str,true));
+    }
+
+private:
+    line& append(const char* str, size_t length)
+    {
+        if (length > RECORD_TEXT_SIZE - _length)
+            length = RECORD_TEXT_SIZE - _length;
+        memcpy(_text + _length,str,length);
+        _length += length;
+        return *this;
+    }
+
+    level       _level;
+    int         _base;
+    size_t      _length;
+    char        _text[RECORD_TEXT_SIZE];
+};
+
+/**
+ * @brief Turns a line into a void expression, for LOG_AT. & binds more loosely
+ * than <<, so it comes after the whole line
+ * 
+ */
+struct voidLine
+{
+    void operator&(const line&) {}
+};
+
+} // namespace kernel::log
+
+/* Start a line at a level. An expression rather than an if, so it's safe in an
+   if without braces. With a constant false condition a compiled out line never
+   evaluates its operands, and optimized builds have no code left of it */
+#define LOG_AT(l) !kernel::log::enabled(l) ? static_cast<void>(0) : \
+    kernel::log::voidLine() & kernel::log::line(l)
+
+#define LOG_ERROR   LOG_AT(kernel::log::level::ERROR)
+#define LOG_WARNING LOG_AT(kernel::log::level::WARNING)
+#define LOG_INFO    LOG_AT(kernel::log::level::INFO)
+#define LOG_DEBUG   LOG_AT(kernel::log::level::DEBUG)
+#define LOG_TRACE   LOG_AT(kernel::log::level::TRACE)
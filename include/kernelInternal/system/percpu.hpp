@@ -0,0 +1,133 @@
+/**
+ * @file percpu.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Per-cpu variables. They're linked into the .percpu section, which is
+ * only a template: every processor gets its own copy, and its %gs segment is
+ * based so that %gs:&variable lands on that copy. Accessing this processor's
+ * copy is a single %gs-prefixed instruction
+ * @version 0.1
+ * @date 2025-03-16
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Before smp::init() %gs is the flat data segment, so the accessors reach the
+ * template itself, which smp::init() then copies for every processor.
+ * 
+ * Use:
+ *     DEFINE_PER_CPU(uint32_t, interruptCount);     // In one .cpp
+ *     DECLARE_PER_CPU(uint32_t, interruptCount);    // In a header, if needed
+ *     kernel::smp::thisCPUInc(interruptCount);
+ */
+
+/* Define a per-cpu variable. Can be static */
+#define DEFINE_PER_CPU(type, name) __attribute__((section(".percpu"))) type name
+
+/* Declare a per-cpu variable defined elsewhere */
+#define DECLARE_PER_CPU(type, name) extern type name
+
+extern "C" {
+    extern uint8_t __percpu_start[];
+    extern uint8_t __percpu_end[];
+}
+
+namespace kernel::smp
+{
+
+template<typename T> struct isPerCPUScalar
+{
+    static const bool value = sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4;
+};
+
+/**
+ * @brief Read this processor's copy of a per-cpu variable
+ * 
+ * @tparam T 1, 2 or 4 bytes
+ * @param variable Per-cpu variable
+ * @return T
+ */
+template<typename T> static inline T thisCPURead(const T& variable)
+{
+    static_assert(isPerCPUScalar<T>::value, "Per-cpu access must be 1, 2 or 4 bytes");
+    T value;
+    __asm__ __volatile__ ("mov %%gs:%1, %0" : "=q"(value) : "m"(variable));
+    return value;
+}
+
+/**
+ * @brief Write this processor's copy of a per-cpu variable
+ * 
+ * @tparam T 1, 2 or 4 bytes
+ * @param variable Per-cpu variable
+ * @param value Value to write
+ */
+template<typename T> static inline void thisCPUWrite(T& variable, T value)
+{
+    static_assert(isPerCPUScalar<T>::value, "Per-cpu access must be 1, 2 or 4 bytes");
+    __asm__ __volatile__ ("mov %1, %%gs:%0" : "=m"(variable) : "qi"(value) : "memory");
+}
+
+/**
+ * @brief Add to this processor's copy of a per-cpu variable. A single
+ * instruction, so an interrupt can't split it
+ * 
+ * @tparam T 1, 2 or 4 bytes
+ * @param variable Per-cpu variable
+ * @param value Value to add
+ */
+template<typename T> static inline void thisCPUAdd(T& variable, T value)
+{
+    static_assert(isPerCPUScalar<T>::value, "Per-cpu access must be 1, 2 or 4 bytes");
+    __asm__ __volatile__ ("add%z0 %1, %%gs:%0" : "+m"(variable) : "qi"(value) : "memory");
+}
+
+template<typename T> static inline void thisCPUInc(T& variable) { thisCPUAdd(variable,T(1)); }
+template<typename T> static inline void thisCPUDec(T& variable) { thisCPUAdd(variable,T(-1)); }
+
+/**
+ * @brief Distance from the template to a processor's copy of the per-cpu
+ * variables, which is also the base of its %gs segment
+ * 
+ * @param cpu Index of the processor
+ * @return uint32_t 0 before smp::init(), or for unknown processors
+ */
+uint32_t perCPUOffset(size_t cpu);
+
+/* perCPUOffset() of the processor itself */
+DECLARE_PER_CPU(uint32_t, localOffset);
+
+/**
+ * @brief Get a pointer to some processor's copy of a per-cpu variable
+ * 
+ * @tparam T
+ * @param variable Per-cpu variable
+ * @param cpu Index of the processor
+ * @return T*
+ */
+template<typename T> static inline T* perCPUPointer(T& variable, size_t cpu)
+{
+    return reinterpret_cast<T*>(reinterpret_cast<uint32_t>(&variable) + perCPUOffset(cpu));
+}
+
+/**
+ * @brief Get a pointer to this processor's copy of a per-cpu variable, for
+ * things that don't fit in a register. Only valid as long as the caller can't
+ * move to another processor
+ * 
+ * @tparam T 
+ * @param variable Per-cpu variable
+ * @return T* 
+ */
+template<typename T> static inline T* thisCPUPointer(T& variable)
+{
+    return reinterpret_cast<T*>(reinterpret_cast<uint32_t>(&variable) + thisCPURead(localOffset));
+}
+
+} // namespace kernel::smp
@@ -0,0 +1,153 @@
+/**
+ * @file smp.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Multiprocessor support: finding the processors, starting the APs, and
+ * per-cpu data
+ * @version 0.1
+ * @date 2025-03-02
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernelInternal/acpi.hpp>
+#include <kernelInternal/devices/cpu/apic.hpp>
+#include <kernelInternal/system/gdt.hpp>
+#include <kernelInternal/system/percpu.hpp>
+
+namespace kernel::smp
+{
+
+/* Maximum number of processors we can deal with */
+static const size_t MAX_CPUS =                  32;
+
+/* Set of processors, one bit per processor index */
+typedef uint32_t cpuMask;
+static_assert(MAX_CPUS <= sizeof(cpuMask) * 8, "cpuMask is too small for MAX_CPUS");
+
+/* Size of the stack each AP starts running on */
+static const size_t AP_STACK_SIZE =             16384;
+
+/* Where the real mode trampoline is copied to. Must be page aligned and below
+   1 MiB. This is the bootloader's disk buffer, which nobody uses anymore */
+static const uint32_t AP_TRAMPOLINE_ADDRESS =   0x70000;
+
+/**
+ * @brief Per-cpu control block, with what other processors need to get at.
+ * Anything only the processor itself uses should be a DEFINE_PER_CPU variable
+ * instead. Cache line aligned, so processors don't fight over each other's data
+ * 
+ */
+struct alignas(64) perCPU
+{
+    /* Index of the processor (0 is the BSP) */
+    uint32_t                index;
+
+    /* Local APIC ID */
+    uint32_t                apicID;
+
+    /* Set by the processor itself once it's up and running */
+    volatile bool           online;
+
+    /* Top of the stack the processor booted on */
+    uint32_t                stackTop;
+
+    /* Address space (CR3) the processor is currently running in, used to skip
+       TLB shootdowns of address spaces it isn't in */
+    volatile uint32_t       activeCR3;
+
+    /* This processor's GDT and TSS */
+    globalDescriptorTable   gdt;
+};
+
+/* Control block and index of each processor, as per-cpu variables */
+DECLARE_PER_CPU(perCPU*, cpuBlock);
+DECLARE_PER_CPU(uint32_t, cpuNumber);
+
+/**
+ * @brief Get the per-cpu block of the processor running this code
+ * 
+ * @return perCPU* nullptr before init()
+ */
+static inline perCPU* thisCPU()
+{
+    return thisCPURead(cpuBlock);
+}
+
+/**
+ * @brief Get the index of the processor running this code
+ * 
+ * @return uint32_t 
+ */
+static inline uint32_t cpuIndex()
+{
+    return thisCPURead(cpuNumber);
+}
+
+/**
+ * @brief Find the processors in the MADT, give every one of them its per-cpu
+ * block and copy of the per-cpu variables, and load the GDT of the BSP. Needs
+ * the heap. Must be run on the BSP, with the local APIC enabled
+ * 
+ * @param madt MADT to enumerate the processors from
+ * @param lapic Local APIC of the BSP
+ * @return size_t Number of usable processors found (including the BSP)
+ */
+size_t init(acpi::acpi_madt* madt, cpu::l_apic* lapic);
+
+/**
+ * @brief Start all the APs found by init() with INIT-SIPI-SIPI
+ * 
+ * @return size_t Number of processors online (including the BSP)
+ */
+size_t startAPs();
+
+/**
+ * @brief Number of processors found by init()
+ * 
+ * @return size_t 
+ */
+size_t cpuCount();
+
+/**
+ * @brief Get the per-cpu block of some processor
+ * 
+ * @param index Index of the processor
+ * @return perCPU* nullptr if the index is out of range
+ */
+perCPU* getCPU(size_t index);
+
+/**
+ * @brief Get the set of processors that are online
+ * 
+ * @return cpuMask 
+ */
+cpuMask onlineMask();
+
+/**
+ * @brief Send an IPI to every processor in a set
+ * 
+ * @param mask Processors to send it to
+ * @param vector Interrupt vector to raise
+ */
+void sendIPI(cpuMask mask, uint8_t vector);
+
+/**
+ * @brief Send an IPI to every other online processor
+ * 
+ * @param vector Interrupt vector to raise
+ */
+void broadcastIPI(uint8_t vector);
+
+} // namespace kernel::smp
+
+/**
+ * @brief Protected mode C++ entry point of the APs, called from the trampoline
+ * 
+ * @param index Index of the processor
+ */
+extern "C" [[noreturn]] void apMain(uint32_t index);
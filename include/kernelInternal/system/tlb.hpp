@@ -0,0 +1,121 @@
+/**
+ * @file tlb.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief TLB invalidation, locally and on other processors (shootdowns)
+ * @version 0.1
+ * @date 2025-03-05
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace kernel::tlb
+{
+
+static const uint32_t PAGE_SIZE =               4096;
+
+/* Ranges a single batch can hold before it degrades to a full flush */
+static const size_t BATCH_RANGES =              8;
+
+/* Past this many pages, reloading CR3 is cheaper than invlpg on each page */
+static const uint32_t FULL_FLUSH_THRESHOLD =    32;
+
+/* Address space value meaning "every address space" (kernel mappings) */
+static const uint32_t ALL_ADDRESS_SPACES =      0;
+
+struct range
+{
+    /* Page aligned start address */
+    uint32_t        start;
+
+    /* Number of pages */
+    uint32_t        pages;
+};
+
+/**
+ * @brief A set of invalidations for one address space, sent to the other
+ * processors in a single IPI round. Add every page that was unmapped, then
+ * flush() once
+ * 
+ */
+class shootdownBatch
+{
+private:
+    uint32_t _cr3;
+    range _ranges[BATCH_RANGES];
+    size_t _count;
+    uint32_t _pages;
+    bool _flushAll;
+public:
+    /**
+     * @brief Start a batch
+     * 
+     * @param cr3 Address space the mappings belong to, ALL_ADDRESS_SPACES for
+     * kernel mappings
+     */
+    shootdownBatch(uint32_t cr3) : _cr3(cr3), _count(0), _pages(0),
+                _flushAll(false) {}
+
+    /**
+     * @brief Add a range of pages to invalidate
+     * 
+     * @param address Address of the first page
+     * @param pages Number of pages
+     */
+    void add(uint32_t address, uint32_t pages = 1);
+
+    /**
+     * @brief Invalidate everything in the batch, on this processor and on
+     * every other processor that might have it cached, and wait for them. The
+     * batch is empty afterwards
+     * 
+     */
+    void flush();
+
+    /**
+     * @brief Whether the batch is going to reload CR3 instead of using invlpg
+     * 
+     */
+    bool isFullFlush() { return _flushAll; }
+};
+
+/**
+ * @brief Register the shootdown IPI handler. Call once, on the BSP
+ * 
+ */
+void init();
+
+/**
+ * @brief Record the address space this processor just switched to. Must be
+ * called before loading CR3, so shootdowns can't miss it
+ * 
+ * @param cr3 New address space
+ */
+void setActiveAddressSpace(uint32_t cr3);
+
+/**
+ * @brief Invalidate a single page on this processor
+ * 
+ * @param address Address inside the page
+ */
+static inline void invalidatePage(uint32_t address)
+{
+    __asm__ __volatile__ ("invlpg (%0)" : : "r"(address) : "memory");
+}
+
+/**
+ * @brief Flush every (non-global) TLB entry on this processor by reloading CR3
+ * 
+ */
+static inline void flushLocal()
+{
+    uint32_t cr3;
+    __asm__ __volatile__ ("mov %%cr3, %0\n\tmov %0, %%cr3" : "=r"(cr3) : : "memory");
+}
+
+} // namespace kernel::tlb
@@ -0,0 +1,48 @@
+/**
+ * @file vdso.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Page shared read-only with every process (see sys/vdso.h), that lets
+ * user programs read the clock without a system call
+ * @version 0.1
+ * @date 2025-03-21
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/vdso.h>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/mm/addressSpace.hpp>
+
+namespace kernel::vdso
+{
+
+/**
+ * @brief Allocate the page, and fill it in from the clock and the system call
+ * setup. Needs mm::init(), clock::init() and syscall::init()
+ * 
+ */
+void init();
+
+/**
+ * @brief Publish new clock parameters. Call it whenever they change, before
+ * init() it does nothing
+ * 
+ * @param parameters New parameters
+ */
+void updateClock(const clock::clockParameters& parameters);
+
+/**
+ * @brief Map the page at VDSO_DATA_ADDRESS, read-only. It faults in like any
+ * other page
+ * 
+ * @param space Address space of a new process
+ * @return true It was mapped
+ * @return false Out of memory, or init() didn't run
+ */
+bool mapInto(mm::addressSpace* space);
+
+} // namespace kernel::vdso
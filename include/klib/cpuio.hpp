@@ -30,6 +30,30 @@ static inline uint8_t inb(uint16_t port)
     return byte;
 }
 
+static inline void outw(uint16_t port, uint16_t word)
+{
+    __asm__ __volatile__ ("outw %[w], %[p]" : : [w]"a"(word), [p]"Nd"(port));
+}
+
+static inline uint16_t inw(uint16_t port)
+{
+    uint16_t word;
+    __asm__ __volatile__ ("inw %[p], %[w]" : [w]"=a"(word) : [p]"Nd"(port));
+    return word;
+}
+
+/* Read count words from port into buffer */
+static inline void insw(uint16_t port, void* buffer, uint32_t count)
+{
+    __asm__ __volatile__ ("rep insw" : "+D"(buffer), "+c"(count) : "d"(port) : "memory");
+}
+
+/* Write count words from buffer to port */
+static inline void outsw(uint16_t port, const void* buffer, uint32_t count)
+{
+    __asm__ __volatile__ ("rep outsw" : "+S"(buffer), "+c"(count) : "d"(port) : "memory");
+}
+
 static inline void iowait()
 {
     outb(io_port,0);
@@ -39,7 +39,12 @@ template <typename T> static char* xtoa(T value, char* str, int base) {
     size_t index = 0;
     for (; num != 0; ++index)
     {
-        char digit = static_cast<char>(num % convertedBase); // Guaranteed between 0 and base
+        // Between 0 and base, or 0 and -base for negative values
+        char digit = static_cast<char>(num % convertedBase);
+        if (digit < 0)
+        {
+            digit = static_cast<char>(-digit);
+        }
         if (digit < 10)
         {
             str[index] = '0' + digit;
@@ -51,7 +56,7 @@ template <typename T> static char* xtoa(T value, char* str, int base) {
         num /= convertedBase;
     }
 
-    if (convertedBase == 10 && value < 0)
+    if (value < 0)
     {
         str[index] = '-';
         index++;
@@ -0,0 +1,407 @@
+/**
+ * @file format.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Type safe formatting, with the format string parsed at compile time.
+ * io::format("{} at 0x{:X}", name, address) writes to out, io::formatTo()
+ * to a buffer. Also the number conversions out and the log use
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Placeholders are {} or {:[0][width][type]}, one per argument, in order:
+ *     d    integers, in decimal (their default)
+ *     x X  integers and pointers, in hex without a prefix
+ *     c    characters (their default)
+ *     s    strings (their default), and bools as true or false (theirs too)
+ *     p    pointers, as 0x and lowercase hex (their default)
+ * A width right aligns with spaces, or with zeros after any sign or 0x if it
+ * starts with 0. {{ and }} are a brace. Anything else doesn't compile
+ */
+
+namespace io
+{
+
+/* Longest number the converters write: 64 bits in decimal, and a sign */
+constexpr size_t FORMAT_NUMBER_SIZE =       21;
+
+/* Largest width a placeholder can have */
+constexpr uint8_t FORMAT_MAX_WIDTH =        64;
+
+/* Stack buffer _outstream::format() fills before each write to the backend */
+constexpr size_t FORMAT_BUFFER_SIZE =       128;
+
+/**
+ * @brief Write a number in decimal, two digits at a time from a table of
+ * pairs. Numbers that fit 32 bits never use 64 bit division
+ * 
+ * @param value Number to write
+ * @param str Where to write it, FORMAT_NUMBER_SIZE bytes is always enough
+ * @return size_t Characters written. No terminator
+ */
+size_t formatDecimal(uint32_t value, char* str);
+size_t formatDecimal(uint64_t value, char* str);
+
+/**
+ * @brief Write a number in hex, a table lookup per nibble, no division
+ * 
+ * @param value Number to write
+ * @param str Where to write it
+ * @param upper Whether the digits above 9 are uppercase
+ * @return size_t Characters written. No terminator
+ */
+size_t formatHex(uint32_t value, char* str, bool upper);
+size_t formatHex(uint64_t value, char* str, bool upper);
+
+/**
+ * @brief Write an integer in decimal, or in uppercase hex, with a '-' if it's
+ * negative. What xtoa() gives for those bases, only faster
+ * 
+ * @param value Integer to write, of any integer type
+ * @param str Where to write it, FORMAT_NUMBER_SIZE bytes
+ * @param base 16 for hex, anything else is decimal
+ * @return size_t Characters written. No terminator
+ */
+template<typename T> size_t formatNumber(T value, char* str, int base)
+{
+    size_t sign = 0;
+    bool negative = false;
+    if constexpr (static_cast<T>(-1) < static_cast<T>(0))
+        negative = value < 0;
+    if (negative)
+        str[sign++] = '-';
+
+    // Narrow types stay on the 32 bit path
+    if constexpr (sizeof(T) > sizeof(uint32_t))
+    {
+        const uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(value) :
+                static_cast<uint64_t>(value);
+        return sign + (base == 16 ? formatHex(magnitude,str + sign,true) :
+                formatDecimal(magnitude,str + sign));
+    }
+    else
+    {
+        const uint32_t magnitude = negative ? 0 - static_cast<uint32_t>(value) :
+                static_cast<uint32_t>(value);
+        return sign + (base == 16 ? formatHex(magnitude,str + sign,true) :
+                formatDecimal(magnitude,str + sign));
+    }
+}
+
+/**
+ * @brief An argument, with its type erased, so one formatWrite() does every
+ * call
+ * 
+ */
+struct formatArgument
+{
+    enum class kind : uint8_t
+    {
+        SIGNED,
+        UNSIGNED,
+        CHARACTER,
+        BOOLEAN,
+        STRING,
+        POINTER
+    };
+
+    kind            type;
+
+    /* Integers, characters and pointers. Signed ones as their two's complement */
+    uint64_t        value;
+
+    const char*     string;
+};
+
+/**
+ * @brief One step of writing a format string: some of its text, then maybe an
+ * argument
+ * 
+ */
+struct formatOp
+{
+    /* Text before the argument, in the format string */
+    uint16_t        textStart = 0;
+    uint16_t        textLength = 0;
+
+    /* Index of the argument, or NO_ARGUMENT */
+    uint8_t         argument = 0;
+
+    /* Placeholder type, 0 for the default */
+    char            type = 0;
+    uint8_t         width = 0;
+    uint8_t         flags = 0;
+
+    static constexpr uint8_t NO_ARGUMENT = 0xFF;
+
+    /* Flags. Pad with zeros rather than spaces */
+    static constexpr uint8_t ZERO_PAD = 1;
+
+    /* The text has {{ or }} in it, each to write as one brace */
+    static constexpr uint8_t ESCAPES = 2;
+};
+
+/**
+ * @brief Where formatWrite() puts characters
+ * 
+ */
+struct formatSink
+{
+    char*           buffer;
+    size_t          size;
+
+    /* Characters in buffer */
+    size_t          used;
+
+    /* Called with the buffer full, to write it out and set used to 0. Without
+       one, output stops when the buffer is full */
+    void            (*flush)(formatSink* sink);
+    void*           context;
+};
+
+/**
+ * @brief Write a parsed format string and its arguments to a sink
+ * 
+ * @return size_t Characters in the whole output, even what didn't fit
+ */
+size_t formatWrite(formatSink* sink, const char* text, const formatOp* ops, size_t count,
+        const formatArgument* arguments);
+
+namespace formatting
+{
+
+template<typename T> struct typeIdentity
+{
+    using type = T;
+};
+
+/* Keeps the format string from deciding the argument types, so it converts
+   to the formatString the arguments ask for */
+template<typename T> using nonDeduced = typename typeIdentity<T>::type;
+
+/**
+ * @brief How each argument type is erased. Integers by default, and anything
+ * else is an error
+ * 
+ */
+template<typename T> struct argumentTraits
+{
+    static_assert(static_cast<T>(1) / 2 == 0,
+            "Only integers, characters, bools, strings and pointers can be formatted");
+
+    static constexpr formatArgument::kind type = static_cast<T>(-1) < static_cast<T>(0) ?
+            formatArgument::kind::SIGNED : formatArgument::kind::UNSIGNED;
+
+    static formatArgument make(T value)
+    {
+        if constexpr (type == formatArgument::kind::SIGNED)
+            return {type,static_cast<uint64_t>(static_cast<int64_t>(value)),nullptr};
+        else
+            return {type,static_cast<uint64_t>(value),nullptr};
+    }
+};
+
+template<> struct argumentTraits<char>
+{
+    static constexpr formatArgument::kind type = formatArgument::kind::CHARACTER;
+    static formatArgument make(char value)
+    {
+        return {type,static_cast<uint8_t>(value),nullptr};
+    }
+};
+
+template<> struct argumentTraits<bool>
+{
+    static constexpr formatArgument::kind type = formatArgument::kind::BOOLEAN;
+    static formatArgument make(bool value) { return {type,value,nullptr}; }
+};
+
+template<> struct argumentTraits<const char*>
+{
+    static constexpr formatArgument::kind type = formatArgument::kind::STRING;
+    static formatArgument make(const char* value) { return {type,0,value}; }
+};
+
+template<> struct argumentTraits<char*> : argumentTraits<const char*> {};
+template<size_t N> struct argumentTraits<char[N]> : argumentTraits<const char*> {};
+
+template<typename T> struct argumentTraits<T*>
+{
+    static constexpr formatArgument::kind type = formatArgument::kind::POINTER;
+    static formatArgument make(const T* value)
+    {
+        return {type,reinterpret_cast<uintptr_t>(value),nullptr};
+    }
+};
+
+/**
+ * @brief Never defined. A format string that's wrong calls it while being
+ * parsed, which stops the compile at the call, and its reason
+ * 
+ */
+void formatError(const char* reason);
+
+constexpr bool isInteger(formatArgument::kind k)
+{
+    return k == formatArgument::kind::SIGNED || k == formatArgument::kind::UNSIGNED;
+}
+
+/**
+ * @brief Whether a placeholder type suits an argument
+ * 
+ */
+constexpr bool accepts(char type, formatArgument::kind k)
+{
+    switch (type)
+    {
+    case 0:
+        return true;
+    case 'd':
+        return isInteger(k);
+    case 'x':
+    case 'X':
+        return isInteger(k) || k == formatArgument::kind::POINTER;
+    case 'c':
+        return k == formatArgument::kind::CHARACTER;
+    case 's':
+        return k == formatArgument::kind::STRING || k == formatArgument::kind::BOOLEAN;
+    case 'p':
+        return k == formatArgument::kind::POINTER;
+    default:
+        return false;
+    }
+}
+
+} // namespace formatting
+
+/**
+ * @brief A format string for some argument types, parsed into formatOps when
+ * it's compiled. Made from a string literal where a function takes one
+ * 
+ */
+template<typename... Args> struct formatString
+{
+    /* One for each argument and the text before it, and the text at the end */
+    static constexpr size_t OPS = sizeof...(Args) + 1;
+
+    const char*     text;
+    formatOp        ops[OPS];
+
+    template<size_t N> consteval formatString(const char (&str)[N]) : text(str), ops()
+    {
+        static_assert(sizeof...(Args) < formatOp::NO_ARGUMENT, "Too many arguments");
+        if (N - 1 > UINT16_MAX)
+            formatting::formatError("Format string too long");
+        parse(str,N - 1);
+    }
+
+private:
+    consteval void parse(const char* str, size_t length)
+    {
+        constexpr formatArgument::kind kinds[] = {formatting::argumentTraits<Args>::type...,
+                formatArgument::kind::SIGNED};
+
+        size_t start = 0;
+        size_t argument = 0;
+        uint8_t textFlags = 0;
+        size_t i = 0;
+        while (i < length)
+        {
+            const char c = str[i];
+            if (c != '{' && c != '}')
+            {
+                i++;
+                continue;
+            }
+
+            // Left in the text, for formatWrite() to take out. Only the text
+            // that has escapes pays for that
+            if (str[i + 1] == c)
+            {
+                textFlags = formatOp::ESCAPES;
+                i += 2;
+                continue;
+            }
+            if (c == '}')
+                formatting::formatError("Unmatched } in the format string, }} writes one");
+
+            const size_t end = i++;
+            char type = 0;
+            uint8_t width = 0;
+            uint8_t flags = textFlags;
+            if (str[i] == ':')
+            {
+                i++;
+                if (str[i] == '0')
+                {
+                    flags |= formatOp::ZERO_PAD;
+                    i++;
+                }
+                while (str[i] >= '0' && str[i] <= '9')
+                {
+                    if (width * 10 + (str[i] - '0') > FORMAT_MAX_WIDTH)
+                        formatting::formatError("Placeholder width too large");
+                    width = static_cast<uint8_t>(width * 10 + (str[i] - '0'));
+                    i++;
+                }
+                if (str[i] != '}')
+                    type = str[i++];
+            }
+            if (str[i] != '}')
+                formatting::formatError("Placeholders are {} or {:[0][width][type]}");
+            if (argument == sizeof...(Args))
+                formatting::formatError("More placeholders than arguments");
+            if (!formatting::accepts(type,kinds[argument]))
+                formatting::formatError("Placeholder type doesn't suit its argument");
+
+            ops[argument] = {static_cast<uint16_t>(start),static_cast<uint16_t>(end - start),
+                    static_cast<uint8_t>(argument),type,width,flags};
+            argument++;
+            textFlags = 0;
+            start = ++i;
+        }
+
+        if (argument != sizeof...(Args))
+            formatting::formatError("More arguments than placeholders");
+        ops[argument] = {static_cast<uint16_t>(start),static_cast<uint16_t>(length - start),
+                formatOp::NO_ARGUMENT,0,0,textFlags};
+    }
+};
+
+template<typename... Args> size_t formatWrite(formatSink* sink, const formatString<Args...>& fmt,
+        const formatArgument* arguments)
+{
+    return formatWrite(sink,fmt.text,fmt.ops,fmt.OPS,arguments);
+}
+
+/**
+ * @brief Format into a buffer, like snprintf()
+ * 
+ * @param buffer Where to write, always terminated unless size is 0
+ * @param size Size of the buffer
+ * @param fmt Format string, checked against the arguments when compiled
+ * @param args Arguments, one per placeholder
+ * @return size_t Length of the whole output, which didn't all fit if it's
+ * size or more
+ */
+template<typename... Args> size_t formatTo(char* buffer, size_t size,
+        formatString<formatting::nonDeduced<Args>...> fmt, const Args&... args)
+{
+    const formatArgument arguments[] = {formatting::argumentTraits<Args>::make(args)...,
+            {formatArgument::kind::SIGNED,0,nullptr}};
+    formatSink sink = {buffer,size == 0 ? 0 : size - 1,0,nullptr,nullptr};
+    const size_t length = formatWrite(&sink,fmt,arguments);
+    if (size != 0)
+        buffer[sink.used] = '\0';
+    return length;
+}
+
+} // namespace io
@@ -15,13 +15,11 @@
 #include <stdint.h>
 #include <klib/cstdlib.hpp>
 #include <klib/string.h>
+#include <klib/format.hpp>
 #include <devices/BIOSVideoIO.hpp>
-#include <stdarg.h>
 
-// FIXME get rid of this
-extern "C" size_t outFormat(const char* fmt, va_list parameters, int (*putfunc)(const char* ,size_t));
-
-// FIXME add what the requirements of the backEnd class are (I think it's just putchar and clear)
+// A backEnd needs putchar() and clear(). A write(str, size) too, if it does
+// better with whole strings than a character at a time
 
 namespace io
 {
@@ -33,48 +31,98 @@ private:
     backEnd* _backEnd;
     int _base;
 
+    /* Another backend that gets everything too, or nullptr */
+    void* _mirror;
+    void (*_mirrorWrite)(void* mirror, const char* str, size_t size);
+
+    /* In one go, if the backend can */
+    template<class anyEnd> static void writeTo(anyEnd* end, const char* str, size_t size) {
+        if constexpr (requires { end->write(str,size); })
+            end->write(str,size);
+        else
+            for (size_t i = 0; i < size; i++)
+                end->putchar(str[i]);
+    }
+
+    static void flushSink(formatSink* sink) {
+        static_cast<_outstream*>(sink->context)->writeString(sink->buffer,sink->used);
+        sink->used = 0;
+    }
+
 public:
     void clear() { _backEnd->clear(); }
 
     // FIXME
-    void init(backEnd* aaaa) { _backEnd = aaaa; _base=10; /*_backEnd->init();*/ }
+    void init(backEnd* aaaa) { _backEnd = aaaa; _base=10; _mirror = nullptr; /*_backEnd->init();*/ }
 
     backEnd* getBackEnd() { return _backEnd; }
 
+    /**
+     * @brief Write everything to another backend as well, of any type with a
+     * putchar() (like the serial port). Not clear(), which is for the screen
+     * 
+     * @param other The other backend, nullptr to stop
+     */
+    template<class mirrorEnd> void mirror(mirrorEnd* other) {
+        _mirrorWrite = [](void* m, const char* str, size_t size) {
+            writeTo(static_cast<mirrorEnd*>(m),str,size);
+        };
+        _mirror = other;
+    }
+
+    void mirror(decltype(nullptr)) { _mirror = nullptr; }
+
     //auto &getBackEnd() { return _backEnd; }
 
     size_t writeString(const char *str) {
-        size_t i = 0;
-        for(size_t size = strlen(str);i<size;i++){
-            _backEnd->putchar(*(str++));}
-        return i;
+        return writeString(str,strlen(str));
     }
 
     size_t writeString(const char *str, size_t size) {
-        size_t i = 0;
-        for (; i < size; i++)
-        {
-            _backEnd->putchar(str[i]);
-        }
-        return i;
+        writeTo(_backEnd,str,size);
+        if (_mirror != nullptr)
+            _mirrorWrite(_mirror,str,size);
+        return size;
     }
 
     size_t writeHex( uint64_t num) {
-        char str[MAX_NUM_STR_SIZE];
-        xtoa(num,str,16);
-        return writeString(str);
+        char str[FORMAT_NUMBER_SIZE];
+        return writeString(str,formatNumber(num,str,16));
     }
 
     size_t writeInt( int64_t num) {
-        char str[MAX_NUM_STR_SIZE];
-        xtoa(num,str,10);
-        return writeString(str);
+        char str[FORMAT_NUMBER_SIZE];
+        return writeString(str,formatNumber(num,str,10));
     }
 
     template<typename T> size_t writeNum( T num ) {
-        char str[MAX_NUM_STR_SIZE];
-        xtoa(num,str,_base);
-        return writeString(str);
+        // Other bases are rare enough for the slow way
+        if (_base != 10 && _base != 16)
+        {
+            char str[MAX_NUM_STR_SIZE];
+            xtoa(num,str,_base);
+            return writeString(str);
+        }
+        char str[FORMAT_NUMBER_SIZE];
+        return writeString(str,formatNumber(num,str,_base));
+    }
+
+    /**
+     * @brief Write a format string and its arguments (see format.hpp), a
+     * buffer full at a time
+     * 
+     * @param fmt Format string, checked against the arguments when compiled
+     * @param args Arguments, one per placeholder
+     */
+    template<typename... Args> void format(formatString<formatting::nonDeduced<Args>...> fmt,
+            const Args&... args) {
+        const formatArgument arguments[] = {formatting::argumentTraits<Args>::make(args)...,
+                {formatArgument::kind::SIGNED,0,nullptr}};
+        char buffer[FORMAT_BUFFER_SIZE];
+        formatSink sink = {buffer,sizeof(buffer),0,&flushSink,this};
+        formatWrite(&sink,fmt,arguments);
+        if (sink.used != 0)
+            writeString(buffer,sink.used);
     }
 
     int changeBase(int num) {
@@ -133,4 +181,19 @@ extern io::_outstream<io::framebuffer_terminal> out;
 extern io::_outstream<io::realMode_terminal> out;
 #endif*/
 
-extern io::_outstream<io::framebuffer_terminal> out;
\ No newline at end of file
+extern io::_outstream<io::framebuffer_terminal> out;
+
+namespace io
+{
+
+/**
+ * @brief out.format(), see format.hpp
+ * 
+ */
+template<typename... Args> void format(formatString<formatting::nonDeduced<Args>...> fmt,
+        const Args&... args)
+{
+    out.format(fmt,args...);
+}
+
+} // namespace io
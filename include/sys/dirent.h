@@ -0,0 +1,54 @@
+/**
+ * @file dirent.h
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Records getdents() fills a buffer with, one per name in a
+ * directory. The kernel and user programs share this file
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* dirent.d_type, same values as Linux */
+#define DT_DIR                  4
+#define DT_REG                  8
+
+/* Longest name in a record, in bytes */
+#define DIRENT_NAME_MAX         255
+
+/**
+ * @brief Start of a record. The name follows it, terminated, and the record
+ * is padded to 4 bytes. "." and ".." aren't listed
+ * 
+ */
+typedef struct
+{
+    /* Inode number */
+    uint32_t            d_ino;
+
+    /* Where the next getdents() carries on from, right after this one. It
+       becomes the descriptor's position once the record is returned */
+    uint32_t            d_off;
+
+    /* Bytes from this record to the next */
+    uint16_t            d_reclen;
+
+    /* DT_* */
+    uint8_t             d_type;
+
+    /* Of the name, without its terminator */
+    uint8_t             d_namlen;
+} dirent;
+
+#ifdef __cplusplus
+}
+#endif
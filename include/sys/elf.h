@@ -141,6 +141,11 @@ enum elf_Ident {
 #define PT_LOPROC       0x70000000 // Processor specific semantics
 #define PT_HIPROC       0x7fffffff
 
+/* Segment flags */
+#define PF_X            0x1 // Execute
+#define PF_W            0x2 // Write
+#define PF_R            0x4 // Read
+
 /**
  * @brief Program header (32-bit), defines information about how to load the ELF into memory
  * 
@@ -0,0 +1,23 @@
+/**
+ * @file fcntl.h
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Flags for opening files. The kernel and user programs share this
+ * file
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+/* Same values as Linux */
+#define O_RDONLY                0x0u
+#define O_WRONLY                0x1u
+#define O_RDWR                  0x2u
+#define O_ACCMODE               0x3u    /* Which of the three it is */
+#define O_CREAT                 0x40u   /* Make the file if it isn't there */
+#define O_EXCL                  0x80u   /* With O_CREAT, fail if it is */
+#define O_TRUNC                 0x200u  /* Empty it, if it's opened for writing */
+#define O_APPEND                0x400u  /* Every write goes at the end */
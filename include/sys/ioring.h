@@ -0,0 +1,144 @@
+/**
+ * @file ioring.h
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Layout of the submission and completion rings a process shares with
+ * the kernel for asynchronous I/O. The kernel and user programs share this
+ * file
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The program fills submission entries at sqTail and bumps it, the kernel
+ * takes them from sqHead and posts a completion for each at cqTail, which the
+ * program consumes from cqHead. Indices only ever grow, and wrap at 2^32; the
+ * slot is index & (entries - 1). Whoever bumps an index does it with a
+ * release store, after the entry is written, and the other side reads it with
+ * an acquire load
+ */
+
+/* Largest submission ring. The completion ring is twice its size */
+#define IORING_MAX_ENTRIES      256
+
+/* io_ring_params.flags: a kernel thread takes submissions as they come, so
+   the program only has to enter the ring when the thread went to sleep */
+#define IORING_SETUP_SQPOLL     0x1
+
+/* io_ring_header.flags: the polling thread is asleep, enter with
+   IORING_ENTER_WAKEUP to get it going again */
+#define IORING_SQ_NEED_WAKEUP   0x1
+
+/* Flags for entering the ring */
+#define IORING_ENTER_GETEVENTS  0x1     /* Wait for minComplete completions */
+#define IORING_ENTER_WAKEUP     0x2     /* Wake the polling thread */
+
+/* Operations */
+#define IORING_OP_NOP           0
+#define IORING_OP_READ          1       /* Into address, length bytes at offset */
+#define IORING_OP_WRITE         2       /* From address, length bytes at offset */
+#define IORING_OP_FSYNC         3       /* Make writes to fd stick */
+#define IORING_OP_POLL          4       /* Wait for the POLL* events in length */
+
+/* Offset that means the descriptor's own position, for descriptors that
+   have one */
+#define IORING_OFFSET_CURRENT   0xffffffffffffffffULL
+
+/* Events, same values as Linux */
+#define POLLIN                  0x01
+#define POLLOUT                 0x04
+#define POLLHUP                 0x10
+
+/**
+ * @brief Start of the shared memory, read and written by both sides
+ * 
+ */
+typedef struct
+{
+    /* Moved by the kernel */
+    volatile uint32_t   sqHead;
+
+    /* Moved by the program */
+    volatile uint32_t   sqTail;
+
+    /* Moved by the program */
+    volatile uint32_t   cqHead;
+
+    /* Moved by the kernel */
+    volatile uint32_t   cqTail;
+
+    /* IORING_SQ_* */
+    volatile uint32_t   flags;
+
+    /* Times the kernel found sqTail more than the ring's size ahead of
+       sqHead, and skipped to it */
+    volatile uint32_t   dropped;
+} io_ring_header;
+
+/**
+ * @brief Submission queue entry
+ * 
+ */
+typedef struct
+{
+    uint8_t             opcode;
+    uint8_t             flags;      /* None yet, must be 0 */
+    uint16_t            reserved;
+    int32_t             fd;
+    uint64_t            offset;
+    uint32_t            address;
+    uint32_t            length;
+
+    /* Comes back in the completion, untouched */
+    uint64_t            userData;
+} io_sqe;
+
+/**
+ * @brief Completion queue entry
+ * 
+ */
+typedef struct
+{
+    uint64_t            userData;
+
+    /* What the operation returned: bytes, events, 0, or a negative error */
+    int32_t             result;
+    uint32_t            flags;
+} io_cqe;
+
+/**
+ * @brief Argument of the setup system call
+ * 
+ */
+typedef struct
+{
+    /* In: submission entries wanted, a power of two up to
+       IORING_MAX_ENTRIES. Out: what was set up */
+    uint32_t            sqEntries;
+
+    /* Out: twice sqEntries */
+    uint32_t            cqEntries;
+
+    /* In: IORING_SETUP_* */
+    uint32_t            flags;
+
+    /* Out: where the rings are mapped, and where the entry arrays are in
+       there. The header is at the start */
+    uint32_t            address;
+    uint32_t            sqOffset;
+    uint32_t            cqOffset;
+} io_ring_params;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,19 @@
+/**
+ * @file mman.h
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Protection flags for mapping files. The kernel and user programs
+ * share this file
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+/* Same values as Linux. Mappings are always private: writes to them never
+   reach the file */
+#define PROT_READ               0x1u
+#define PROT_WRITE              0x2u
+#define PROT_EXEC               0x4u
@@ -0,0 +1,57 @@
+/**
+ * @file vdso.h
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Layout of the page the kernel maps read-only into every process, so
+ * user programs can get at things like the clock without a system call. The
+ * kernel and user programs share this file
+ * @version 0.1
+ * @date 2025-03-21
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Where the page is in every process: below the stack, with a guard page
+   between the two */
+#define VDSO_DATA_ADDRESS   0xbfefe000
+
+/* Bumped whenever the layout changes */
+#define VDSO_VERSION        1
+
+/**
+ * @brief The page itself. Fields that can change are covered by sequence,
+ * which is odd while the kernel is updating them: read it, read the fields,
+ * and start over if it was odd or it changed in between
+ * 
+ */
+typedef struct
+{
+    /* VDSO_VERSION */
+    uint32_t            version;
+
+    volatile uint32_t   sequence;
+
+    /* TSC to nanoseconds since boot: ((tsc - tscBase) * mult) >> shift */
+    uint64_t            tscBase;
+    uint32_t            mult;
+    uint32_t            shift;
+
+    /* TSC frequency, in Hz */
+    uint64_t            tscFrequency;
+
+    /* SYSENTER stub to call for system calls, 0 if int 0x80 must be used.
+       Fixed after boot, not covered by sequence */
+    uint32_t            syscallEntry;
+} vdso_data;
+
+#ifdef __cplusplus
+}
+#endif
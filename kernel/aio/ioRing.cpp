@@ -0,0 +1,436 @@
+/**
+ * @file ioRing.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from ioRing.hpp
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/aio/ioRing.hpp>
+#include <kernelInternal/proc/process.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <klib/cstdlib.hpp>
+#include <klib/string.h>
+
+using namespace kernel::aio;
+using namespace kernel::syscall;
+using kernel::mm::PAGE_SIZE;
+
+// The header gets a cache line, the submission entries follow it, and the
+// completion entries follow those. Entries never straddle a page
+static const uint32_t SQ_OFFSET =           64;
+static_assert(sizeof(io_ring_header) <= SQ_OFFSET, "The header doesn't fit");
+static_assert(sizeof(io_sqe) == 32 && sizeof(io_cqe) == 16, "Entries must divide the page size");
+
+static inline uint32_t cqOffset(uint32_t sqEntries)
+{
+    return SQ_OFFSET + sqEntries * static_cast<uint32_t>(sizeof(io_sqe));
+}
+
+ioRing::ioRing() : _references(1), _memory(nullptr), _address(0), _sqEntries(0), _cqEntries(0),
+        _flags(0), _sqHead(0), _cqTail(0), _submitting(0), _executing(0), _owner(nullptr),
+        _space(nullptr), _poller(nullptr), _stopping(false), _stopper(nullptr), _pollerState(0)
+{
+}
+
+io_ring_header* ioRing::header() const
+{
+    return static_cast<io_ring_header*>(mm::frameAddress(_memory->frame(0)));
+}
+
+/**
+ * @brief Kernel address of a byte of the shared memory
+ * 
+ */
+void* ioRing::at(uint32_t offset) const
+{
+    return static_cast<uint8_t*>(mm::frameAddress(_memory->frame(offset / PAGE_SIZE))) +
+            offset % PAGE_SIZE;
+}
+
+/**
+ * @brief Completions that can be posted without overwriting ones the
+ * program hasn't consumed
+ * 
+ */
+uint32_t ioRing::completionRoom() const
+{
+    const uint32_t used = _cqTail - __atomic_load_n(&header()->cqHead,__ATOMIC_ACQUIRE);
+    return used >= _cqEntries ? 0 : _cqEntries - used;
+}
+
+bool ioRing::canSubmit() const
+{
+    return __atomic_load_n(&header()->sqTail,__ATOMIC_SEQ_CST) != _sqHead && completionRoom() != 0;
+}
+
+void ioRing::complete(uint64_t userData, int32_t result)
+{
+    io_ring_header* h = header();
+    _completionLock.lock();
+    io_cqe* cqe = static_cast<io_cqe*>(at(cqOffset(_sqEntries) +
+            (_cqTail & (_cqEntries - 1)) * static_cast<uint32_t>(sizeof(io_cqe))));
+    cqe->userData = userData;
+    cqe->result = result;
+    cqe->flags = 0;
+    _cqTail++;
+    __atomic_store_n(&h->cqTail,_cqTail,__ATOMIC_RELEASE);
+    __atomic_store_n(&_executing,0u,__ATOMIC_RELEASE);
+    _completionWait.wakeAll();
+    _completionLock.unlock();
+}
+
+int32_t ioRing::execute(const io_sqe* sqe)
+{
+    if (sqe->flags != 0 || sqe->reserved != 0)
+        return -EINVAL;
+    if (sqe->opcode == IORING_OP_NOP)
+        return 0;
+
+    // Reads and writes at the position go through the same path as the
+    // system calls, which move it
+    if (sqe->offset == IORING_OFFSET_CURRENT && sqe->opcode == IORING_OP_READ)
+        return proc::readDescriptor(sqe->fd,sqe->address,sqe->length);
+    if (sqe->offset == IORING_OFFSET_CURRENT && sqe->opcode == IORING_OP_WRITE)
+        return proc::writeDescriptor(sqe->fd,sqe->address,sqe->length);
+
+    proc::descriptor d;
+    if (!proc::getDescriptor(sqe->fd,&d))
+        return -EBADF;
+
+    int32_t result;
+    switch (sqe->opcode)
+    {
+    case IORING_OP_READ:
+        result = proc::descriptorRead(&d,sqe->address,sqe->length,sqe->offset);
+        break;
+    case IORING_OP_WRITE:
+        result = proc::descriptorWrite(&d,sqe->address,sqe->length,sqe->offset);
+        break;
+    case IORING_OP_FSYNC:
+        result = proc::descriptorSync(&d);
+        break;
+    case IORING_OP_POLL:
+        result = static_cast<int32_t>(proc::descriptorPoll(&d,sqe->length,true));
+        break;
+    default:
+        result = -EINVAL;
+        break;
+    }
+    proc::putDescriptor(&d);
+    return result;
+}
+
+/**
+ * @brief Take submissions and run them, as long as there's room for their
+ * completions. Only one thread at a time
+ * 
+ * @return size_t How many were taken
+ */
+size_t ioRing::submit(size_t limit)
+{
+    io_ring_header* h = header();
+    size_t taken = 0;
+    while (taken < limit)
+    {
+        const uint32_t tail = __atomic_load_n(&h->sqTail,__ATOMIC_ACQUIRE);
+        const uint32_t head = _sqHead;
+        if (tail == head || completionRoom() == 0)
+            break;
+
+        // The program can write anything in there
+        if (tail - head > _sqEntries)
+        {
+            __atomic_add_fetch(&h->dropped,1u,__ATOMIC_RELAXED);
+            __atomic_store_n(&_sqHead,tail,__ATOMIC_RELEASE);
+            __atomic_store_n(&h->sqHead,tail,__ATOMIC_RELEASE);
+            break;
+        }
+
+        // Copied out first, so it can't change while it's checked and run
+        io_sqe sqe;
+        memcpy(&sqe,at(SQ_OFFSET + (head & (_sqEntries - 1)) * static_cast<uint32_t>(sizeof(io_sqe))),
+                sizeof(sqe));
+        __atomic_store_n(&_executing,1u,__ATOMIC_RELAXED);
+        __atomic_store_n(&_sqHead,head + 1,__ATOMIC_RELEASE);
+        __atomic_store_n(&h->sqHead,head + 1,__ATOMIC_RELEASE);
+
+        complete(sqe.userData,execute(&sqe));
+        taken++;
+    }
+    return taken;
+}
+
+void ioRing::waitCompletions(uint32_t count)
+{
+    io_ring_header* h = header();
+    if (count > _cqEntries)
+        count = _cqEntries;
+
+    _completionLock.lock();
+    for (;;)
+    {
+        const uint32_t ready = _cqTail - __atomic_load_n(&h->cqHead,__ATOMIC_ACQUIRE);
+        const bool inFlight = __atomic_load_n(&h->sqTail,__ATOMIC_ACQUIRE) !=
+                __atomic_load_n(&_sqHead,__ATOMIC_ACQUIRE) ||
+                __atomic_load_n(&_executing,__ATOMIC_ACQUIRE) != 0;
+
+        // Nothing else is coming otherwise
+        if (ready >= count || !inFlight)
+            break;
+
+        sched::waiter w;
+        _completionWait.add(&w);
+        _completionLock.unlock();
+        sched::sleep(&w);
+        _completionLock.lock();
+    }
+    _completionLock.unlock();
+}
+
+void ioRing::pollerThread(void* arg)
+{
+    ioRing* r = static_cast<ioRing*>(arg);
+    sched::thread* t = sched::currentThread();
+    io_ring_header* h = r->header();
+
+    // Works in the process' address space, on its descriptors
+    uint32_t flags = saveAndDisableInterrupts();
+    t->space = r->_space;
+    t->process = r->_owner;
+    mm::activate(r->_space);
+    restoreInterrupts(flags);
+
+    uint64_t idleSince = clock::nanoseconds();
+    while (!__atomic_load_n(&r->_stopping,__ATOMIC_ACQUIRE))
+    {
+        if (r->submit(r->_sqEntries) != 0)
+        {
+            idleSince = clock::nanoseconds();
+            continue;
+        }
+        if (clock::nanoseconds() - idleSince < SQPOLL_IDLE_NS)
+        {
+            sched::yield();
+            continue;
+        }
+
+        // Say we're going to sleep, then look once more: a submission that
+        // came before the flag was seen won't get a wakeup
+        __atomic_or_fetch(&h->flags,static_cast<uint32_t>(IORING_SQ_NEED_WAKEUP),__ATOMIC_SEQ_CST);
+        if (!r->canSubmit() && !__atomic_load_n(&r->_stopping,__ATOMIC_ACQUIRE))
+            sched::block();
+        __atomic_and_fetch(&h->flags,~static_cast<uint32_t>(IORING_SQ_NEED_WAKEUP),__ATOMIC_SEQ_CST);
+        idleSince = clock::nanoseconds();
+    }
+
+    flags = saveAndDisableInterrupts();
+    t->space = nullptr;
+    t->process = nullptr;
+    mm::activate(nullptr);
+    restoreInterrupts(flags);
+
+    r->_pollerLock.lock();
+    r->_poller = nullptr;
+    r->_pollerLock.unlock();
+
+    // The ring can go as soon as the state is 2
+    sched::thread* stopper = r->_stopper;
+    __atomic_store_n(&r->_pollerState,1u,__ATOMIC_RELEASE);
+    sched::wake(stopper);
+    __atomic_store_n(&r->_pollerState,2u,__ATOMIC_RELEASE);
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+int32_t ioRing::setup(io_ring_params* params)
+{
+    const uint32_t entries = params->sqEntries;
+    if ((params->flags & ~static_cast<uint32_t>(IORING_SETUP_SQPOLL)) != 0 || entries == 0 ||
+            entries > IORING_MAX_ENTRIES || (entries & (entries - 1)) != 0)
+        return -EINVAL;
+    sched::thread* t = sched::currentThread();
+    if (t->process == nullptr || t->space == nullptr)
+        return -EINVAL;
+
+    ioRing* ring = new ioRing;
+    if (ring == nullptr)
+        return -ENOMEM;
+    ring->_sqEntries = entries;
+    ring->_cqEntries = 2 * entries;
+    ring->_flags = params->flags;
+    ring->_owner = t->process;
+    ring->_space = t->space;
+
+    const uint32_t size = cqOffset(entries) + ring->_cqEntries * static_cast<uint32_t>(sizeof(io_cqe));
+    const uint32_t mapSize = (size + PAGE_SIZE - 1) & mm::PAGE_MASK;
+    ring->_memory = mm::memoryObject::create(mapSize / PAGE_SIZE);
+    if (ring->_memory == nullptr)
+    {
+        delete ring;
+        return -ENOMEM;
+    }
+
+    // The mapping takes its own reference on the memory
+    ring->_address = t->space->findFreeRange(mapSize,proc::USER_MAP_START,proc::USER_IMAGE_END);
+    if (ring->_address == 0 || !t->space->addRegion(ring->_address,ring->_address + mapSize,
+            mm::REGION_READ | mm::REGION_WRITE | mm::REGION_SHARED,ring->_memory,0,
+            ring->_address + mapSize))
+    {
+        ring->_address = 0;
+        ring->put();
+        return -ENOMEM;
+    }
+
+    if (ring->_flags & IORING_SETUP_SQPOLL)
+    {
+        // Not pinned: it goes wherever there's room for it
+        ring->_pollerLock.lock();
+        ring->_poller = sched::createThread(&pollerThread,ring,sched::PRIORITY_NORMAL,"ioRingPoller");
+        const bool started = ring->_poller != nullptr;
+        ring->_pollerLock.unlock();
+        if (!started)
+        {
+            ring->put();
+            return -ENOMEM;
+        }
+    }
+
+    const int32_t fd = proc::openDescriptor(proc::descriptorType::IO_RING,ring);
+    if (fd < 0)
+    {
+        ring->shutdown();
+        ring->put();
+        return fd;
+    }
+
+    params->cqEntries = ring->_cqEntries;
+    params->address = ring->_address;
+    params->sqOffset = SQ_OFFSET;
+    params->cqOffset = cqOffset(entries);
+    return fd;
+}
+
+void ioRing::put()
+{
+    if (__atomic_sub_fetch(&_references,1,__ATOMIC_ACQ_REL) != 0)
+        return;
+
+    // A process that's exiting is off its address space, and takes the
+    // mapping down with it
+    if (_address != 0 && sched::currentThread()->space == _space)
+        _space->removeRegion(_address);
+    if (_memory != nullptr)
+        _memory->put();
+    delete this;
+}
+
+void ioRing::shutdown()
+{
+    _pollerLock.lock();
+    const bool running = _poller != nullptr;
+    _stopper = sched::currentThread();
+    __atomic_store_n(&_stopping,true,__ATOMIC_RELEASE);
+    if (running)
+        sched::wake(_poller);
+    _pollerLock.unlock();
+    if (!running)
+        return;
+
+    // Wakeups that come before block() aren't lost
+    while (__atomic_load_n(&_pollerState,__ATOMIC_ACQUIRE) != 2)
+    {
+        if (__atomic_load_n(&_pollerState,__ATOMIC_ACQUIRE) == 0)
+            sched::block();
+        else
+            __builtin_ia32_pause();
+    }
+}
+
+int32_t ioRing::enter(uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+{
+    if ((flags & ~static_cast<uint32_t>(IORING_ENTER_GETEVENTS | IORING_ENTER_WAKEUP)) != 0)
+        return -EINVAL;
+    if (toSubmit > _sqEntries)
+        toSubmit = _sqEntries;
+
+    size_t submitted;
+    if (_flags & IORING_SETUP_SQPOLL)
+    {
+        // Waiting on completions of submissions nobody takes would be forever
+        if (flags & (IORING_ENTER_WAKEUP | IORING_ENTER_GETEVENTS))
+        {
+            _pollerLock.lock();
+            if (_poller != nullptr)
+                sched::wake(_poller);
+            _pollerLock.unlock();
+        }
+        submitted = toSubmit;
+    }
+    else
+    {
+        if (__atomic_exchange_n(&_submitting,1u,__ATOMIC_ACQUIRE) != 0)
+            return -EBUSY;
+        submitted = submit(toSubmit);
+        __atomic_store_n(&_submitting,0u,__ATOMIC_RELEASE);
+    }
+
+    if (flags & IORING_ENTER_GETEVENTS)
+        waitCompletions(minComplete);
+    return static_cast<int32_t>(submitted);
+}
+
+/**========================================================================
+ *                           System calls
+ *========================================================================**/
+
+static int32_t sysIoRingSetup(const uint32_t* args)
+{
+    io_ring_params params;
+    if (args[1] != sizeof(params))
+        return -EINVAL;
+    if (!copyFromUser(&params,args[0],sizeof(params)))
+        return -EFAULT;
+
+    const int32_t fd = ioRing::setup(&params);
+    if (fd < 0)
+        return fd;
+    if (!copyToUser(args[0],&params,sizeof(params)))
+    {
+        kernel::proc::closeDescriptor(fd);
+        return -EFAULT;
+    }
+    return fd;
+}
+
+static int32_t sysIoRingEnter(const uint32_t* args)
+{
+    kernel::proc::descriptor d;
+    if (!kernel::proc::getDescriptor(static_cast<int32_t>(args[0]),&d))
+        return -EBADF;
+
+    const int32_t result = d.type == kernel::proc::descriptorType::IO_RING ?
+            static_cast<ioRing*>(d.object)->enter(args[1],args[2],args[3]) : -EBADF;
+    kernel::proc::putDescriptor(&d);
+    return result;
+}
+
+static const syscallDescriptor setupDescriptor =    {"io_ring_setup",&sysIoRingSetup,2,
+        {argKind::USER_POINTER,argKind::LENGTH}};
+static const syscallDescriptor enterDescriptor =    {"io_ring_enter",&sysIoRingEnter,4,
+        {argKind::VALUE,argKind::VALUE,argKind::VALUE,argKind::VALUE}};
+
+void kernel::aio::init()
+{
+    if (!registerSyscall(SYS_IORING_SETUP,&setupDescriptor) ||
+            !registerSyscall(SYS_IORING_ENTER,&enterDescriptor))
+        earlyPanic("aio: couldn't register the system calls");
+}
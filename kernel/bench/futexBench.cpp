@@ -0,0 +1,205 @@
+/**
+ * @file futexBench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Futex mutex benchmark: uncontended cost and lock handoff latency,
+ * from bench.hpp
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/bench/bench.hpp>
+#include <kernelInternal/ipc/futex.hpp>
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <klib/io.hpp>
+
+using namespace kernel::sched;
+
+static const uint32_t UNCONTENDED_ROUNDS =  100000;
+static const uint32_t HANDOFF_ROUNDS =      2000;
+
+// The mutex word, in an address space of our own, since futexes go by user
+// addresses
+static const uint32_t MUTEX_ADDRESS =       kernel::mm::USER_SPACE_START;
+
+struct handoffState
+{
+    kernel::bench::threadGroup group;
+    kernel::mm::addressSpace* space;
+    volatile uint32_t   go;
+    volatile uint32_t   done;
+
+    /* When the owner let go, and the total until the waiter had it */
+    volatile uint64_t   releasedAt;
+    uint64_t            total;
+};
+
+/**========================================================================
+ *                           Mutex
+ *========================================================================**/
+
+// The usual three state futex mutex, what a user library would do: 0 is
+// unlocked, 1 locked, 2 locked with (maybe) someone sleeping
+
+static inline volatile uint32_t* mutexWord()
+{
+    return reinterpret_cast<volatile uint32_t*>(MUTEX_ADDRESS);
+}
+
+static void mutexLock()
+{
+    uint32_t c = 0;
+    if (__atomic_compare_exchange_n(mutexWord(),&c,1,false,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+        return;
+    if (c != 2)
+        c = __atomic_exchange_n(mutexWord(),2,__ATOMIC_ACQUIRE);
+    while (c != 0)
+    {
+        kernel::ipc::futexWait(MUTEX_ADDRESS,2);
+        c = __atomic_exchange_n(mutexWord(),2,__ATOMIC_ACQUIRE);
+    }
+}
+
+static void mutexUnlock()
+{
+    if (__atomic_fetch_sub(mutexWord(),1,__ATOMIC_RELEASE) != 1)
+    {
+        __atomic_store_n(mutexWord(),0,__ATOMIC_RELEASE);
+        kernel::ipc::futexWake(MUTEX_ADDRESS,1);
+    }
+}
+
+static void enterSpace(kernel::mm::addressSpace* space)
+{
+    const uint32_t flags = kernel::saveAndDisableInterrupts();
+    currentThread()->space = space;
+    kernel::mm::activate(space);
+    kernel::restoreInterrupts(flags);
+}
+
+/**========================================================================
+ *                           Handoff
+ *========================================================================**/
+
+static void ownerThread(void* arg)
+{
+    handoffState* state = static_cast<handoffState*>(arg);
+    enterSpace(state->space);
+
+    for (uint32_t round = 1; round <= HANDOFF_ROUNDS; round++)
+    {
+        mutexLock();
+        __atomic_store_n(&state->go,round,__ATOMIC_RELEASE);
+
+        // Until the other one is (about to be) asleep on it
+        while (__atomic_load_n(mutexWord(),__ATOMIC_ACQUIRE) != 2)
+            yield();
+
+        state->releasedAt = kernel::clock::nanoseconds();
+        mutexUnlock();
+        while (__atomic_load_n(&state->done,__ATOMIC_ACQUIRE) != round)
+            yield();
+    }
+
+    enterSpace(nullptr);
+    kernel::bench::leaveGroup(&state->group);
+}
+
+static void contenderThread(void* arg)
+{
+    handoffState* state = static_cast<handoffState*>(arg);
+    enterSpace(state->space);
+
+    for (uint32_t round = 1; round <= HANDOFF_ROUNDS; round++)
+    {
+        while (__atomic_load_n(&state->go,__ATOMIC_ACQUIRE) != round)
+            yield();
+
+        mutexLock();
+        state->total += kernel::clock::nanoseconds() - state->releasedAt;
+        mutexUnlock();
+        __atomic_store_n(&state->done,round,__ATOMIC_RELEASE);
+    }
+
+    enterSpace(nullptr);
+    kernel::bench::leaveGroup(&state->group);
+}
+
+/**
+ * @brief Hand a mutex back and forth between two threads pinned to the
+ * given processors
+ * 
+ * @return uint64_t Nanoseconds from an unlock until the sleeping waiter has
+ * the mutex, 0 if the threads couldn't be made
+ */
+static uint64_t handoff(kernel::mm::addressSpace* space, int ownerCPU, int contenderCPU)
+{
+    handoffState state = {};
+    kernel::bench::initGroup(&state.group,2);
+    state.space = space;
+
+    if (createThread(&ownerThread,&state,PRIORITY_NORMAL,"futexOwner",ownerCPU) == nullptr ||
+            createThread(&contenderThread,&state,PRIORITY_NORMAL,"futexContender",contenderCPU) == nullptr)
+        return 0; // Leaks the other one, it'll never get past go
+
+    kernel::bench::joinGroup(&state.group);
+    return state.total / HANDOFF_ROUNDS;
+}
+
+/**
+ * @brief Lock and unlock with nobody else around, which never enters the
+ * kernel
+ * 
+ * @return uint64_t Nanoseconds per lock/unlock
+ */
+static uint64_t uncontended(kernel::mm::addressSpace* space)
+{
+    enterSpace(space);
+    const uint64_t start = kernel::clock::nanoseconds();
+    for (uint32_t i = 0; i < UNCONTENDED_ROUNDS; i++)
+    {
+        mutexLock();
+        mutexUnlock();
+    }
+    const uint64_t elapsed = kernel::clock::nanoseconds() - start;
+    enterSpace(nullptr);
+    return elapsed / UNCONTENDED_ROUNDS;
+}
+
+void kernel::bench::runFutexBenchmarks()
+{
+    out << "Futex benchmarks\n";
+
+    mm::addressSpace* space = mm::addressSpace::create();
+    if (space == nullptr || !space->addRegion(MUTEX_ADDRESS,MUTEX_ADDRESS + mm::PAGE_SIZE,
+            mm::REGION_READ | mm::REGION_WRITE))
+    {
+        out << "  couldn't make the address space\n";
+        if (space != nullptr)
+            space->destroy();
+        return;
+    }
+
+    out << out.dec() << "  uncontended lock/unlock: " << uncontended(space) << " ns\n";
+
+    const int self = static_cast<int>(smp::cpuIndex());
+    out << "  handoff to a sleeping waiter, same processor: " << handoff(space,self,self)
+        << " ns\n";
+
+    const smp::cpuMask others = smp::onlineMask() & ~(smp::cpuMask(1) << self);
+    if (others != 0)
+    {
+        const int other = __builtin_ctz(others);
+        out << "  handoff to a sleeping waiter, across processors: "
+            << handoff(space,self,other) << " ns\n";
+    }
+    out << out.hex();
+
+    space->destroy();
+}
@@ -0,0 +1,274 @@
+/**
+ * @file ioRingBench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Block device reads through an I/O ring against one at a time, from
+ * bench.hpp
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/bench/bench.hpp>
+#include <kernelInternal/aio/ioRing.hpp>
+#include <kernelInternal/devices/bufferCache.hpp>
+#include <kernelInternal/proc/process.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <klib/io.hpp>
+
+using namespace kernel::sched;
+using kernel::mm::PAGE_SIZE;
+
+static const uint32_t READ_SIZE =           4096;
+static const uint32_t READS_PER_RUN =       4096;
+static const uint32_t BATCH =               32;
+
+// Reads cycle over the start of the disk, which fits in the buffer cache
+static const uint64_t WINDOW =              64 * READ_SIZE;
+static_assert(WINDOW / kernel::block::BLOCK_SIZE <= kernel::block::CACHE_BUFFERS);
+
+// Where reads land, in an address space of our own
+static const uint32_t BUFFER =              kernel::mm::USER_SPACE_START;
+static const uint32_t BUFFER_SIZE =         BATCH * READ_SIZE;
+
+enum benchPath : size_t
+{
+    PATH_SYNC,
+    PATH_RING,
+    PATH_SQPOLL,
+    NUM_PATHS
+};
+
+static const char* const PATH_NAMES[NUM_PATHS] = {"one at a time","ring, batches of 32",
+        "ring, polling thread"};
+
+struct ioRingBenchState
+{
+    kernel::bench::threadGroup group;
+    bool                noDevice;
+
+    /* Nanoseconds per run, 0 if it failed */
+    uint64_t            elapsed[NUM_PATHS];
+
+    /* Times the kernel was entered, per run */
+    uint32_t            entries[NUM_PATHS];
+};
+
+/**
+ * @brief The shared rings, as the program sees them
+ * 
+ */
+struct ringView
+{
+    int32_t             fd;
+    io_ring_header*     header;
+    io_sqe*             sqes;
+    io_cqe*             cqes;
+    uint32_t            sqMask;
+    uint32_t            cqMask;
+};
+
+static bool openRing(ringView* view, uint32_t flags)
+{
+    io_ring_params params = {BATCH,0,flags,0,0,0};
+    view->fd = kernel::aio::ioRing::setup(&params);
+    if (view->fd < 0)
+        return false;
+    view->header = reinterpret_cast<io_ring_header*>(params.address);
+    view->sqes = reinterpret_cast<io_sqe*>(params.address + params.sqOffset);
+    view->cqes = reinterpret_cast<io_cqe*>(params.address + params.cqOffset);
+    view->sqMask = params.sqEntries - 1;
+    view->cqMask = params.cqEntries - 1;
+    return true;
+}
+
+static int32_t enterRing(const ringView* view, uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+{
+    kernel::proc::descriptor d;
+    if (!kernel::proc::getDescriptor(view->fd,&d))
+        return -1;
+    const int32_t result = static_cast<kernel::aio::ioRing*>(d.object)->enter(toSubmit,minComplete,flags);
+    kernel::proc::putDescriptor(&d);
+    return result;
+}
+
+/**
+ * @brief Queue a batch of reads
+ * 
+ */
+static void queueReads(ringView* view, int32_t device, uint32_t first)
+{
+    uint32_t tail = view->header->sqTail;
+    for (uint32_t i = 0; i < BATCH; i++, tail++)
+    {
+        io_sqe* sqe = view->sqes + (tail & view->sqMask);
+        sqe->opcode = IORING_OP_READ;
+        sqe->flags = 0;
+        sqe->reserved = 0;
+        sqe->fd = device;
+        sqe->offset = (static_cast<uint64_t>(first + i) * READ_SIZE) % WINDOW;
+        sqe->address = BUFFER + i * READ_SIZE;
+        sqe->length = READ_SIZE;
+        sqe->userData = i;
+    }
+    __atomic_store_n(&view->header->sqTail,tail,__ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Consume the completions there are
+ * 
+ * @return uint32_t How many, or ~0 if one of them failed
+ */
+static uint32_t reapCompletions(ringView* view)
+{
+    uint32_t head = view->header->cqHead;
+    const uint32_t tail = __atomic_load_n(&view->header->cqTail,__ATOMIC_ACQUIRE);
+    uint32_t count = 0;
+    bool failed = false;
+    for (; head != tail; head++, count++)
+        failed |= view->cqes[head & view->cqMask].result != static_cast<int32_t>(READ_SIZE);
+    __atomic_store_n(&view->header->cqHead,head,__ATOMIC_RELEASE);
+    return failed ? ~0u : count;
+}
+
+static uint64_t measureSync(int32_t device, uint32_t* entries)
+{
+    const uint64_t start = kernel::clock::nanoseconds();
+    for (uint32_t i = 0; i < READS_PER_RUN; i++)
+    {
+        // What a pread() system call would do, minus getting there
+        kernel::proc::descriptor d;
+        if (!kernel::proc::getDescriptor(device,&d))
+            return 0;
+        const int32_t read = kernel::proc::descriptorRead(&d,BUFFER + (i % BATCH) * READ_SIZE,READ_SIZE,
+                (static_cast<uint64_t>(i) * READ_SIZE) % WINDOW);
+        kernel::proc::putDescriptor(&d);
+        if (read != static_cast<int32_t>(READ_SIZE))
+            return 0;
+    }
+    *entries = READS_PER_RUN;
+    return kernel::clock::nanoseconds() - start;
+}
+
+static uint64_t measureRing(int32_t device, bool polled, uint32_t* entries)
+{
+    ringView view;
+    if (!openRing(&view,polled ? IORING_SETUP_SQPOLL : 0))
+        return 0;
+
+    bool failed = false;
+    *entries = 0;
+    const uint64_t start = kernel::clock::nanoseconds();
+    for (uint32_t done = 0; done < READS_PER_RUN && !failed; done += BATCH)
+    {
+        queueReads(&view,device,done);
+        if (!polled)
+        {
+            failed = enterRing(&view,BATCH,BATCH,IORING_ENTER_GETEVENTS) != static_cast<int32_t>(BATCH);
+            (*entries)++;
+        }
+        else if (__atomic_load_n(&view.header->flags,__ATOMIC_SEQ_CST) & IORING_SQ_NEED_WAKEUP)
+        {
+            enterRing(&view,0,0,IORING_ENTER_WAKEUP);
+            (*entries)++;
+        }
+
+        // The polling thread could be on this processor
+        uint32_t reaped = 0;
+        while (reaped < BATCH && !failed)
+        {
+            const uint32_t count = reapCompletions(&view);
+            failed = count == ~0u;
+            reaped += count;
+            if (reaped < BATCH && polled)
+                yield();
+        }
+    }
+    const uint64_t elapsed = kernel::clock::nanoseconds() - start;
+
+    kernel::proc::closeDescriptor(view.fd);
+    return failed ? 0 : elapsed;
+}
+
+static void benchThread(void* arg)
+{
+    ioRingBenchState* state = static_cast<ioRingBenchState*>(arg);
+    thread* self = currentThread();
+
+    // Rings belong to a process, so this is one, without a program
+    const kernel::block::blockDevice* disk = kernel::block::findDevice("ata0");
+    kernel::proc::process* p = disk != nullptr ? new kernel::proc::process() : nullptr;
+    kernel::mm::addressSpace* space = p != nullptr ? kernel::mm::addressSpace::create() : nullptr;
+    state->noDevice = disk == nullptr;
+    if (space != nullptr &&
+            space->addRegion(BUFFER,BUFFER + BUFFER_SIZE,kernel::mm::REGION_READ | kernel::mm::REGION_WRITE))
+    {
+        kernel::proc::initDescriptors(p);
+        p->space = space;
+        uint32_t flags = kernel::saveAndDisableInterrupts();
+        self->space = space;
+        self->process = p;
+        kernel::mm::activate(space);
+        kernel::restoreInterrupts(flags);
+
+        const int32_t device = kernel::proc::openDescriptor(kernel::proc::descriptorType::BLOCK_DEVICE,
+                const_cast<kernel::block::blockDevice*>(disk));
+
+        // Once through first, so every path finds the cache warm
+        uint32_t unused;
+        if (device >= 0 && measureSync(device,&unused) != 0)
+        {
+            state->elapsed[PATH_SYNC] = measureSync(device,&state->entries[PATH_SYNC]);
+            state->elapsed[PATH_RING] = measureRing(device,false,&state->entries[PATH_RING]);
+            state->elapsed[PATH_SQPOLL] = measureRing(device,true,&state->entries[PATH_SQPOLL]);
+        }
+
+        // Rings take their mappings down while we're still in here
+        kernel::proc::closeDescriptors(p);
+        flags = kernel::saveAndDisableInterrupts();
+        self->space = nullptr;
+        self->process = nullptr;
+        kernel::mm::activate(nullptr);
+        kernel::restoreInterrupts(flags);
+    }
+    if (space != nullptr)
+        space->destroy();
+    delete p;
+
+    kernel::bench::leaveGroup(&state->group);
+}
+
+void kernel::bench::runIORingBenchmarks()
+{
+    out << "I/O ring benchmarks (" << out.dec() << READ_SIZE << " byte reads from the buffer cache)\n";
+
+    ioRingBenchState state = {};
+    initGroup(&state.group,1);
+    if (createThread(&benchThread,&state,PRIORITY_NORMAL,"ioRingBench") == nullptr)
+    {
+        out << "  couldn't create the thread\n" << out.hex();
+        return;
+    }
+    joinGroup(&state.group);
+
+    if (state.noDevice)
+    {
+        out << "  no disk\n" << out.hex();
+        return;
+    }
+    for (size_t i = 0; i < NUM_PATHS; i++)
+    {
+        out << "  " << PATH_NAMES[i] << ": ";
+        if (state.elapsed[i] == 0)
+            out << "failed\n";
+        else
+            out << state.elapsed[i] / READS_PER_RUN << " ns per read, " << state.entries[i]
+                << " kernel entries for " << READS_PER_RUN << " reads\n";
+    }
+
+    const kernel::block::cacheStats stats = kernel::block::getCacheStats();
+    out << "  buffer cache: " << stats.hits << " hits, " << stats.misses << " misses\n" << out.hex();
+}
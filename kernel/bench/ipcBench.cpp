@@ -0,0 +1,140 @@
+/**
+ * @file ipcBench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Pipe throughput benchmark, copying against remapping, from bench.hpp
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/bench/bench.hpp>
+#include <kernelInternal/ipc/pipe.hpp>
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <klib/io.hpp>
+
+using namespace kernel::sched;
+using kernel::mm::PAGE_SIZE;
+
+static const size_t MESSAGE_SIZES[] =       {256,4096,16384,65536};
+static const size_t NUM_MESSAGE_SIZES =     sizeof(MESSAGE_SIZES) / sizeof(MESSAGE_SIZES[0]);
+static const uint64_t BYTES_PER_RUN =       0x800000;
+
+// Buffers, in an address space of our own. Messages fit in a pipe, so one
+// thread can write and then read them without waiting
+static const uint32_t BUFFER_SIZE =         kernel::ipc::PIPE_PAGES * PAGE_SIZE;
+static const uint32_t SOURCE =              kernel::mm::USER_SPACE_START;
+static const uint32_t DESTINATION =         SOURCE + 2 * BUFFER_SIZE;
+
+struct ipcBenchState
+{
+    kernel::bench::threadGroup group;
+
+    /* Nanoseconds per run, 0 if it failed. Copy, then remap */
+    uint64_t            elapsed[NUM_MESSAGE_SIZES][2];
+};
+
+/**
+ * @brief Push BYTES_PER_RUN through a pipe, size bytes at a time
+ * 
+ * @return uint64_t Nanoseconds it took, 0 if the data came out wrong
+ */
+static uint64_t measure(uint32_t flags, size_t size)
+{
+    kernel::ipc::pipe* p = kernel::ipc::pipe::create(flags);
+    if (p == nullptr)
+        return 0;
+
+    uint8_t* source = reinterpret_cast<uint8_t*>(SOURCE);
+    uint8_t* destination = reinterpret_cast<uint8_t*>(DESTINATION);
+    const uint32_t rounds = static_cast<uint32_t>(BYTES_PER_RUN / size);
+    bool failed = false;
+
+    const uint64_t start = kernel::clock::nanoseconds();
+    for (uint32_t i = 0; i < rounds && !failed; i++)
+    {
+        // New data every time, as a real producer would have. Pages lent last
+        // time get copied here, which remapping has to pay for
+        for (size_t offset = 0; offset < size; offset += PAGE_SIZE)
+            source[offset] = static_cast<uint8_t>(i);
+
+        failed = p->write(source,size) != static_cast<int32_t>(size) ||
+                p->read(destination,size) != static_cast<int32_t>(size) ||
+                destination[0] != static_cast<uint8_t>(i);
+    }
+    const uint64_t elapsed = kernel::clock::nanoseconds() - start;
+
+    p->close(false);
+    p->close(true);
+    return failed ? 0 : elapsed;
+}
+
+static void benchThread(void* arg)
+{
+    ipcBenchState* state = static_cast<ipcBenchState*>(arg);
+    thread* self = currentThread();
+
+    kernel::mm::addressSpace* space = kernel::mm::addressSpace::create();
+    if (space != nullptr &&
+            space->addRegion(SOURCE,SOURCE + BUFFER_SIZE,kernel::mm::REGION_READ | kernel::mm::REGION_WRITE) &&
+            space->addRegion(DESTINATION,DESTINATION + BUFFER_SIZE,
+                    kernel::mm::REGION_READ | kernel::mm::REGION_WRITE))
+    {
+        uint32_t flags = kernel::saveAndDisableInterrupts();
+        self->space = space;
+        kernel::mm::activate(space);
+        kernel::restoreInterrupts(flags);
+
+        for (size_t i = 0; i < NUM_MESSAGE_SIZES; i++)
+        {
+            state->elapsed[i][0] = measure(kernel::ipc::PIPE_COPY,MESSAGE_SIZES[i]);
+            state->elapsed[i][1] = measure(0,MESSAGE_SIZES[i]);
+        }
+
+        flags = kernel::saveAndDisableInterrupts();
+        self->space = nullptr;
+        kernel::mm::activate(nullptr);
+        kernel::restoreInterrupts(flags);
+    }
+    if (space != nullptr)
+        space->destroy();
+
+    kernel::bench::leaveGroup(&state->group);
+}
+
+static void printThroughput(uint64_t elapsed)
+{
+    if (elapsed == 0)
+        out << "failed";
+    else
+        out << BYTES_PER_RUN * 1000 / elapsed << " MB/s";
+}
+
+void kernel::bench::runIPCBenchmarks()
+{
+    out << "Pipe benchmarks (copy against remap, one thread)\n";
+
+    ipcBenchState state = {};
+    initGroup(&state.group,1);
+    if (createThread(&benchThread,&state,PRIORITY_NORMAL,"ipcBench") == nullptr)
+    {
+        out << "  couldn't create the thread\n";
+        return;
+    }
+    joinGroup(&state.group);
+
+    out << out.dec();
+    for (size_t i = 0; i < NUM_MESSAGE_SIZES; i++)
+    {
+        out << "  " << MESSAGE_SIZES[i] << " bytes: copy ";
+        printThroughput(state.elapsed[i][0]);
+        out << ", remap ";
+        printThroughput(state.elapsed[i][1]);
+        out << "\n";
+    }
+    out << out.hex();
+}
@@ -0,0 +1,202 @@
+/**
+ * @file schedBench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Scheduler benchmarks, from bench.hpp
+ * @version 0.1
+ * @date 2025-03-08
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/bench/bench.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <klib/io.hpp>
+
+using namespace kernel::sched;
+
+static const uint32_t PING_PONG_ROUNDS =    10000;
+static const uint32_t YIELD_ITERATIONS =    1000;
+static const size_t THREADS_PER_CPU =       4;
+static const size_t MAX_YIELD_THREADS =     64;
+
+/**========================================================================
+ *                           Ping-pong
+ *========================================================================**/
+
+// turn values
+static const uint32_t TURN_PING =   0;
+static const uint32_t TURN_PONG =   1;
+static const uint32_t TURN_STOP =   2;
+
+struct pingPongState
+{
+    thread*             ping;
+    thread*             pong;
+    kernel::bench::threadGroup group;
+    volatile bool       go;
+    volatile uint32_t   turn;
+    uint64_t            cycles;
+};
+
+static void pingThread(void* arg)
+{
+    pingPongState* state = static_cast<pingPongState*>(arg);
+    while (!state->go)
+        yield();
+
+    const uint64_t start = kernel::clock::readTSC();
+    for (uint32_t i = 0; i < PING_PONG_ROUNDS; i++)
+    {
+        state->turn = TURN_PONG;
+        wake(state->pong);
+        while (state->turn != TURN_PING)
+            block();
+    }
+    state->cycles = kernel::clock::readTSC() - start;
+
+    state->turn = TURN_STOP;
+    wake(state->pong);
+    kernel::bench::leaveGroup(&state->group);
+}
+
+static void pongThread(void* arg)
+{
+    pingPongState* state = static_cast<pingPongState*>(arg);
+    while (!state->go)
+        yield();
+
+    while (true)
+    {
+        while (state->turn == TURN_PING)
+            block();
+        if (state->turn == TURN_STOP)
+            break;
+        state->turn = TURN_PING;
+        wake(state->ping);
+    }
+    kernel::bench::leaveGroup(&state->group);
+}
+
+/**
+ * @brief Two threads waking each other up, pinned to the given processors
+ * 
+ * @return uint64_t Nanoseconds per wakeup, 0 if the threads couldn't be made
+ */
+static uint64_t pingPong(int pingCPU, int pongCPU)
+{
+    pingPongState state;
+    kernel::bench::initGroup(&state.group,2);
+    state.go = false;
+    state.turn = TURN_PING;
+    state.cycles = 0;
+
+    state.ping = createThread(&pingThread,&state,PRIORITY_NORMAL,"ping",pingCPU);
+    state.pong = createThread(&pongThread,&state,PRIORITY_NORMAL,"pong",pongCPU);
+    if (state.ping == nullptr || state.pong == nullptr)
+        return 0; // Leaks the other one, it'll never get past go
+
+    __atomic_store_n(&state.go,true,__ATOMIC_RELEASE);
+    kernel::bench::joinGroup(&state.group);
+
+    return kernel::clock::cyclesToNanoseconds(state.cycles) / (2 * PING_PONG_ROUNDS);
+}
+
+/**========================================================================
+ *                           Yield throughput
+ *========================================================================**/
+
+struct yieldState
+{
+    kernel::bench::threadGroup group;
+    volatile bool       go;
+};
+
+static void yieldThread(void* arg)
+{
+    yieldState* state = static_cast<yieldState*>(arg);
+    while (!state->go)
+        yield();
+
+    for (uint32_t i = 0; i < YIELD_ITERATIONS; i++)
+        yield();
+    kernel::bench::leaveGroup(&state->group);
+}
+
+static uint64_t totalSwitches(uint64_t* steals)
+{
+    uint64_t switches = 0;
+    *steals = 0;
+    for (size_t i = 0; i < kernel::smp::cpuCount(); i++)
+    {
+        const schedulerStats* stats = getStats(i);
+        switches += stats->switches;
+        *steals += stats->steals;
+    }
+    return switches;
+}
+
+static void yieldThroughput()
+{
+    size_t cpus = 0;
+    for (kernel::smp::cpuMask online = kernel::smp::onlineMask(); online != 0; online &= online - 1)
+        cpus++;
+    size_t threads = cpus * THREADS_PER_CPU;
+    if (threads > MAX_YIELD_THREADS)
+        threads = MAX_YIELD_THREADS;
+
+    // Counted as they're made, none can leave before go
+    yieldState state;
+    kernel::bench::initGroup(&state.group,0);
+    state.go = false;
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        if (createThread(&yieldThread,&state,PRIORITY_NORMAL,"yield") != nullptr)
+            state.group.threads++;
+    }
+
+    uint64_t stealsBefore,stealsAfter;
+    const uint64_t switchesBefore = totalSwitches(&stealsBefore);
+    const uint64_t start = kernel::clock::nanoseconds();
+
+    __atomic_store_n(&state.go,true,__ATOMIC_RELEASE);
+    kernel::bench::joinGroup(&state.group);
+
+    const uint64_t elapsed = kernel::clock::nanoseconds() - start;
+    const uint64_t switches = totalSwitches(&stealsAfter) - switchesBefore;
+    const uint64_t yields = static_cast<uint64_t>(state.group.threads) * YIELD_ITERATIONS;
+
+    out << out.dec() << "  yield: " << state.group.threads << " threads on " << cpus
+        << " processors, " << yields << " yields in " << elapsed / 1000 << " us\n";
+    out << "         " << (elapsed ? yields * 1000000000ULL / elapsed : 0)
+        << " yields/s, " << switches << " switches, "
+        << stealsAfter - stealsBefore << " steals\n" << out.hex();
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+void kernel::bench::runSchedulerBenchmarks()
+{
+    out << "Scheduler benchmarks\n";
+
+    const int self = static_cast<int>(kernel::smp::cpuIndex());
+    out << out.dec() << "  ping-pong, same processor: "
+        << pingPong(self,self) << " ns per wakeup\n" << out.hex();
+
+    // Another processor that's online, if there is one
+    const kernel::smp::cpuMask others =
+            kernel::smp::onlineMask() & ~(kernel::smp::cpuMask(1) << self);
+    if (others != 0)
+    {
+        const int other = __builtin_ctz(others);
+        out << out.dec() << "  ping-pong, across processors: "
+            << pingPong(self,other) << " ns per wakeup\n" << out.hex();
+    }
+
+    yieldThroughput();
+}
@@ -0,0 +1,124 @@
+/**
+ * @file syncBench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Spinlock scaling benchmark, from bench.hpp
+ * @version 0.1
+ * @date 2025-03-12
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/bench/bench.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <klib/io.hpp>
+
+using namespace kernel::sched;
+
+static const uint32_t LOCK_ITERATIONS = 20000;
+
+enum class lockKind
+{
+    TICKET,
+    MCS
+};
+
+struct lockBenchState
+{
+    lockKind                    kind;
+    kernel::sync::spinlock      ticket;
+    kernel::sync::mcsSpinlock   mcs;
+    kernel::bench::threadGroup  group;
+    volatile uint32_t           ready;
+    volatile bool               go;
+
+    /* Protected by the lock being measured */
+    uint32_t                    counter;
+};
+
+static void lockThread(void* arg)
+{
+    lockBenchState* state = static_cast<lockBenchState*>(arg);
+    __atomic_add_fetch(&state->ready,1,__ATOMIC_RELEASE);
+    while (!__atomic_load_n(&state->go,__ATOMIC_ACQUIRE))
+        kernel::sync::cpuRelax();
+
+    if (state->kind == lockKind::TICKET)
+    {
+        for (uint32_t i = 0; i < LOCK_ITERATIONS; i++)
+        {
+            state->ticket.lock();
+            state->counter++;
+            state->ticket.unlock();
+        }
+    }
+    else
+    {
+        kernel::sync::mcsNode node;
+        for (uint32_t i = 0; i < LOCK_ITERATIONS; i++)
+        {
+            state->mcs.lock(&node);
+            state->counter++;
+            state->mcs.unlock(&node);
+        }
+    }
+    kernel::bench::leaveGroup(&state->group);
+}
+
+/**
+ * @brief One thread on each of the first cpus online processors hammering the
+ * same lock
+ * 
+ * @return uint64_t Nanoseconds per acquisition, 0 if it couldn't run
+ */
+static uint64_t contend(lockKind kind, const int* cpus, uint32_t count)
+{
+    lockBenchState state;
+    state.kind = kind;
+    state.ticket = kernel::sync::spinlock();
+    state.mcs = kernel::sync::mcsSpinlock();
+    kernel::bench::initGroup(&state.group,count);
+    state.ready = 0;
+    state.go = false;
+    state.counter = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (createThread(&lockThread,&state,PRIORITY_NORMAL,"lock",cpus[i]) == nullptr)
+            return 0; // The ones already made wait forever, but we're out of memory anyway
+    }
+
+    // The one sharing our processor needs us out of the way to get ready
+    while (__atomic_load_n(&state.ready,__ATOMIC_ACQUIRE) != count)
+        yield();
+
+    const uint64_t start = kernel::clock::nanoseconds();
+    __atomic_store_n(&state.go,true,__ATOMIC_RELEASE);
+    kernel::bench::joinGroup(&state.group);
+    const uint64_t elapsed = kernel::clock::nanoseconds() - start;
+
+    if (state.counter != count * LOCK_ITERATIONS)
+        out << "  lost updates, the lock is broken!\n";
+
+    return elapsed / (static_cast<uint64_t>(count) * LOCK_ITERATIONS);
+}
+
+void kernel::bench::runSyncBenchmarks()
+{
+    int cpus[kernel::smp::MAX_CPUS];
+    uint32_t online = 0;
+    for (kernel::smp::cpuMask mask = kernel::smp::onlineMask(); mask != 0; mask &= mask - 1)
+        cpus[online++] = __builtin_ctz(mask);
+
+    out << "Spinlock benchmarks (ns per lock/unlock, 1 to " << out.dec() << online
+        << " processors)\n";
+    for (uint32_t count = 1; count <= online; count++)
+    {
+        out << "  " << count << ": ticket " << contend(lockKind::TICKET,cpus,count)
+            << ", MCS " << contend(lockKind::MCS,cpus,count) << "\n";
+    }
+    out << out.hex();
+}
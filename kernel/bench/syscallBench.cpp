@@ -0,0 +1,149 @@
+/**
+ * @file syscallBench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Null system call round trip benchmark, from bench.hpp
+ * @version 0.1
+ * @date 2025-03-18
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/bench/bench.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <klib/io.hpp>
+
+using namespace kernel::syscall;
+
+static const uint32_t NULL_SYSCALL_ROUNDS = 100000;
+static const size_t USER_STACK_SIZE =       4096;
+
+/**
+ * @brief Round trips of one path. Per-call timings include an rdtsc
+ * 
+ */
+struct pathResult
+{
+    uint64_t            minCycles;
+    uint64_t            totalCycles;
+    bool                failed;
+};
+
+// Filled in from ring 3
+USER_DATA static pathResult sysenterResult;
+USER_DATA static pathResult interruptResult;
+USER_DATA static volatile bool finished;
+
+USER_DATA __attribute__((aligned(16)))
+static uint8_t userStack[USER_STACK_SIZE];
+
+/**========================================================================
+ *                           Ring 3
+ *========================================================================**/
+
+// Nothing in here may touch the kernel: %gs isn't the per-cpu segment, and
+// only USER_TEXT and USER_DATA are mapped for ring 3. Everything it calls is
+// forced inline, even without optimizations
+
+__attribute__((always_inline)) static inline uint64_t userReadTSC()
+{
+    uint32_t low, high;
+    __asm__ __volatile__ ("rdtsc" : "=a"(low), "=d"(high));
+    return static_cast<uint64_t>(high) << 32 | low;
+}
+
+__attribute__((always_inline)) static inline uint32_t sysenterNull()
+{
+    uint32_t result;
+    __asm__ __volatile__ ("call sysenterCall" : "=a"(result) : "a"(SYS_NULL)
+            : "ecx", "edx", "memory");
+    return result;
+}
+
+__attribute__((always_inline)) static inline uint32_t interruptNull()
+{
+    uint32_t result;
+    __asm__ __volatile__ ("int $0x80" : "=a"(result) : "a"(SYS_NULL) : "memory");
+    return result;
+}
+
+USER_TEXT static void measure(bool useSysenter, pathResult* result)
+{
+    result->minCycles = ~uint64_t(0);
+    result->totalCycles = 0;
+    result->failed = false;
+
+    for (uint32_t i = 0; i < NULL_SYSCALL_ROUNDS; i++)
+    {
+        const uint64_t start = userReadTSC();
+        const uint32_t value = useSysenter ? sysenterNull() : interruptNull();
+        const uint64_t cycles = userReadTSC() - start;
+
+        result->failed |= value != 0;
+        result->totalCycles += cycles;
+        if (cycles < result->minCycles)
+            result->minCycles = cycles;
+    }
+}
+
+[[noreturn]] USER_TEXT static void userMain(bool useSysenter)
+{
+    if (useSysenter)
+        measure(true,&sysenterResult);
+    measure(false,&interruptResult);
+
+    __atomic_store_n(&finished,true,__ATOMIC_RELEASE);
+    __asm__ __volatile__ ("int $0x80" : : "a"(SYS_EXIT), "b"(0) : "memory");
+    __builtin_unreachable();
+}
+
+[[noreturn]] USER_TEXT static void userEntrySysenter() { userMain(true); }
+[[noreturn]] USER_TEXT static void userEntryInterrupt() { userMain(false); }
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+static void userThread(void*)
+{
+    const uint32_t entry = hasSysenter() ? reinterpret_cast<uint32_t>(&userEntrySysenter) :
+            reinterpret_cast<uint32_t>(&userEntryInterrupt);
+    enterUserMode(entry,reinterpret_cast<uint32_t>(userStack + USER_STACK_SIZE));
+}
+
+static void printResult(const char* path, const pathResult* result)
+{
+    out << out.dec() << "  null syscall, " << path << ": ";
+    if (result->failed)
+        out << "failed\n";
+    else
+        out << result->minCycles << " cycles min, "
+            << result->totalCycles / NULL_SYSCALL_ROUNDS << " average ("
+            << kernel::clock::cyclesToNanoseconds(result->totalCycles / NULL_SYSCALL_ROUNDS)
+            << " ns)\n";
+    out << out.hex();
+}
+
+void kernel::bench::runSyscallBenchmarks()
+{
+    out << "System call benchmarks\n";
+
+    finished = false;
+    if (sched::createThread(&userThread,nullptr,sched::PRIORITY_NORMAL,"syscallBench") == nullptr)
+    {
+        out << "  couldn't create the thread\n";
+        return;
+    }
+
+    // It can't wake us from ring 3
+    while (!__atomic_load_n(&finished,__ATOMIC_ACQUIRE))
+        sched::yield();
+
+    if (hasSysenter())
+        printResult("sysenter",&sysenterResult);
+    else
+        out << "  no sysenter on this processor\n";
+    printResult("int 0x80",&interruptResult);
+}
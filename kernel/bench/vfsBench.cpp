@@ -0,0 +1,167 @@
+/**
+ * @file vfsBench.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Path lookup and file read benchmarks, through the dentry and page
+ * caches, from bench.hpp
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/bench/bench.hpp>
+#include <kernelInternal/fs/vfs.hpp>
+#include <kernelInternal/fs/pageCache.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <klib/io.hpp>
+
+static const uint32_t WALK_ROUNDS =         10000;
+static const uint32_t READ_ROUNDS =         100;
+static const size_t READ_CHUNK =            4096;
+
+static uint8_t readBuffer[READ_CHUNK];
+
+/**
+ * @brief A path, and whether it's supposed to be there
+ * 
+ */
+struct benchPath
+{
+    const char*         path;
+    bool                exists;
+};
+
+static const benchPath PATHS[] = {
+    {"/boot/INIT.ELF",true},        // From the disk the first time
+    {"/boot/MISSING.ELF",false},    // Same, but it isn't there
+    {"/tmp/../boot/./INIT.ELF",true},
+    {"/tmp/bench/file",true},       // All in memory
+};
+
+/**
+ * @brief Walk a path over and over
+ * 
+ * @return uint64_t Nanoseconds per walk, after the first. 0 if it didn't
+ * come out as expected
+ */
+static uint64_t timeWalks(const benchPath* p, uint64_t* first)
+{
+    kernel::vfs::vnode* node;
+    uint64_t start = kernel::clock::nanoseconds();
+    int32_t result = kernel::vfs::walk(p->path,&node);
+    *first = kernel::clock::nanoseconds() - start;
+    if ((result == 0) != p->exists)
+        return 0;
+    if (result == 0)
+        kernel::vfs::putVnode(node);
+
+    start = kernel::clock::nanoseconds();
+    for (uint32_t i = 0; i < WALK_ROUNDS; i++)
+    {
+        result = kernel::vfs::walk(p->path,&node);
+        if ((result == 0) != p->exists)
+            return 0;
+        if (result == 0)
+            kernel::vfs::putVnode(node);
+    }
+    return (kernel::clock::nanoseconds() - start) / WALK_ROUNDS;
+}
+
+/**
+ * @brief Read a whole file into readBuffer, a chunk at a time
+ * 
+ * @return uint64_t Nanoseconds it took, 0 if a read failed
+ */
+static uint64_t timeRead(kernel::vfs::vnode* node)
+{
+    const uint64_t start = kernel::clock::nanoseconds();
+    for (uint64_t offset = 0; offset < node->size; offset += READ_CHUNK)
+    {
+        if (kernel::vfs::read(node,offset,readBuffer,READ_CHUNK) <= 0)
+            return 0;
+    }
+    const uint64_t took = kernel::clock::nanoseconds() - start;
+    return took != 0 ? took : 1;
+}
+
+/**
+ * @brief Read a file from the disk, with whatever isn't mapped thrown out of
+ * the page cache first, and then from the cache
+ * 
+ */
+static void readBenchmark(const char* path)
+{
+    kernel::vfs::vnode* node;
+    out << "  read " << path << ": ";
+    if (kernel::vfs::walk(path,&node) != 0)
+    {
+        out << "not there\n";
+        return;
+    }
+
+    kernel::vfs::reclaimPages(SIZE_MAX);
+    const kernel::vfs::pageCacheStats before = kernel::vfs::getPageCacheStats();
+    const uint64_t cold = timeRead(node);
+    uint64_t hot = 0;
+    for (uint32_t i = 0; i < READ_ROUNDS && cold != 0; i++)
+    {
+        const uint64_t took = timeRead(node);
+        if (took == 0)
+        {
+            hot = 0;
+            break;
+        }
+        hot += took;
+    }
+    const kernel::vfs::pageCacheStats after = kernel::vfs::getPageCacheStats();
+    const uint32_t size = node->size;
+    kernel::vfs::putVnode(node);
+
+    if (cold == 0 || hot == 0)
+    {
+        out << "failed\n";
+        return;
+    }
+    out << size << " bytes, " << cold << " ns from the disk, then " << hot / READ_ROUNDS
+        << " ns\n  page cache: " << after.hits - before.hits << " hits, "
+        << after.misses - before.misses << " misses, " << after.readahead - before.readahead
+        << " read ahead\n";
+}
+
+void kernel::bench::runVFSBenchmarks()
+{
+    out << "VFS benchmarks (" << out.dec() << WALK_ROUNDS << " walks of each path)\n";
+
+    vfs::vnode* node;
+    if (vfs::create("/tmp/bench",vfs::vnodeType::DIRECTORY,&node) == 0)
+        vfs::putVnode(node);
+    if (vfs::create("/tmp/bench/file",vfs::vnodeType::FILE,&node) == 0)
+        vfs::putVnode(node);
+
+    const vfs::vfsStats before = vfs::getStats();
+    for (const benchPath& p : PATHS)
+    {
+        uint64_t first;
+        const uint64_t warm = timeWalks(&p,&first);
+        out << "  " << p.path << ": ";
+        if (warm == 0)
+            out << "unexpected result\n";
+        else
+            out << first << " ns the first time, then " << warm << " ns\n";
+    }
+
+    const vfs::vfsStats after = vfs::getStats();
+    const uint32_t hits = after.hits - before.hits;
+    const uint32_t negativeHits = after.negativeHits - before.negativeHits;
+    const uint32_t misses = after.misses - before.misses;
+    const uint32_t total = hits + negativeHits + misses;
+    out << "  dentry cache: " << hits << " hits, " << negativeHits << " negative hits, "
+        << misses << " misses";
+    if (total != 0)
+        out << " (" << (100 * static_cast<uint64_t>(hits + negativeHits)) / total << "% hit rate)";
+    out << "\n";
+
+    readBenchmark("/boot/INIT.ELF");
+    out << out.hex();
+}
@@ -0,0 +1,265 @@
+/**
+ * @file ata.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from ata.hpp
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/devices/ata.hpp>
+#include <kernelInternal/devices/block.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <klib/cpuio.hpp>
+
+using namespace kernel::cpu::io;
+
+// Primary bus registers
+static const uint16_t ATA_DATA =            0x1f0;
+static const uint16_t ATA_SECTOR_COUNT =    0x1f2;
+static const uint16_t ATA_LBA_LOW =         0x1f3;
+static const uint16_t ATA_LBA_MID =         0x1f4;
+static const uint16_t ATA_LBA_HIGH =        0x1f5;
+static const uint16_t ATA_DRIVE =           0x1f6;
+static const uint16_t ATA_STATUS =          0x1f7; // Read
+static const uint16_t ATA_COMMAND =         0x1f7; // Write
+static const uint16_t ATA_CONTROL =         0x3f6; // Alternate status on reads
+
+static const uint8_t STATUS_ERR =           0x01;
+static const uint8_t STATUS_DRQ =           0x08;
+static const uint8_t STATUS_DF =            0x20;
+static const uint8_t STATUS_BSY =           0x80;
+
+// Interrupts off, we poll
+static const uint8_t CONTROL_NIEN =         0x02;
+
+// Master, LBA addressing
+static const uint8_t DRIVE_MASTER_LBA =     0xe0;
+
+static const uint8_t CMD_READ_SECTORS =     0x20;
+static const uint8_t CMD_READ_SECTORS_EXT = 0x24;
+static const uint8_t CMD_WRITE_SECTORS =    0x30;
+static const uint8_t CMD_WRITE_SECTORS_EXT = 0x34;
+static const uint8_t CMD_CACHE_FLUSH =      0xe7;
+static const uint8_t CMD_CACHE_FLUSH_EXT =  0xea;
+static const uint8_t CMD_IDENTIFY =         0xec;
+
+// Sectors per command. 0 would mean 256 (LBA28), keep clear of that
+static const size_t MAX_SECTORS_PER_COMMAND = 255;
+
+// Past this, the disk is considered gone
+static const uint64_t TIMEOUT_NS =          1000000000;
+
+static const uint64_t LBA28_LIMIT =         uint64_t(1) << 28;
+
+static kernel::sync::spinlock busLock;
+static uint64_t diskSectors = 0;
+static bool hasLBA48 = false;
+
+// What the block layer sees. writeSectors() already flushes
+static kernel::block::blockDevice device = {"ata0",kernel::ata::SECTOR_SIZE,0,
+        &kernel::ata::readSectors,&kernel::ata::writeSectors,nullptr};
+
+/**========================================================================
+ *                           Bus helpers
+ *========================================================================**/
+
+/**
+ * @brief Reading the alternate status 4 times gives the drive the 400ns it
+ * needs to put up a valid status after a command or a drive select
+ * 
+ */
+static inline void delay400ns()
+{
+    for (int i = 0; i < 4; i++)
+        inb(ATA_CONTROL);
+}
+
+/**
+ * @brief Wait until the drive isn't busy, and has all the bits in want set
+ * 
+ * @return true It got there
+ * @return false It reported an error, or took too long
+ */
+static bool waitStatus(uint8_t want)
+{
+    const uint64_t deadline = kernel::clock::nanoseconds() + TIMEOUT_NS;
+    while (true)
+    {
+        const uint8_t status = inb(ATA_STATUS);
+        if (!(status & STATUS_BSY))
+        {
+            if (status & (STATUS_ERR | STATUS_DF))
+                return false;
+            if ((status & want) == want)
+                return true;
+        }
+        if (kernel::clock::nanoseconds() > deadline)
+            return false;
+        kernel::sync::cpuRelax();
+    }
+}
+
+/**
+ * @brief Select the drive and send an addressed command
+ * 
+ */
+static void issue(uint8_t command, uint64_t lba, size_t sectors, bool lba48)
+{
+    if (lba48)
+    {
+        outb(ATA_DRIVE,0x40);
+        // High bytes first, the registers are two deep
+        outb(ATA_SECTOR_COUNT,static_cast<uint8_t>(sectors >> 8));
+        outb(ATA_LBA_LOW,static_cast<uint8_t>(lba >> 24));
+        outb(ATA_LBA_MID,static_cast<uint8_t>(lba >> 32));
+        outb(ATA_LBA_HIGH,static_cast<uint8_t>(lba >> 40));
+    }
+    else
+        outb(ATA_DRIVE,static_cast<uint8_t>(DRIVE_MASTER_LBA | ((lba >> 24) & 0x0f)));
+
+    outb(ATA_SECTOR_COUNT,static_cast<uint8_t>(sectors));
+    outb(ATA_LBA_LOW,static_cast<uint8_t>(lba));
+    outb(ATA_LBA_MID,static_cast<uint8_t>(lba >> 8));
+    outb(ATA_LBA_HIGH,static_cast<uint8_t>(lba >> 16));
+    outb(ATA_COMMAND,command);
+    delay400ns();
+}
+
+static bool inRange(uint64_t lba, size_t sectors)
+{
+    return sectors != 0 && lba < diskSectors && sectors <= diskSectors - lba;
+}
+
+/**
+ * @brief Move sectors in or out, one command at a time. Bus lock held
+ * 
+ */
+static bool transfer(uint64_t lba, uint8_t* buffer, size_t sectors, bool write)
+{
+    while (sectors != 0)
+    {
+        const size_t count = sectors < MAX_SECTORS_PER_COMMAND ? sectors : MAX_SECTORS_PER_COMMAND;
+        const bool lba48 = lba + count > LBA28_LIMIT;
+        if (lba48 && !hasLBA48)
+            return false;
+
+        if (!waitStatus(0))
+            return false;
+        if (write)
+            issue(lba48 ? CMD_WRITE_SECTORS_EXT : CMD_WRITE_SECTORS,lba,count,lba48);
+        else
+            issue(lba48 ? CMD_READ_SECTORS_EXT : CMD_READ_SECTORS,lba,count,lba48);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!waitStatus(STATUS_DRQ))
+                return false;
+            if (write)
+                outsw(ATA_DATA,buffer,kernel::ata::SECTOR_SIZE / 2);
+            else
+                insw(ATA_DATA,buffer,kernel::ata::SECTOR_SIZE / 2);
+            buffer += kernel::ata::SECTOR_SIZE;
+        }
+
+        lba += count;
+        sectors -= count;
+    }
+
+    if (write)
+    {
+        outb(ATA_COMMAND,hasLBA48 ? CMD_CACHE_FLUSH_EXT : CMD_CACHE_FLUSH);
+        delay400ns();
+        return waitStatus(0);
+    }
+    return true;
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+bool kernel::ata::init()
+{
+    outb(ATA_CONTROL,CONTROL_NIEN);
+
+    // Floating bus, no drives at all
+    if (inb(ATA_STATUS) == 0xff)
+        return false;
+
+    outb(ATA_DRIVE,0xa0);
+    delay400ns();
+    outb(ATA_SECTOR_COUNT,0);
+    outb(ATA_LBA_LOW,0);
+    outb(ATA_LBA_MID,0);
+    outb(ATA_LBA_HIGH,0);
+    outb(ATA_COMMAND,CMD_IDENTIFY);
+    delay400ns();
+
+    if (inb(ATA_STATUS) == 0)
+        return false; // No master
+
+    const uint64_t deadline = clock::nanoseconds() + TIMEOUT_NS;
+    while (inb(ATA_STATUS) & STATUS_BSY)
+    {
+        if (clock::nanoseconds() > deadline)
+            return false;
+    }
+
+    // ATAPI and SATA bridges set these, ATA disks don't
+    if (inb(ATA_LBA_MID) != 0 || inb(ATA_LBA_HIGH) != 0)
+        return false;
+    if (!waitStatus(STATUS_DRQ))
+        return false;
+
+    uint16_t identify[SECTOR_SIZE / 2];
+    insw(ATA_DATA,identify,SECTOR_SIZE / 2);
+
+    hasLBA48 = identify[83] & (1u << 10);
+    if (hasLBA48)
+        diskSectors = static_cast<uint64_t>(identify[100]) |
+                static_cast<uint64_t>(identify[101]) << 16 |
+                static_cast<uint64_t>(identify[102]) << 32 |
+                static_cast<uint64_t>(identify[103]) << 48;
+    else
+        diskSectors = static_cast<uint64_t>(identify[60]) |
+                static_cast<uint64_t>(identify[61]) << 16;
+    if (diskSectors == 0)
+        return false;
+
+    device.sectorCount = diskSectors;
+    kernel::block::registerDevice(&device);
+    return true;
+}
+
+uint64_t kernel::ata::sectorCount()
+{
+    return diskSectors;
+}
+
+int kernel::ata::readSectors(uint64_t lba, void* buffer, size_t sectors)
+{
+    if (!inRange(lba,sectors))
+        return 0;
+
+    busLock.lock();
+    const bool ok = transfer(lba,static_cast<uint8_t*>(buffer),sectors,false);
+    busLock.unlock();
+    return ok;
+}
+
+int kernel::ata::writeSectors(uint64_t lba, const void* buffer, size_t sectors)
+{
+    if (!inRange(lba,sectors))
+        return 0;
+
+    // transfer() doesn't write through the buffer when writing
+    busLock.lock();
+    const bool ok = transfer(lba,const_cast<uint8_t*>(static_cast<const uint8_t*>(buffer)),
+            sectors,true);
+    busLock.unlock();
+    return ok;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file block.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from block.hpp
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/devices/block.hpp>
+#include <kernelInternal/mm/frames.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <klib/string.h>
+
+using namespace kernel::block;
+
+// Entries are only ever added, so readers don't need the lock
+static const blockDevice* devices[MAX_BLOCK_DEVICES];
+static kernel::sync::spinlock devicesLock;
+
+bool kernel::block::registerDevice(const blockDevice* device)
+{
+    if (device == nullptr || device->read == nullptr || device->name[0] == '\0' ||
+            device->sectorSize == 0 || mm::PAGE_SIZE % device->sectorSize != 0)
+        return false;
+
+    bool added = false;
+    devicesLock.lock();
+    if (findDevice(device->name) == nullptr)
+    {
+        for (const blockDevice*& slot : devices)
+        {
+            if (slot == nullptr)
+            {
+                __atomic_store_n(&slot,device,__ATOMIC_RELEASE);
+                added = true;
+                break;
+            }
+        }
+    }
+    devicesLock.unlock();
+    return added;
+}
+
+const blockDevice* kernel::block::findDevice(const char* name)
+{
+    for (const blockDevice* const& slot : devices)
+    {
+        const blockDevice* device = __atomic_load_n(&slot,__ATOMIC_ACQUIRE);
+        if (device != nullptr && strcmp(device->name,name) == 0)
+            return device;
+    }
+    return nullptr;
+}
@@ -0,0 +1,444 @@
+/**
+ * @file bufferCache.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from bufferCache.hpp
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/devices/bufferCache.hpp>
+#include <kernelInternal/mm/frames.hpp>
+#include <kernelInternal/sched/waitQueue.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <klib/string.h>
+
+using namespace kernel::block;
+
+static_assert(BLOCK_SIZE == kernel::mm::PAGE_SIZE, "Buffers are one frame each");
+
+// Buffer states
+static const uint8_t BUFFER_VALID =         0x1;    // Has the block's contents
+static const uint8_t BUFFER_DIRTY =         0x2;    // Needs writing back
+static const uint8_t BUFFER_BUSY =          0x4;    // I/O in flight, wait for it
+
+static const size_t HASH_BUCKETS =          64;
+static const uint32_t HASH_SHIFT =          26;     // 32 - log2(HASH_BUCKETS)
+
+struct kernel::block::buffer
+{
+    const blockDevice*  device;
+    uint64_t            block;
+
+    /* Allocated the first time the buffer is used */
+    uint32_t            frame;
+
+    uint32_t            references;
+    uint8_t             state;
+
+    buffer*             hashNext;
+
+    /* Only unreferenced buffers are in the LRU list */
+    buffer*             lruPrev;
+    buffer*             lruNext;
+};
+
+// Everything below is under cacheLock. Device I/O never is: a buffer doing
+// I/O is BUSY, and whoever else wants it waits on ioWait, keyed by its index
+static buffer buffers[CACHE_BUFFERS];
+static buffer* hashTable[HASH_BUCKETS];
+static buffer* lruHead = nullptr;
+static buffer* lruTail = nullptr;
+static bool lruReady = false;
+static cacheStats stats;
+static kernel::sync::spinlock cacheLock;
+static kernel::sched::waitQueue ioWait;
+
+/**========================================================================
+ *                           Lists
+ *========================================================================**/
+
+static inline uint32_t hashOf(const blockDevice* device, uint64_t block)
+{
+    const uint32_t mixed = reinterpret_cast<uint32_t>(device) ^ static_cast<uint32_t>(block) ^
+            static_cast<uint32_t>(block >> 32);
+    return (mixed * 2654435761u) >> HASH_SHIFT;
+}
+
+static inline uint32_t indexOf(const buffer* b)
+{
+    return static_cast<uint32_t>(b - buffers);
+}
+
+static void lruRemove(buffer* b)
+{
+    if (b->lruPrev != nullptr)
+        b->lruPrev->lruNext = b->lruNext;
+    else
+        lruHead = b->lruNext;
+    if (b->lruNext != nullptr)
+        b->lruNext->lruPrev = b->lruPrev;
+    else
+        lruTail = b->lruPrev;
+    b->lruPrev = b->lruNext = nullptr;
+}
+
+static void lruAppend(buffer* b)
+{
+    b->lruPrev = lruTail;
+    b->lruNext = nullptr;
+    if (lruTail != nullptr)
+        lruTail->lruNext = b;
+    else
+        lruHead = b;
+    lruTail = b;
+}
+
+static void hashInsert(buffer* b)
+{
+    buffer** bucket = hashTable + hashOf(b->device,b->block);
+    b->hashNext = *bucket;
+    *bucket = b;
+}
+
+static void hashRemove(buffer* b)
+{
+    buffer** link = hashTable + hashOf(b->device,b->block);
+    while (*link != b)
+        link = &(*link)->hashNext;
+    *link = b->hashNext;
+}
+
+static buffer* find(const blockDevice* device, uint64_t block)
+{
+    buffer* b = hashTable[hashOf(device,block)];
+    while (b != nullptr && (b->device != device || b->block != block))
+        b = b->hashNext;
+    return b;
+}
+
+/**
+ * @brief Take a reference. Lock held
+ * 
+ */
+static inline void reference(buffer* b)
+{
+    if (b->references++ == 0)
+        lruRemove(b);
+}
+
+/**
+ * @brief Drop a reference. Lock held
+ * 
+ */
+static inline void release(buffer* b)
+{
+    if (--b->references == 0)
+        lruAppend(b);
+}
+
+/**
+ * @brief Wait for a BUSY buffer. Lock held, and held again on return
+ * 
+ */
+static void waitIdle(buffer* b)
+{
+    kernel::sched::waiter w;
+    ioWait.add(&w,indexOf(b));
+    cacheLock.unlock();
+    kernel::sched::sleep(&w);
+    cacheLock.lock();
+}
+
+/**
+ * @brief Done with the I/O on a BUSY buffer. Lock held
+ * 
+ */
+static void finishIO(buffer* b, uint8_t state)
+{
+    b->state = state;
+    ioWait.wake(kernel::sched::WAKE_ALL,indexOf(b));
+}
+
+/**========================================================================
+ *                           I/O
+ *========================================================================**/
+
+/**
+ * @brief Read or write a BUSY buffer. No lock held
+ * 
+ */
+static bool blockIO(buffer* b, bool write)
+{
+    const blockDevice* device = b->device;
+    const size_t perBlock = BLOCK_SIZE / device->sectorSize;
+    const uint64_t lba = b->block * perBlock;
+    uint8_t* data = static_cast<uint8_t*>(kernel::mm::frameAddress(b->frame));
+
+    // Whatever is past the end of the device is zeroes, and stays that way
+    const size_t sectors = lba >= device->sectorCount ? 0 :
+            device->sectorCount - lba < perBlock ? static_cast<size_t>(device->sectorCount - lba) :
+            perBlock;
+    if (write)
+        return sectors == 0 || device->write == nullptr ? sectors == 0 :
+                device->write(lba,data,sectors) != 0;
+
+    if (sectors < perBlock)
+        memset(data + sectors * device->sectorSize,0,(perBlock - sectors) * device->sectorSize);
+    return sectors == 0 || device->read(lba,data,sectors) != 0;
+}
+
+/**
+ * @brief getBuffer(), but when fill is false a block that isn't cached comes
+ * back BUSY and with garbage in it, for the caller to overwrite whole and
+ * hand to finishWrite(). filling says which way it came back
+ * 
+ */
+static buffer* acquire(const blockDevice* device, uint64_t block, bool fill, bool* filling)
+{
+    *filling = false;
+    cacheLock.lock();
+    if (!lruReady)
+    {
+        for (buffer& b : buffers)
+            lruAppend(&b);
+        lruReady = true;
+    }
+
+    buffer* b;
+    for (;;)
+    {
+        b = find(device,block);
+        if (b != nullptr)
+        {
+            if (b->state & BUFFER_BUSY)
+            {
+                waitIdle(b);
+                continue;
+            }
+            reference(b);
+            if (b->state & BUFFER_VALID)
+            {
+                stats.hits++;
+                cacheLock.unlock();
+                return b;
+            }
+
+            // A read of it failed before, try again
+            b->state |= BUFFER_BUSY;
+            break;
+        }
+
+        // The least recently used one goes, after it's written back
+        b = lruHead;
+        if (b == nullptr)
+        {
+            cacheLock.unlock();
+            return nullptr;
+        }
+        if (b->state & BUFFER_DIRTY)
+        {
+            reference(b);
+            b->state = static_cast<uint8_t>((b->state & ~BUFFER_DIRTY) | BUFFER_BUSY);
+            cacheLock.unlock();
+            const bool written = blockIO(b,true);
+            cacheLock.lock();
+
+            stats.writebacks++;
+            finishIO(b,written ? BUFFER_VALID : BUFFER_VALID | BUFFER_DIRTY);
+            release(b);
+            if (!written)
+            {
+                cacheLock.unlock();
+                return nullptr;
+            }
+            continue; // Someone could have wanted it, or our block, meanwhile
+        }
+
+        lruRemove(b);
+        if (b->device != nullptr)
+            hashRemove(b);
+        b->device = device;
+        b->block = block;
+        b->references = 1;
+        b->state = BUFFER_BUSY;
+        hashInsert(b);
+        break;
+    }
+    stats.misses++;
+    cacheLock.unlock();
+
+    if (b->frame == 0)
+        b->frame = kernel::mm::allocateFrame();
+    if (b->frame != 0 && !fill)
+    {
+        *filling = true;
+        return b;
+    }
+
+    const bool read = b->frame != 0 && blockIO(b,false);
+    cacheLock.lock();
+    finishIO(b,read ? BUFFER_VALID : 0);
+    if (!read)
+    {
+        release(b);
+        b = nullptr;
+    }
+    cacheLock.unlock();
+    return b;
+}
+
+/**
+ * @brief Done writing to a buffer from acquire(), and drop the reference
+ * 
+ */
+static void finishWrite(buffer* b, bool filling)
+{
+    cacheLock.lock();
+    if (filling)
+        finishIO(b,BUFFER_VALID | BUFFER_DIRTY);
+    else
+        b->state |= BUFFER_DIRTY;
+    release(b);
+    cacheLock.unlock();
+}
+
+/**
+ * @brief Clamp a transfer to the end of the device
+ * 
+ * @return size_t What's left of length
+ */
+static size_t clampLength(const blockDevice* device, uint64_t offset, size_t length)
+{
+    const uint64_t size = device->sectorCount * device->sectorSize;
+    if (offset >= size)
+        return 0;
+    if (length > INT32_MAX)
+        length = INT32_MAX;
+    return size - offset < length ? static_cast<size_t>(size - offset) : length;
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+buffer* kernel::block::getBuffer(const blockDevice* device, uint64_t block)
+{
+    bool filling;
+    return acquire(device,block,true,&filling);
+}
+
+uint8_t* kernel::block::bufferData(buffer* b)
+{
+    return static_cast<uint8_t*>(mm::frameAddress(b->frame));
+}
+
+void kernel::block::markDirty(buffer* b)
+{
+    cacheLock.lock();
+    b->state |= BUFFER_DIRTY;
+    cacheLock.unlock();
+}
+
+void kernel::block::putBuffer(buffer* b)
+{
+    cacheLock.lock();
+    release(b);
+    cacheLock.unlock();
+}
+
+int32_t kernel::block::readDevice(const blockDevice* device, uint64_t offset, void* destination,
+            size_t length)
+{
+    length = clampLength(device,offset,length);
+    uint8_t* to = static_cast<uint8_t*>(destination);
+    size_t done = 0;
+    while (done < length)
+    {
+        const uint64_t position = offset + done;
+        const size_t inBlock = static_cast<size_t>(position % BLOCK_SIZE);
+        const size_t chunk = BLOCK_SIZE - inBlock < length - done ? BLOCK_SIZE - inBlock : length - done;
+
+        buffer* b = getBuffer(device,position / BLOCK_SIZE);
+        if (b == nullptr)
+            return done != 0 ? static_cast<int32_t>(done) : -syscall::EIO;
+        memcpy(to + done,bufferData(b) + inBlock,chunk);
+        putBuffer(b);
+        done += chunk;
+    }
+    return static_cast<int32_t>(done);
+}
+
+int32_t kernel::block::writeDevice(const blockDevice* device, uint64_t offset, const void* source,
+            size_t length)
+{
+    if (device->write == nullptr)
+        return -syscall::EIO;
+    length = clampLength(device,offset,length);
+    const uint8_t* from = static_cast<const uint8_t*>(source);
+    size_t done = 0;
+    while (done < length)
+    {
+        const uint64_t position = offset + done;
+        const size_t inBlock = static_cast<size_t>(position % BLOCK_SIZE);
+        const size_t chunk = BLOCK_SIZE - inBlock < length - done ? BLOCK_SIZE - inBlock : length - done;
+
+        // Whole blocks don't need reading first
+        bool filling;
+        buffer* b = acquire(device,position / BLOCK_SIZE,chunk != BLOCK_SIZE,&filling);
+        if (b == nullptr)
+            return done != 0 ? static_cast<int32_t>(done) : -syscall::EIO;
+        memcpy(bufferData(b) + inBlock,from + done,chunk);
+        finishWrite(b,filling);
+        done += chunk;
+    }
+    return static_cast<int32_t>(done);
+}
+
+int32_t kernel::block::syncDevice(const blockDevice* device)
+{
+    int32_t result = 0;
+    cacheLock.lock();
+    for (buffer& b : buffers)
+    {
+        while (result == 0 && b.device == device && (b.state & BUFFER_DIRTY))
+        {
+            if (b.state & BUFFER_BUSY)
+            {
+                waitIdle(&b);
+                continue;
+            }
+
+            // Clean before the write, so a write that lands meanwhile makes
+            // it dirty again
+            reference(&b);
+            b.state = static_cast<uint8_t>((b.state & ~BUFFER_DIRTY) | BUFFER_BUSY);
+            cacheLock.unlock();
+            const bool written = blockIO(&b,true);
+            cacheLock.lock();
+
+            stats.writebacks++;
+            const uint8_t idle = static_cast<uint8_t>(b.state & ~BUFFER_BUSY);
+            finishIO(&b,written ? idle : idle | BUFFER_DIRTY);
+            release(&b);
+            if (!written)
+                result = -syscall::EIO;
+        }
+    }
+    cacheLock.unlock();
+
+    if (result == 0 && device->flush != nullptr && !device->flush())
+        result = -syscall::EIO;
+    return result;
+}
+
+cacheStats kernel::block::getCacheStats()
+{
+    cacheLock.lock();
+    const cacheStats copy = stats;
+    cacheLock.unlock();
+    return copy;
+}
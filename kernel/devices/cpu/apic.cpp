@@ -19,6 +19,13 @@
 
 using namespace kernel::cpu;
 
+static l_apic* enabledLAPIC = nullptr;
+
+l_apic* kernel::cpu::getLocalAPIC()
+{
+    return enabledLAPIC;
+}
+
 bool kernel::cpu::checkApic()
 {
     uint32_t a,b,c,d;
@@ -26,6 +33,13 @@ bool kernel::cpu::checkApic()
     return d & static_cast<uint32_t>(cpuid_features::CPUID_FEAT_EDX_APIC);
 }
 
+bool kernel::cpu::checkX2Apic()
+{
+    uint32_t a,b,c,d;
+    cpuid(1,&a,&b,&c,&d);
+    return c & static_cast<uint32_t>(cpuid_features::CPUID_FEAT_ECX_X2APIC);
+}
+
 /**========================================================================
  *                           CLASS l_apic
  *========================================================================**/
@@ -35,26 +49,110 @@ l_apic::l_apic()
     if (!checkApic())
         earlyPanic("In kernel::cpu::l_apic constructor: Error: No APIC present!");
     
-    // Get the base registers
-    uint32_t a,b,c,d;
-    cpuid(1,&a,&b,&c,&d);
-    _reg = reinterpret_cast<lapic_base_register*>(a);
+    // Get the base of the registers from the MSR
+    uint32_t low,high;
+    getMSR(IA32_APIC_BASE_MSR,&low,&high);
+    _base = reinterpret_cast<uint32_t volatile*>(low & 0xfffff000);
+
+    // Already in x2APIC mode if the firmware left it there
+    _x2apic = low & IA32_APIC_BASE_MSR_X2APIC;
 }
 
 void l_apic::enable()
 {
-    // Set enabled bit
-    setMSR(IA32_APIC_BASE_MSR,reinterpret_cast<uint32_t>(_reg) & 0xfffff000,0);
+    // Set the global enable bit
+    uint32_t low,high;
+    getMSR(IA32_APIC_BASE_MSR,&low,&high);
+    low |= IA32_APIC_BASE_MSR_ENABLE;
+    setMSR(IA32_APIC_BASE_MSR,low,high);
+
+    // Going from disabled straight to x2APIC is invalid, so it has to be done
+    // in two steps
+    if (checkX2Apic())
+    {
+        setMSR(IA32_APIC_BASE_MSR,low | IA32_APIC_BASE_MSR_X2APIC,high);
+        _x2apic = true;
+    }
+
+    // Set the Spurious Interrupt Vector register enable bit to start receiving
+    // interrupts, and set the spurious interrupt to 0xff
+    write(lapic_registers::SPURIOUS_INTERRUPT_VECTOR,
+            read(lapic_registers::SPURIOUS_INTERRUPT_VECTOR) | 0x100 | 0xff);
 
-    // Set the Spurious Interrupt Vector register enable bit to start receiving interrupts
-    uint32_t* lapicReg = reinterpret_cast<uint32_t*>(_reg->address << 12);
+    enabledLAPIC = this;
+}
 
-    auto regPtr = reinterpret_cast<spurious_interrupt_vector_register*>
-        (lapicReg + static_cast<uint32_t>(lapic_registers::SPURIOUS_INTERRUPT_VECTOR));
+void l_apic::waitICRIdle()
+{
+    // x2APIC has no delivery status bit, the write is all there is
+    if (_x2apic)
+        return;
 
-    regPtr->enable_flag = 1;
+    while (read(lapic_registers::INTERRUPT_COMMAND) & ICR_DELIVERY_PENDING)
+        __asm__ __volatile__ ("pause");
+}
 
-    regPtr->sp_vector = 0xff; // Set spurious interrupt to 0xff
+void l_apic::writeICR(uint32_t apicID, uint32_t command)
+{
+    if (_x2apic)
+    {
+        // A single wrmsr with the full 32-bit destination. x2APIC MSR writes
+        // aren't serializing, so make sure whatever the target is going to
+        // look at is visible before it gets the IPI
+        __asm__ __volatile__ ("mfence\n\tlfence" : : : "memory");
+        setMSR(X2APIC_MSR_BASE +
+                (static_cast<uint32_t>(lapic_registers::INTERRUPT_COMMAND) >> 4),
+                command,apicID);
+        return;
+    }
+
+    waitICRIdle();
+    // The write to the low dword is what sends the IPI, so high goes first
+    write(lapic_registers::INTERRUPT_COMMAND_HIGH,apicID << 24);
+    write(lapic_registers::INTERRUPT_COMMAND,command);
+}
+
+void l_apic::sendInitIPI(uint32_t apicID)
+{
+    writeICR(apicID,ICR_DELIVERY_INIT | ICR_LEVEL_ASSERT | ICR_TRIGGER_LEVEL);
+    waitICRIdle();
+    // De-assert, only needed by old (non-xAPIC) processors, and not
+    // supported at all in x2APIC mode
+    if (_x2apic)
+        return;
+    writeICR(apicID,ICR_DELIVERY_INIT | ICR_TRIGGER_LEVEL);
+    waitICRIdle();
+}
+
+void l_apic::sendStartupIPI(uint32_t apicID, uint8_t vector)
+{
+    writeICR(apicID,ICR_DELIVERY_STARTUP | vector);
+    waitICRIdle();
+}
+
+void l_apic::sendIPI(uint32_t apicID, uint8_t vector)
+{
+    writeICR(apicID,ICR_DELIVERY_FIXED | ICR_LEVEL_ASSERT | vector);
+}
+
+void l_apic::broadcastIPI(uint8_t vector, bool includeSelf)
+{
+    writeICR(0,(includeSelf ? ICR_DEST_ALL : ICR_DEST_ALL_BUT_SELF) |
+            ICR_DELIVERY_FIXED | ICR_LEVEL_ASSERT | vector);
+}
+
+void l_apic::startTimer(uint8_t vector, uint32_t initialCount, bool periodic)
+{
+    write(lapic_registers::DIVIDE_CONFIGURATION,TIMER_DIVIDE_BY_16);
+    write(lapic_registers::LVT_TIMER,vector | (periodic ? LVT_TIMER_PERIODIC : 0));
+    // Writing the initial count is what starts it
+    write(lapic_registers::INITIAL_COUNT,initialCount);
+}
+
+void l_apic::stopTimer()
+{
+    write(lapic_registers::LVT_TIMER,LVT_MASKED);
+    write(lapic_registers::INITIAL_COUNT,0);
 }
 
 /**========================================================================
@@ -70,6 +168,7 @@ void l_apic::enable()
         earlyPanic("In kernel::cpu::io_apic constructor: Error: Couldn't find a MADT type 1 entry!");
     
     _ptr = reinterpret_cast<kernel::acpi::madt_entry_type1*>(entry);
+    _madt = ptr;
 }
 
 uint32_t io_apic::read(ioapic_mm_register reg)
@@ -88,4 +187,37 @@ void io_apic::write(ioapic_mm_register reg, uint32_t value)
             (_ptr->io_apic_address);
     ioapicPtr[0] = (static_cast<uint32_t>(reg) & 0xff);
     ioapicPtr[4] = value;
-}
\ No newline at end of file
+}
+
+bool io_apic::routeIRQ(uint8_t irq, uint8_t vector, uint32_t apicID)
+{
+    // ISA interrupts are edge triggered and active high, on the GSI of their
+    // number, unless the MADT says otherwise
+    uint32_t gsi = irq;
+    uint32_t entry = vector;
+    for (size_t i = 0; i < _madt->getEntryCount(2); i++)
+    {
+        auto override = reinterpret_cast<kernel::acpi::madt_entry_type2*>(_madt->getEntry(2,i));
+        if (override->bus_source != 0 || override->irq_source != irq)
+            continue;
+        gsi = override->global_system_interrupt;
+        if ((override->flags & kernel::acpi::MADT_POLARITY_MASK) == kernel::acpi::MADT_POLARITY_ACTIVE_LOW)
+            entry |= IOREDTBL_ACTIVE_LOW;
+        if ((override->flags & kernel::acpi::MADT_TRIGGER_MASK) == kernel::acpi::MADT_TRIGGER_LEVEL)
+            entry |= IOREDTBL_TRIGGER_LEVEL;
+        break;
+    }
+
+    // Maximum redirection entry is in bits 16-23 of the version register
+    const uint32_t entries = ((read(ioapic_mm_register::IOAPICVER) >> 16) & 0xff) + 1;
+    if (gsi < _ptr->global_system_interrupt_base || gsi - _ptr->global_system_interrupt_base >= entries)
+        return false;
+    const uint32_t pin = gsi - _ptr->global_system_interrupt_base;
+
+    // Destination first, so it's never unmasked towards the wrong processor
+    const uint32_t reg = IOREDTBL_FIRST + 2 * pin;
+    write(static_cast<ioapic_mm_register>(reg),entry | IOREDTBL_MASKED);
+    write(static_cast<ioapic_mm_register>(reg + 1),apicID << IOREDTBL_DEST_SHIFT);
+    write(static_cast<ioapic_mm_register>(reg),entry);
+    return true;
+}
@@ -18,20 +18,3 @@ bool kernel::cpu::checkMSR()
     cpuid(1,&a,&b,&c,&d);
     return d & static_cast<uint32_t>(cpuid_features::CPUID_FEAT_EDX_MSR);
 }
-
-void kernel::cpu::getMSR(uint32_t msr, uint32_t *low, uint32_t *high)
-{
-    __asm__ volatile(
-        "rdmsr"
-        : "=a"(*low), "=d"(*high)
-        : "c"(msr)
-    );
-}
-
-void kernel::cpu::setMSR(uint32_t msr, uint32_t low, uint32_t high)
-{
-    __asm__ volatile(
-        "wrmsr"
-        : : "a"(low), "d"(high), "c"(msr)
-    );
-}
\ No newline at end of file
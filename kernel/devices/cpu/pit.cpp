@@ -0,0 +1,42 @@
+/**
+ * @file pit.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from pit.hpp
+ * @version 0.1
+ * @date 2025-03-02
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/devices/cpu/pit.hpp>
+#include <klib/cpuio.hpp>
+
+void kernel::cpu::pitBusyWait(uint32_t microseconds)
+{
+    using namespace kernel::cpu::io;
+
+    uint64_t ticks = static_cast<uint64_t>(microseconds) * PIT_FREQUENCY / 1000000;
+
+    // Gate on, speaker off
+    uint8_t gate = inb(PIT_CHANNEL2_GATE) & static_cast<uint8_t>(~PIT_SPEAKER_BIT);
+
+    // The counter is only 16 bits, so long waits go in chunks
+    while (ticks != 0)
+    {
+        uint16_t count = ticks > 0xffff ? 0xffff : static_cast<uint16_t>(ticks);
+        ticks -= count;
+
+        outb(PIT_COMMAND,PIT_CH2_ONESHOT);
+        outb(PIT_CHANNEL2_DATA,count & 0xff);
+        outb(PIT_CHANNEL2_DATA,static_cast<uint8_t>(count >> 8));
+
+        // Rising edge on the gate (re)starts the count
+        outb(PIT_CHANNEL2_GATE,gate & static_cast<uint8_t>(~PIT_GATE_BIT));
+        outb(PIT_CHANNEL2_GATE,gate | PIT_GATE_BIT);
+
+        // OUT2 goes high on terminal count
+        while (!(inb(PIT_CHANNEL2_GATE) & PIT_OUT2_BIT))
+            __asm__ __volatile__ ("pause");
+    }
+}
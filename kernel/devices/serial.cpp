@@ -0,0 +1,52 @@
+/**
+ * @file serial.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from kernelInternal/devices/serial.hpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/devices/serial.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <klib/io.hpp>
+
+static io::serial_port com1;
+static char ring[io::SERIAL_RING_SIZE];
+
+static void serialInterrupt(kernel::isr_frame_t*)
+{
+    com1.onInterrupt();
+}
+
+bool kernel::serial::init()
+{
+    if (!com1.init(io::COM1_PORT))
+        return false;
+    out.mirror(&com1);
+    return true;
+}
+
+bool kernel::serial::startInterrupts(cpu::io_apic* ioAPIC, uint32_t apicID)
+{
+    if (!com1.present())
+        return false;
+
+    // Handler before the IRQ can come in
+    if (!setInterruptHandler(SERIAL_VECTOR,serialInterrupt))
+        return false;
+    if (!ioAPIC->routeIRQ(io::COM1_IRQ,SERIAL_VECTOR,apicID))
+    {
+        setInterruptHandler(SERIAL_VECTOR,nullptr);
+        return false;
+    }
+    com1.startInterrupts(ring);
+    return true;
+}
+
+io::serial_port* kernel::serial::port()
+{
+    return com1.present() ? &com1 : nullptr;
+}
@@ -0,0 +1,226 @@
+/**
+ * @file dcache.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from dcache.hpp
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/fs/dcache.hpp>
+#include <kernelInternal/fs/dentryName.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <klib/string.h>
+
+using namespace kernel::vfs;
+
+static const size_t DCACHE_BUCKETS =        64;
+
+/**
+ * @brief A name in a directory. Holds a reference on both the directory and
+ * what the name is, so neither can be freed and come back as something
+ * else at the same address
+ * 
+ */
+struct dentry
+{
+    /* nullptr while the entry is free */
+    vnode*              directory;
+
+    /* nullptr for names that aren't there */
+    vnode*              node;
+
+    uint32_t            hash;
+    uint8_t             length;
+
+    /* Looked up since the clock hand last went by */
+    bool                referenced;
+
+    char                name[DENTRY_NAME_LENGTH];
+    dentry*             hashNext;
+};
+
+static kernel::sync::spinlock dcacheLock;
+static dentry entries[DCACHE_ENTRIES];
+static dentry* buckets[DCACHE_BUCKETS];
+static size_t clockHand = 0;
+
+/**
+ * @brief Whether a name can be cached: not too long, and folded the way the
+ * filesystem does if it ignores case
+ * 
+ */
+static bool cacheable(const vnode* directory, const char* name, size_t length)
+{
+    return length <= DENTRY_NAME_LENGTH &&
+            dentryNameCacheable(name,length,directory->fs->caseInsensitive);
+}
+
+/**
+ * @brief Hash of the name, and the directory's address mixed in
+ * 
+ */
+static uint32_t hashName(const vnode* directory, const char* name, size_t length)
+{
+    return hashDentryName(reinterpret_cast<uint32_t>(directory),name,length,
+            directory->fs->caseInsensitive);
+}
+
+/**
+ * @brief Cached entry for a name, in whatever case it was cached if the
+ * filesystem ignores case. Lock held
+ * 
+ */
+static dentry* find(const vnode* directory, const char* name, size_t length, uint32_t hash)
+{
+    const bool fold = directory->fs->caseInsensitive;
+    for (dentry* d = buckets[hash % DCACHE_BUCKETS]; d != nullptr; d = d->hashNext)
+    {
+        if (d->hash == hash && d->directory == directory && d->length == length &&
+                sameDentryName(d->name,name,length,fold))
+            return d;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Take an entry out of its bucket, and hand its references to the
+ * caller to drop once the lock is gone. Lock held
+ * 
+ */
+static void unlink(dentry* d, vnode** directory, vnode** node)
+{
+    dentry** link = buckets + d->hash % DCACHE_BUCKETS;
+    while (*link != d)
+        link = &(*link)->hashNext;
+    *link = d->hashNext;
+
+    *directory = d->directory;
+    *node = d->node;
+    d->directory = nullptr;
+    d->node = nullptr;
+    d->hashNext = nullptr;
+}
+
+/**
+ * @brief Free entry, or the first one the clock hand finds that wasn't
+ * looked up since it last went by, evicted. Lock held
+ * 
+ */
+static dentry* takeEntry(vnode** directory, vnode** node)
+{
+    *directory = nullptr;
+    *node = nullptr;
+
+    // Two rounds at most: the first clears every referenced bit
+    while (true)
+    {
+        dentry* d = entries + clockHand;
+        clockHand = (clockHand + 1) % DCACHE_ENTRIES;
+        if (d->directory == nullptr)
+            return d;
+        if (d->referenced)
+        {
+            d->referenced = false;
+            continue;
+        }
+        unlink(d,directory,node);
+        return d;
+    }
+}
+
+static void putBoth(vnode* directory, vnode* node)
+{
+    if (directory != nullptr)
+        putVnode(directory);
+    if (node != nullptr)
+        putVnode(node);
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+dentryResult kernel::vfs::dcacheLookup(vnode* directory, const char* name, size_t length,
+            vnode** result)
+{
+    if (!cacheable(directory,name,length))
+        return dentryResult::MISS;
+
+    const uint32_t hash = hashName(directory,name,length);
+    dentryResult found = dentryResult::MISS;
+    dcacheLock.lock();
+    dentry* d = find(directory,name,length,hash);
+    if (d != nullptr)
+    {
+        d->referenced = true;
+        if (d->node != nullptr)
+        {
+            getVnode(d->node);
+            *result = d->node;
+            found = dentryResult::FOUND;
+        }
+        else
+            found = dentryResult::NOT_FOUND;
+    }
+    dcacheLock.unlock();
+    return found;
+}
+
+void kernel::vfs::dcacheInsert(vnode* directory, const char* name, size_t length, vnode* node)
+{
+    if (!cacheable(directory,name,length))
+        return;
+
+    // Taken before the lock, dropping them might free something
+    getVnode(directory);
+    if (node != nullptr)
+        getVnode(node);
+
+    const uint32_t hash = hashName(directory,name,length);
+    vnode* oldDirectory;
+    vnode* oldNode;
+    dcacheLock.lock();
+    dentry* d = find(directory,name,length,hash);
+    if (d != nullptr)
+    {
+        // Already has its reference on the directory
+        oldDirectory = directory;
+        oldNode = d->node;
+        d->node = node;
+    }
+    else
+    {
+        d = takeEntry(&oldDirectory,&oldNode);
+        d->directory = directory;
+        d->node = node;
+        d->hash = hash;
+        d->length = static_cast<uint8_t>(length);
+        memcpy(d->name,name,length);
+        d->hashNext = buckets[hash % DCACHE_BUCKETS];
+        buckets[hash % DCACHE_BUCKETS] = d;
+    }
+    d->referenced = true;
+    dcacheLock.unlock();
+
+    putBoth(oldDirectory,oldNode);
+}
+
+void kernel::vfs::dcacheInvalidate(vnode* directory, const char* name, size_t length)
+{
+    if (!cacheable(directory,name,length))
+        return;
+
+    const uint32_t hash = hashName(directory,name,length);
+    vnode* oldDirectory = nullptr;
+    vnode* oldNode = nullptr;
+    dcacheLock.lock();
+    dentry* d = find(directory,name,length,hash);
+    if (d != nullptr)
+        unlink(d,&oldDirectory,&oldNode);
+    dcacheLock.unlock();
+
+    putBoth(oldDirectory,oldNode);
+}
@@ -0,0 +1,740 @@
+/**
+ * @file fat32Backend.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from fat32Backend.hpp
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/fs/fat32Backend.hpp>
+#include <kernelInternal/mm/frames.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/system/log.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <fs/fat32.hpp>
+#include <klib/string.h>
+#include <sys/dirent.h>
+
+using namespace kernel::vfs;
+using namespace kernel::syscall;
+using kernel::mm::PAGE_SIZE;
+
+static const size_t SECTOR_SIZE =           512;
+
+// Threads checkFAT32() splits the FAT between, at most
+static const size_t MAX_CHECK_WORKERS =     8;
+
+static const uint8_t ATTRIBUTE_SUBDIRECTORY =
+        static_cast<uint8_t>(fs::fat32_dirEntry_attributes::SUBDIRECTORY);
+
+/**
+ * @brief Clusters of a file that follow each other on the disk
+ * 
+ */
+struct fatExtent
+{
+    /* Cluster of the file it starts at, counting from 0 */
+    uint32_t            fileCluster;
+
+    /* Where that is on the disk */
+    uint32_t            diskCluster;
+
+    uint32_t            count;
+};
+
+/**
+ * @brief Where a file's clusters are, made from its chain the first time
+ * it's read, so pages never have to follow the chain from the start
+ * 
+ */
+struct fatExtentMap
+{
+    size_t              count;
+    fatExtent*          extents;
+};
+
+/**
+ * @brief vnode::data: the directory entry, which says where the data is.
+ * Everything in it is under the volume's lock
+ * 
+ */
+struct fatNode
+{
+    fs::fat32_dirEntry  entry;
+
+    /* Where the entry is, to write it back. Not for the root directory */
+    fs::fat32_entryLocation location;
+    bool                hasLocation;
+
+    /* Its entry is gone, and its clusters go with the vnode */
+    bool                unlinked;
+
+    /* nullptr until the first read, and after the chain changes */
+    fatExtentMap*       map;
+};
+
+/**
+ * @brief filesystem::data. The library isn't thread safe, and the FAT, the
+ * free cluster map and the extent maps all change on writes, so one lock
+ * covers all of it. It's held over disk transfers, which don't sleep
+ * 
+ */
+struct fatVolume
+{
+    kernel::sync::spinlock lock;
+    fs::fat32*          fat;
+};
+
+static int32_t fatLookup(vnode* directory, const char* name, size_t length, vnode** result);
+static int32_t fatCreate(vnode* directory, const char* name, size_t length, vnodeType type,
+            vnode** result);
+static int32_t fatUnlink(vnode* directory, const char* name, size_t length, vnode* node);
+static int32_t fatReaddir(vnode* directory, uint32_t* cursor, void* buffer, size_t size);
+static int32_t fatReadpage(vnode* node, uint32_t index, uint32_t frame);
+static int32_t fatWritepage(vnode* node, uint32_t index, uint32_t frame);
+static int32_t fatSetSize(vnode* node, uint32_t size);
+static void fatRelease(vnode* node);
+
+static const vnodeOps fatOps = {&fatLookup,&fatCreate,&fatUnlink,&fatReaddir,&fatReadpage,
+        &fatWritepage,&fatSetSize,&fatRelease};
+
+// Volumes there's no way to write to
+static const vnodeOps fatReadOnlyOps = {&fatLookup,nullptr,nullptr,&fatReaddir,&fatReadpage,
+        nullptr,nullptr,&fatRelease};
+
+static inline fatVolume* volumeOf(const vnode* node)
+{
+    return static_cast<fatVolume*>(node->fs->data);
+}
+
+/**
+ * @brief Inode number of a directory entry: where it is on the disk, so the
+ * same entry always gets the same one. The root directory, which has no
+ * entry, is 0
+ * 
+ */
+static uint32_t entryID(const fs::fat32* volume, const fs::fat32_entryLocation* location)
+{
+    const uint32_t perCluster = static_cast<uint32_t>(volume->clusterSize() / sizeof(fs::fat32_dirEntry));
+    return (location->cluster - 2) * perCluster + location->index + 1;
+}
+
+/**
+ * @brief A vnode for a directory entry, not in the inode cache yet
+ * 
+ */
+static vnode* makeNode(filesystem* volume, uint32_t id, const fs::fat32_dirEntry* entry,
+            const fs::fat32_entryLocation* location)
+{
+    const bool directory = entry->attributes & ATTRIBUTE_SUBDIRECTORY;
+    const vnodeOps* ops = static_cast<fatVolume*>(volume->data)->fat->writable() ? &fatOps :
+            &fatReadOnlyOps;
+    vnode* node = allocateVnode(volume,id,directory ? vnodeType::DIRECTORY : vnodeType::FILE,ops);
+    fatNode* data = new fatNode;
+    if (node == nullptr || data == nullptr)
+    {
+        delete node;
+        delete data;
+        return nullptr;
+    }
+    data->entry = *entry;
+    data->hasLocation = location != nullptr;
+    if (location != nullptr)
+        data->location = *location;
+    data->unlinked = false;
+    data->map = nullptr;
+    node->data = data;
+    node->size = directory ? 0 : entry->size;
+    return node;
+}
+
+/**
+ * @brief Follow a file's chain as far as its size goes, and count the runs
+ * of clusters in it, filling them in if there's somewhere to. A chain that
+ * ends early, or loops, only gets as far as it goes
+ * 
+ */
+static size_t walkChain(const fs::fat32* volume, const fatNode* file, fatExtent* extents)
+{
+    const size_t clusterBytes = volume->clusterSize();
+    const uint32_t clusters = static_cast<uint32_t>((file->entry.size + clusterBytes - 1) / clusterBytes);
+
+    size_t runs = 0;
+    uint32_t previous = 0;
+    uint32_t cluster = fs::fat32::firstCluster(&file->entry);
+    for (uint32_t i = 0; i < clusters && !fs::fat32::isChainEnd(cluster); i++)
+    {
+        if (i == 0 || cluster != previous + 1)
+        {
+            if (extents != nullptr)
+                extents[runs] = {i,cluster,0};
+            runs++;
+        }
+        if (extents != nullptr)
+            extents[runs - 1].count++;
+        previous = cluster;
+        cluster = volume->nextCluster(cluster);
+    }
+    return runs;
+}
+
+static fatExtentMap* buildMap(const fs::fat32* volume, const fatNode* file)
+{
+    fatExtentMap* map = new fatExtentMap;
+    if (map == nullptr)
+        return nullptr;
+    map->count = walkChain(volume,file,nullptr);
+    map->extents = new fatExtent[map->count != 0 ? map->count : 1];
+    if (map->extents == nullptr)
+    {
+        delete map;
+        return nullptr;
+    }
+    walkChain(volume,file,map->extents);
+    return map;
+}
+
+/**
+ * @brief The extent map of a file, made if it isn't there yet. Volume lock
+ * held
+ * 
+ */
+static const fatExtentMap* mapOf(const fs::fat32* volume, fatNode* file)
+{
+    if (file->map == nullptr)
+        file->map = buildMap(volume,file);
+    return file->map;
+}
+
+/**
+ * @brief Throw the extent map away, after the chain changed. Volume lock
+ * held
+ * 
+ */
+static void dropMap(fatNode* file)
+{
+    if (file->map != nullptr)
+    {
+        delete[] file->map->extents;
+        delete file->map;
+        file->map = nullptr;
+    }
+}
+
+/**
+ * @brief Clusters in a map, and the last one of them, 0 if there are none
+ * 
+ */
+static uint32_t mappedClusters(const fatExtentMap* map, uint32_t* last)
+{
+    if (map->count == 0)
+    {
+        *last = 0;
+        return 0;
+    }
+    const fatExtent* e = map->extents + map->count - 1;
+    *last = e->diskCluster + e->count - 1;
+    return e->fileCluster + e->count;
+}
+
+/**
+ * @brief Extent a cluster of a file is in, nullptr past the end of the
+ * chain
+ * 
+ */
+static const fatExtent* findExtent(const fatExtentMap* map, uint32_t fileCluster)
+{
+    size_t low = 0;
+    size_t high = map->count;
+    while (low < high)
+    {
+        const size_t middle = (low + high) / 2;
+        const fatExtent* e = map->extents + middle;
+        if (fileCluster < e->fileCluster)
+            high = middle;
+        else if (fileCluster >= e->fileCluster + e->count)
+            low = middle + 1;
+        else
+            return e;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Read or write the part of a page the file has on the disk, a run of
+ * sectors at a time. Volume lock held
+ * 
+ * @param page The page, in the kernel's window
+ * @return int32_t 0, -EIO or -ENOMEM
+ */
+static int32_t transfer(fs::fat32* volume, fatNode* file, uint32_t index, uint8_t* page,
+            bool write)
+{
+    const uint64_t offset = static_cast<uint64_t>(index) * PAGE_SIZE;
+    const size_t valid = offset >= file->entry.size ? 0 :
+            file->entry.size - offset < PAGE_SIZE ? static_cast<size_t>(file->entry.size - offset) :
+            PAGE_SIZE;
+    if (valid == 0)
+        return 0;
+
+    const fatExtentMap* map = mapOf(volume,file);
+    if (map == nullptr)
+        return -ENOMEM;
+    const size_t sectorsPerCluster = volume->sectorsPerCluster();
+    const size_t sectors = (valid + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    size_t done = 0;
+    while (done < sectors)
+    {
+        const uint64_t sector = offset / SECTOR_SIZE + done;
+        const uint32_t cluster = static_cast<uint32_t>(sector / sectorsPerCluster);
+        const size_t within = static_cast<size_t>(sector % sectorsPerCluster);
+        const fatExtent* e = findExtent(map,cluster);
+        if (e == nullptr)
+            return -EIO;
+
+        size_t run = (e->fileCluster + e->count - cluster) * sectorsPerCluster - within;
+        if (run > sectors - done)
+            run = sectors - done;
+        const uint64_t LBA = volume->clusterLBA(e->diskCluster + (cluster - e->fileCluster)) + within;
+        if (!(write ? volume->writeSectors(LBA,page + done * SECTOR_SIZE,run) :
+                volume->readSectors(LBA,page + done * SECTOR_SIZE,run)))
+            return -EIO;
+        done += run;
+    }
+    return 0;
+}
+
+/**========================================================================
+ *                           Operations
+ *========================================================================**/
+
+static int32_t fatLookup(vnode* directory, const char* name, size_t length, vnode** result)
+{
+    fatVolume* volume = volumeOf(directory);
+    const fatNode* d = static_cast<const fatNode*>(directory->data);
+
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    volume->lock.lock();
+    const int found = volume->fat->lookup(fs::fat32::firstCluster(&d->entry),name,length,&entry,
+            &location);
+    volume->lock.unlock();
+    switch (found)
+    {
+    case 0:
+        break;
+    case 1:
+        return -ENOENT;
+    default:
+        return -EIO;
+    }
+
+    vnode* node = makeNode(directory->fs,entryID(volume->fat,&location),&entry,&location);
+    if (node == nullptr)
+        return -ENOMEM;
+    *result = internVnode(node);
+    return 0;
+}
+
+static int32_t fatCreate(vnode* directory, const char* name, size_t length, vnodeType type,
+            vnode** result)
+{
+    fatVolume* volume = volumeOf(directory);
+    const fatNode* d = static_cast<const fatNode*>(directory->data);
+    const uint32_t cluster = fs::fat32::firstCluster(&d->entry);
+
+    // Metadata goes out right away, only file data waits for writeback
+    fs::fat32_dirEntry entry;
+    fs::fat32_entryLocation location;
+    volume->lock.lock();
+    fs::fat32_createResult created = type == vnodeType::DIRECTORY ?
+            volume->fat->createDirectory(cluster,name,length,&entry,&location) :
+            volume->fat->createEntry(cluster,name,length,
+                    static_cast<uint8_t>(fs::fat32_dirEntry_attributes::ARCHIVE),0,&entry,&location);
+    if (!volume->fat->flush() && created == fs::fat32_createResult::SUCCESS)
+        created = fs::fat32_createResult::DISK_ERROR;
+    volume->lock.unlock();
+
+    switch (created)
+    {
+    case fs::fat32_createResult::SUCCESS:
+        break;
+    case fs::fat32_createResult::EXISTS:
+        return -EEXIST;
+    case fs::fat32_createResult::BAD_NAME:
+        return -EINVAL;
+    case fs::fat32_createResult::NO_SPACE:
+        return -ENOSPC;
+    case fs::fat32_createResult::DISK_ERROR:
+    default:
+        return -EIO;
+    }
+
+    vnode* node = makeNode(directory->fs,entryID(volume->fat,&location),&entry,&location);
+    if (node == nullptr)
+        return -ENOMEM;
+    *result = internVnode(node);
+    return 0;
+}
+
+static int32_t fatUnlink(vnode* directory, const char* /*name*/, size_t /*length*/, vnode* node)
+{
+    fatVolume* volume = volumeOf(directory);
+    fatNode* file = static_cast<fatNode*>(node->data);
+
+    // The clusters stay until the vnode goes, for whoever has it open
+    volume->lock.lock();
+    int32_t error = 0;
+    if (file->unlinked || !file->hasLocation)
+        error = -ENOENT;
+    else if (!volume->fat->removeEntry(&file->location))
+        error = -EIO;
+    else
+        file->unlinked = true;
+    volume->lock.unlock();
+    return error;
+}
+
+static int32_t fatReaddir(vnode* directory, uint32_t* cursor, void* buffer, size_t size)
+{
+    fatVolume* volume = volumeOf(directory);
+    const fatNode* d = static_cast<const fatNode*>(directory->data);
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+
+    // The library's records are bigger than dirents, so they're turned into
+    // them in place, each over the ones already done. If all there was were
+    // "." and "..", it goes for more
+    size_t filled = 0;
+    int listed;
+    volume->lock.lock();
+    do
+    {
+        listed = volume->fat->readDirectory(fs::fat32::firstCluster(&d->entry),cursor,out,size);
+        for (size_t at = 0; listed > 0 && at < static_cast<size_t>(listed); )
+        {
+            const fs::fat32_dirRecord record = *reinterpret_cast<const fs::fat32_dirRecord*>(out + at);
+            const char* name = reinterpret_cast<const char*>(out + at + sizeof(record));
+            at += record.length;
+            // Names that long can't be in a path anyway
+            if ((name[0] == '.' && (record.nameLength == 1 || (record.nameLength == 2 &&
+                    name[1] == '.'))) || record.nameLength > DIRENT_NAME_MAX)
+                continue;
+
+            const fs::fat32_entryLocation location = {record.entryCluster,record.entryIndex,0,0};
+            filled += putDirent(out + filled,size - filled,entryID(volume->fat,&location),
+                    record.next,record.attributes & ATTRIBUTE_SUBDIRECTORY ? vnodeType::DIRECTORY :
+                    vnodeType::FILE,name,record.nameLength);
+        }
+    } while (listed > 0 && filled == 0);
+    volume->lock.unlock();
+
+    if (listed == -2)
+        return -EIO;
+    if (listed == -1 && filled == 0)
+        return -EINVAL;
+    return static_cast<int32_t>(filled);
+}
+
+static int32_t fatReadpage(vnode* node, uint32_t index, uint32_t frame)
+{
+    fatVolume* volume = volumeOf(node);
+    uint8_t* page = static_cast<uint8_t*>(kernel::mm::frameAddress(frame));
+
+    // Past what's on the disk it's zeroes, even before the file's end: it
+    // was made longer, and nothing was written there yet
+    volume->lock.lock();
+    fatNode* file = static_cast<fatNode*>(node->data);
+    const uint64_t offset = static_cast<uint64_t>(index) * PAGE_SIZE;
+    const size_t valid = offset >= file->entry.size ? 0 :
+            file->entry.size - offset < PAGE_SIZE ? static_cast<size_t>(file->entry.size - offset) :
+            PAGE_SIZE;
+    const int32_t error = transfer(volume->fat,file,index,page,false);
+    volume->lock.unlock();
+
+    if (error == 0)
+        memset(page + valid,0,PAGE_SIZE - valid);
+    return error;
+}
+
+static int32_t fatWritepage(vnode* node, uint32_t index, uint32_t frame)
+{
+    fatVolume* volume = volumeOf(node);
+    volume->lock.lock();
+    const int32_t error = transfer(volume->fat,static_cast<fatNode*>(node->data),index,
+            static_cast<uint8_t*>(kernel::mm::frameAddress(frame)),true);
+    volume->lock.unlock();
+    return error;
+}
+
+/**
+ * @brief Delayed allocation: writes only go to the page cache, and clusters
+ * are only found here, on writeback, for everything written since the last
+ * one at once, so they come out in one run when there's one
+ * 
+ */
+static int32_t fatSetSize(vnode* node, uint32_t size)
+{
+    fatVolume* volume = volumeOf(node);
+    fs::fat32* fat = volume->fat;
+    fatNode* file = static_cast<fatNode*>(node->data);
+    const size_t clusterBytes = fat->clusterSize();
+    const uint32_t needed = static_cast<uint32_t>((size + clusterBytes - 1) / clusterBytes);
+
+    volume->lock.lock();
+    if (file->entry.size == size)
+    {
+        volume->lock.unlock();
+        return 0;
+    }
+    const fatExtentMap* map = mapOf(fat,file);
+    if (map == nullptr)
+    {
+        volume->lock.unlock();
+        return -ENOMEM;
+    }
+
+    int32_t error = 0;
+    uint32_t last;
+    const uint32_t have = mappedClusters(map,&last);
+    if (needed == 0 && have != 0)
+    {
+        fat->freeChain(fs::fat32::firstCluster(&file->entry));
+        fs::fat32::setFirstCluster(&file->entry,0);
+    }
+    else if (needed != 0 && needed <= have)
+    {
+        const fatExtent* e = findExtent(map,needed - 1);
+        fat->truncateChain(e->diskCluster + (needed - 1 - e->fileCluster));
+    }
+    else if (needed > have)
+    {
+        // Whatever the chain had past its size isn't worth keeping
+        if (last != 0)
+            fat->truncateChain(last);
+        else if (fs::fat32::firstCluster(&file->entry) != 0)
+            fat->freeChain(fs::fat32::firstCluster(&file->entry));
+        const uint32_t added = fat->allocateClusters(last,needed - have);
+        if (added == 0)
+            error = -ENOSPC;
+        if (last == 0)
+            fs::fat32::setFirstCluster(&file->entry,added);
+    }
+
+    if (error == 0)
+    {
+        file->entry.size = size;
+        if (!file->unlinked && file->hasLocation && !fat->writeEntry(&file->location,&file->entry))
+            error = -EIO;
+    }
+    if (!fat->flush() && error == 0)
+        error = -EIO;
+    dropMap(file);
+    volume->lock.unlock();
+    return error;
+}
+
+static void fatRelease(vnode* node)
+{
+    fatVolume* volume = volumeOf(node);
+    fatNode* file = static_cast<fatNode*>(node->data);
+    volume->lock.lock();
+    if (file->unlinked)
+    {
+        fs::fat32* fat = volume->fat;
+        if (fs::fat32::firstCluster(&file->entry) != 0)
+            fat->freeChain(fs::fat32::firstCluster(&file->entry));
+        fat->flush();
+    }
+    dropMap(file);
+    volume->lock.unlock();
+    delete file;
+}
+
+/**========================================================================
+ *                           Checking
+ *========================================================================**/
+
+/**
+ * @brief A phase of checkFAT32(), which every worker runs on its own range
+ * 
+ */
+struct checkJob
+{
+    kernel::sched::thread* waiter;
+    volatile uint32_t   finished;
+    uint32_t            workers;
+    const fs::fat32*    fat;
+    const fs::fat32_check* check;
+
+    /* Looking for lost clusters, instead of going over the FAT */
+    bool                lost;
+};
+
+struct checkWorker
+{
+    checkJob*           job;
+    uint32_t            first;
+    uint32_t            end;
+    void*               scratch;
+    fs::fat32_checkResult result;
+};
+
+static void checkRange(checkWorker* worker)
+{
+    const checkJob* job = worker->job;
+    if (job->lost)
+        job->fat->checkLost(job->check,worker->first,worker->end,&worker->result);
+    else
+        job->fat->checkFAT(job->check,worker->first,worker->end,worker->scratch,&worker->result);
+}
+
+static void checkThread(void* arg)
+{
+    checkWorker* worker = static_cast<checkWorker*>(arg);
+    checkJob* job = worker->job;
+    checkRange(worker);
+
+    // The job is on checkFAT32()'s stack, and can be gone as soon as the
+    // last worker is counted
+    kernel::sched::thread* waiter = job->waiter;
+    const uint32_t workers = job->workers;
+    if (__atomic_add_fetch(&job->finished,1,__ATOMIC_ACQ_REL) == workers)
+        kernel::sched::wake(waiter);
+}
+
+/**
+ * @brief Run a phase on every worker, and wait for all of them. Workers
+ * whose thread can't be made run here instead
+ * 
+ */
+static void runCheckJob(checkJob* job, checkWorker* workers, const int* cpus, bool lost)
+{
+    job->finished = 0;
+    job->lost = lost;
+    for (uint32_t i = 0; i < job->workers; i++)
+    {
+        if (kernel::sched::createThread(&checkThread,workers + i,kernel::sched::PRIORITY_NORMAL,
+                "fat32Check",cpus[i]) == nullptr)
+            checkThread(workers + i);
+    }
+    while (__atomic_load_n(&job->finished,__ATOMIC_ACQUIRE) != job->workers)
+        kernel::sched::block();
+}
+
+bool kernel::vfs::checkFAT32(filesystem* volume)
+{
+    fs::fat32* fat = static_cast<fatVolume*>(volume->data)->fat;
+    fs::fat32_check check;
+    if (!fat->checkBegin(&check))
+    {
+        LOG_ERROR << "fat32: out of memory to check the volume";
+        return false;
+    }
+    const uint64_t start = kernel::clock::readTSC();
+
+    // A worker per processor, each on its own slice of the FAT. Slices
+    // start on a sector of it, so no two read the same one from the disk
+    int cpus[MAX_CHECK_WORKERS];
+    uint32_t count = 0;
+    for (smp::cpuMask online = smp::onlineMask(); online != 0 && count < MAX_CHECK_WORKERS;
+            online &= online - 1)
+        cpus[count++] = __builtin_ctz(online);
+    if (count == 0)
+        cpus[count++] = kernel::sched::ANY_CPU;
+
+    checkWorker workers[MAX_CHECK_WORKERS];
+    checkJob job = {kernel::sched::currentThread(),0,count,fat,&check,false};
+    uint32_t slice = (check.clusterEnd + count - 1) / count;
+    slice = (slice + FAT32_CHECK_ALIGN - 1) & ~(FAT32_CHECK_ALIGN - 1u);
+    bool checked = true;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t first = i * slice < check.clusterEnd ? i * slice : check.clusterEnd;
+        const uint32_t end = first + slice < check.clusterEnd ? first + slice : check.clusterEnd;
+        workers[i] = {&job,first,end,new uint8_t[FAT32_CHECK_SCRATCH_SECTORS * SECTOR_SIZE],{}};
+        checked = checked && workers[i].scratch != nullptr;
+    }
+
+    fs::fat32_checkResult result = {};
+    if (checked)
+    {
+        runCheckJob(&job,workers,cpus,false);
+
+        // The tree is walked here, one directory at a time: it's all reads
+        // from the one disk, which threads wouldn't make any faster
+        checked = fat->checkTree(&check,&result);
+    }
+    for (uint32_t i = 0; i < count; i++)
+        delete[] static_cast<uint8_t*>(workers[i].scratch);
+    if (checked)
+        runCheckJob(&job,workers,cpus,true);
+    fs::fat32::checkEnd(&check);
+    if (!checked)
+    {
+        LOG_ERROR << "fat32: out of memory to check the volume";
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+        fs::fat32::addResults(&result,&workers[i].result);
+    const uint64_t microseconds = kernel::clock::cyclesToNanoseconds(kernel::clock::readTSC() - start) / 1000;
+    LOG_INFO << "fat32: " << result.files << " files, " << result.directories << " directories, "
+        << result.usedClusters << " clusters in use, checked in " << microseconds << " us on "
+        << count << " processors";
+
+    const uint32_t problems = result.lostChains + result.crossLinks + result.sizeMismatches +
+            result.badLinks + result.mirrorMismatches + result.diskErrors;
+    if (problems != 0)
+    {
+        LOG_WARNING << "fat32: " << result.lostChains << " lost chains (" << result.lostClusters
+            << " clusters), " << result.crossLinks << " cross-links, " << result.sizeMismatches
+            << " size mismatches, " << result.badLinks << " bad links";
+        LOG_WARNING << "fat32: " << result.mirrorMismatches << " FAT sectors differing from the copy, "
+            << result.diskErrors << " disk errors";
+    }
+    return problems == 0;
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+filesystem* kernel::vfs::openFAT32(int (*diskRead)(uint64_t LBA, void* buffer, size_t sectors),
+            int (*diskWrite)(uint64_t LBA, const void* buffer, size_t sectors), uint32_t partitionLBA)
+{
+    fatVolume* volume = new fatVolume();
+    fs::fat32* fat = diskWrite != nullptr ? new fs::fat32(diskRead,diskWrite) :
+            new fs::fat32(diskRead);
+    filesystem* mounted = new filesystem;
+    if (volume == nullptr || fat == nullptr || mounted == nullptr || fat->init(partitionLBA) != 0)
+    {
+        delete volume;
+        delete fat;
+        delete mounted;
+        return nullptr;
+    }
+    volume->fat = fat;
+    *mounted = {"fat32",nullptr,volume,true};
+
+    // The root directory has no entry of its own, so it gets a made up one
+    fs::fat32_dirEntry root = {};
+    root.attributes = ATTRIBUTE_SUBDIRECTORY;
+    fs::fat32::setFirstCluster(&root,fat->rootCluster());
+
+    vnode* node = makeNode(mounted,0,&root,nullptr);
+    if (node == nullptr)
+    {
+        delete mounted;
+        delete fat;
+        delete volume;
+        return nullptr;
+    }
+    mounted->root = internVnode(node);
+    return mounted;
+}
@@ -0,0 +1,857 @@
+/**
+ * @file pageCache.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from pageCache.hpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/fs/pageCache.hpp>
+#include <kernelInternal/mm/frames.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <kernelInternal/system/percpu.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <klib/cstdlib.hpp>
+#include <klib/string.h>
+
+using namespace kernel::vfs;
+using namespace kernel::syscall;
+using kernel::mm::PAGE_SIZE;
+using kernel::mm::PAGE_MASK;
+
+/* Pages the reclaimer gives back, and looks at, with one hold of a lock */
+static const size_t RECLAIM_BATCH =         32;
+static const size_t RECLAIM_SCAN =          256;
+
+/* Pages writeback takes out of a file with one hold of its lock */
+static const size_t WRITEBACK_BATCH =       16;
+
+// Vnodes with pages that can be reclaimed, in a ring, and where the hand is
+static kernel::sync::spinlock clockLock;
+static vnode* clockHand = nullptr;
+static uint32_t clockIndex = 0;
+static size_t clockNodes = 0;
+
+// Woken by the frame allocator, once, until it's been round
+static kernel::sched::thread* reclaimer = nullptr;
+static bool reclaimPending = false;
+static size_t highWater = 0;
+
+// Files with dirty pages, or a size the filesystem hasn't been told of yet
+static kernel::sync::spinlock dirtyLock;
+static vnode* dirtyNodes = nullptr;
+static uint32_t dirtyPages = 0;
+
+// Woken when there are WRITEBACK_PAGES dirty pages
+static kernel::sched::thread* writer = nullptr;
+static bool writebackPending = false;
+
+static uint32_t reclaimedPages = 0;
+static uint32_t writtenPages = 0;
+static DEFINE_PER_CPU(uint32_t, pageHits) = 0;
+static DEFINE_PER_CPU(uint32_t, pageMisses) = 0;
+static DEFINE_PER_CPU(uint32_t, readaheadPages) = 0;
+
+/**========================================================================
+ *                           Cache
+ *========================================================================**/
+
+/**
+ * @brief Cached frame of a page, with a reference, marked as used. pagesLock
+ * held
+ * 
+ */
+static uint32_t lookup(vnode* node, uint32_t index)
+{
+    if (index >= node->pageSlots || node->pages[index] == 0)
+        return 0;
+    node->pages[index] |= PAGE_REFERENCED;
+    const uint32_t frame = node->pages[index] & PAGE_MASK;
+    kernel::mm::getFrame(frame);
+    return frame;
+}
+
+static bool isCached(vnode* node, uint32_t index)
+{
+    node->pagesLock.lock();
+    const bool cached = index < node->pageSlots && node->pages[index] != 0;
+    node->pagesLock.unlock();
+    return cached;
+}
+
+/**
+ * @brief Make sure there's a slot for a page. Nothing that can take long
+ * with the lock held, so a bigger array is made without it, then swapped in
+ * 
+ * @return false Out of memory
+ */
+static bool reserveSlot(vnode* node, uint32_t index)
+{
+    node->pagesLock.lock();
+    const uint32_t slots = node->pageSlots;
+    node->pagesLock.unlock();
+    if (index < slots)
+        return true;
+
+    uint32_t newSlots = slots < 4 ? 4 : slots * 2;
+    if (newSlots <= index)
+        newSlots = index + 1;
+    uint32_t* pages = new uint32_t[newSlots];
+    if (pages == nullptr)
+        return false;
+    memset(pages,0,newSlots * sizeof(uint32_t));
+
+    node->pagesLock.lock();
+    if (node->pageSlots < newSlots)
+    {
+        if (node->pageSlots != 0)
+            memcpy(pages,node->pages,node->pageSlots * sizeof(uint32_t));
+        uint32_t* old = node->pages;
+        node->pages = pages;
+        node->pageSlots = newSlots;
+        pages = old;
+    }
+    node->pagesLock.unlock();
+    delete[] pages;
+    return true;
+}
+
+/**
+ * @brief Put a vnode in the clock's ring, just behind the hand, so it's the
+ * last to be looked at
+ * 
+ */
+static void joinClock(vnode* node)
+{
+    clockLock.lock();
+    if (node->clockNext == nullptr)
+    {
+        if (clockHand == nullptr)
+        {
+            node->clockNext = node;
+            node->clockPrev = node;
+            clockHand = node;
+            clockIndex = 0;
+        }
+        else
+        {
+            node->clockNext = clockHand;
+            node->clockPrev = clockHand->clockPrev;
+            clockHand->clockPrev->clockNext = node;
+            clockHand->clockPrev = node;
+        }
+        clockNodes++;
+    }
+    clockLock.unlock();
+}
+
+static void leaveClock(vnode* node)
+{
+    clockLock.lock();
+    if (node->clockNext != nullptr)
+    {
+        if (node->clockNext == node)
+            clockHand = nullptr;
+        else
+        {
+            node->clockPrev->clockNext = node->clockNext;
+            node->clockNext->clockPrev = node->clockPrev;
+            if (clockHand == node)
+            {
+                clockHand = node->clockNext;
+                clockIndex = 0;
+            }
+        }
+        node->clockNext = nullptr;
+        node->clockPrev = nullptr;
+        clockNodes--;
+    }
+    clockLock.unlock();
+}
+
+/**
+ * @brief Have a file written back, holding a reference on it until it is
+ * 
+ */
+static void queueWriteback(vnode* node)
+{
+    dirtyLock.lock();
+    if (!node->dirty)
+    {
+        node->dirty = true;
+        getVnode(node);
+        node->dirtyNext = dirtyNodes;
+        dirtyNodes = node;
+    }
+    dirtyLock.unlock();
+}
+
+static void wakeWriteback()
+{
+    if (!__atomic_exchange_n(&writebackPending,true,__ATOMIC_ACQ_REL))
+        kernel::sched::wake(writer);
+}
+
+/**
+ * @brief Count a page that just became dirty, if there's somewhere to write
+ * it back to. pagesLock not held
+ * 
+ */
+static void pageDirtied(vnode* node)
+{
+    if (node->ops->writepage == nullptr)
+        return;
+    queueWriteback(node);
+    if (__atomic_add_fetch(&dirtyPages,1,__ATOMIC_RELAXED) >= WRITEBACK_PAGES)
+        wakeWriteback();
+}
+
+/**
+ * @brief Take back the count of dirty pages that went without being
+ * written back, or were
+ * 
+ */
+static void pagesCleaned(vnode* node, uint32_t count)
+{
+    if (node->ops->writepage != nullptr && count != 0)
+        __atomic_sub_fetch(&dirtyPages,count,__ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Put a filled in frame in the cache, unless someone beat us to the
+ * page
+ * 
+ * @param frame Its reference goes to the cache, or back
+ * @param flags PAGE_*
+ * @return uint32_t Whatever is cached for the page now, with a reference
+ * for the caller. 0 if out of memory
+ */
+static uint32_t insert(vnode* node, uint32_t index, uint32_t frame, uint32_t flags)
+{
+    if (!reserveSlot(node,index))
+    {
+        kernel::mm::putFrame(frame);
+        return 0;
+    }
+
+    node->pagesLock.lock();
+    uint32_t cached = lookup(node,index);
+    if (cached == 0)
+    {
+        node->pages[index] = frame | flags;
+        node->cachedPages++;
+        kernel::mm::getFrame(frame);
+        cached = frame;
+        frame = 0;
+    }
+    node->pagesLock.unlock();
+
+    if (frame != 0)
+        kernel::mm::putFrame(frame);
+    else if (!(flags & PAGE_DIRTY))
+        joinClock(node);
+    else
+        pageDirtied(node);
+    return cached;
+}
+
+/**
+ * @brief A frame for the cache, taking some back from it if there are none
+ * 
+ */
+static uint32_t allocateCacheFrame()
+{
+    uint32_t frame = kernel::mm::allocateFrame();
+    if (frame == 0 && reclaimPages(RECLAIM_BATCH) != 0)
+        frame = kernel::mm::allocateFrame();
+    return frame;
+}
+
+/**
+ * @brief Bring in a page that isn't cached, and read ahead the ones after it
+ * 
+ */
+static uint32_t fill(vnode* node, uint32_t index, int32_t* error)
+{
+    if (node->ops->readpage == nullptr)
+    {
+        // Never written, so zeroes, which are the only copy from now on
+        const uint32_t frame = allocateCacheFrame();
+        if (frame == 0)
+        {
+            *error = -ENOMEM;
+            return 0;
+        }
+        memset(kernel::mm::frameAddress(frame),0,PAGE_SIZE);
+        const uint32_t cached = insert(node,index,frame,PAGE_DIRTY | PAGE_REFERENCED);
+        if (cached == 0)
+            *error = -ENOMEM;
+        return cached;
+    }
+
+    const uint64_t pagesInFile = (static_cast<uint64_t>(node->size) + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (index >= pagesInFile)
+    {
+        *error = -EINVAL;
+        return 0;
+    }
+
+    uint32_t frames[READAHEAD_PAGES];
+    size_t count = 0;
+    while (count < READAHEAD_PAGES && index + count < pagesInFile &&
+            (count == 0 || !isCached(node,static_cast<uint32_t>(index + count))))
+    {
+        frames[count] = allocateCacheFrame();
+        if (frames[count] == 0)
+            break;
+        count++;
+    }
+    if (count == 0)
+    {
+        *error = -ENOMEM;
+        return 0;
+    }
+
+    size_t filled = 0;
+    int32_t result = 0;
+    while (filled < count &&
+            (result = node->ops->readpage(node,static_cast<uint32_t>(index + filled),frames[filled])) == 0)
+        filled++;
+
+    // Pages read ahead aren't marked used, so they go first if nobody wants
+    // them
+    uint32_t frame = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i >= filled)
+        {
+            kernel::mm::putFrame(frames[i]);
+            continue;
+        }
+        const uint32_t cached = insert(node,static_cast<uint32_t>(index + i),frames[i],
+                i == 0 ? PAGE_REFERENCED : 0);
+        if (i == 0)
+            frame = cached;
+        else if (cached != 0)
+            kernel::mm::putFrame(cached);
+    }
+
+    if (filled == 0)
+    {
+        *error = result;
+        return 0;
+    }
+    kernel::smp::thisCPUInc(pageMisses);
+    kernel::smp::thisCPUAdd(readaheadPages,static_cast<uint32_t>(filled - 1));
+    if (frame == 0)
+        *error = -ENOMEM;
+    return frame;
+}
+
+/**========================================================================
+ *                           Pager
+ *========================================================================**/
+
+static uint32_t pagerFind(void* owner, size_t index)
+{
+    return findPage(static_cast<vnode*>(owner),static_cast<uint32_t>(index));
+}
+
+static uint32_t pagerLoad(void* owner, size_t index)
+{
+    int32_t error;
+    return getPage(static_cast<vnode*>(owner),static_cast<uint32_t>(index),&error);
+}
+
+static void pagerRelease(void* owner)
+{
+    putVnode(static_cast<vnode*>(owner));
+}
+
+static const kernel::mm::pager cachePager = {&pagerFind,&pagerLoad,&pagerRelease};
+
+/**========================================================================
+ *                           Reclaim
+ *========================================================================**/
+
+/**
+ * @brief Take a reference on a vnode, unless its last one is gone already
+ * and it's on its way out
+ * 
+ */
+static bool tryGetVnode(vnode* node)
+{
+    uint32_t references = __atomic_load_n(&node->references,__ATOMIC_RELAXED);
+    while (references != 0)
+    {
+        if (__atomic_compare_exchange_n(&node->references,&references,references + 1,true,
+                __ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief From the frame allocator, which is running low
+ * 
+ */
+static void lowMemory()
+{
+    if (!__atomic_exchange_n(&reclaimPending,true,__ATOMIC_ACQ_REL))
+        kernel::sched::wake(reclaimer);
+}
+
+static void reclaimThread(void*)
+{
+    while (true)
+    {
+        kernel::sched::block();
+        __atomic_store_n(&reclaimPending,false,__ATOMIC_RELEASE);
+        size_t free = kernel::mm::freeFrames();
+        if (free >= highWater)
+            continue;
+
+        // Not enough clean pages: make some
+        if (reclaimPages(highWater - free) < highWater - free)
+        {
+            writebackAll();
+            free = kernel::mm::freeFrames();
+            if (free < highWater)
+                reclaimPages(highWater - free);
+        }
+    }
+}
+
+/**========================================================================
+ *                           Writeback
+ *========================================================================**/
+
+static void writebackThread(void*)
+{
+    while (true)
+    {
+        kernel::sched::block();
+        __atomic_store_n(&writebackPending,false,__ATOMIC_RELEASE);
+        writebackAll();
+    }
+}
+
+/**
+ * @brief Whether any page of a file is still dirty
+ * 
+ */
+static bool hasDirtyPages(vnode* node)
+{
+    bool dirty = false;
+    node->pagesLock.lock();
+    for (uint32_t i = 0; i < node->pageSlots && !dirty; i++)
+        dirty = node->pages[i] & PAGE_DIRTY;
+    node->pagesLock.unlock();
+    return dirty;
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+uint32_t kernel::vfs::findPage(vnode* node, uint32_t index)
+{
+    node->pagesLock.lock();
+    const uint32_t frame = lookup(node,index);
+    node->pagesLock.unlock();
+    if (frame != 0)
+        smp::thisCPUInc(pageHits);
+    return frame;
+}
+
+uint32_t kernel::vfs::getPage(vnode* node, uint32_t index, int32_t* error)
+{
+    const uint32_t frame = findPage(node,index);
+    if (frame != 0)
+        return frame;
+    return fill(node,index,error);
+}
+
+int32_t kernel::vfs::readPages(vnode* node, uint64_t offset, void* buffer, size_t length)
+{
+    uint8_t* destination = static_cast<uint8_t*>(buffer);
+    size_t done = 0;
+    while (done < length)
+    {
+        const uint64_t position = offset + done;
+        const uint32_t size = node->size;
+        if (position >= size)
+            break;
+        const size_t within = static_cast<size_t>(position % PAGE_SIZE);
+        size_t chunk = PAGE_SIZE - within;
+        if (chunk > length - done)
+            chunk = length - done;
+        if (chunk > size - position)
+            chunk = static_cast<size_t>(size - position);
+
+        int32_t error;
+        const uint32_t frame = getPage(node,static_cast<uint32_t>(position / PAGE_SIZE),&error);
+        if (frame == 0)
+            return done != 0 ? static_cast<int32_t>(done) : error;
+
+        // The copy can fault on the buffer, so the frame is held instead of
+        // the lock
+        memcpy(destination + done,static_cast<const uint8_t*>(mm::frameAddress(frame)) + within,
+                chunk);
+        mm::putFrame(frame);
+        done += chunk;
+    }
+    return static_cast<int32_t>(done);
+}
+
+int32_t kernel::vfs::writePages(vnode* node, uint64_t offset, const void* buffer, size_t length)
+{
+    if (offset >= UINT32_MAX)
+        return -EFBIG;
+    if (length > UINT32_MAX - offset)
+        length = static_cast<size_t>(UINT32_MAX - offset);
+
+    const uint8_t* source = static_cast<const uint8_t*>(buffer);
+    size_t done = 0;
+    int32_t error = 0;
+    while (done < length)
+    {
+        const uint64_t position = offset + done;
+        const uint32_t index = static_cast<uint32_t>(position / PAGE_SIZE);
+        const size_t within = static_cast<size_t>(position % PAGE_SIZE);
+        size_t chunk = PAGE_SIZE - within;
+        if (chunk > length - done)
+            chunk = length - done;
+
+        uint32_t frame = findPage(node,index);
+        if (frame == 0)
+        {
+            // What the page had only matters if some of it is kept
+            const uint32_t size = node->size;
+            const bool overwritten = within == 0 && (chunk == PAGE_SIZE || position + chunk >= size);
+            if (node->ops->readpage != nullptr && !overwritten &&
+                    static_cast<uint64_t>(index) * PAGE_SIZE < size)
+                frame = getPage(node,index,&error);
+            else if ((frame = allocateCacheFrame()) != 0)
+            {
+                memset(mm::frameAddress(frame),0,PAGE_SIZE);
+                frame = insert(node,index,frame,PAGE_DIRTY | PAGE_REFERENCED);
+            }
+            if (frame == 0)
+            {
+                if (error == 0)
+                    error = -ENOMEM;
+                break;
+            }
+        }
+
+        memcpy(static_cast<uint8_t*>(mm::frameAddress(frame)) + within,source + done,chunk);
+        done += chunk;
+
+        // Held, so it can't have been reclaimed, but it might have been
+        // truncated away
+        node->pagesLock.lock();
+        uint32_t& slot = node->pages[index];
+        const bool dirtied = (slot & PAGE_MASK) == frame && !(slot & PAGE_DIRTY);
+        if ((slot & PAGE_MASK) == frame)
+            slot |= PAGE_DIRTY;
+        if (position + chunk > node->size)
+            node->size = static_cast<uint32_t>(position + chunk);
+        node->pagesLock.unlock();
+        mm::putFrame(frame);
+        if (dirtied)
+            pageDirtied(node);
+    }
+
+    if (done == 0 && length != 0)
+        return error;
+    return static_cast<int32_t>(done);
+}
+
+void kernel::vfs::truncatePages(vnode* node, uint32_t size)
+{
+    const uint32_t keep = static_cast<uint32_t>((static_cast<uint64_t>(size) + PAGE_SIZE - 1) /
+            PAGE_SIZE);
+    node->pagesLock.lock();
+    node->size = size;
+    node->pagesLock.unlock();
+
+    // A batch at a time, so the lock isn't held for long
+    uint32_t index = keep;
+    while (true)
+    {
+        uint32_t frames[RECLAIM_BATCH];
+        size_t count = 0;
+        uint32_t dirty = 0;
+        node->pagesLock.lock();
+        for (; index < node->pageSlots && count < RECLAIM_BATCH; index++)
+        {
+            uint32_t& slot = node->pages[index];
+            if (slot == 0)
+                continue;
+            if (slot & PAGE_DIRTY)
+                dirty++;
+            frames[count++] = slot & PAGE_MASK;
+            slot = 0;
+            node->cachedPages--;
+        }
+        node->pagesLock.unlock();
+
+        for (size_t i = 0; i < count; i++)
+            mm::putFrame(frames[i]);
+        pagesCleaned(node,dirty);
+        if (count < RECLAIM_BATCH)
+            break;
+    }
+
+    // Whatever was past the end of the last page isn't there anymore
+    const size_t within = size % PAGE_SIZE;
+    if (within != 0)
+    {
+        node->pagesLock.lock();
+        const uint32_t frame = lookup(node,keep - 1);
+        node->pagesLock.unlock();
+        if (frame != 0)
+        {
+            memset(static_cast<uint8_t*>(mm::frameAddress(frame)) + within,0,PAGE_SIZE - within);
+            node->pagesLock.lock();
+            uint32_t& slot = node->pages[keep - 1];
+            const bool dirtied = (slot & PAGE_MASK) == frame && !(slot & PAGE_DIRTY);
+            if (dirtied)
+                slot |= PAGE_DIRTY;
+            node->pagesLock.unlock();
+            mm::putFrame(frame);
+            if (dirtied)
+                pageDirtied(node);
+        }
+    }
+
+    // The filesystem hears about the size on writeback
+    if (node->ops->writepage != nullptr)
+        queueWriteback(node);
+}
+
+int32_t kernel::vfs::writebackPages(vnode* node)
+{
+    if (node->ops->writepage == nullptr)
+        return 0;
+
+    // One at a time, so sizes and pages get there in order
+    while (__atomic_exchange_n(&node->writingBack,true,__ATOMIC_ACQUIRE))
+        sched::yield();
+
+    const uint32_t size = node->size;
+    int32_t error = node->ops->setSize != nullptr ? node->ops->setSize(node,size) : 0;
+    const uint32_t pages = static_cast<uint32_t>((static_cast<uint64_t>(size) + PAGE_SIZE - 1) /
+            PAGE_SIZE);
+
+    uint32_t index = 0;
+    while (error == 0 && index < pages)
+    {
+        uint32_t frames[WRITEBACK_BATCH];
+        uint32_t indexes[WRITEBACK_BATCH];
+        size_t count = 0;
+        node->pagesLock.lock();
+        for (; index < pages && index < node->pageSlots && count < WRITEBACK_BATCH; index++)
+        {
+            uint32_t& slot = node->pages[index];
+            if (!(slot & PAGE_DIRTY))
+                continue;
+            // Written past the size the filesystem was just told, so it
+            // waits for the next time
+            if (static_cast<uint64_t>(index + 1) * PAGE_SIZE > size && node->size > size)
+                continue;
+            // Cleaned first, so a write from now on dirties it again
+            slot &= ~PAGE_DIRTY;
+            frames[count] = slot & PAGE_MASK;
+            indexes[count++] = index;
+            mm::getFrame(slot & PAGE_MASK);
+        }
+        if (index >= node->pageSlots)
+            index = pages;
+        node->pagesLock.unlock();
+
+        uint32_t written = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const int32_t result = error == 0 ? node->ops->writepage(node,indexes[i],frames[i]) :
+                    error;
+            if (result == 0)
+                written++;
+            else
+            {
+                error = result;
+                node->pagesLock.lock();
+                uint32_t& slot = node->pages[indexes[i]];
+                if ((slot & PAGE_MASK) == frames[i])
+                    slot |= PAGE_DIRTY;
+                node->pagesLock.unlock();
+            }
+            mm::putFrame(frames[i]);
+        }
+        if (written != 0)
+        {
+            pagesCleaned(node,written);
+            __atomic_add_fetch(&writtenPages,written,__ATOMIC_RELAXED);
+            joinClock(node);
+        }
+    }
+
+    __atomic_store_n(&node->writingBack,false,__ATOMIC_RELEASE);
+    return error;
+}
+
+void kernel::vfs::writebackAll()
+{
+    dirtyLock.lock();
+    vnode* list = dirtyNodes;
+    dirtyNodes = nullptr;
+    for (vnode* node = list; node != nullptr; node = node->dirtyNext)
+        node->dirty = false;
+    dirtyLock.unlock();
+
+    while (list != nullptr)
+    {
+        vnode* node = list;
+        list = node->dirtyNext;
+        // Whatever didn't make it goes round again
+        if (writebackPages(node) != 0 || hasDirtyPages(node))
+            queueWriteback(node);
+        putVnode(node);
+    }
+}
+
+kernel::mm::memoryObject* kernel::vfs::cacheObject(vnode* node)
+{
+    const size_t pages = static_cast<size_t>((static_cast<uint64_t>(node->size) + PAGE_SIZE - 1) /
+            PAGE_SIZE);
+    mm::memoryObject* object = mm::memoryObject::createPaged(pages,&cachePager,node);
+    if (object != nullptr)
+        getVnode(node);
+    return object;
+}
+
+void kernel::vfs::dropPages(vnode* node)
+{
+    leaveClock(node);
+    uint32_t dirty = 0;
+    for (uint32_t i = 0; i < node->pageSlots; i++)
+    {
+        if (node->pages[i] & PAGE_DIRTY)
+            dirty++;
+        if (node->pages[i] != 0)
+            mm::putFrame(node->pages[i] & PAGE_MASK);
+    }
+    pagesCleaned(node,dirty);
+    delete[] node->pages;
+    node->pages = nullptr;
+    node->pageSlots = 0;
+    node->cachedPages = 0;
+}
+
+size_t kernel::vfs::reclaimPages(size_t target)
+{
+    // Twice round at most: once to clear what's marked used, once to take it
+    clockLock.lock();
+    const size_t laps = 2 * clockNodes + 1;
+    clockLock.unlock();
+
+    size_t freed = 0;
+    size_t finished = 0;
+    while (freed < target && finished < laps)
+    {
+        clockLock.lock();
+        vnode* node = clockHand;
+        if (node == nullptr)
+        {
+            clockLock.unlock();
+            break;
+        }
+        if (!tryGetVnode(node))
+        {
+            // It's leaving the ring anyway
+            clockHand = node->clockNext;
+            clockIndex = 0;
+            clockLock.unlock();
+            finished++;
+            continue;
+        }
+        uint32_t index = clockIndex;
+        clockLock.unlock();
+
+        uint32_t frames[RECLAIM_BATCH];
+        size_t count = 0;
+        node->pagesLock.lock();
+        for (size_t scanned = 0; index < node->pageSlots && scanned < RECLAIM_SCAN &&
+                count < RECLAIM_BATCH && freed + count < target; index++, scanned++)
+        {
+            uint32_t& slot = node->pages[index];
+            if (slot == 0 || (slot & PAGE_DIRTY))
+                continue;
+            if (slot & PAGE_REFERENCED)
+            {
+                slot &= ~PAGE_REFERENCED;
+                continue;
+            }
+            // Mapped somewhere, or someone is copying out of it
+            const uint32_t frame = slot & PAGE_MASK;
+            if (mm::frameReferences(frame) != 1)
+                continue;
+            slot = 0;
+            node->cachedPages--;
+            frames[count++] = frame;
+        }
+        const bool done = index >= node->pageSlots;
+        node->pagesLock.unlock();
+
+        // Unless someone else moved it meanwhile
+        clockLock.lock();
+        if (clockHand == node)
+        {
+            clockHand = done ? node->clockNext : node;
+            clockIndex = done ? 0 : index;
+        }
+        clockLock.unlock();
+        if (done)
+            finished++;
+
+        for (size_t i = 0; i < count; i++)
+            mm::putFrame(frames[i]);
+        freed += count;
+        putVnode(node);
+    }
+
+    __atomic_add_fetch(&reclaimedPages,static_cast<uint32_t>(freed),__ATOMIC_RELAXED);
+    return freed;
+}
+
+pageCacheStats kernel::vfs::getPageCacheStats()
+{
+    pageCacheStats stats = {0,0,0,__atomic_load_n(&reclaimedPages,__ATOMIC_RELAXED),
+            __atomic_load_n(&writtenPages,__ATOMIC_RELAXED),
+            __atomic_load_n(&dirtyPages,__ATOMIC_RELAXED)};
+    for (size_t i = 0; i < smp::cpuCount(); i++)
+    {
+        stats.hits += *smp::perCPUPointer(pageHits,i);
+        stats.misses += *smp::perCPUPointer(pageMisses,i);
+        stats.readahead += *smp::perCPUPointer(readaheadPages,i);
+    }
+    return stats;
+}
+
+void kernel::vfs::initPageCache()
+{
+    const size_t lowWater = mm::totalFrames() / RECLAIM_LOW_DIVISOR;
+    highWater = 2 * lowWater;
+
+    reclaimer = sched::createThread(&reclaimThread,nullptr,sched::PRIORITY_HIGH,"reclaim");
+    writer = sched::createThread(&writebackThread,nullptr,sched::PRIORITY_NORMAL,"writeback");
+    if (reclaimer == nullptr || writer == nullptr)
+        earlyPanic("vfs: couldn't start the reclaim and writeback threads");
+    mm::setLowMemoryHandler(lowWater,&lowMemory);
+}
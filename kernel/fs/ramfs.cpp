@@ -0,0 +1,253 @@
+/**
+ * @file ramfs.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from ramfs.hpp
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/fs/ramfs.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <klib/string.h>
+
+using namespace kernel::vfs;
+using namespace kernel::syscall;
+
+/**
+ * @brief A name in a directory. Holds the reference that keeps what it
+ * names around
+ * 
+ */
+struct ramEntry
+{
+    vnode*              node;
+    size_t              length;
+    char*               name;
+    ramEntry*           next;
+
+    /* Its readdir() cursor. Every entry after it in the list has a lower
+       one, so a listing carries on where it was, whatever came and went */
+    uint32_t            cookie;
+};
+
+/**
+ * @brief vnode::data of every ramfs vnode. A vnode lives as long as its
+ * name, or whoever has it open after that. File contents are all in the page
+ * cache, which never lets them go
+ * 
+ */
+struct ramNode
+{
+    kernel::sync::spinlock lock;
+
+    /* Names in it, for directories, newest first */
+    ramEntry*           entries;
+
+    /* Cookie of the newest of them */
+    uint32_t            lastCookie;
+};
+
+/**
+ * @brief filesystem::data
+ * 
+ */
+struct ramVolume
+{
+    uint32_t            nextID;
+};
+
+static int32_t ramLookup(vnode* directory, const char* name, size_t length, vnode** result);
+static int32_t ramCreate(vnode* directory, const char* name, size_t length, vnodeType type,
+            vnode** result);
+static int32_t ramUnlink(vnode* directory, const char* name, size_t length, vnode* node);
+static int32_t ramReaddir(vnode* directory, uint32_t* cursor, void* buffer, size_t size);
+static void ramRelease(vnode* node);
+
+static const vnodeOps ramOps = {&ramLookup,&ramCreate,&ramUnlink,&ramReaddir,nullptr,nullptr,
+        nullptr,&ramRelease};
+
+/**
+ * @brief A vnode and its ramNode, both empty
+ * 
+ */
+static vnode* makeNode(filesystem* fs, vnodeType type)
+{
+    ramVolume* volume = static_cast<ramVolume*>(fs->data);
+    vnode* node = allocateVnode(fs,__atomic_add_fetch(&volume->nextID,1,__ATOMIC_RELAXED),type,&ramOps);
+    if (node == nullptr)
+        return nullptr;
+    node->data = new ramNode();
+    if (node->data == nullptr)
+    {
+        delete node;
+        return nullptr;
+    }
+    return node;
+}
+
+/**
+ * @brief Find a name. Directory lock held
+ * 
+ */
+static ramEntry* find(const ramNode* directory, const char* name, size_t length)
+{
+    for (ramEntry* e = directory->entries; e != nullptr; e = e->next)
+    {
+        if (e->length == length && memcmp(e->name,name,length) == 0)
+            return e;
+    }
+    return nullptr;
+}
+
+/**========================================================================
+ *                           Operations
+ *========================================================================**/
+
+static int32_t ramLookup(vnode* directory, const char* name, size_t length, vnode** result)
+{
+    ramNode* d = static_cast<ramNode*>(directory->data);
+    d->lock.lock();
+    const ramEntry* e = find(d,name,length);
+    if (e != nullptr)
+    {
+        getVnode(e->node);
+        *result = e->node;
+    }
+    d->lock.unlock();
+    return e != nullptr ? 0 : -ENOENT;
+}
+
+static int32_t ramCreate(vnode* directory, const char* name, size_t length, vnodeType type,
+            vnode** result)
+{
+    vnode* node = makeNode(directory->fs,type);
+    ramEntry* entry = new ramEntry;
+    char* copy = new char[length];
+    if (node == nullptr || entry == nullptr || copy == nullptr)
+    {
+        if (node != nullptr)
+            putVnode(node);
+        delete entry;
+        delete[] copy;
+        return -ENOMEM;
+    }
+    memcpy(copy,name,length);
+    *entry = {node,length,copy,nullptr,0};
+
+    ramNode* d = static_cast<ramNode*>(directory->data);
+    d->lock.lock();
+    const bool exists = find(d,name,length) != nullptr;
+    if (!exists)
+    {
+        // The entry keeps the first reference, the caller gets another
+        getVnode(node);
+        entry->cookie = ++d->lastCookie;
+        entry->next = d->entries;
+        d->entries = entry;
+    }
+    d->lock.unlock();
+
+    if (exists)
+    {
+        putVnode(node);
+        delete[] copy;
+        delete entry;
+        return -EEXIST;
+    }
+    *result = node;
+    return 0;
+}
+
+static int32_t ramUnlink(vnode* directory, const char* name, size_t length, vnode* node)
+{
+    ramNode* d = static_cast<ramNode*>(directory->data);
+    d->lock.lock();
+    ramEntry** link = &d->entries;
+    while (*link != nullptr && !((*link)->length == length && memcmp((*link)->name,name,length) == 0))
+        link = &(*link)->next;
+    // Gone already, or something else has the name now
+    ramEntry* e = *link;
+    if (e != nullptr && e->node == node)
+        *link = e->next;
+    else
+        e = nullptr;
+    d->lock.unlock();
+
+    if (e == nullptr)
+        return -ENOENT;
+    putVnode(e->node);
+    delete[] e->name;
+    delete e;
+    return 0;
+}
+
+static int32_t ramReaddir(vnode* directory, uint32_t* cursor, void* buffer, size_t size)
+{
+    ramNode* d = static_cast<ramNode*>(directory->data);
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    size_t filled = 0;
+    d->lock.lock();
+    const ramEntry* e = d->entries;
+    // 0 is the start, the newest entry, and cookies start at 1
+    while (e != nullptr && *cursor != 0 && e->cookie >= *cursor)
+        e = e->next;
+    for (; e != nullptr; e = e->next)
+    {
+        const size_t record = putDirent(out + filled,size - filled,e->node->id,e->cookie,
+                e->node->type,e->name,e->length);
+        if (record == 0)
+            break;
+        filled += record;
+        *cursor = e->cookie;
+    }
+    d->lock.unlock();
+
+    if (filled == 0 && e != nullptr)
+        return -EINVAL;
+    return static_cast<int32_t>(filled);
+}
+
+static void ramRelease(vnode* node)
+{
+    ramNode* r = static_cast<ramNode*>(node->data);
+    while (r->entries != nullptr)
+    {
+        ramEntry* e = r->entries;
+        r->entries = e->next;
+        putVnode(e->node);
+        delete[] e->name;
+        delete e;
+    }
+    delete r;
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+filesystem* kernel::vfs::createRamfs()
+{
+    filesystem* fs = new filesystem;
+    ramVolume* volume = new ramVolume;
+    if (fs == nullptr || volume == nullptr)
+    {
+        delete fs;
+        delete volume;
+        return nullptr;
+    }
+    volume->nextID = 0;
+    *fs = {"ramfs",nullptr,volume,false};
+
+    fs->root = makeNode(fs,vnodeType::DIRECTORY);
+    if (fs->root == nullptr)
+    {
+        delete volume;
+        delete fs;
+        return nullptr;
+    }
+    return fs;
+}
@@ -0,0 +1,794 @@
+/**
+ * @file vfs.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from vfs.hpp
+ * @version 0.1
+ * @date 2025-03-24
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/fs/vfs.hpp>
+#include <kernelInternal/fs/dcache.hpp>
+#include <kernelInternal/fs/pageCache.hpp>
+#include <kernelInternal/fs/ramfs.hpp>
+#include <kernelInternal/proc/process.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <kernelInternal/system/percpu.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <klib/cstdlib.hpp>
+#include <klib/string.h>
+#include <sys/fcntl.h>
+#include <sys/mman.h>
+#include <sys/dirent.h>
+
+using namespace kernel::vfs;
+using namespace kernel::syscall;
+using kernel::mm::PAGE_SIZE;
+using kernel::mm::PAGE_MASK;
+
+static const size_t ICACHE_BUCKETS =        64;
+
+// Directory records are made here, on the stack, then copied out, so no
+// filesystem touches user memory with its locks held
+static const size_t DIRECTORY_CHUNK =       1024;
+
+/**
+ * @brief A filesystem on a directory of another one
+ * 
+ */
+struct mountPoint
+{
+    /* With a reference. nullptr for the root filesystem, and free slots */
+    vnode*              covered;
+    filesystem*         fs;
+};
+
+// Inode cache, by filesystem and inode number
+static kernel::sync::spinlock icacheLock;
+static vnode* icache[ICACHE_BUCKETS];
+
+static kernel::sync::spinlock mountLock;
+static mountPoint mounts[MAX_MOUNTS];
+static vnode* rootNode = nullptr;
+
+static DEFINE_PER_CPU(uint32_t, dentryHits) = 0;
+static DEFINE_PER_CPU(uint32_t, dentryNegativeHits) = 0;
+static DEFINE_PER_CPU(uint32_t, dentryMisses) = 0;
+
+/**========================================================================
+ *                           Inode cache
+ *========================================================================**/
+
+static inline size_t icacheBucket(const filesystem* fs, uint32_t id)
+{
+    return (reinterpret_cast<uint32_t>(fs) / sizeof(filesystem) ^ id * 2654435761u) % ICACHE_BUCKETS;
+}
+
+/**
+ * @brief Free a vnode nobody has a reference on anymore
+ * 
+ */
+static void release(vnode* node)
+{
+    dropPages(node);
+    if (node->ops->release != nullptr)
+        node->ops->release(node);
+    delete node;
+}
+
+/**
+ * @brief Take a vnode out of the inode cache early, because its inode
+ * number can be handed out again (unlinked FAT32 entries)
+ * 
+ */
+static void forgetVnode(const vnode* node)
+{
+    icacheLock.lock();
+    vnode** link = icache + icacheBucket(node->fs,node->id);
+    while (*link != nullptr && *link != node)
+        link = &(*link)->hashNext;
+    if (*link == node)
+        *link = node->hashNext;
+    icacheLock.unlock();
+}
+
+/**========================================================================
+ *                           Walking
+ *========================================================================**/
+
+/**
+ * @brief Whatever is mounted on a vnode, and on that, instead of it
+ * 
+ */
+static vnode* crossMounts(vnode* node)
+{
+    while (node->covered)
+    {
+        vnode* root = nullptr;
+        mountLock.lock();
+        for (const mountPoint& m : mounts)
+        {
+            if (m.covered == node)
+            {
+                root = m.fs->root;
+                getVnode(root);
+                break;
+            }
+        }
+        mountLock.unlock();
+        if (root == nullptr)
+            break;
+        putVnode(node);
+        node = root;
+    }
+    return node;
+}
+
+/**
+ * @brief One component, from the dentry cache if it's there, from the
+ * filesystem, and into the cache, if not
+ * 
+ */
+static int32_t lookupComponent(vnode* directory, const char* name, size_t length, vnode** result)
+{
+    switch (dcacheLookup(directory,name,length,result))
+    {
+    case dentryResult::FOUND:
+        kernel::smp::thisCPUInc(dentryHits);
+        return 0;
+    case dentryResult::NOT_FOUND:
+        kernel::smp::thisCPUInc(dentryNegativeHits);
+        return -ENOENT;
+    case dentryResult::MISS:
+    default:
+        break;
+    }
+
+    kernel::smp::thisCPUInc(dentryMisses);
+    if (directory->ops->lookup == nullptr)
+        return -ENOENT;
+    const int32_t error = directory->ops->lookup(directory,name,length,result);
+    if (error == 0)
+        dcacheInsert(directory,name,length,*result);
+    else if (error == -ENOENT)
+        dcacheInsert(directory,name,length,nullptr);
+    return error;
+}
+
+/**
+ * @brief Where the last component of a path starts, and how long it is,
+ * without trailing slashes
+ * 
+ */
+static void lastComponent(const char* path, size_t* start, size_t* length)
+{
+    size_t end = strlen(path);
+    while (end != 0 && path[end - 1] == '/')
+        end--;
+    size_t first = end;
+    while (first != 0 && path[first - 1] != '/')
+        first--;
+    *start = first;
+    *length = end - first;
+}
+
+/**
+ * @brief Walk the first length characters of a path
+ * 
+ */
+static int32_t walkPath(const char* path, size_t length, vnode** result)
+{
+    mountLock.lock();
+    vnode* current = rootNode;
+    if (current != nullptr)
+        getVnode(current);
+    mountLock.unlock();
+    if (current == nullptr)
+        return -ENOENT;
+
+    // Where ".." goes back to
+    vnode* parents[MAX_WALK_DEPTH];
+    size_t depth = 0;
+    int32_t error = 0;
+
+    size_t i = 0;
+    while (error == 0)
+    {
+        while (i < length && path[i] == '/')
+            i++;
+        if (i == length)
+            break;
+        const char* name = path + i;
+        while (i < length && path[i] != '/')
+            i++;
+        const size_t nameLength = static_cast<size_t>(path + i - name);
+
+        if (nameLength == 1 && name[0] == '.')
+            continue;
+        if (nameLength == 2 && name[0] == '.' && name[1] == '.')
+        {
+            // The root is its own parent
+            if (depth != 0)
+            {
+                putVnode(current);
+                current = parents[--depth];
+            }
+            continue;
+        }
+
+        if (current->type != vnodeType::DIRECTORY)
+            error = -ENOTDIR;
+        else if (nameLength > MAX_NAME_LENGTH || depth == MAX_WALK_DEPTH)
+            error = -ENAMETOOLONG;
+        else
+        {
+            vnode* next;
+            error = lookupComponent(current,name,nameLength,&next);
+            if (error == 0)
+            {
+                parents[depth++] = current;
+                current = crossMounts(next);
+            }
+        }
+    }
+
+    while (depth != 0)
+        putVnode(parents[--depth]);
+    if (error != 0)
+    {
+        putVnode(current);
+        return error;
+    }
+    *result = current;
+    return 0;
+}
+
+/**========================================================================
+ *                           System calls
+ *========================================================================**/
+
+/**
+ * @brief Copy a path in from user memory, and terminate it
+ * 
+ * @return int32_t 0, or a negative error
+ */
+static int32_t copyPath(char* path, uint32_t address, size_t length)
+{
+    if (length == 0)
+        return -ENOENT;
+    if (length > MAX_PATH_LENGTH)
+        return -ENAMETOOLONG;
+    if (!copyFromUser(path,address,length))
+        return -EFAULT;
+    path[length] = '\0';
+    // Anything after a terminator isn't part of it
+    return strlen(path) == 0 ? -ENOENT : 0;
+}
+
+static int32_t sysOpen(const uint32_t* args)
+{
+    const uint32_t flags = args[2];
+    const uint32_t access = flags & O_ACCMODE;
+    if ((flags & ~(O_ACCMODE | O_CREAT | O_EXCL | O_TRUNC | O_APPEND)) != 0 || access == O_ACCMODE)
+        return -EINVAL;
+
+    char path[MAX_PATH_LENGTH + 1];
+    int32_t error = copyPath(path,args[0],args[1]);
+    if (error != 0)
+        return error;
+
+    vnode* node;
+    if (flags & O_CREAT)
+    {
+        error = create(path,vnodeType::FILE,&node);
+        if (error == -EEXIST && !(flags & O_EXCL))
+            error = walk(path,&node);
+    }
+    else
+        error = walk(path,&node);
+    if (error != 0)
+        return error;
+
+    if (access != O_RDONLY && node->type == vnodeType::DIRECTORY)
+        error = -EISDIR;
+    else if (access != O_RDONLY && !writable(node))
+        error = -EROFS;
+    else if (access != O_RDONLY && (flags & O_TRUNC))
+        error = truncate(node,0);
+    if (error != 0)
+    {
+        putVnode(node);
+        return error;
+    }
+
+    const int32_t fd = kernel::proc::openDescriptor(kernel::proc::descriptorType::FILE,node,flags);
+    if (fd < 0)
+        putVnode(node);
+    return fd;
+}
+
+/**
+ * @brief args[3] and args[4] are the low and high halves of the offset
+ * 
+ */
+static int32_t sysPread(const uint32_t* args)
+{
+    kernel::proc::descriptor d;
+    if (!kernel::proc::getDescriptor(static_cast<int32_t>(args[0]),&d))
+        return -EBADF;
+
+    int32_t result = -ESPIPE;
+    if (d.type == kernel::proc::descriptorType::FILE ||
+            d.type == kernel::proc::descriptorType::BLOCK_DEVICE)
+        result = kernel::proc::descriptorRead(&d,args[1],args[2],
+                static_cast<uint64_t>(args[4]) << 32 | args[3]);
+    kernel::proc::putDescriptor(&d);
+    return result;
+}
+
+static int32_t sysMmap(const uint32_t* args)
+{
+    const uint32_t prot = args[3];
+    if ((prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) != 0 || prot == 0)
+        return -EINVAL;
+
+    kernel::proc::descriptor d;
+    if (!kernel::proc::getDescriptor(static_cast<int32_t>(args[0]),&d))
+        return -EBADF;
+
+    int32_t result;
+    if (d.type != kernel::proc::descriptorType::FILE || (d.flags & O_ACCMODE) == O_WRONLY)
+        result = -EBADF;
+    else
+    {
+        uint32_t flags = 0;
+        if (prot & PROT_READ)
+            flags |= kernel::mm::REGION_READ;
+        if (prot & PROT_WRITE)
+            flags |= kernel::mm::REGION_WRITE | kernel::mm::REGION_READ;
+        if (prot & PROT_EXEC)
+            flags |= kernel::mm::REGION_EXEC | kernel::mm::REGION_READ;
+
+        uint32_t address;
+        result = mapFile(static_cast<vnode*>(d.object),args[2],args[1],flags,&address);
+        if (result == 0)
+            result = static_cast<int32_t>(address);
+    }
+    kernel::proc::putDescriptor(&d);
+    return result;
+}
+
+static int32_t sysUnlink(const uint32_t* args)
+{
+    char path[MAX_PATH_LENGTH + 1];
+    const int32_t error = copyPath(path,args[0],args[1]);
+    return error != 0 ? error : unlink(path);
+}
+
+static int32_t sysFtruncate(const uint32_t* args)
+{
+    kernel::proc::descriptor d;
+    if (!kernel::proc::getDescriptor(static_cast<int32_t>(args[0]),&d))
+        return -EBADF;
+
+    int32_t result;
+    if (d.type != kernel::proc::descriptorType::FILE || (d.flags & O_ACCMODE) == O_RDONLY)
+        result = -EBADF;
+    else
+        result = truncate(static_cast<vnode*>(d.object),args[1]);
+    kernel::proc::putDescriptor(&d);
+    return result;
+}
+
+static int32_t sysGetdents(const uint32_t* args)
+{
+    return kernel::proc::readDirectoryDescriptor(static_cast<int32_t>(args[0]),args[1],args[2]);
+}
+
+static int32_t sysMunmap(const uint32_t* args)
+{
+    // Only what mmap() and friends put there, not the program or its stack
+    kernel::mm::addressSpace* space = kernel::sched::currentThread()->space;
+    if (space == nullptr || args[0] < kernel::proc::USER_MAP_START ||
+            args[0] >= kernel::proc::USER_IMAGE_END)
+        return -EINVAL;
+    return space->removeRegion(args[0]) ? 0 : -EINVAL;
+}
+
+static const syscallDescriptor openDescriptor =     {"open",&sysOpen,3,
+        {argKind::USER_POINTER,argKind::LENGTH,argKind::VALUE}};
+static const syscallDescriptor preadDescriptor =    {"pread",&sysPread,5,
+        {argKind::VALUE,argKind::USER_POINTER,argKind::LENGTH,argKind::VALUE,argKind::VALUE}};
+static const syscallDescriptor mmapDescriptor =     {"mmap",&sysMmap,4,
+        {argKind::VALUE,argKind::VALUE,argKind::VALUE,argKind::VALUE}};
+static const syscallDescriptor munmapDescriptor =   {"munmap",&sysMunmap,1,{argKind::VALUE}};
+static const syscallDescriptor unlinkDescriptor =   {"unlink",&sysUnlink,2,
+        {argKind::USER_POINTER,argKind::LENGTH}};
+static const syscallDescriptor ftruncateDescriptor = {"ftruncate",&sysFtruncate,2,
+        {argKind::VALUE,argKind::VALUE}};
+static const syscallDescriptor getdentsDescriptor = {"getdents",&sysGetdents,3,
+        {argKind::VALUE,argKind::USER_POINTER,argKind::LENGTH}};
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+void kernel::vfs::putVnode(vnode* node)
+{
+    // Only the last reference needs the lock, so nobody finds the vnode in
+    // the inode cache while it's going
+    uint32_t references = __atomic_load_n(&node->references,__ATOMIC_RELAXED);
+    while (references > 1)
+    {
+        if (__atomic_compare_exchange_n(&node->references,&references,references - 1,true,
+                __ATOMIC_RELEASE,__ATOMIC_RELAXED))
+            return;
+    }
+
+    icacheLock.lock();
+    const bool last = __atomic_sub_fetch(&node->references,1,__ATOMIC_ACQ_REL) == 0;
+    if (last)
+    {
+        vnode** link = icache + icacheBucket(node->fs,node->id);
+        while (*link != nullptr && *link != node)
+            link = &(*link)->hashNext;
+        if (*link == node)
+            *link = node->hashNext;
+    }
+    icacheLock.unlock();
+
+    if (last)
+        release(node);
+}
+
+vnode* kernel::vfs::allocateVnode(filesystem* fs, uint32_t id, vnodeType type, const vnodeOps* ops)
+{
+    vnode* node = new vnode();
+    if (node == nullptr)
+        return nullptr;
+    node->references = 1;
+    node->type = type;
+    node->id = id;
+    node->fs = fs;
+    node->ops = ops;
+    return node;
+}
+
+vnode* kernel::vfs::internVnode(vnode* node)
+{
+    vnode** bucket = icache + icacheBucket(node->fs,node->id);
+    vnode* existing;
+    icacheLock.lock();
+    for (existing = *bucket; existing != nullptr; existing = existing->hashNext)
+    {
+        if (existing->fs == node->fs && existing->id == node->id)
+        {
+            getVnode(existing);
+            break;
+        }
+    }
+    if (existing == nullptr)
+    {
+        node->hashNext = *bucket;
+        *bucket = node;
+    }
+    icacheLock.unlock();
+
+    if (existing == nullptr)
+        return node;
+    release(node);
+    return existing;
+}
+
+int32_t kernel::vfs::walk(const char* path, vnode** result)
+{
+    return walkPath(path,strlen(path),result);
+}
+
+int32_t kernel::vfs::create(const char* path, vnodeType type, vnode** result)
+{
+    size_t start;
+    size_t length;
+    lastComponent(path,&start,&length);
+    const char* name = path + start;
+
+    // The root, "." and ".." are always there
+    if (length == 0 || (length == 1 && name[0] == '.') ||
+            (length == 2 && name[0] == '.' && name[1] == '.'))
+        return -EEXIST;
+    if (length > MAX_NAME_LENGTH)
+        return -ENAMETOOLONG;
+
+    vnode* directory;
+    int32_t error = walkPath(path,start,&directory);
+    if (error != 0)
+        return error;
+
+    if (directory->type != vnodeType::DIRECTORY)
+        error = -ENOTDIR;
+    else if (directory->ops->create == nullptr)
+    {
+        // Read-only, but it might be there anyway
+        vnode* node;
+        error = lookupComponent(directory,name,length,&node);
+        if (error == 0)
+        {
+            putVnode(node);
+            error = -EEXIST;
+        }
+        else if (error == -ENOENT)
+            error = -EROFS;
+    }
+    else
+    {
+        error = directory->ops->create(directory,name,length,type,result);
+        // Whatever was cached for the name, most likely that it wasn't there
+        if (error == 0)
+            dcacheInsert(directory,name,length,*result);
+    }
+
+    putVnode(directory);
+    return error;
+}
+
+int32_t kernel::vfs::unlink(const char* path)
+{
+    size_t start;
+    size_t length;
+    lastComponent(path,&start,&length);
+    const char* name = path + start;
+    if (length == 0 || (length == 1 && name[0] == '.') ||
+            (length == 2 && name[0] == '.' && name[1] == '.'))
+        return -EISDIR;
+
+    vnode* directory;
+    int32_t error = walkPath(path,start,&directory);
+    if (error != 0)
+        return error;
+
+    vnode* node = nullptr;
+    if (directory->type != vnodeType::DIRECTORY)
+        error = -ENOTDIR;
+    else
+        error = lookupComponent(directory,name,length,&node);
+    if (error == 0 && node->type == vnodeType::DIRECTORY)
+        error = -EISDIR;
+    else if (error == 0 && directory->ops->unlink == nullptr)
+        error = -EROFS;
+    else if (error == 0)
+        error = directory->ops->unlink(directory,name,length,node);
+
+    if (error == 0)
+    {
+        dcacheInsert(directory,name,length,nullptr);
+        forgetVnode(node);
+    }
+    if (node != nullptr)
+        putVnode(node);
+    putVnode(directory);
+    return error;
+}
+
+int32_t kernel::vfs::mount(const char* path, filesystem* fs)
+{
+    vnode* covered = nullptr;
+    mountLock.lock();
+    const bool first = rootNode == nullptr;
+    mountLock.unlock();
+    if (!first)
+    {
+        const int32_t error = walk(path,&covered);
+        if (error != 0)
+            return error;
+        if (covered->type != vnodeType::DIRECTORY)
+        {
+            putVnode(covered);
+            return -ENOTDIR;
+        }
+    }
+    else if (strcmp(path,"/") != 0)
+        return -ENOENT;
+
+    int32_t error = 0;
+    mountLock.lock();
+    mountPoint* slot = nullptr;
+    for (mountPoint& m : mounts)
+    {
+        if (m.fs == nullptr)
+        {
+            slot = &m;
+            break;
+        }
+    }
+    if (first ? rootNode != nullptr : covered->covered)
+        error = -EBUSY;
+    else if (slot == nullptr)
+        error = -ENOMEM;
+    else
+    {
+        *slot = {covered,fs};
+        if (first)
+            rootNode = fs->root;
+        else
+            covered->covered = true;
+    }
+    mountLock.unlock();
+
+    if (error != 0 && covered != nullptr)
+        putVnode(covered);
+    return error;
+}
+
+int32_t kernel::vfs::read(vnode* node, uint64_t offset, void* buffer, size_t length)
+{
+    if (node->type == vnodeType::DIRECTORY)
+        return -EISDIR;
+    if (length > INT32_MAX)
+        length = INT32_MAX;
+    return readPages(node,offset,buffer,length);
+}
+
+int32_t kernel::vfs::write(vnode* node, uint64_t offset, const void* buffer, size_t length)
+{
+    if (node->type == vnodeType::DIRECTORY)
+        return -EISDIR;
+    if (!writable(node))
+        return -EROFS;
+    if (length > INT32_MAX)
+        length = INT32_MAX;
+    return writePages(node,offset,buffer,length);
+}
+
+size_t kernel::vfs::putDirent(void* buffer, size_t size, uint32_t id, uint32_t next,
+            vnodeType type, const char* name, size_t length)
+{
+    const size_t record = (sizeof(dirent) + length + 1 + 3) & ~size_t(3);
+    if (record > size || length > DIRENT_NAME_MAX)
+        return 0;
+    dirent* d = static_cast<dirent*>(buffer);
+    *d = {id,next,static_cast<uint16_t>(record),
+            static_cast<uint8_t>(type == vnodeType::DIRECTORY ? DT_DIR : DT_REG),
+            static_cast<uint8_t>(length)};
+    char* copy = reinterpret_cast<char*>(d + 1);
+    memmove(copy,name,length);
+    copy[length] = '\0';
+    return record;
+}
+
+int32_t kernel::vfs::readDirectory(vnode* node, uint32_t* cursor, void* buffer, size_t length)
+{
+    if (node->type != vnodeType::DIRECTORY || node->ops->readdir == nullptr)
+        return -ENOTDIR;
+    if (length > INT32_MAX)
+        length = INT32_MAX;
+
+    alignas(4) uint8_t chunk[DIRECTORY_CHUNK];
+    size_t done = 0;
+    while (done < length)
+    {
+        uint32_t next = *cursor;
+        const int32_t filled = node->ops->readdir(node,&next,chunk,
+                length - done < sizeof(chunk) ? length - done : sizeof(chunk));
+        // What was listed already counts, the error comes back next time
+        if (filled <= 0)
+            return done != 0 ? static_cast<int32_t>(done) : filled;
+        memcpy(static_cast<uint8_t*>(buffer) + done,chunk,static_cast<size_t>(filled));
+        done += static_cast<size_t>(filled);
+        *cursor = next;
+    }
+    return static_cast<int32_t>(done);
+}
+
+int32_t kernel::vfs::truncate(vnode* node, uint64_t size)
+{
+    if (node->type == vnodeType::DIRECTORY)
+        return -EISDIR;
+    if (!writable(node))
+        return -EROFS;
+    if (size > UINT32_MAX)
+        return -EFBIG;
+    truncatePages(node,static_cast<uint32_t>(size));
+    return 0;
+}
+
+int32_t kernel::vfs::sync(vnode* node)
+{
+    if (node->type == vnodeType::DIRECTORY)
+        return 0;
+    return writebackPages(node);
+}
+
+kernel::mm::memoryObject* kernel::vfs::fileObject(vnode* node, int32_t* error)
+{
+    if (node->type == vnodeType::DIRECTORY)
+    {
+        *error = -EISDIR;
+        return nullptr;
+    }
+
+    mm::memoryObject* object = cacheObject(node);
+    if (object == nullptr)
+        *error = -ENOMEM;
+    return object;
+}
+
+int32_t kernel::vfs::mapFile(vnode* node, uint32_t offset, size_t length, uint32_t flags,
+            uint32_t* address)
+{
+    mm::addressSpace* space = sched::currentThread()->space;
+    if (space == nullptr || length == 0 || (offset & ~PAGE_MASK) != 0)
+        return -EINVAL;
+    if (length > proc::USER_IMAGE_END - proc::USER_MAP_START)
+        return -ENOMEM;
+
+    int32_t error;
+    mm::memoryObject* object = fileObject(node,&error);
+    if (object == nullptr)
+        return error;
+
+    // Pages past the end of the object are zero filled
+    const uint32_t mapSize = static_cast<uint32_t>((length + PAGE_SIZE - 1) & PAGE_MASK);
+    const size_t firstPage = offset / PAGE_SIZE;
+    size_t backedPages = firstPage < object->pages() ? object->pages() - firstPage : 0;
+    if (backedPages > mapSize / PAGE_SIZE)
+        backedPages = mapSize / PAGE_SIZE;
+
+    // The mapping takes its own reference
+    const uint32_t start = space->findFreeRange(mapSize,proc::USER_MAP_START,proc::USER_IMAGE_END);
+    const bool mapped = start != 0 && (backedPages == 0 ?
+            space->addRegion(start,start + mapSize,flags) :
+            space->addRegion(start,start + mapSize,flags,object,offset,
+                    start + static_cast<uint32_t>(backedPages * PAGE_SIZE)));
+    object->put();
+    if (!mapped)
+        return -ENOMEM;
+
+    *address = start;
+    return 0;
+}
+
+vfsStats kernel::vfs::getStats()
+{
+    vfsStats stats = {0,0,0};
+    for (size_t i = 0; i < smp::cpuCount(); i++)
+    {
+        stats.hits += *smp::perCPUPointer(dentryHits,i);
+        stats.negativeHits += *smp::perCPUPointer(dentryNegativeHits,i);
+        stats.misses += *smp::perCPUPointer(dentryMisses,i);
+    }
+    return stats;
+}
+
+void kernel::vfs::init()
+{
+    filesystem* root = createRamfs();
+    if (root == nullptr || mount("/",root) != 0)
+        earlyPanic("vfs: couldn't mount the root filesystem");
+
+    vnode* directory;
+    if (create(BOOT_DIRECTORY,vnodeType::DIRECTORY,&directory) != 0)
+        earlyPanic("vfs: couldn't make the boot directory");
+    putVnode(directory);
+
+    // Scratch space, gone on reboot
+    filesystem* scratch = createRamfs();
+    if (scratch == nullptr || create("/tmp",vnodeType::DIRECTORY,&directory) != 0 ||
+            mount("/tmp",scratch) != 0)
+        earlyPanic("vfs: couldn't mount /tmp");
+    putVnode(directory);
+
+    initPageCache();
+
+    if (!registerSyscall(SYS_OPEN,&openDescriptor) ||
+            !registerSyscall(SYS_PREAD,&preadDescriptor) ||
+            !registerSyscall(SYS_MMAP,&mmapDescriptor) ||
+            !registerSyscall(SYS_MUNMAP,&munmapDescriptor) ||
+            !registerSyscall(SYS_UNLINK,&unlinkDescriptor) ||
+            !registerSyscall(SYS_FTRUNCATE,&ftruncateDescriptor) ||
+            !registerSyscall(SYS_GETDENTS,&getdentsDescriptor))
+        earlyPanic("vfs: couldn't register the system calls");
+}
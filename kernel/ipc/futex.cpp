@@ -0,0 +1,170 @@
+/**
+ * @file futex.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from futex.hpp
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/ipc/futex.hpp>
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/sched/waitQueue.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+
+using namespace kernel::ipc;
+
+static_assert((FUTEX_BUCKETS & (FUTEX_BUCKETS - 1)) == 0, "FUTEX_BUCKETS must be a power of 2");
+
+/**
+ * @brief A queue of the hash table, shared by every word that hashes to it
+ * 
+ */
+struct futexBucket
+{
+    kernel::sync::spinlock  lock;
+    kernel::sched::waitQueue queue;
+};
+
+static futexBucket buckets[FUTEX_BUCKETS];
+
+static futexBucket* bucketOf(uint32_t physical)
+{
+    // Fibonacci hashing, words are 4 byte aligned
+    const uint32_t hash = (physical >> 2) * 0x9e3779b9u;
+    return buckets + (hash >> (32 - __builtin_ctz(FUTEX_BUCKETS)));
+}
+
+/**
+ * @brief Physical address of a user word of the current thread
+ * 
+ * @param physical Set to it, with a reference on its frame, so the frame (and
+ * the key) can't be reused while we're using it, or sleeping on it
+ * @return int32_t 0, or a negative error
+ */
+static int32_t resolve(uint32_t address, uint32_t* physical)
+{
+    if ((address & 3) != 0 || !kernel::syscall::isUserRange(address,sizeof(uint32_t)))
+        return -kernel::syscall::EINVAL;
+    kernel::mm::addressSpace* space = kernel::sched::currentThread()->space;
+    if (space == nullptr || (*physical = space->physicalAddress(address)) == 0)
+        return -kernel::syscall::EFAULT;
+    return 0;
+}
+
+static inline void release(uint32_t physical)
+{
+    kernel::mm::putFrame(physical & kernel::mm::PAGE_MASK);
+}
+
+/**
+ * @brief Read a word through the direct map, where it can't fault with a
+ * lock held
+ * 
+ */
+static inline uint32_t readWord(uint32_t physical)
+{
+    return __atomic_load_n(static_cast<const volatile uint32_t*>(kernel::mm::frameAddress(physical)),
+            __ATOMIC_ACQUIRE);
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+int32_t kernel::ipc::futexWait(uint32_t address, uint32_t expected)
+{
+    uint32_t physical;
+    const int32_t error = resolve(address,&physical);
+    if (error != 0)
+        return error;
+
+    futexBucket* bucket = bucketOf(physical);
+    bucket->lock.lock();
+    if (readWord(physical) != expected)
+    {
+        bucket->lock.unlock();
+        release(physical);
+        return -syscall::EAGAIN;
+    }
+    sched::waiter w;
+    bucket->queue.add(&w,physical);
+    bucket->lock.unlock();
+
+    sched::sleep(&w);
+    // A requeue moves the reference to the word it was moved to, its key now
+    release(w.key);
+    return 0;
+}
+
+int32_t kernel::ipc::futexWake(uint32_t address, uint32_t count)
+{
+    uint32_t physical;
+    const int32_t error = resolve(address,&physical);
+    if (error != 0)
+        return error;
+
+    futexBucket* bucket = bucketOf(physical);
+    bucket->lock.lock();
+    const size_t woken = bucket->queue.wake(count,physical);
+    bucket->lock.unlock();
+
+    release(physical);
+    return static_cast<int32_t>(woken);
+}
+
+int32_t kernel::ipc::futexRequeue(uint32_t address, uint32_t wakeCount, uint32_t target,
+            uint32_t requeueCount, uint32_t expected)
+{
+    uint32_t physical, targetPhysical;
+    int32_t error = resolve(address,&physical);
+    if (error != 0)
+        return error;
+    if ((error = resolve(target,&targetPhysical)) != 0)
+    {
+        release(physical);
+        return error;
+    }
+
+    // Always in the same order, so two requeues the other way around can't
+    // deadlock
+    futexBucket* from = bucketOf(physical);
+    futexBucket* to = bucketOf(targetPhysical);
+    futexBucket* first = from < to ? from : to;
+    futexBucket* second = from < to ? to : from;
+    first->lock.lock();
+    if (second != first)
+        second->lock.lock();
+
+    int32_t result;
+    size_t moved = 0;
+    if (readWord(physical) != expected)
+        result = -syscall::EAGAIN;
+    else
+    {
+        const size_t woken = from->queue.wake(wakeCount,physical);
+        moved = from->queue.requeue(&to->queue,requeueCount,physical,targetPhysical);
+        result = static_cast<int32_t>(woken + moved);
+    }
+
+    if (second != first)
+        second->lock.unlock();
+    first->lock.unlock();
+
+    // Sleepers keep a reference on the frame of their key, so it can't be
+    // reused for another futex while they're on it. Ours keep both alive
+    // until the moved ones' are moved too, even if they wake meanwhile
+    for (size_t i = 0; i < moved; i++)
+    {
+        mm::getFrame(targetPhysical & mm::PAGE_MASK);
+        release(physical);
+    }
+
+    release(targetPhysical);
+    release(physical);
+    return result;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file ipc.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from ipc.hpp
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/ipc/ipc.hpp>
+#include <kernelInternal/proc/descriptor.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <klib/cstdlib.hpp>
+
+using namespace kernel::ipc;
+using namespace kernel::syscall;
+
+// Longest name any of these take, and the terminator
+static const size_t NAME_SIZE =             16;
+static_assert(PIPE_NAME_LENGTH < NAME_SIZE && SHM_NAME_LENGTH < NAME_SIZE);
+
+/**
+ * @brief Copy a name in from user memory, and terminate it
+ * 
+ * @return int32_t 0, or a negative error
+ */
+static int32_t copyName(char* name, uint32_t address, size_t length)
+{
+    if (length == 0)
+        return -EINVAL;
+    if (length >= NAME_SIZE)
+        return -ENAMETOOLONG;
+    if (!copyFromUser(name,address,length))
+        return -EFAULT;
+    name[length] = '\0';
+    return 0;
+}
+
+static int32_t sysPipe(const uint32_t* args)
+{
+    if (args[1] != 2 * sizeof(int32_t) || (args[2] & ~PIPE_COPY) != 0)
+        return -EINVAL;
+
+    pipe* p = pipe::create(args[2]);
+    if (p == nullptr)
+        return -ENOMEM;
+
+    int32_t fds[2];
+    fds[0] = kernel::proc::openDescriptor(kernel::proc::descriptorType::PIPE_READ,p);
+    if (fds[0] < 0)
+    {
+        p->close(false);
+        p->close(true);
+        return fds[0];
+    }
+    fds[1] = kernel::proc::openDescriptor(kernel::proc::descriptorType::PIPE_WRITE,p);
+    if (fds[1] < 0)
+    {
+        kernel::proc::closeDescriptor(fds[0]);
+        p->close(true);
+        return fds[1];
+    }
+
+    if (!copyToUser(args[0],fds,sizeof(fds)))
+    {
+        kernel::proc::closeDescriptor(fds[0]);
+        kernel::proc::closeDescriptor(fds[1]);
+        return -EFAULT;
+    }
+    return 0;
+}
+
+static int32_t sysPipeOpen(const uint32_t* args)
+{
+    if ((args[2] & ~(PIPE_WRITE | PIPE_COPY)) != 0)
+        return -EINVAL;
+    char name[NAME_SIZE];
+    const int32_t error = copyName(name,args[0],args[1]);
+    if (error != 0)
+        return error;
+
+    pipe* p = pipe::open(name,args[2]);
+    if (p == nullptr)
+        return -ENOMEM;
+
+    const bool writeEnd = args[2] & PIPE_WRITE;
+    const int32_t fd = kernel::proc::openDescriptor(writeEnd ? kernel::proc::descriptorType::PIPE_WRITE :
+            kernel::proc::descriptorType::PIPE_READ,p);
+    if (fd < 0)
+        p->close(writeEnd);
+    return fd;
+}
+
+static int32_t sysShmOpen(const uint32_t* args)
+{
+    char name[NAME_SIZE];
+    const int32_t error = copyName(name,args[0],args[1]);
+    if (error != 0)
+        return error;
+
+    uint32_t address;
+    const int32_t result = shmOpen(name,args[2],&address);
+    return result != 0 ? result : static_cast<int32_t>(address);
+}
+
+static int32_t sysShmUnlink(const uint32_t* args)
+{
+    char name[NAME_SIZE];
+    const int32_t error = copyName(name,args[0],args[1]);
+    if (error != 0)
+        return error;
+    return shmUnlink(name);
+}
+
+static int32_t sysShmWait(const uint32_t* args)
+{
+    return shmWait(args[0],args[1]);
+}
+
+static int32_t sysShmWake(const uint32_t* args)
+{
+    return shmWake(args[0],args[1]);
+}
+
+/**
+ * @brief FUTEX_WAIT: args[2] = expected. FUTEX_WAKE: args[2] = count.
+ * FUTEX_REQUEUE: args[2] = how many to wake, in the low 16 bits, and how many
+ * to move to args[3], in the high ones; args[4] = expected
+ * 
+ */
+static int32_t sysFutex(const uint32_t* args)
+{
+    switch (args[0])
+    {
+    case FUTEX_WAIT:
+        return futexWait(args[1],args[2]);
+    case FUTEX_WAKE:
+        return futexWake(args[1],args[2]);
+    case FUTEX_REQUEUE:
+        return futexRequeue(args[1],args[2] & 0xffff,args[3],args[2] >> 16,args[4]);
+    default:
+        return -EINVAL;
+    }
+}
+
+static const syscallDescriptor pipeDescriptor =         {"pipe",&sysPipe,3,
+        {argKind::USER_POINTER,argKind::LENGTH,argKind::VALUE}};
+static const syscallDescriptor pipeOpenDescriptor =     {"pipe_open",&sysPipeOpen,3,
+        {argKind::USER_POINTER,argKind::LENGTH,argKind::VALUE}};
+static const syscallDescriptor shmOpenDescriptor =      {"shm_open",&sysShmOpen,3,
+        {argKind::USER_POINTER,argKind::LENGTH,argKind::VALUE}};
+static const syscallDescriptor shmUnlinkDescriptor =    {"shm_unlink",&sysShmUnlink,2,
+        {argKind::USER_POINTER,argKind::LENGTH}};
+static const syscallDescriptor shmWaitDescriptor =      {"shm_wait",&sysShmWait,2,
+        {argKind::VALUE,argKind::VALUE}};
+static const syscallDescriptor shmWakeDescriptor =      {"shm_wake",&sysShmWake,2,
+        {argKind::VALUE,argKind::VALUE}};
+static const syscallDescriptor futexDescriptor =        {"futex",&sysFutex,5,
+        {argKind::VALUE,argKind::VALUE,argKind::VALUE,argKind::VALUE,argKind::VALUE}};
+
+void kernel::ipc::init()
+{
+    if (!registerSyscall(SYS_PIPE,&pipeDescriptor) ||
+            !registerSyscall(SYS_PIPE_OPEN,&pipeOpenDescriptor) ||
+            !registerSyscall(SYS_SHM_OPEN,&shmOpenDescriptor) ||
+            !registerSyscall(SYS_SHM_UNLINK,&shmUnlinkDescriptor) ||
+            !registerSyscall(SYS_SHM_WAIT,&shmWaitDescriptor) ||
+            !registerSyscall(SYS_SHM_WAKE,&shmWakeDescriptor) ||
+            !registerSyscall(SYS_FUTEX,&futexDescriptor))
+        earlyPanic("ipc: couldn't register the system calls");
+}
@@ -0,0 +1,300 @@
+/**
+ * @file pipe.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from pipe.hpp
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/ipc/pipe.hpp>
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <klib/string.h>
+#include <sys/ioring.h>
+
+using namespace kernel::ipc;
+using kernel::mm::PAGE_SIZE;
+
+// Named pipes with ends open. Taken before any pipe's own lock
+static pipe* namedPipes = nullptr;
+static kernel::sync::spinlock namedLock;
+
+static inline bool aligned(const void* address)
+{
+    return (reinterpret_cast<uint32_t>(address) & ~kernel::mm::PAGE_MASK) == 0;
+}
+
+/**
+ * @brief Wait on one of the queues. Lock held, and held again on return
+ * 
+ */
+void pipe::sleepOn(sched::waitQueue* queue)
+{
+    sched::waiter w;
+    queue->add(&w);
+    _lock.unlock();
+    sched::sleep(&w);
+    _lock.lock();
+}
+
+/**
+ * @brief Add a page at the back. Lock held, and there must be room
+ * 
+ */
+void pipe::push(uint32_t frame, uint16_t length, bool lent)
+{
+    _slots[(_first + _count) % PIPE_PAGES] = {frame,0,length,lent};
+    _count++;
+}
+
+/**
+ * @brief Drop the page at the front, which the caller already let go of.
+ * Lock held
+ * 
+ */
+void pipe::pop()
+{
+    _first = (_first + 1) % PIPE_PAGES;
+    _count--;
+}
+
+pipe* pipe::create(uint32_t flags)
+{
+    pipe* p = new pipe;
+    if (p == nullptr)
+        return nullptr;
+    p->_flags = flags & PIPE_COPY;
+    p->_readers = 1;
+    p->_writers = 1;
+    p->_name[0] = '\0';
+    return p;
+}
+
+pipe* pipe::open(const char* name, uint32_t flags)
+{
+    const size_t length = strlen(name);
+    if (length == 0 || length > PIPE_NAME_LENGTH)
+        return nullptr;
+
+    // Allocated up front, not to do it under the lock
+    pipe* fresh = new pipe;
+    if (fresh == nullptr)
+        return nullptr;
+
+    namedLock.lock();
+    pipe* p = namedPipes;
+    while (p != nullptr && strcmp(p->_name,name) != 0)
+        p = p->_next;
+    if (p == nullptr)
+    {
+        p = fresh;
+        fresh = nullptr;
+        p->_flags = flags & PIPE_COPY;
+        memcpy(p->_name,name,length + 1);
+        p->_next = namedPipes;
+        namedPipes = p;
+    }
+
+    p->_lock.lock();
+    if (flags & PIPE_WRITE)
+        p->_writers++;
+    else
+        p->_readers++;
+    p->_lock.unlock();
+    namedLock.unlock();
+
+    delete fresh;
+    return p;
+}
+
+void pipe::reference(bool writeEnd)
+{
+    _lock.lock();
+    if (writeEnd)
+        _writers++;
+    else
+        _readers++;
+    _lock.unlock();
+}
+
+void pipe::close(bool writeEnd)
+{
+    // Keeps open() from finding a pipe that's about to go
+    const bool named = _name[0] != '\0';
+    if (named)
+        namedLock.lock();
+
+    _lock.lock();
+    if (writeEnd)
+        _writers--;
+    else
+        _readers--;
+    const bool last = _readers == 0 && _writers == 0;
+
+    // The other side may be waiting for something that won't come now
+    _readWait.wakeAll();
+    _writeWait.wakeAll();
+    _lock.unlock();
+
+    if (named)
+    {
+        if (last)
+        {
+            pipe** link = &namedPipes;
+            while (*link != this)
+                link = &(*link)->_next;
+            *link = _next;
+        }
+        namedLock.unlock();
+    }
+
+    if (!last)
+        return;
+
+    // Nobody has an end, so nobody can be in here
+    while (_count != 0)
+    {
+        mm::putFrame(_slots[_first].frame);
+        pop();
+    }
+    delete this;
+}
+
+int32_t pipe::read(void* buffer, size_t length)
+{
+    if (length == 0)
+        return 0;
+
+    mm::addressSpace* space = sched::currentThread()->space;
+    uint8_t* destination = static_cast<uint8_t*>(buffer);
+    size_t done = 0;
+
+    _lock.lock();
+    while (_count == 0 && _writers != 0)
+        sleepOn(&_readWait);
+
+    while (done < length && _count != 0)
+    {
+        slot& s = _slots[_first];
+
+        // A whole page goes in place of the reader's, no copy
+        if (!(_flags & PIPE_COPY) && space != nullptr && s.offset == 0 && s.length == PAGE_SIZE &&
+                aligned(destination + done) && length - done >= PAGE_SIZE &&
+                space->insertPage(reinterpret_cast<uint32_t>(destination + done),s.frame))
+        {
+            // The mapping has our reference now
+            pop();
+            done += PAGE_SIZE;
+            continue;
+        }
+
+        const size_t chunk = length - done < s.length ? length - done : s.length;
+        memcpy(destination + done,static_cast<uint8_t*>(mm::frameAddress(s.frame)) + s.offset,chunk);
+        s.offset = static_cast<uint16_t>(s.offset + chunk);
+        s.length = static_cast<uint16_t>(s.length - chunk);
+        done += chunk;
+        if (s.length == 0)
+        {
+            mm::putFrame(s.frame);
+            pop();
+        }
+    }
+
+    if (done != 0)
+        _writeWait.wakeAll();
+    _lock.unlock();
+    return static_cast<int32_t>(done);
+}
+
+int32_t pipe::write(const void* buffer, size_t length)
+{
+    mm::addressSpace* space = sched::currentThread()->space;
+    const uint8_t* source = static_cast<const uint8_t*>(buffer);
+    size_t done = 0;
+    int32_t error = 0;
+
+    _lock.lock();
+    while (done < length)
+    {
+        if (_readers == 0)
+        {
+            error = -syscall::EPIPE;
+            break;
+        }
+
+        // Room at the end of the last page, for copies
+        slot* last = _count != 0 ? &_slots[(_first + _count - 1) % PIPE_PAGES] : nullptr;
+        const size_t room = last != nullptr && !last->lent ?
+                PAGE_SIZE - last->offset - last->length : 0;
+        if (_count == PIPE_PAGES && room == 0)
+        {
+            // Readers could be waiting for what's in there already
+            _readWait.wakeAll();
+            sleepOn(&_writeWait);
+            continue;
+        }
+
+        // A whole page gets lent, no copy
+        if (!(_flags & PIPE_COPY) && space != nullptr && _count != PIPE_PAGES &&
+                aligned(source + done) && length - done >= PAGE_SIZE)
+        {
+            const uint32_t frame = space->lendPage(reinterpret_cast<uint32_t>(source + done));
+            if (frame != 0)
+            {
+                push(frame,PAGE_SIZE,true);
+                done += PAGE_SIZE;
+                continue;
+            }
+        }
+
+        if (room == 0)
+        {
+            const uint32_t frame = mm::allocateFrame();
+            if (frame == 0)
+            {
+                error = -syscall::ENOMEM;
+                break;
+            }
+            push(frame,0,false);
+            continue;
+        }
+
+        const size_t chunk = length - done < room ? length - done : room;
+        memcpy(static_cast<uint8_t*>(mm::frameAddress(last->frame)) + last->offset + last->length,
+                source + done,chunk);
+        last->length = static_cast<uint16_t>(last->length + chunk);
+        done += chunk;
+    }
+
+    if (_count != 0)
+        _readWait.wakeAll();
+    _lock.unlock();
+
+    // A short write still counts
+    return done != 0 ? static_cast<int32_t>(done) : error;
+}
+
+uint32_t pipe::poll(uint32_t events, bool wait)
+{
+    _lock.lock();
+    for (;;)
+    {
+        uint32_t ready = 0;
+        if ((events & POLLIN) && (_count != 0 || _writers == 0))
+            ready |= _writers == 0 ? POLLIN | POLLHUP : POLLIN;
+        if ((events & POLLOUT) && (_count != PIPE_PAGES || _readers == 0))
+            ready |= _readers == 0 ? POLLOUT | POLLHUP : POLLOUT;
+
+        // Not both: the pipe can't be empty and full at once
+        if (ready != 0 || !wait || (events & (POLLIN | POLLOUT)) == 0)
+        {
+            _lock.unlock();
+            return ready;
+        }
+        sleepOn(events & POLLIN ? &_readWait : &_writeWait);
+    }
+}
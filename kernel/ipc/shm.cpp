@@ -0,0 +1,168 @@
+/**
+ * @file shm.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from shm.hpp
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/ipc/shm.hpp>
+#include <kernelInternal/ipc/futex.hpp>
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/proc/process.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <klib/string.h>
+
+using namespace kernel::ipc;
+using kernel::mm::PAGE_SIZE;
+
+/**
+ * @brief A name, and the object it stands for
+ * 
+ */
+struct segment
+{
+    char                    name[SHM_NAME_LENGTH + 1];
+    kernel::mm::memoryObject* object;
+};
+
+// The table holds a reference on every object in it
+static segment segments[MAX_SHM_SEGMENTS];
+static kernel::sync::spinlock segmentsLock;
+
+static segment* find(const char* name)
+{
+    for (segment& s : segments)
+    {
+        if (s.object != nullptr && strcmp(s.name,name) == 0)
+            return &s;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Check that a user address is in a segment of the current process
+ * 
+ */
+static bool inSegment(uint32_t address)
+{
+    kernel::mm::addressSpace* space = kernel::sched::currentThread()->space;
+    if (space == nullptr)
+        return false;
+
+    uint32_t offset;
+    kernel::mm::memoryObject* object = space->sharedObject(address,&offset);
+    if (object == nullptr)
+        return false;
+    object->put();
+    return true;
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+int32_t kernel::ipc::shmOpen(const char* name, size_t size, uint32_t* address)
+{
+    const size_t length = strlen(name);
+    if (length == 0 || length > SHM_NAME_LENGTH || size > MAX_SHM_SIZE)
+        return -syscall::EINVAL;
+    mm::addressSpace* space = sched::currentThread()->space;
+    if (space == nullptr)
+        return -syscall::EINVAL;
+    const size_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    // Created up front, not to do it under the lock. Most opens create
+    mm::memoryObject* fresh = nullptr;
+    if (pages != 0 && (fresh = mm::memoryObject::create(pages)) == nullptr)
+        return -syscall::ENOMEM;
+
+    segmentsLock.lock();
+    segment* s = find(name);
+    int32_t error = 0;
+    if (s == nullptr)
+    {
+        for (segment& unused : segments)
+        {
+            if (unused.object == nullptr)
+            {
+                s = &unused;
+                break;
+            }
+        }
+        if (s == nullptr || fresh == nullptr)
+            error = fresh == nullptr ? -syscall::ENOENT : -syscall::ENOMEM;
+        else
+        {
+            memcpy(s->name,name,length + 1);
+            s->object = fresh;
+            fresh = nullptr;
+        }
+    }
+    else if (pages > s->object->pages())
+        error = -syscall::EINVAL;
+
+    mm::memoryObject* object = nullptr;
+    if (error == 0)
+    {
+        object = s->object;
+        object->get();
+    }
+    segmentsLock.unlock();
+
+    if (fresh != nullptr)
+        fresh->put();
+    if (error != 0)
+        return error;
+
+    // The mapping takes its own reference
+    const uint32_t mapSize = static_cast<uint32_t>((pages != 0 ? pages : object->pages()) * PAGE_SIZE);
+    const uint32_t start = space->findFreeRange(mapSize,proc::USER_MAP_START,proc::USER_IMAGE_END);
+    const bool mapped = start != 0 && space->addRegion(start,start + mapSize,
+            mm::REGION_READ | mm::REGION_WRITE | mm::REGION_SHARED,object,0,start + mapSize);
+    object->put();
+    if (!mapped)
+        return -syscall::ENOMEM;
+
+    *address = start;
+    return 0;
+}
+
+int32_t kernel::ipc::shmUnlink(const char* name)
+{
+    segmentsLock.lock();
+    segment* s = find(name);
+    mm::memoryObject* object = nullptr;
+    if (s != nullptr)
+    {
+        object = s->object;
+        s->object = nullptr;
+    }
+    segmentsLock.unlock();
+
+    if (object == nullptr)
+        return -syscall::ENOENT;
+    object->put();
+    return 0;
+}
+
+// Segments are mapped straight from their object's frames, so a word's
+// physical address, and the futex, is the same in every process
+
+int32_t kernel::ipc::shmWait(uint32_t address, uint32_t expected)
+{
+    if (!inSegment(address))
+        return -syscall::EINVAL;
+    return futexWait(address,expected);
+}
+
+int32_t kernel::ipc::shmWake(uint32_t address, uint32_t count)
+{
+    if (!inSegment(address))
+        return -syscall::EINVAL;
+    return futexWake(address,count);
+}
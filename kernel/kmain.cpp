@@ -11,13 +11,31 @@
 
 #include <sys/multiboot.h>
 #include <klib/io.hpp>
+#include <klib/cpuio.hpp>
 #include <klib/cstdlib.hpp>
 #include <devices/BIOSVideoIO.hpp>
 #include <earlyLib/memory.hpp>
 #include <kernelInternal/system/interrupts.hpp>
 #include <kernelInternal/devices/cpu/cpuid.hpp>
 #include <kernelInternal/devices/cpu/apic.hpp>
+#include <kernelInternal/devices/serial.hpp>
 #include <kernelInternal/acpiKernel.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <kernelInternal/system/tlb.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/system/deferred.hpp>
+#include <kernelInternal/system/log.hpp>
+#include <kernelInternal/system/vdso.hpp>
+#include <kernelInternal/bench/bench.hpp>
+#include <kernelInternal/sync/lockstat.hpp>
+#include <kernelInternal/sync/rcu.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <kernelInternal/mm/paging.hpp>
+#include <kernelInternal/ipc/ipc.hpp>
+#include <kernelInternal/aio/ioRing.hpp>
+#include <kernelInternal/fs/vfs.hpp>
+#include <kernelInternal/proc/process.hpp>
 #include <debug.h>
 
 
@@ -28,17 +46,37 @@ extern "C" {
 
 extern uintptr_t _endSymbol;
 
+// Kernel heap size, thread stacks come from here
+static const size_t KERNEL_HEAP_SIZE = 4*1024*1024;
+
 // Variables
 io::_outstream<io::framebuffer_terminal> out;
 
+/**
+ * @brief End the run if this is build-scripts/bench-boot.sh timing the boot.
+ * The 0xE9 port reads back 0xE9 when an emulator listens on it, and a write to
+ * QEMU's isa-debug-exit, when it's there, quits with the status
+ * 
+ */
+static void finishBootBenchmark()
+{
+    if (kernel::cpu::io::inb(BOOT_MARK_PORT) == BOOT_MARK_PORT)
+        kernel::cpu::io::outb(BOOT_EXIT_PORT,0);
+}
+
 void kmain( uint32_t multiboot_flag,
             const struct multiboot_info_structure* info, uint32_t terminalIndex )
 {
+    BOOT_MARK(BOOT_MARK_KMAIN)
+
     // Initialize the terminal
     io::framebuffer_terminal initTerminal;
     out.init(&initTerminal);
     out.hex();
 
+    // Everything printed also goes out COM1, if there is one
+    kernel::serial::init();
+
     // Test to see if we were booted from custom bootloader
     if (multiboot_flag == MULTIBOOT_CUSTOM_BOOTLOADER_MAGIC)
     {
@@ -58,10 +96,22 @@ void kmain( uint32_t multiboot_flag,
     initTerminal.setColor(io::vga_color::VGA_COLOR_LIGHT_GREY,
                             io::vga_color::VGA_COLOR_BLACK);
 
-    // Set up temporary heap, 4K should be enough
+    // Set up the heap, right after the binary, as long as there's memory there
     void* endOfBinary = &_endSymbol; // This is a linker symbol, end of binary in memory
-    out << "Creating a temporary heap at 0x" << endOfBinary << " of size 4k\n";
-    mem::heapInitialize(endOfBinary,4*1024);
+    size_t heapSize = KERNEL_HEAP_SIZE;
+    uint64_t memoryEnd = 0;
+    if (info != nullptr && (info->flags & MULTIBOOT_INFO_MEMORY) && info->mem_upper != 0)
+    {
+        // mem_upper is in KiB, starting at 1 MiB (0 means more than 4 GiB)
+        memoryEnd = 0x100000 + static_cast<uint64_t>(info->mem_upper) * 1024;
+        const uint64_t heapStart = reinterpret_cast<uint32_t>(endOfBinary);
+        if (memoryEnd <= heapStart)
+            earlyPanic("Error: No memory for the heap, aborting!");
+        if (memoryEnd - heapStart < heapSize)
+            heapSize = static_cast<size_t>(memoryEnd - heapStart);
+    }
+    out << "Creating a heap at 0x" << endOfBinary << " of size 0x" << heapSize << "\n";
+    mem::heapInitialize(endOfBinary,heapSize);
 
     // Check CPUID
     if (check_CPUID_available())
@@ -100,8 +150,75 @@ void kmain( uint32_t multiboot_flag,
 
     out << "Are they enabled?...\n";
 
+    if (kernel::serial::startInterrupts(&ioAPIC,localAPIC.id()))
+        out << "Serial console on COM1\n";
+
+    kernel::clock::init();
+    out << "TSC runs at " << out.dec() << kernel::clock::getParameters().tscFrequency
+        << out.hex() << " Hz\n";
+
+    // Bring up the other processors
+    size_t cpusFound = kernel::smp::init(&madt,&localAPIC);
+    out << "Found " << cpusFound << " processors in the MADT\n";
+    kernel::tlb::init();
+    kernel::rcu::init();
+
+    // Whatever memory is past the heap becomes page frames
+    const uint32_t heapEnd = reinterpret_cast<uint32_t>(endOfBinary) + heapSize;
+    kernel::mm::init(heapEnd,memoryEnd > kernel::mm::DIRECT_MAP_END ? kernel::mm::DIRECT_MAP_END
+            : static_cast<uint32_t>(memoryEnd));
+    out << "Paging is on, " << out.dec() << kernel::mm::freeFrames() << out.hex()
+        << " page frames free\n";
+
+    kernel::syscall::init();
+    out << "System calls through " << (kernel::syscall::hasSysenter() ? "sysenter" : "int 0x80")
+        << "\n";
+    kernel::vdso::init();
+    kernel::ipc::init();
+    kernel::aio::init();
+    kernel::vfs::init();
+
+    // From here on we're a thread, and can be preempted
+    kernel::sched::init(&localAPIC);
+    out << "Scheduler is running\n";
+
+    size_t cpusOnline = kernel::smp::startAPs();
+    out << "Processors online: " << cpusOnline << "\n";
+    BOOT_MARK(BOOT_MARK_CPUS_ONLINE)
+
+    kernel::deferred::init();
+
+    // From here on lines logged go through the per-processor rings
+    kernel::log::init();
+
+    if (kernel::proc::init())
+    {
+        const int32_t pid = kernel::proc::spawn("INIT.ELF");
+        if (pid > 0)
+            LOG_INFO << "Started INIT.ELF as process " << pid;
+    }
+    else
+        LOG_WARNING << "No disk to run programs from";
+    BOOT_MARK(BOOT_MARK_INIT)
+
+#ifdef KERNEL_BENCHMARKS
+    kernel::bench::runSchedulerBenchmarks();
+    kernel::bench::runSyncBenchmarks();
+    kernel::bench::runSyscallBenchmarks();
+    kernel::bench::runIPCBenchmarks();
+    kernel::bench::runFutexBenchmarks();
+    kernel::bench::runIORingBenchmarks();
+    kernel::bench::runVFSBenchmarks();
+#endif
+#ifdef LOCK_PROFILING
+    kernel::sync::printLockStats();
+#endif
+
+    finishBootBenchmark();
     BOCHS_STOP
-    __asm__ __volatile__ ("int $0x34");
+
+    // Nothing left for kmain to do, the other threads carry on
+    kernel::sched::exitThread();
     
     /*
     // Try to find ACPI headers
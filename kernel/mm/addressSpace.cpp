@@ -0,0 +1,582 @@
+/**
+ * @file addressSpace.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from addressSpace.hpp
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/system/tlb.hpp>
+#include <earlyLib/memory.hpp>
+#include <klib/string.h>
+
+using namespace kernel::mm;
+
+static const uint32_t USER_FIRST_PDE =      USER_SPACE_START / LARGE_PAGE_SIZE;
+static const uint32_t USER_END_PDE =        USER_SPACE_END / LARGE_PAGE_SIZE;
+
+static inline uint32_t* tableOf(uint32_t entry)
+{
+    return static_cast<uint32_t*>(frameAddress(entry & PAGE_MASK));
+}
+
+static inline bool aligned(uint32_t address)
+{
+    return (address & ~PAGE_MASK) == 0;
+}
+
+/**
+ * @brief Page table entry bits for a page of a region. Pages of an object
+ * are mapped read-only while they're shared, whatever the region says
+ * 
+ */
+static inline uint32_t entryFlags(const region* r, bool shared)
+{
+    uint32_t flags = PTE_PRESENT | PTE_USER;
+    if ((r->flags & REGION_WRITE) && !shared)
+        flags |= PTE_WRITE;
+    return flags;
+}
+
+/**========================================================================
+ *                           memoryObject
+ *========================================================================**/
+
+memoryObject* memoryObject::create(size_t pages)
+{
+    memoryObject* object = new memoryObject;
+    if (object == nullptr)
+        return nullptr;
+
+    object->_frames = new uint32_t[pages != 0 ? pages : 1];
+    if (object->_frames == nullptr)
+    {
+        delete object;
+        return nullptr;
+    }
+
+    for (; object->_pages < pages; object->_pages++)
+    {
+        const uint32_t frame = allocateZeroedFrame();
+        if (frame == 0)
+        {
+            object->put();
+            return nullptr;
+        }
+        object->_frames[object->_pages] = frame;
+    }
+    return object;
+}
+
+memoryObject* memoryObject::createPaged(size_t pages, const pager* source, void* owner)
+{
+    memoryObject* object = new memoryObject;
+    if (object == nullptr)
+        return nullptr;
+    object->_pages = pages;
+    object->_pager = source;
+    object->_owner = owner;
+    return object;
+}
+
+void memoryObject::put()
+{
+    if (__atomic_sub_fetch(&_references,1,__ATOMIC_ACQ_REL) != 0)
+        return;
+
+    if (_pager != nullptr)
+        _pager->release(_owner);
+    else
+    {
+        for (size_t i = 0; i < _pages; i++)
+            putFrame(_frames[i]);
+        delete[] _frames;
+    }
+    delete this;
+}
+
+/**========================================================================
+ *                           addressSpace
+ *========================================================================**/
+
+addressSpace* addressSpace::create()
+{
+    addressSpace* space = new addressSpace;
+    if (space == nullptr)
+        return nullptr;
+
+    space->_directory = allocateZeroedFrame();
+    if (space->_directory == 0)
+    {
+        delete space;
+        return nullptr;
+    }
+
+    // Kernel entries never change, so copying them once is enough
+    uint32_t* directory = tableOf(space->_directory);
+    const uint32_t* kernelEntries = tableOf(kernelDirectory());
+    for (uint32_t i = 0; i < ENTRIES_PER_TABLE; i++)
+    {
+        if (i < USER_FIRST_PDE || i >= USER_END_PDE)
+            directory[i] = kernelEntries[i];
+    }
+    return space;
+}
+
+void addressSpace::destroy()
+{
+    uint32_t* directory = tableOf(_directory);
+    for (uint32_t i = USER_FIRST_PDE; i < USER_END_PDE; i++)
+    {
+        if (!(directory[i] & PTE_PRESENT))
+            continue;
+
+        uint32_t* table = tableOf(directory[i]);
+        for (uint32_t j = 0; j < ENTRIES_PER_TABLE; j++)
+        {
+            if (table[j] & PTE_PRESENT)
+                putFrame(table[j] & PAGE_MASK);
+        }
+        putFrame(directory[i] & PAGE_MASK);
+    }
+    putFrame(_directory);
+
+    while (_regions != nullptr)
+    {
+        region* r = _regions;
+        _regions = r->next;
+        if (r->object != nullptr)
+            r->object->put();
+        delete r;
+    }
+    delete this;
+}
+
+/**
+ * @brief Region holding an address. Lock held
+ * 
+ */
+region* addressSpace::find(uint32_t address)
+{
+    for (region* r = _regions; r != nullptr && r->start <= address; r = r->next)
+    {
+        if (address < r->end)
+            return r;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Page table entry of an address. Lock held
+ * 
+ * @param create Allocate the page table if it isn't there
+ * @return uint32_t* nullptr if there's no page table (or no memory for it)
+ */
+uint32_t* addressSpace::walk(uint32_t address, bool create)
+{
+    uint32_t* directory = tableOf(_directory);
+    uint32_t& entry = directory[address / LARGE_PAGE_SIZE];
+    if (!(entry & PTE_PRESENT))
+    {
+        if (!create)
+            return nullptr;
+        const uint32_t table = allocateZeroedFrame();
+        if (table == 0)
+            return nullptr;
+        // Page table entries decide what's allowed
+        entry = table | PTE_PRESENT | PTE_WRITE | PTE_USER;
+    }
+    return tableOf(entry) + (address / PAGE_SIZE) % ENTRIES_PER_TABLE;
+}
+
+/**
+ * @brief Unmap every page of a range, on every processor. Lock held
+ * 
+ */
+void addressSpace::unmapRange(uint32_t start, uint32_t end)
+{
+    // Entries are cleared but keep their frame until every processor has
+    // forgotten them, then the frames go
+    kernel::tlb::shootdownBatch batch(_directory);
+    for (uint32_t address = start; address < end; address += PAGE_SIZE)
+    {
+        uint32_t* entry = walk(address,false);
+        if (entry == nullptr)
+        {
+            // Skip the rest of the missing page table
+            address = (address & ~(LARGE_PAGE_SIZE - 1)) + LARGE_PAGE_SIZE - PAGE_SIZE;
+            continue;
+        }
+        if (*entry & PTE_PRESENT)
+        {
+            batch.add(address);
+            *entry &= PAGE_MASK;
+        }
+    }
+    batch.flush();
+
+    for (uint32_t address = start; address < end; address += PAGE_SIZE)
+    {
+        uint32_t* entry = walk(address,false);
+        if (entry == nullptr)
+        {
+            address = (address & ~(LARGE_PAGE_SIZE - 1)) + LARGE_PAGE_SIZE - PAGE_SIZE;
+            continue;
+        }
+        if (*entry != 0)
+        {
+            putFrame(*entry & PAGE_MASK);
+            *entry = 0;
+        }
+    }
+}
+
+bool addressSpace::addRegion(uint32_t start, uint32_t end, uint32_t flags,
+            memoryObject* object, uint32_t objectOffset, uint32_t backedEnd)
+{
+    if (!aligned(start) || !aligned(end) || start >= end || !aligned(objectOffset) ||
+            start < USER_SPACE_START || end > USER_SPACE_END)
+        return false;
+
+    if (object != nullptr)
+    {
+        // Every backed page must be in the object
+        if (backedEnd < start || backedEnd > end)
+            return false;
+        const uint32_t backedPages = (backedEnd - start + PAGE_SIZE - 1) / PAGE_SIZE;
+        if (objectOffset / PAGE_SIZE > object->pages() ||
+                backedPages > object->pages() - objectOffset / PAGE_SIZE)
+            return false;
+    }
+    else
+        backedEnd = start;
+
+    region* r = new region;
+    if (r == nullptr)
+        return false;
+    *r = {start,end,flags,object,objectOffset,backedEnd,nullptr};
+
+    const uint32_t lockFlags = _lock.lockIrqSave();
+    region** link = &_regions;
+    while (*link != nullptr && (*link)->end <= start)
+        link = &(*link)->next;
+    if (*link != nullptr && (*link)->start < end)
+    {
+        _lock.unlockIrqRestore(lockFlags);
+        delete r;
+        return false;
+    }
+    r->next = *link;
+    *link = r;
+    if (object != nullptr)
+        object->get();
+    _lock.unlockIrqRestore(lockFlags);
+    return true;
+}
+
+bool addressSpace::removeRegion(uint32_t start)
+{
+    const uint32_t lockFlags = _lock.lockIrqSave();
+    region** link = &_regions;
+    while (*link != nullptr && (*link)->start < start)
+        link = &(*link)->next;
+    region* r = *link;
+    if (r == nullptr || r->start != start)
+    {
+        _lock.unlockIrqRestore(lockFlags);
+        return false;
+    }
+    *link = r->next;
+    unmapRange(r->start,r->end);
+    _lock.unlockIrqRestore(lockFlags);
+
+    if (r->object != nullptr)
+        r->object->put();
+    delete r;
+    return true;
+}
+
+bool addressSpace::handleFault(uint32_t address, bool write)
+{
+    const uint32_t page = address & PAGE_MASK;
+
+    // A page of the object might have to be brought in first, without the
+    // lock, and then everything is looked at again
+    while (true)
+    {
+        const uint32_t lockFlags = _lock.lockIrqSave();
+
+        region* r = find(page);
+        uint32_t* entry = nullptr;
+        if (r == nullptr || (write && !(r->flags & REGION_WRITE)) ||
+                (entry = walk(page,true)) == nullptr)
+        {
+            _lock.unlockIrqRestore(lockFlags);
+            return false;
+        }
+
+        bool mapped = true;
+        if (*entry & PTE_PRESENT)
+        {
+            // Only a write to a shared page needs anything done: copy it. Any
+            // other fault on a present page is a stale TLB entry
+            const uint32_t shared = *entry & PAGE_MASK;
+            if (write && !(*entry & PTE_WRITE) && frameReferences(shared) == 1)
+            {
+                // Nobody else has it anymore (the object is gone), no need to copy
+                *entry |= PTE_WRITE;
+                kernel::tlb::invalidatePage(page);
+            }
+            else if (write && !(*entry & PTE_WRITE))
+            {
+                const uint32_t copy = allocateFrame();
+                if (copy != 0)
+                {
+                    memcpy(frameAddress(copy),frameAddress(shared),PAGE_SIZE);
+                    *entry = copy | entryFlags(r,false);
+                    kernel::tlb::shootdownBatch batch(_directory);
+                    batch.add(page);
+                    batch.flush();
+                    putFrame(shared);
+                }
+                else
+                    mapped = false;
+            }
+            else
+                kernel::tlb::invalidatePage(page);
+        }
+        else if (r->object != nullptr && page < r->backedEnd)
+        {
+            const size_t index = (r->objectOffset + page - r->start) / PAGE_SIZE;
+            const uint32_t shared = r->object->findPage(index);
+            if (shared == 0)
+            {
+                memoryObject* object = r->object;
+                object->get();
+                _lock.unlockIrqRestore(lockFlags);
+
+                const uint32_t loaded = object->loadPage(index);
+                object->put();
+                if (loaded == 0)
+                    return false;
+                // It's cached now. If it's reclaimed before we're back, it
+                // just gets loaded again
+                putFrame(loaded);
+                continue;
+            }
+
+            if (page + PAGE_SIZE > r->backedEnd)
+            {
+                // Zero filled, but for the end of the file at the start
+                const uint32_t frame = allocateZeroedFrame();
+                if (frame != 0)
+                {
+                    memcpy(frameAddress(frame),frameAddress(shared),r->backedEnd - page);
+                    *entry = frame | entryFlags(r,false);
+                }
+                else
+                    mapped = false;
+                putFrame(shared);
+            }
+            else if (r->flags & REGION_SHARED)
+            {
+                // Everyone writes to the same page
+                *entry = shared | entryFlags(r,false);
+            }
+            else if (write)
+            {
+                // Would be copied on the next fault anyway
+                const uint32_t copy = allocateFrame();
+                if (copy != 0)
+                {
+                    memcpy(frameAddress(copy),frameAddress(shared),PAGE_SIZE);
+                    *entry = copy | entryFlags(r,false);
+                }
+                else
+                    mapped = false;
+                putFrame(shared);
+            }
+            else
+                *entry = shared | entryFlags(r,true);
+        }
+        else
+        {
+            const uint32_t frame = allocateZeroedFrame();
+            if (frame != 0)
+                *entry = frame | entryFlags(r,false);
+            else
+                mapped = false;
+        }
+
+        _lock.unlockIrqRestore(lockFlags);
+        return mapped;
+    }
+}
+
+bool addressSpace::checkRange(uint32_t address, size_t length, bool write)
+{
+    if (length == 0)
+        return true;
+    if (address < USER_SPACE_START || address >= USER_SPACE_END ||
+            length > USER_SPACE_END - address)
+        return false;
+
+    const uint32_t last = address + static_cast<uint32_t>(length) - 1;
+    const uint32_t lockFlags = _lock.lockIrqSave();
+    bool valid = true;
+    for (uint32_t page = address & PAGE_MASK; valid; page += PAGE_SIZE)
+    {
+        const region* r = find(page);
+        if (r == nullptr || (write && !(r->flags & REGION_WRITE)))
+            valid = false;
+        // The region covers up to its end, jump there
+        else if (r->end - 1 >= last)
+            break;
+        else
+            page = r->end - PAGE_SIZE;
+    }
+    _lock.unlockIrqRestore(lockFlags);
+    return valid;
+}
+
+uint32_t addressSpace::lendPage(uint32_t address)
+{
+    if (!aligned(address))
+        return 0;
+
+    // Once to see if it's there, once more after faulting it in
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        const uint32_t lockFlags = _lock.lockIrqSave();
+        const region* r = find(address);
+        if (r == nullptr || (r->flags & REGION_SHARED))
+        {
+            _lock.unlockIrqRestore(lockFlags);
+            return 0;
+        }
+
+        uint32_t* entry = walk(address,false);
+        if (entry != nullptr && (*entry & PTE_PRESENT))
+        {
+            const uint32_t frame = *entry & PAGE_MASK;
+            getFrame(frame);
+            if (*entry & PTE_WRITE)
+            {
+                *entry &= ~PTE_WRITE;
+                kernel::tlb::shootdownBatch batch(_directory);
+                batch.add(address);
+                batch.flush();
+            }
+            _lock.unlockIrqRestore(lockFlags);
+            return frame;
+        }
+        _lock.unlockIrqRestore(lockFlags);
+
+        if (!handleFault(address,false))
+            return 0;
+    }
+    return 0;
+}
+
+bool addressSpace::insertPage(uint32_t address, uint32_t frame)
+{
+    if (!aligned(address))
+        return false;
+
+    const uint32_t lockFlags = _lock.lockIrqSave();
+    const region* r = find(address);
+    uint32_t* entry = nullptr;
+    if (r == nullptr || !(r->flags & REGION_WRITE) || (r->flags & REGION_SHARED) ||
+            (entry = walk(address,true)) == nullptr)
+    {
+        _lock.unlockIrqRestore(lockFlags);
+        return false;
+    }
+
+    const uint32_t old = *entry;
+    *entry = frame | entryFlags(r,frameReferences(frame) != 1);
+    if (old & PTE_PRESENT)
+    {
+        kernel::tlb::shootdownBatch batch(_directory);
+        batch.add(address);
+        batch.flush();
+        putFrame(old & PAGE_MASK);
+    }
+    _lock.unlockIrqRestore(lockFlags);
+    return true;
+}
+
+uint32_t addressSpace::findFreeRange(size_t length, uint32_t from, uint32_t to)
+{
+    if (length == 0 || !aligned(from) || from >= to)
+        return 0;
+
+    const uint32_t lockFlags = _lock.lockIrqSave();
+    uint32_t candidate = from;
+    for (const region* r = _regions; r != nullptr; r = r->next)
+    {
+        if (r->end <= candidate)
+            continue;
+        // Sorted, so if it fits before this one it fits
+        if (r->start >= candidate && r->start - candidate >= length)
+            break;
+        candidate = r->end;
+    }
+    _lock.unlockIrqRestore(lockFlags);
+
+    if (candidate >= to || length > to - candidate)
+        return 0;
+    return candidate;
+}
+
+memoryObject* addressSpace::sharedObject(uint32_t address, uint32_t* offset)
+{
+    const uint32_t lockFlags = _lock.lockIrqSave();
+    const region* r = find(address);
+    memoryObject* object = nullptr;
+    if (r != nullptr && (r->flags & REGION_SHARED) && r->object != nullptr &&
+            address < r->backedEnd)
+    {
+        object = r->object;
+        object->get();
+        *offset = r->objectOffset + address - r->start;
+    }
+    _lock.unlockIrqRestore(lockFlags);
+    return object;
+}
+
+uint32_t addressSpace::physicalAddress(uint32_t address)
+{
+    const uint32_t page = address & PAGE_MASK;
+
+    // Once to see if it's there, once more after faulting it in
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        const uint32_t lockFlags = _lock.lockIrqSave();
+        const region* r = find(page);
+        if (r == nullptr)
+        {
+            _lock.unlockIrqRestore(lockFlags);
+            return 0;
+        }
+
+        const bool write = r->flags & REGION_WRITE;
+        const uint32_t* entry = walk(page,false);
+        if (entry != nullptr && (*entry & PTE_PRESENT) && (!write || (*entry & PTE_WRITE)))
+        {
+            const uint32_t frame = *entry & PAGE_MASK;
+            getFrame(frame);
+            _lock.unlockIrqRestore(lockFlags);
+            return frame | (address & ~PAGE_MASK);
+        }
+        _lock.unlockIrqRestore(lockFlags);
+
+        if (!handleFault(page,write))
+            return 0;
+    }
+    return 0;
+}
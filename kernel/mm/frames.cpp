@@ -0,0 +1,147 @@
+/**
+ * @file frames.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from frames.hpp
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/mm/frames.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <klib/string.h>
+#include <klib/cstdlib.hpp>
+
+using namespace kernel::mm;
+
+// Free frames are a stack, linked through their first word
+static kernel::sync::spinlock frameLock;
+static uint32_t freeList = 0;
+static size_t freeCount = 0;
+
+// Managed range, and a reference count for each of its frames
+static uint32_t firstFrame = 0;
+static size_t frameCount = 0;
+static uint16_t* references = nullptr;
+
+// Told when allocations take the free count below lowWater
+static size_t lowWater = 0;
+static void (*lowMemoryHandler)() = nullptr;
+
+static inline size_t frameIndex(uint32_t frame)
+{
+    if (frame < firstFrame || (frame & ~PAGE_MASK) != 0 ||
+            (frame - firstFrame) / PAGE_SIZE >= frameCount)
+        earlyPanic("mm: bad frame address");
+    return (frame - firstFrame) / PAGE_SIZE;
+}
+
+void kernel::mm::initFrames(uint32_t start, uint32_t end)
+{
+    start = (start + PAGE_SIZE - 1) & PAGE_MASK;
+    if (end > DIRECT_MAP_END)
+        end = DIRECT_MAP_END;
+    end &= PAGE_MASK;
+    if (end <= start)
+        return;
+
+    // The counts go first, the frames after them
+    const size_t pages = (end - start) / PAGE_SIZE;
+    const size_t countPages = (pages * sizeof(uint16_t) + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (countPages >= pages)
+        return;
+
+    references = reinterpret_cast<uint16_t*>(start);
+    firstFrame = start + static_cast<uint32_t>(countPages) * PAGE_SIZE;
+    frameCount = pages - countPages;
+    memset(references,0,frameCount * sizeof(uint16_t));
+
+    // Pushed from the top, so allocations come out lowest first
+    for (size_t i = frameCount; i > 0; i--)
+    {
+        const uint32_t frame = firstFrame + static_cast<uint32_t>(i - 1) * PAGE_SIZE;
+        *static_cast<uint32_t*>(frameAddress(frame)) = freeList;
+        freeList = frame;
+    }
+    freeCount = frameCount;
+}
+
+uint32_t kernel::mm::allocateFrame()
+{
+    const uint32_t flags = frameLock.lockIrqSave();
+    const uint32_t frame = freeList;
+    if (frame != 0)
+    {
+        freeList = *static_cast<uint32_t*>(frameAddress(frame));
+        freeCount--;
+        references[frameIndex(frame)] = 1;
+    }
+    const bool low = freeCount < lowWater;
+    frameLock.unlockIrqRestore(flags);
+
+    if (low)
+    {
+        void (*handler)() = __atomic_load_n(&lowMemoryHandler,__ATOMIC_ACQUIRE);
+        if (handler != nullptr)
+            handler();
+    }
+    return frame;
+}
+
+uint32_t kernel::mm::allocateZeroedFrame()
+{
+    const uint32_t frame = allocateFrame();
+    if (frame != 0)
+        memset(frameAddress(frame),0,PAGE_SIZE);
+    return frame;
+}
+
+void kernel::mm::getFrame(uint32_t frame)
+{
+    const uint32_t flags = frameLock.lockIrqSave();
+    const size_t index = frameIndex(frame);
+    if (references[index] == 0 || references[index] == UINT16_MAX)
+        earlyPanic("mm: getFrame() on a free or saturated frame");
+    references[index]++;
+    frameLock.unlockIrqRestore(flags);
+}
+
+void kernel::mm::putFrame(uint32_t frame)
+{
+    const uint32_t flags = frameLock.lockIrqSave();
+    const size_t index = frameIndex(frame);
+    if (references[index] == 0)
+        earlyPanic("mm: putFrame() on a free frame");
+    if (--references[index] == 0)
+    {
+        *static_cast<uint32_t*>(frameAddress(frame)) = freeList;
+        freeList = frame;
+        freeCount++;
+    }
+    frameLock.unlockIrqRestore(flags);
+}
+
+uint32_t kernel::mm::frameReferences(uint32_t frame)
+{
+    return __atomic_load_n(references + frameIndex(frame),__ATOMIC_RELAXED);
+}
+
+void kernel::mm::setLowMemoryHandler(size_t mark, void (*handler)())
+{
+    const uint32_t flags = frameLock.lockIrqSave();
+    lowWater = mark;
+    __atomic_store_n(&lowMemoryHandler,handler,__ATOMIC_RELEASE);
+    frameLock.unlockIrqRestore(flags);
+}
+
+size_t kernel::mm::freeFrames()
+{
+    return freeCount;
+}
+
+size_t kernel::mm::totalFrames()
+{
+    return frameCount;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file paging.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from paging.hpp, and the page fault handler
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/mm/paging.hpp>
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/devices/cpu/cpuid.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <kernelInternal/system/tlb.hpp>
+#include <kernelInternal/sched/preempt.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <klib/io.hpp>
+#include <klib/cstdlib.hpp>
+
+using namespace kernel::mm;
+
+static const uint32_t CR0_WP =              1u << 16;
+static const uint32_t CR0_PG =              1u << 31;
+static const uint32_t CR4_PSE =             1u << 4;
+static const uint32_t CR4_PGE =             1u << 7;
+
+// Page fault error code
+static const uint32_t FAULT_WRITE =         0x2;
+static const uint32_t FAULT_USER =          0x4;
+
+// Directory entries of the identity map, below and above user space
+static const uint32_t USER_FIRST_PDE =      USER_SPACE_START / LARGE_PAGE_SIZE;
+static const uint32_t USER_END_PDE =        USER_SPACE_END / LARGE_PAGE_SIZE;
+
+static_assert(USER_SPACE_START == DIRECT_MAP_END, "The identity map would overlap user space");
+static_assert(USER_SPACE_START == kernel::syscall::USER_SPACE_START &&
+        USER_SPACE_END == kernel::syscall::USER_SPACE_END, "System calls check the wrong range");
+
+// Every address space copies the kernel entries from here, and they never
+// change after init()
+alignas(PAGE_SIZE) static uint32_t kernelPageDirectory[ENTRIES_PER_TABLE];
+
+// First 4 MiB, in 4 KiB pages, so the kernel binary's user pages can be
+// told apart
+alignas(PAGE_SIZE) static uint32_t lowPageTable[ENTRIES_PER_TABLE];
+
+static uint32_t cr4Bits = 0;
+static bool pagingEnabled = false;
+
+static inline uint32_t readCR0()
+{
+    uint32_t value;
+    __asm__ __volatile__ ("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void writeCR0(uint32_t value)
+{
+    __asm__ __volatile__ ("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+static inline uint32_t readCR4()
+{
+    uint32_t value;
+    __asm__ __volatile__ ("mov %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+static inline void writeCR4(uint32_t value)
+{
+    __asm__ __volatile__ ("mov %0, %%cr4" : : "r"(value) : "memory");
+}
+
+static inline void loadDirectory(uint32_t cr3)
+{
+    __asm__ __volatile__ ("mov %0, %%cr3" : : "r"(cr3) : "memory");
+}
+
+static inline bool inRange(uint32_t address, const uint8_t* start, const uint8_t* end)
+{
+    return address >= reinterpret_cast<uint32_t>(start) && address < reinterpret_cast<uint32_t>(end);
+}
+
+/**
+ * @brief Identity map the kernel's part of the address space
+ * 
+ */
+static void buildKernelDirectory(uint32_t global)
+{
+    if (reinterpret_cast<uint32_t>(__userdata_end) > LARGE_PAGE_SIZE)
+        earlyPanic("mm: the kernel's user pages are past the first 4 MiB");
+
+    for (uint32_t i = 0; i < ENTRIES_PER_TABLE; i++)
+    {
+        const uint32_t address = i * PAGE_SIZE;
+        uint32_t entry = address | PTE_PRESENT | PTE_WRITE | global;
+        if (inRange(address,__usertext_start,__usertext_end))
+            entry = address | PTE_PRESENT | PTE_USER | global;
+        else if (inRange(address,__userdata_start,__userdata_end))
+            entry = address | PTE_PRESENT | PTE_WRITE | PTE_USER | global;
+        lowPageTable[i] = entry;
+    }
+
+    // The table decides, per page, what ring 3 gets
+    kernelPageDirectory[0] = reinterpret_cast<uint32_t>(lowPageTable) |
+            PTE_PRESENT | PTE_WRITE | PTE_USER;
+
+    for (uint32_t i = 1; i < ENTRIES_PER_TABLE; i++)
+    {
+        if (i >= USER_FIRST_PDE && i < USER_END_PDE)
+        {
+            kernelPageDirectory[i] = 0;
+            continue;
+        }
+
+        uint32_t entry = i * LARGE_PAGE_SIZE | PTE_PRESENT | PTE_WRITE | PTE_LARGE | global;
+        // Above user space there's only MMIO (local APIC, IO APIC, ...)
+        if (i >= USER_END_PDE)
+            entry |= PTE_CACHE_DISABLE | PTE_WRITE_THROUGH;
+        kernelPageDirectory[i] = entry;
+    }
+}
+
+static void enablePaging()
+{
+    writeCR4(readCR4() | cr4Bits);
+    kernel::tlb::setActiveAddressSpace(kernelDirectory());
+    loadDirectory(kernelDirectory());
+    writeCR0(readCR0() | CR0_PG | CR0_WP);
+}
+
+/**
+ * @brief Page faults. User addresses go to the current address space, which
+ * maps the page in if it can. Anything else kills a user thread, stops a
+ * userCopy(), or panics
+ * 
+ */
+static void pageFaultHandler(kernel::isr_frame_t* frame)
+{
+    const uint32_t address = faultAddress();
+    const bool write = frame->errorCode & FAULT_WRITE;
+    kernel::sched::thread* t = kernel::sched::currentThread();
+
+    if (address >= USER_SPACE_START && address < USER_SPACE_END && t != nullptr &&
+            t->space != nullptr && t->space->handleFault(address,write))
+        return;
+
+    // A page a copy needs that couldn't be brought in (out of memory, a disk
+    // error, or unmapped since it was checked): the copy stops there, and the
+    // system call fails
+    if (!(frame->errorCode & FAULT_USER) && address >= USER_SPACE_START &&
+            address < USER_SPACE_END && frame->eip == reinterpret_cast<uint32_t>(userCopyAccess))
+    {
+        frame->eip = reinterpret_cast<uint32_t>(userCopyFault);
+        return;
+    }
+
+    if (frame->errorCode & FAULT_USER)
+    {
+        out << "Page fault at 0x" << address << " (eip 0x" << frame->eip << ") in "
+            << (t != nullptr ? t->name : "?") << ", killing it\n";
+        // It leaves through the exit system call, on its way back to ring 3
+        frame->eip = reinterpret_cast<uint32_t>(userFaultExit);
+        return;
+    }
+
+    out << "Page fault at 0x" << address << " (eip 0x" << frame->eip << ", error 0x"
+        << frame->errorCode << ")\n";
+    earlyPanic("mm: page fault in the kernel");
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+void kernel::mm::init(uint32_t framesStart, uint32_t framesEnd)
+{
+    uint32_t eax,ebx,ecx,edx;
+    cpu::cpuid(1,&eax,&ebx,&ecx,&edx);
+    if (!(edx & static_cast<uint32_t>(cpu::cpuid_features::CPUID_FEAT_EDX_PSE)))
+        earlyPanic("mm: no 4 MiB pages on this processor");
+
+    cr4Bits = CR4_PSE;
+    uint32_t global = 0;
+    if (edx & static_cast<uint32_t>(cpu::cpuid_features::CPUID_FEAT_EDX_PGE))
+    {
+        cr4Bits |= CR4_PGE;
+        global = PTE_GLOBAL;
+    }
+
+    buildKernelDirectory(global);
+    initFrames(framesStart,framesEnd);
+    setInterruptHandler(PAGE_FAULT_VECTOR,&pageFaultHandler);
+
+    enablePaging();
+    pagingEnabled = true;
+}
+
+void kernel::mm::initCPU()
+{
+    enablePaging();
+}
+
+uint32_t kernel::mm::kernelDirectory()
+{
+    return reinterpret_cast<uint32_t>(kernelPageDirectory);
+}
+
+void kernel::mm::activate(addressSpace* space)
+{
+    if (!pagingEnabled)
+        return;
+
+    const uint32_t cr3 = space != nullptr ? space->directory() : kernelDirectory();
+    if (smp::thisCPU()->activeCR3 == cr3)
+        return;
+
+    // Shootdowns look at activeCR3, so it goes first
+    tlb::setActiveAddressSpace(cr3);
+    loadDirectory(cr3);
+}
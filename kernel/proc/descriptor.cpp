@@ -0,0 +1,371 @@
+/**
+ * @file descriptor.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from descriptor.hpp
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/proc/descriptor.hpp>
+#include <kernelInternal/proc/process.hpp>
+#include <kernelInternal/aio/ioRing.hpp>
+#include <kernelInternal/devices/bufferCache.hpp>
+#include <kernelInternal/fs/vfs.hpp>
+#include <kernelInternal/ipc/pipe.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <klib/io.hpp>
+#include <sys/fcntl.h>
+#include <sys/ioring.h>
+
+using namespace kernel::proc;
+
+// What threads without a process (kernel threads that dropped to ring 3) get
+static const descriptor console = {descriptorType::CONSOLE,nullptr,0,O_RDWR};
+static const descriptor closed = {descriptorType::NONE,nullptr,0,0};
+
+/**
+ * @brief Take a reference on what a descriptor refers to
+ * 
+ */
+static void reference(const descriptor* d)
+{
+    switch (d->type)
+    {
+    case descriptorType::PIPE_READ:
+    case descriptorType::PIPE_WRITE:
+        static_cast<kernel::ipc::pipe*>(d->object)->reference(d->type == descriptorType::PIPE_WRITE);
+        break;
+    case descriptorType::IO_RING:
+        static_cast<kernel::aio::ioRing*>(d->object)->get();
+        break;
+    case descriptorType::FILE:
+        kernel::vfs::getVnode(static_cast<kernel::vfs::vnode*>(d->object));
+        break;
+    case descriptorType::NONE:
+    case descriptorType::CONSOLE:
+    case descriptorType::BLOCK_DEVICE:  // Devices stay around forever
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Drop a reference on what a descriptor refers to
+ * 
+ * @param closing It's the table's own reference, the descriptor is being
+ * closed
+ */
+static void release(const descriptor* d, bool closing)
+{
+    switch (d->type)
+    {
+    case descriptorType::PIPE_READ:
+    case descriptorType::PIPE_WRITE:
+        static_cast<kernel::ipc::pipe*>(d->object)->close(d->type == descriptorType::PIPE_WRITE);
+        break;
+    case descriptorType::IO_RING:
+        // Its polling thread only works for the process while it has it open
+        if (closing)
+            static_cast<kernel::aio::ioRing*>(d->object)->shutdown();
+        static_cast<kernel::aio::ioRing*>(d->object)->put();
+        break;
+    case descriptorType::FILE:
+        kernel::vfs::putVnode(static_cast<kernel::vfs::vnode*>(d->object));
+        break;
+    case descriptorType::NONE:
+    case descriptorType::CONSOLE:
+    case descriptorType::BLOCK_DEVICE:
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Check that a buffer can be touched, the whole of it
+ * 
+ */
+static bool validBuffer(uint32_t buffer, size_t length, bool write)
+{
+    kernel::mm::addressSpace* space = kernel::sched::currentThread()->space;
+    return length == 0 || (space != nullptr && space->checkRange(buffer,length,write));
+}
+
+/**
+ * @brief Move the position of a descriptor, if it's still the same one
+ * 
+ */
+static void advance(int32_t fd, const descriptor* d, int32_t moved)
+{
+    process* p = kernel::sched::currentThread()->process;
+    if (p == nullptr || moved <= 0)
+        return;
+    p->descriptorLock.lock();
+    descriptor& current = p->descriptors[fd];
+    if (current.type == d->type && current.object == d->object)
+        current.position += static_cast<uint32_t>(moved);
+    p->descriptorLock.unlock();
+}
+
+/**
+ * @brief Put a descriptor somewhere else, if it's still the same one
+ * 
+ */
+static void moveTo(int32_t fd, const descriptor* d, uint64_t position)
+{
+    process* p = kernel::sched::currentThread()->process;
+    if (p == nullptr)
+        return;
+    p->descriptorLock.lock();
+    descriptor& current = p->descriptors[fd];
+    if (current.type == d->type && current.object == d->object)
+        current.position = position;
+    p->descriptorLock.unlock();
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+void kernel::proc::initDescriptors(process* p)
+{
+    for (descriptor& d : p->descriptors)
+        d = closed;
+    p->descriptors[STDIN] = console;
+    p->descriptors[STDOUT] = console;
+    p->descriptors[STDERR] = console;
+}
+
+void kernel::proc::closeDescriptors(process* p)
+{
+    for (descriptor& d : p->descriptors)
+    {
+        p->descriptorLock.lock();
+        const descriptor copy = d;
+        d = closed;
+        p->descriptorLock.unlock();
+        release(&copy,true);
+    }
+}
+
+int32_t kernel::proc::openDescriptor(descriptorType type, void* object, uint32_t flags)
+{
+    process* p = sched::currentThread()->process;
+    if (p == nullptr)
+        return -syscall::EBADF;
+
+    int32_t result = -syscall::EMFILE;
+    p->descriptorLock.lock();
+    for (size_t fd = 0; fd < MAX_DESCRIPTORS; fd++)
+    {
+        if (p->descriptors[fd].type == descriptorType::NONE)
+        {
+            p->descriptors[fd] = {type,object,0,flags};
+            result = static_cast<int32_t>(fd);
+            break;
+        }
+    }
+    p->descriptorLock.unlock();
+    return result;
+}
+
+int32_t kernel::proc::closeDescriptor(int32_t fd)
+{
+    process* p = sched::currentThread()->process;
+    if (p == nullptr || fd < 0 || static_cast<size_t>(fd) >= MAX_DESCRIPTORS)
+        return -syscall::EBADF;
+
+    // Off the table before it goes, in case closing sleeps
+    p->descriptorLock.lock();
+    const descriptor d = p->descriptors[fd];
+    p->descriptors[fd] = closed;
+    p->descriptorLock.unlock();
+
+    if (d.type == descriptorType::NONE)
+        return -syscall::EBADF;
+    release(&d,true);
+    return 0;
+}
+
+bool kernel::proc::getDescriptor(int32_t fd, descriptor* d)
+{
+    process* p = sched::currentThread()->process;
+    if (p == nullptr)
+    {
+        if (fd != STDOUT && fd != STDERR)
+            return false;
+        *d = console;
+        return true;
+    }
+    if (fd < 0 || static_cast<size_t>(fd) >= MAX_DESCRIPTORS)
+        return false;
+
+    // Taking a reference never sleeps
+    p->descriptorLock.lock();
+    *d = p->descriptors[fd];
+    reference(d);
+    p->descriptorLock.unlock();
+    return d->type != descriptorType::NONE;
+}
+
+void kernel::proc::putDescriptor(const descriptor* d)
+{
+    release(d,false);
+}
+
+int32_t kernel::proc::descriptorRead(const descriptor* d, uint32_t buffer, size_t length,
+            uint64_t offset)
+{
+    if (!validBuffer(buffer,length,true))
+        return -syscall::EFAULT;
+
+    switch (d->type)
+    {
+    case descriptorType::CONSOLE:
+        return 0; // No keyboard yet
+    case descriptorType::PIPE_READ:
+        return static_cast<ipc::pipe*>(d->object)->read(reinterpret_cast<void*>(buffer),length);
+    case descriptorType::BLOCK_DEVICE:
+        return block::readDevice(static_cast<const block::blockDevice*>(d->object),offset,
+                reinterpret_cast<void*>(buffer),length);
+    case descriptorType::FILE:
+        if ((d->flags & O_ACCMODE) == O_WRONLY)
+            return -syscall::EBADF;
+        return vfs::read(static_cast<vfs::vnode*>(d->object),offset,reinterpret_cast<void*>(buffer),
+                length);
+    case descriptorType::NONE:
+    case descriptorType::PIPE_WRITE:
+    case descriptorType::IO_RING:
+    default:
+        return -syscall::EBADF;
+    }
+}
+
+int32_t kernel::proc::descriptorWrite(const descriptor* d, uint32_t buffer, size_t length,
+            uint64_t offset)
+{
+    if (!validBuffer(buffer,length,false))
+        return -syscall::EFAULT;
+
+    switch (d->type)
+    {
+    case descriptorType::CONSOLE:
+        out.writeString(reinterpret_cast<const char*>(buffer),length);
+        return static_cast<int32_t>(length);
+    case descriptorType::PIPE_WRITE:
+        return static_cast<ipc::pipe*>(d->object)->write(reinterpret_cast<const void*>(buffer),length);
+    case descriptorType::BLOCK_DEVICE:
+        return block::writeDevice(static_cast<const block::blockDevice*>(d->object),offset,
+                reinterpret_cast<const void*>(buffer),length);
+    case descriptorType::FILE:
+        if ((d->flags & O_ACCMODE) == O_RDONLY)
+            return -syscall::EBADF;
+        // Not atomic against other writers yet, each one just goes where
+        // the end was when it started
+        if (d->flags & O_APPEND)
+            offset = static_cast<vfs::vnode*>(d->object)->size;
+        return vfs::write(static_cast<vfs::vnode*>(d->object),offset,
+                reinterpret_cast<const void*>(buffer),length);
+    case descriptorType::NONE:
+    case descriptorType::PIPE_READ:
+    case descriptorType::IO_RING:
+    default:
+        return -syscall::EBADF;
+    }
+}
+
+int32_t kernel::proc::descriptorSync(const descriptor* d)
+{
+    switch (d->type)
+    {
+    case descriptorType::CONSOLE:
+    case descriptorType::PIPE_WRITE:
+        return 0; // Nothing is held back
+    case descriptorType::FILE:
+        return vfs::sync(static_cast<vfs::vnode*>(d->object));
+    case descriptorType::BLOCK_DEVICE:
+        return block::syncDevice(static_cast<const block::blockDevice*>(d->object));
+    case descriptorType::NONE:
+    case descriptorType::PIPE_READ:
+    case descriptorType::IO_RING:
+    default:
+        return -syscall::EINVAL;
+    }
+}
+
+uint32_t kernel::proc::descriptorPoll(const descriptor* d, uint32_t events, bool wait)
+{
+    switch (d->type)
+    {
+    case descriptorType::CONSOLE:
+        return events & POLLOUT; // Never anything to read, so no waiting for it
+    case descriptorType::PIPE_READ:
+        return static_cast<ipc::pipe*>(d->object)->poll(events & POLLIN,wait);
+    case descriptorType::PIPE_WRITE:
+        return static_cast<ipc::pipe*>(d->object)->poll(events & POLLOUT,wait);
+    case descriptorType::BLOCK_DEVICE:
+    case descriptorType::FILE:
+        return events & (POLLIN | POLLOUT);
+    case descriptorType::NONE:
+    case descriptorType::IO_RING:
+    default:
+        return 0;
+    }
+}
+
+int32_t kernel::proc::readDescriptor(int32_t fd, uint32_t buffer, size_t length)
+{
+    descriptor d;
+    if (!getDescriptor(fd,&d))
+        return -syscall::EBADF;
+    const int32_t result = descriptorRead(&d,buffer,length,d.position);
+    if (d.type == descriptorType::BLOCK_DEVICE || d.type == descriptorType::FILE)
+        advance(fd,&d,result);
+    putDescriptor(&d);
+    return result;
+}
+
+int32_t kernel::proc::writeDescriptor(int32_t fd, uint32_t buffer, size_t length)
+{
+    descriptor d;
+    if (!getDescriptor(fd,&d))
+        return -syscall::EBADF;
+    const int32_t result = descriptorWrite(&d,buffer,length,d.position);
+    if (d.type == descriptorType::BLOCK_DEVICE || d.type == descriptorType::FILE)
+        advance(fd,&d,result);
+    putDescriptor(&d);
+    return result;
+}
+
+int32_t kernel::proc::readDirectoryDescriptor(int32_t fd, uint32_t buffer, size_t length)
+{
+    descriptor d;
+    if (!getDescriptor(fd,&d))
+        return -syscall::EBADF;
+
+    int32_t result = -syscall::ENOTDIR;
+    if (d.type == descriptorType::FILE)
+    {
+        // The position is the filesystem's cursor, not a byte offset
+        uint32_t cursor = static_cast<uint32_t>(d.position);
+        result = validBuffer(buffer,length,true) ? vfs::readDirectory(static_cast<vfs::vnode*>(
+                d.object),&cursor,reinterpret_cast<void*>(buffer),length) : -syscall::EFAULT;
+        if (result > 0)
+            moveTo(fd,&d,cursor);
+    }
+    putDescriptor(&d);
+    return result;
+}
+
+int32_t kernel::proc::syncDescriptor(int32_t fd)
+{
+    descriptor d;
+    if (!getDescriptor(fd,&d))
+        return -syscall::EBADF;
+    const int32_t result = descriptorSync(&d);
+    putDescriptor(&d);
+    return result;
+}
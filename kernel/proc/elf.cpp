@@ -0,0 +1,347 @@
+/**
+ * @file elf.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from elf.hpp
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/proc/elf.hpp>
+#include <kernelInternal/proc/process.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <earlyLib/memory.hpp>
+#include <klib/string.h>
+#include <sys/elf.h>
+
+using namespace kernel::proc;
+using kernel::mm::PAGE_SIZE;
+using kernel::mm::PAGE_MASK;
+
+static kernel::sync::spinlock cacheLock;
+static image* cache = nullptr;
+
+/**========================================================================
+ *                           Validation
+ *========================================================================**/
+
+/**
+ * @brief Check the ELF header: a static i386 executable, with its program
+ * headers inside the file
+ * 
+ */
+static bool validHeader(const elf32_Ehdr* header, size_t fileSize)
+{
+    if (header->e_ident[EI_MAG0] != ELFMAG0 || header->e_ident[EI_MAG1] != ELFMAG1 ||
+            header->e_ident[EI_MAG2] != ELFMAG2 || header->e_ident[EI_MAG3] != ELFMAG3 ||
+            header->e_ident[EI_CLASS] != ELFCLASS32 || header->e_ident[EI_DATA] != ELFDATA2LSB ||
+            header->e_ident[EI_VERSION] != EV_CURRENT)
+        return false;
+
+    if (header->e_type != ET_EXEC || header->e_machine != EM_386 ||
+            header->e_version != EV_CURRENT || header->e_phentsize != sizeof(elf32_Phdr) ||
+            header->e_phnum == 0 || header->e_phnum > MAX_PROGRAM_HEADERS)
+        return false;
+
+    const uint64_t tableEnd = static_cast<uint64_t>(header->e_phoff) +
+            static_cast<uint64_t>(header->e_phnum) * sizeof(elf32_Phdr);
+    return tableEnd <= fileSize;
+}
+
+/**
+ * @brief Check the program headers, and keep the loadable segments. Every
+ * segment must be inside the file and inside user space, below the stack,
+ * and no two can share a page
+ * 
+ */
+static bool validSegments(const elf32_Phdr* headers, size_t count, size_t fileSize,
+            uint32_t entry, image* program)
+{
+    program->segmentCount = 0;
+    bool entryFound = false;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const elf32_Phdr* ph = headers + i;
+        // Static executables only
+        if (ph->p_type == PT_DYNAMIC || ph->p_type == PT_INTERP)
+            return false;
+        if (ph->p_type != PT_LOAD || ph->p_memsz == 0)
+            continue;
+
+        if (program->segmentCount == MAX_SEGMENTS || ph->p_filesz > ph->p_memsz ||
+                static_cast<uint64_t>(ph->p_offset) + ph->p_filesz > fileSize ||
+                (ph->p_vaddr & ~PAGE_MASK) != (ph->p_offset & ~PAGE_MASK))
+            return false;
+
+        const uint64_t end = static_cast<uint64_t>(ph->p_vaddr) + ph->p_memsz;
+        if (ph->p_vaddr < kernel::mm::USER_SPACE_START || end > USER_IMAGE_END)
+            return false;
+
+        const uint32_t firstPage = ph->p_vaddr & PAGE_MASK;
+        const uint32_t endPage = (static_cast<uint32_t>(end) + PAGE_SIZE - 1) & PAGE_MASK;
+        for (size_t j = 0; j < program->segmentCount; j++)
+        {
+            const segment* other = program->segments + j;
+            const uint32_t otherFirst = other->vaddr & PAGE_MASK;
+            const uint32_t otherEnd = (other->vaddr + other->memorySize + PAGE_SIZE - 1) & PAGE_MASK;
+            if (firstPage < otherEnd && otherFirst < endPage)
+                return false;
+        }
+
+        uint32_t flags = 0;
+        if (ph->p_flags & PF_R)
+            flags |= kernel::mm::REGION_READ;
+        if (ph->p_flags & PF_W)
+            flags |= kernel::mm::REGION_WRITE | kernel::mm::REGION_READ;
+        if (ph->p_flags & PF_X)
+            flags |= kernel::mm::REGION_EXEC | kernel::mm::REGION_READ;
+
+        if ((ph->p_flags & PF_X) && entry >= ph->p_vaddr && entry < end)
+            entryFound = true;
+
+        program->segments[program->segmentCount++] = {ph->p_vaddr,ph->p_memsz,
+                ph->p_offset,ph->p_filesz,flags};
+    }
+
+    return program->segmentCount != 0 && entryFound;
+}
+
+/**========================================================================
+ *                           Loading
+ *========================================================================**/
+
+/**
+ * @brief Read and check an executable. Not in the cache yet
+ * 
+ */
+static image* load(kernel::vfs::vnode* node, const char* name, loadError* error)
+{
+    const size_t fileSize = node->size;
+
+    elf32_Ehdr header;
+    if (node->type != kernel::vfs::vnodeType::FILE || fileSize < sizeof(header) ||
+            kernel::vfs::read(node,0,&header,sizeof(header)) != static_cast<int32_t>(sizeof(header)) ||
+            !validHeader(&header,fileSize))
+    {
+        *error = loadError::NOT_AN_EXECUTABLE;
+        return nullptr;
+    }
+
+    elf32_Phdr headers[MAX_PROGRAM_HEADERS];
+    const size_t tableSize = header.e_phnum * sizeof(elf32_Phdr);
+    if (kernel::vfs::read(node,header.e_phoff,headers,tableSize) != static_cast<int32_t>(tableSize))
+    {
+        *error = loadError::IO_ERROR;
+        return nullptr;
+    }
+
+    image* program = new image;
+    if (program == nullptr)
+    {
+        *error = loadError::OUT_OF_MEMORY;
+        return nullptr;
+    }
+    memset(program,0,sizeof(image));
+    memcpy(program->name,name,strlen(name) + 1);
+    program->references = 1;
+    program->entry = header.e_entry;
+
+    if (!validSegments(headers,header.e_phnum,fileSize,header.e_entry,program))
+    {
+        delete program;
+        *error = loadError::BAD_SEGMENTS;
+        return nullptr;
+    }
+
+    // The file's page cache pages. Processes map them from here
+    int32_t readError;
+    program->file = kernel::vfs::fileObject(node,&readError);
+    if (program->file == nullptr)
+    {
+        delete program;
+        *error = readError == -kernel::syscall::ENOMEM ? loadError::OUT_OF_MEMORY : loadError::IO_ERROR;
+        return nullptr;
+    }
+
+    kernel::vfs::getVnode(node);
+    program->node = node;
+    return program;
+}
+
+/**
+ * @brief Cached image of a file, with a reference taken. Cache lock held
+ * 
+ */
+static image* lookup(const kernel::vfs::vnode* node)
+{
+    for (image* program = cache; program != nullptr; program = program->next)
+    {
+        if (program->node == node)
+        {
+            program->references++;
+            return program;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Find the file of an executable
+ * 
+ */
+static kernel::vfs::vnode* findFile(const char* path, loadError* error)
+{
+    // Bare names are in the boot directory
+    char fullPath[kernel::vfs::MAX_PATH_LENGTH + 1];
+    const size_t length = strlen(path);
+    bool bare = true;
+    for (size_t i = 0; i < length; i++)
+        bare &= path[i] != '/';
+
+    const size_t prefix = bare ? sizeof(kernel::vfs::BOOT_DIRECTORY) : 0;
+    if (length == 0 || prefix + length > kernel::vfs::MAX_PATH_LENGTH)
+    {
+        *error = loadError::NOT_FOUND;
+        return nullptr;
+    }
+    if (bare)
+    {
+        memcpy(fullPath,kernel::vfs::BOOT_DIRECTORY,prefix - 1);
+        fullPath[prefix - 1] = '/';
+    }
+    memcpy(fullPath + prefix,path,length + 1);
+
+    kernel::vfs::vnode* node;
+    const int32_t result = kernel::vfs::walk(fullPath,&node);
+    if (result != 0)
+    {
+        *error = result == -kernel::syscall::EIO ? loadError::IO_ERROR : loadError::NOT_FOUND;
+        return nullptr;
+    }
+    return node;
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+image* kernel::proc::getImage(const char* path, loadError* error)
+{
+    *error = loadError::NONE;
+    vfs::vnode* node = findFile(path,error);
+    if (node == nullptr)
+        return nullptr;
+
+    cacheLock.lock();
+    image* program = lookup(node);
+    cacheLock.unlock();
+    if (program != nullptr)
+    {
+        vfs::putVnode(node);
+        return program;
+    }
+
+    // Processes are named after the last component
+    const char* name = path;
+    for (const char* c = path; *c != '\0'; c++)
+    {
+        if (*c == '/' && c[1] != '\0')
+            name = c + 1;
+    }
+    char shortName[IMAGE_NAME_SIZE];
+    size_t length = 0;
+    while (length < IMAGE_NAME_SIZE - 1 && name[length] != '\0' && name[length] != '/')
+    {
+        shortName[length] = name[length];
+        length++;
+    }
+    shortName[length] = '\0';
+
+    // The disk is slow, so no lock. Whoever loses a race to load the same
+    // file throws their copy away
+    image* loaded = load(node,shortName,error);
+    vfs::putVnode(node);
+    if (loaded == nullptr)
+        return nullptr;
+
+    cacheLock.lock();
+    program = lookup(loaded->node);
+    if (program == nullptr)
+    {
+        loaded->next = cache;
+        cache = loaded;
+        program = loaded;
+        loaded = nullptr;
+    }
+    cacheLock.unlock();
+
+    if (loaded != nullptr)
+    {
+        loaded->file->put();
+        vfs::putVnode(loaded->node);
+        delete loaded;
+    }
+    return program;
+}
+
+void kernel::proc::putImage(image* program)
+{
+    cacheLock.lock();
+    const bool last = --program->references == 0;
+    if (last)
+    {
+        image** link = &cache;
+        while (*link != program)
+            link = &(*link)->next;
+        *link = program->next;
+    }
+    cacheLock.unlock();
+
+    if (last)
+    {
+        program->file->put();
+        vfs::putVnode(program->node);
+        delete program;
+    }
+}
+
+bool kernel::proc::mapImage(const image* program, mm::addressSpace* space)
+{
+    for (size_t i = 0; i < program->segmentCount; i++)
+    {
+        const segment* s = program->segments + i;
+        const uint32_t start = s->vaddr & PAGE_MASK;
+        const uint32_t end = (s->vaddr + s->memorySize + PAGE_SIZE - 1) & PAGE_MASK;
+
+        // All of it is .bss-like
+        if (s->fileSize == 0)
+        {
+            if (!space->addRegion(start,end,s->flags))
+                return false;
+            continue;
+        }
+
+        if (!space->addRegion(start,end,s->flags,program->file,s->offset & PAGE_MASK,
+                s->vaddr + s->fileSize))
+            return false;
+    }
+    return true;
+}
+
+const char* kernel::proc::errorString(loadError error)
+{
+    switch (error)
+    {
+    case loadError::NONE:               return "no error";
+    case loadError::NOT_FOUND:          return "file not found";
+    case loadError::IO_ERROR:           return "disk read failed";
+    case loadError::NOT_AN_EXECUTABLE:  return "not an i386 static executable";
+    case loadError::BAD_SEGMENTS:       return "bad segments";
+    case loadError::OUT_OF_MEMORY:      return "out of memory";
+    default:                            return "unknown error";
+    }
+}
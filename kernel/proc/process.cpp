@@ -0,0 +1,173 @@
+/**
+ * @file process.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from process.hpp
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/proc/process.hpp>
+#include <kernelInternal/devices/ata.hpp>
+#include <kernelInternal/fs/fat32Backend.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/system/log.hpp>
+#include <kernelInternal/system/vdso.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <earlyLib/memory.hpp>
+#include <fs/mbr.hpp>
+#include <klib/string.h>
+
+using namespace kernel::proc;
+
+// FAT32 partition types, CHS and LBA
+static const uint8_t PARTITION_FAT32 =      0x0b;
+static const uint8_t PARTITION_FAT32_LBA =  0x0c;
+static const uint8_t PARTITION_BOOTABLE =   0x80;
+
+static volatile uint32_t nextProcessID = 1;
+
+/**
+ * @brief First thing a process' thread runs: move into the address space,
+ * and drop to ring 3
+ * 
+ */
+static void processStart(void* arg)
+{
+    process* p = static_cast<process*>(arg);
+    kernel::sched::thread* t = kernel::sched::currentThread();
+
+    // The scheduler switches address spaces from now on
+    const uint32_t flags = kernel::saveAndDisableInterrupts();
+    t->space = p->space;
+    t->process = p;
+    kernel::mm::activate(p->space);
+    kernel::restoreInterrupts(flags);
+
+    enterUserMode(p->program->entry,USER_STACK_TOP);
+}
+
+static void destroy(process* p)
+{
+    closeDescriptors(p);
+    if (p->space != nullptr)
+        p->space->destroy();
+    if (p->program != nullptr)
+        putImage(p->program);
+    delete p;
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+bool kernel::proc::init()
+{
+    if (!ata::init())
+        return false;
+
+    fs::MBR* mbr = new fs::MBR;
+    if (mbr == nullptr)
+        return false;
+    if (!ata::readSectors(0,mbr,1))
+    {
+        delete mbr;
+        return false;
+    }
+
+    // The partition we booted from
+    const fs::partitionTable* partitions[] = {&mbr->part1,&mbr->part2,&mbr->part3,&mbr->part4};
+    uint32_t partitionLBA = 0;
+    for (const fs::partitionTable* partition : partitions)
+    {
+        if ((partition->attributes & PARTITION_BOOTABLE) &&
+                (partition->partType == PARTITION_FAT32 || partition->partType == PARTITION_FAT32_LBA))
+        {
+            partitionLBA = partition->lbaBegin;
+            break;
+        }
+    }
+    delete mbr;
+    if (partitionLBA == 0)
+        return false;
+
+    // Executables come from here
+    vfs::filesystem* volume = vfs::openFAT32(&ata::readSectors,&ata::writeSectors,partitionLBA);
+    if (volume == nullptr)
+        return false;
+    // Problems are only reported, it's mounted anyway
+    vfs::checkFAT32(volume);
+    if (vfs::mount(vfs::BOOT_DIRECTORY,volume) != 0)
+    {
+        LOG_ERROR << "proc: couldn't mount the boot partition";
+        return false;
+    }
+    return true;
+}
+
+int32_t kernel::proc::spawn(const char* path)
+{
+    loadError error;
+    image* program = getImage(path,&error);
+    if (program == nullptr)
+    {
+        LOG_ERROR << "proc: can't run " << path << ": " << errorString(error);
+        if (error == loadError::NOT_FOUND)
+            return -syscall::ENOENT;
+        return error == loadError::OUT_OF_MEMORY ? -syscall::ENOMEM : -syscall::ENOEXEC;
+    }
+
+    process* p = new process();
+    if (p == nullptr)
+    {
+        putImage(program);
+        return -syscall::ENOMEM;
+    }
+    p->id = __atomic_fetch_add(&nextProcessID,1,__ATOMIC_RELAXED);
+    memcpy(p->name,program->name,IMAGE_NAME_SIZE);
+    p->program = program;
+    initDescriptors(p);
+
+    // Nothing is mapped yet, the segments, the vdso page and the stack fault in
+    p->space = mm::addressSpace::create();
+    if (p->space == nullptr || !mapImage(program,p->space) || !vdso::mapInto(p->space) ||
+            !p->space->addRegion(USER_STACK_TOP - USER_STACK_SIZE,USER_STACK_TOP,
+                    mm::REGION_READ | mm::REGION_WRITE))
+    {
+        destroy(p);
+        return -syscall::ENOMEM;
+    }
+
+    p->mainThread = sched::createThread(&processStart,p,sched::PRIORITY_NORMAL,p->name);
+    if (p->mainThread == nullptr)
+    {
+        destroy(p);
+        return -syscall::ENOMEM;
+    }
+    return static_cast<int32_t>(p->id);
+}
+
+void kernel::proc::exit(int32_t status)
+{
+    sched::thread* t = sched::currentThread();
+    process* p = t->process;
+    if (p != nullptr)
+    {
+        LOG_INFO << "Process " << p->id << " (" << p->name << ") exited with status " << status;
+
+        // Off the address space before it goes away
+        const uint32_t flags = saveAndDisableInterrupts();
+        t->space = nullptr;
+        t->process = nullptr;
+        t->name = "exited";
+        mm::activate(nullptr);
+        restoreInterrupts(flags);
+
+        destroy(p);
+    }
+
+    sched::exitThread();
+}
@@ -0,0 +1,627 @@
+/**
+ * @file scheduler.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from scheduler.hpp
+ * @version 0.1
+ * @date 2025-03-08
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/sync/rcu.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/mm/paging.hpp>
+#include <kernelInternal/devices/cpu/pit.hpp>
+#include <earlyLib/memory.hpp>
+#include <klib/string.h>
+#include <klib/cstdlib.hpp>
+
+using namespace kernel::sched;
+
+// Initial EFLAGS of a new thread: only the reserved bit, interrupts are
+// enabled by threadStartup once the switch is done
+static const uint32_t EFLAGS_INITIAL = 0x2;
+
+// LAPIC timer calibration window, in microseconds
+static const uint32_t CALIBRATION_TIME = 10000;
+
+/**
+ * @brief Run queue of a processor: one FIFO per priority, and a bitmap of the
+ * non-empty ones. Only touched with interrupts disabled and lock held
+ * 
+ */
+struct alignas(64) runQueue
+{
+    kernel::sync::spinlock lock;
+
+    /* Bit n set if head[n] isn't empty */
+    uint32_t            bitmap = 0;
+
+    /* Number of queued threads. Read without the lock as a hint */
+    volatile uint32_t   count = 0;
+
+    thread*             head[NUM_PRIORITIES] = {};
+    thread*             tail[NUM_PRIORITIES] = {};
+
+    /* Runs when there's nothing else, never queued */
+    thread*             idle = nullptr;
+
+    /* Thread we're switching away from, finished off by finishSwitch() */
+    thread*             previous = nullptr;
+
+    schedulerStats      stats = {};
+};
+
+static_assert(NUM_PRIORITIES <= 32, "runQueue bitmap is too small");
+
+static runQueue queues[kernel::smp::MAX_CPUS];
+
+DEFINE_PER_CPU(thread*, kernel::sched::runningThread) = nullptr;
+
+static kernel::cpu::l_apic* lapic;
+static uint32_t timerInitialCount;
+static volatile uint32_t nextThreadID = 0;
+static bool running = false;
+
+/**========================================================================
+ *                           Locking
+ *========================================================================**/
+
+static kernel::sync::lockClass runQueueClass("runqueue");
+
+/**
+ * @brief Thread lock. A plain word, thread.hpp can't depend on sync (which
+ * needs the thread for preemption). Always held with interrupts disabled
+ * 
+ */
+static inline void lockThread(thread* t)
+{
+    while (__atomic_exchange_n(&t->lock,1,__ATOMIC_ACQUIRE) != 0)
+    {
+        while (__atomic_load_n(&t->lock,__ATOMIC_RELAXED) != 0)
+            kernel::sync::cpuRelax();
+    }
+}
+
+static inline void unlockThread(thread* t)
+{
+    __atomic_store_n(&t->lock,0,__ATOMIC_RELEASE);
+}
+
+/**========================================================================
+ *                           Run queues
+ *========================================================================**/
+
+static void enqueue(runQueue* rq, thread* t)
+{
+    const uint8_t priority = t->priority;
+    t->next = nullptr;
+    if (rq->tail[priority] != nullptr)
+        rq->tail[priority]->next = t;
+    else
+        rq->head[priority] = t;
+    rq->tail[priority] = t;
+    rq->bitmap |= 1u << priority;
+    rq->count = rq->count + 1;
+}
+
+/**
+ * @brief Take the highest priority thread out of a run queue
+ * 
+ * @param stealing Skip threads that can't move to another processor
+ */
+static thread* dequeue(runQueue* rq, bool stealing)
+{
+    uint32_t bits = rq->bitmap;
+    while (bits != 0)
+    {
+        const uint32_t priority = 31 - static_cast<uint32_t>(__builtin_clz(bits));
+        bits &= ~(1u << priority);
+
+        thread* previous = nullptr;
+        for (thread* t = rq->head[priority]; t != nullptr; previous = t, t = t->next)
+        {
+            // A thread that's still being switched out by its processor stays
+            // there, otherwise two processors could wait on each other
+            if (stealing && (t->pinned || t->onCPU))
+                continue;
+
+            if (previous != nullptr)
+                previous->next = t->next;
+            else
+                rq->head[priority] = t->next;
+            if (rq->tail[priority] == t)
+                rq->tail[priority] = previous;
+            if (rq->head[priority] == nullptr)
+                rq->bitmap &= ~(1u << priority);
+            rq->count = rq->count - 1;
+
+            t->next = nullptr;
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Is there anything this processor could run, either queued on itself
+ * or to be stolen?
+ * 
+ */
+static bool workAvailable(uint32_t me)
+{
+    const size_t cpus = kernel::smp::cpuCount();
+    for (size_t i = 0; i < cpus; i++)
+    {
+        if (queues[(me + i) % cpus].count != 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Take a thread from another processor's run queue. Never waits on a
+ * lock, a busy queue is just skipped
+ * 
+ */
+static thread* steal(uint32_t me)
+{
+    const size_t cpus = kernel::smp::cpuCount();
+    for (size_t i = 1; i < cpus; i++)
+    {
+        runQueue* victim = queues + (me + i) % cpus;
+        if (victim->count == 0 || !victim->lock.tryLockRaw())
+            continue;
+
+        thread* t = dequeue(victim,true);
+        victim->lock.unlockRaw();
+        if (t != nullptr)
+        {
+            queues[me].stats.steals++;
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Make a processor notice a thread that was queued on it: ask it to
+ * reschedule if it's idle, or if the thread outranks what it's running
+ * 
+ */
+static void kick(uint32_t target, uint8_t priority)
+{
+    thread* current = __atomic_load_n(kernel::smp::perCPUPointer(runningThread,target),
+            __ATOMIC_RELAXED);
+    if (current != queues[target].idle && priority <= current->priority)
+        return;
+
+    if (target == kernel::smp::cpuIndex())
+        current->needResched = true;
+    else
+        kernel::smp::sendIPI(kernel::smp::cpuMask(1) << target,kernel::IPI_RESCHEDULE_VECTOR);
+}
+
+/**========================================================================
+ *                           Switching
+ *========================================================================**/
+
+static void reap(thread* t)
+{
+    if (t->stack != nullptr)
+        delete[] t->stack;
+    delete t;
+}
+
+/**
+ * @brief Second half of a switch, run by the thread switched to. The previous
+ * thread's registers are saved by now, so others may run it
+ * 
+ */
+static void finishSwitch()
+{
+    runQueue* rq = queues + kernel::smp::cpuIndex();
+    thread* previous = rq->previous;
+    rq->previous = nullptr;
+
+    const bool dead = previous->state == threadState::DEAD;
+    __atomic_store_n(&previous->onCPU,false,__ATOMIC_RELEASE);
+    if (dead)
+        reap(previous);
+}
+
+static void switchTo(runQueue* rq, thread* previous, thread* next)
+{
+    kernel::smp::perCPU* cpu = kernel::smp::thisCPU();
+
+    next->state = threadState::RUNNING;
+    next->cpu = cpu->index;
+    next->timeslice = TIMESLICE_TICKS;
+
+    // Wait for its old processor to be done saving it
+    while (__atomic_load_n(&next->onCPU,__ATOMIC_ACQUIRE))
+        __asm__ __volatile__ ("pause");
+    next->onCPU = true;
+
+    rq->previous = previous;
+    rq->stats.switches++;
+    kernel::smp::thisCPUWrite(runningThread,next);
+    cpu->gdt.setKernelStack(next->kernelStackTop);
+    kernel::mm::activate(next->space);
+
+    contextSwitch(&previous->esp,next->esp);
+
+    // We're back, possibly on another processor
+    finishSwitch();
+}
+
+/**
+ * @brief Pick the next thread and switch to it. Interrupts must be disabled
+ * 
+ */
+static void schedule()
+{
+    const uint32_t me = kernel::smp::cpuIndex();
+    runQueue* rq = queues + me;
+    thread* previous = currentThread();
+    previous->needResched = false;
+
+    // Nobody sleeps or gets preempted inside a read section, so this is a
+    // quiescent state
+    kernel::rcu::quiescentState();
+
+    rq->lock.lockRaw();
+    // Still runnable, so it goes to the back of its queue. If it's READY
+    // already, a waker beat us to it and queued it
+    if (previous->state == threadState::RUNNING && previous != rq->idle)
+    {
+        previous->state = threadState::READY;
+        enqueue(rq,previous);
+    }
+    thread* next = dequeue(rq,false);
+    rq->lock.unlockRaw();
+
+    if (next == nullptr)
+        next = steal(me);
+    if (next == nullptr)
+        next = rq->idle;
+
+    if (next == previous)
+    {
+        previous->state = threadState::RUNNING;
+        return;
+    }
+
+    switchTo(rq,previous,next);
+}
+
+/**
+ * @brief Where new threads start, "returned" to by contextSwitch
+ * 
+ */
+[[noreturn]] static void threadStartup(thread* t)
+{
+    finishSwitch();
+    kernel::enableInterrupts();
+
+    t->entry(t->arg);
+
+    exitThread();
+}
+
+/**========================================================================
+ *                           Threads
+ *========================================================================**/
+
+static thread* allocateThread(const char* name, uint8_t priority)
+{
+    thread* t = new thread;
+    if (t == nullptr)
+        return nullptr;
+
+    memset(t,0,sizeof(thread));
+    t->id = __atomic_fetch_add(&nextThreadID,1,__ATOMIC_RELAXED);
+    t->name = name;
+    t->priority = priority > PRIORITY_MAX ? PRIORITY_MAX : priority;
+    t->state = threadState::READY;
+    t->timeslice = TIMESLICE_TICKS;
+    return t;
+}
+
+/**
+ * @brief Create a thread whose stack is set up to start in threadStartup
+ * 
+ */
+static thread* newThread(threadEntry entry, void* arg, uint8_t priority,
+            const char* name)
+{
+    thread* t = allocateThread(name,priority);
+    if (t == nullptr)
+        return nullptr;
+
+    t->stack = new uint8_t[THREAD_STACK_SIZE];
+    if (t->stack == nullptr)
+    {
+        delete t;
+        return nullptr;
+    }
+    t->entry = entry;
+    t->arg = arg;
+
+    const uint32_t top = (reinterpret_cast<uint32_t>(t->stack) + THREAD_STACK_SIZE) & ~0xfu;
+    t->kernelStackTop = top;
+
+    // threadStartup(t) is entered through a ret, so it needs a (fake) return
+    // address, with the argument above it 16-byte aligned like after a call
+    uint32_t* sp = reinterpret_cast<uint32_t*>(top - 16);
+    sp[0] = reinterpret_cast<uint32_t>(t);
+    *--sp = 0;
+
+    switchFrame* frame = reinterpret_cast<switchFrame*>(sp) - 1;
+    memset(frame,0,sizeof(switchFrame));
+    frame->eflags = EFLAGS_INITIAL;
+    frame->eip = reinterpret_cast<uint32_t>(&threadStartup);
+    t->esp = reinterpret_cast<uint32_t>(frame);
+
+    return t;
+}
+
+/**
+ * @brief Online processor with the fewest queued threads
+ * 
+ */
+static uint32_t pickCPU()
+{
+    kernel::smp::cpuMask online = kernel::smp::onlineMask();
+    uint32_t best = kernel::smp::cpuIndex();
+    uint32_t bestCount = queues[best].count;
+    while (online != 0)
+    {
+        const uint32_t index = static_cast<uint32_t>(__builtin_ctz(online));
+        online &= online - 1;
+        if (queues[index].count < bestCount)
+        {
+            best = index;
+            bestCount = queues[index].count;
+        }
+    }
+    return best;
+}
+
+static void idleEntry(void*)
+{
+    idle();
+}
+
+/**
+ * @brief Turn the context we're running in into a thread
+ * 
+ */
+static thread* adoptContext(const char* name, uint8_t priority, uint32_t stackTop)
+{
+    thread* t = allocateThread(name,priority);
+    if (t == nullptr)
+        earlyPanic("sched: out of memory for the boot threads");
+
+    t->state = threadState::RUNNING;
+    t->onCPU = true;
+    t->cpu = kernel::smp::cpuIndex();
+    t->kernelStackTop = stackTop;
+    kernel::smp::thisCPUWrite(runningThread,t);
+    return t;
+}
+
+static void tickHandler(kernel::isr_frame_t*)
+{
+    const uint32_t me = kernel::smp::cpuIndex();
+    runQueue* rq = queues + me;
+    thread* t = currentThread();
+    rq->stats.ticks++;
+
+    // Read sections run with preemption disabled
+    kernel::rcu::onTick(t->preemptCount != 0);
+
+    if (t == rq->idle)
+    {
+        // Look for work to steal, nobody tells us about it
+        if (workAvailable(me))
+            t->needResched = true;
+        return;
+    }
+
+    if (--t->timeslice == 0)
+    {
+        t->timeslice = TIMESLICE_TICKS;
+        // Round robin, if anyone of the same or higher priority is waiting
+        if ((rq->bitmap >> t->priority) != 0)
+            t->needResched = true;
+    }
+}
+
+static void rescheduleHandler(kernel::isr_frame_t*)
+{
+    currentThread()->needResched = true;
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+void kernel::sched::init(cpu::l_apic* localAPIC)
+{
+    lapic = localAPIC;
+    for (size_t i = 0; i < smp::MAX_CPUS; i++)
+        queues[i].lock.setClass(&runQueueClass);
+
+    // How fast does the timer count?
+    lapic->startTimer(LAPIC_TIMER_VECTOR,0xffffffff,false);
+    cpu::pitBusyWait(CALIBRATION_TIME);
+    const uint32_t elapsed = 0xffffffff - lapic->timerCount();
+    lapic->stopTimer();
+    timerInitialCount = static_cast<uint32_t>(static_cast<uint64_t>(elapsed) * 1000000
+            / (static_cast<uint64_t>(CALIBRATION_TIME) * TICK_HZ));
+    if (timerInitialCount == 0)
+        timerInitialCount = 1;
+
+    setInterruptHandler(LAPIC_TIMER_VECTOR,&tickHandler);
+    setInterruptHandler(IPI_RESCHEDULE_VECTOR,&rescheduleHandler);
+
+    // kmain becomes a thread, and the BSP gets an idle thread of its own
+    const uint32_t flags = saveAndDisableInterrupts();
+    adoptContext("kmain",PRIORITY_NORMAL,smp::thisCPU()->stackTop);
+
+    thread* idleThread = newThread(&idleEntry,nullptr,0,"idle0");
+    if (idleThread == nullptr)
+        earlyPanic("sched: out of memory for the idle thread");
+    idleThread->pinned = true;
+    idleThread->state = threadState::RUNNING;
+    queues[0].idle = idleThread;
+
+    running = true;
+    lapic->startTimer(LAPIC_TIMER_VECTOR,timerInitialCount,true);
+    restoreInterrupts(flags);
+}
+
+void kernel::sched::initCPU()
+{
+    const uint32_t flags = saveAndDisableInterrupts();
+    thread* t = adoptContext("idle",0,smp::thisCPU()->stackTop);
+    t->pinned = true;
+    queues[smp::cpuIndex()].idle = t;
+
+    lapic->startTimer(LAPIC_TIMER_VECTOR,timerInitialCount,true);
+    restoreInterrupts(flags);
+}
+
+void kernel::sched::idle()
+{
+    const uint32_t me = smp::cpuIndex();
+    while (true)
+    {
+        disableInterrupts();
+        if (workAvailable(me))
+            schedule();
+
+        // sti only takes effect after hlt, so a wakeup IPI that arrives after
+        // the check still gets us out of it
+        __asm__ __volatile__ ("sti\n\thlt" : : : "memory");
+    }
+}
+
+thread* kernel::sched::createThread(threadEntry entry, void* arg,
+            uint8_t priority, const char* name, int cpu)
+{
+    if (cpu != ANY_CPU && (cpu < 0 || static_cast<size_t>(cpu) >= smp::cpuCount()))
+        return nullptr;
+
+    thread* t = newThread(entry,arg,priority,name);
+    if (t == nullptr)
+        return nullptr;
+
+    const uint32_t flags = saveAndDisableInterrupts();
+    t->pinned = cpu != ANY_CPU;
+    const uint32_t target = t->pinned ? static_cast<uint32_t>(cpu) : pickCPU();
+    t->cpu = target;
+
+    runQueue* rq = queues + target;
+    rq->lock.lockRaw();
+    enqueue(rq,t);
+    rq->lock.unlockRaw();
+    kick(target,t->priority);
+    restoreInterrupts(flags);
+
+    return t;
+}
+
+void kernel::sched::yield()
+{
+    const uint32_t flags = saveAndDisableInterrupts();
+    schedule();
+    restoreInterrupts(flags);
+}
+
+void kernel::sched::block()
+{
+    const uint32_t flags = saveAndDisableInterrupts();
+    thread* t = currentThread();
+
+    lockThread(t);
+    if (t->wakePending)
+    {
+        t->wakePending = false;
+        unlockThread(t);
+        restoreInterrupts(flags);
+        return;
+    }
+    t->state = threadState::BLOCKED;
+    unlockThread(t);
+
+    schedule();
+    restoreInterrupts(flags);
+}
+
+void kernel::sched::wake(thread* t)
+{
+    const uint32_t flags = saveAndDisableInterrupts();
+
+    lockThread(t);
+    if (t->state == threadState::BLOCKED)
+    {
+        // Back to the processor it blocked on, its cache is still warm there
+        t->state = threadState::READY;
+        const uint32_t target = t->cpu;
+        runQueue* rq = queues + target;
+        rq->lock.lockRaw();
+        enqueue(rq,t);
+        rq->lock.unlockRaw();
+        unlockThread(t);
+        kick(target,t->priority);
+    }
+    else
+    {
+        if (t->state != threadState::DEAD)
+            t->wakePending = true;
+        unlockThread(t);
+    }
+
+    restoreInterrupts(flags);
+}
+
+void kernel::sched::exitThread()
+{
+    disableInterrupts();
+    currentThread()->state = threadState::DEAD;
+    schedule();
+
+    earlyPanic("sched: dead thread was scheduled");
+}
+
+void kernel::sched::preemptCheck()
+{
+    const uint32_t flags = saveAndDisableInterrupts();
+    // Not with interrupts disabled, the caller still holds something
+    if ((flags & (1 << 9)) && currentThread()->preemptCount == 0)
+        schedule();
+    restoreInterrupts(flags);
+}
+
+void kernel::sched::onInterruptExit()
+{
+    if (!running)
+        return;
+
+    // APs take interrupts for a little while before they have threads
+    thread* t = currentThread();
+    if (t != nullptr && t->needResched && t->preemptCount == 0)
+        schedule();
+}
+
+const schedulerStats* kernel::sched::getStats(size_t cpu)
+{
+    if (cpu >= smp::cpuCount())
+        return nullptr;
+    return &queues[cpu].stats;
+}
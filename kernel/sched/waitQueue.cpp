@@ -0,0 +1,146 @@
+/**
+ * @file waitQueue.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from waitQueue.hpp
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/sched/waitQueue.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+
+using namespace kernel::sched;
+
+/**
+ * @brief Hand a waiter back to its thread. It's already off the queue
+ * 
+ */
+static void release(waiter* w)
+{
+    thread* owner = w->owner;
+    __atomic_store_n(&w->state,1,__ATOMIC_RELEASE);
+    wake(owner);
+    // After this the waiter (and its stack) can go away
+    __atomic_store_n(&w->state,2,__ATOMIC_RELEASE);
+}
+
+void waitQueue::add(waiter* w, uint32_t key)
+{
+    w->owner = currentThread();
+    w->next = nullptr;
+    w->key = key;
+    w->state = 0;
+
+    if (_tail != nullptr)
+        _tail->next = w;
+    else
+        _head = w;
+    _tail = w;
+}
+
+size_t waitQueue::wake(size_t count, uint32_t key)
+{
+    size_t woken = 0;
+    waiter* previous = nullptr;
+    waiter* w = _head;
+    while (w != nullptr && woken < count)
+    {
+        waiter* next = w->next;
+        if (w->key != key)
+        {
+            previous = w;
+            w = next;
+            continue;
+        }
+
+        if (previous != nullptr)
+            previous->next = next;
+        else
+            _head = next;
+        if (_tail == w)
+            _tail = previous;
+
+        release(w);
+        woken++;
+        w = next;
+    }
+    return woken;
+}
+
+size_t waitQueue::wakeAll()
+{
+    size_t woken = 0;
+    while (_head != nullptr)
+    {
+        waiter* w = _head;
+        _head = w->next;
+        if (_head == nullptr)
+            _tail = nullptr;
+        release(w);
+        woken++;
+    }
+    return woken;
+}
+
+size_t waitQueue::requeue(waitQueue* target, size_t count, uint32_t key, uint32_t newKey)
+{
+    // Off this queue first, so the target can be this queue too
+    waiter* moved = nullptr;
+    waiter** movedTail = &moved;
+    size_t n = 0;
+    waiter* previous = nullptr;
+    waiter* w = _head;
+    while (w != nullptr && n < count)
+    {
+        waiter* next = w->next;
+        if (w->key != key)
+        {
+            previous = w;
+            w = next;
+            continue;
+        }
+
+        if (previous != nullptr)
+            previous->next = next;
+        else
+            _head = next;
+        if (_tail == w)
+            _tail = previous;
+
+        w->next = nullptr;
+        w->key = newKey;
+        *movedTail = w;
+        movedTail = &w->next;
+        n++;
+        w = next;
+    }
+
+    while (moved != nullptr)
+    {
+        w = moved;
+        moved = w->next;
+        w->next = nullptr;
+        if (target->_tail != nullptr)
+            target->_tail->next = w;
+        else
+            target->_head = w;
+        target->_tail = w;
+    }
+    return n;
+}
+
+void kernel::sched::sleep(waiter* w)
+{
+    uint32_t state;
+    while ((state = __atomic_load_n(&w->state,__ATOMIC_ACQUIRE)) != 2)
+    {
+        if (state == 0)
+            block();
+        else
+            sync::cpuRelax(); // Woken, the waker is about to let go
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * @file lockstat.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from lockstat.hpp
+ * @version 0.1
+ * @date 2025-03-12
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/sync/lockstat.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <klib/io.hpp>
+
+using namespace kernel::sync;
+
+// Every class seen so far, newest first
+static lockClass* classes = nullptr;
+
+static void registerClass(lockClass* lc)
+{
+    if (__atomic_exchange_n(&lc->registered,true,__ATOMIC_ACQ_REL))
+        return;
+
+    lockClass* head = __atomic_load_n(&classes,__ATOMIC_RELAXED);
+    do
+    {
+        lc->next = head;
+    } while (!__atomic_compare_exchange_n(&classes,&head,lc,true,
+            __ATOMIC_RELEASE,__ATOMIC_RELAXED));
+}
+
+static void updateMax(uint64_t* max, uint64_t value)
+{
+    uint64_t current = __atomic_load_n(max,__ATOMIC_RELAXED);
+    while (value > current && !__atomic_compare_exchange_n(max,&current,value,true,
+            __ATOMIC_RELAXED,__ATOMIC_RELAXED));
+}
+
+void kernel::sync::recordAcquire(lockClass* lc, uint64_t waited, bool contended)
+{
+    if (!lc->registered)
+        registerClass(lc);
+
+    __atomic_add_fetch(&lc->acquisitions,1,__ATOMIC_RELAXED);
+    if (contended)
+    {
+        __atomic_add_fetch(&lc->contended,1,__ATOMIC_RELAXED);
+        __atomic_add_fetch(&lc->waitCycles,waited,__ATOMIC_RELAXED);
+        updateMax(&lc->maxWait,waited);
+    }
+}
+
+void kernel::sync::recordRelease(lockClass* lc, uint64_t held)
+{
+    __atomic_add_fetch(&lc->holdCycles,held,__ATOMIC_RELAXED);
+    updateMax(&lc->maxHold,held);
+}
+
+void kernel::sync::printLockStats()
+{
+    using kernel::clock::cyclesToNanoseconds;
+
+    out << "Lock classes (times in ns):\n" << out.dec();
+    for (lockClass* lc = __atomic_load_n(&classes,__ATOMIC_ACQUIRE); lc != nullptr; lc = lc->next)
+    {
+        out << "  " << lc->name << ": " << lc->acquisitions << " acquired, "
+            << lc->contended << " contended, wait "
+            << cyclesToNanoseconds(lc->waitCycles) << " (max "
+            << cyclesToNanoseconds(lc->maxWait) << "), hold "
+            << cyclesToNanoseconds(lc->holdCycles) << " (max "
+            << cyclesToNanoseconds(lc->maxHold) << ")\n";
+    }
+    out << out.hex();
+}
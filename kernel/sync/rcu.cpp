@@ -0,0 +1,252 @@
+/**
+ * @file rcu.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from rcu.hpp
+ * @version 0.1
+ * @date 2025-03-14
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/sync/rcu.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <kernelInternal/system/deferred.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+
+using namespace kernel::rcu;
+using kernel::smp::cpuMask;
+
+/**
+ * @brief Callbacks of one processor. Only touched by that processor, with
+ * interrupts disabled
+ * 
+ */
+struct alignas(64) rcuCPU
+{
+    /* Queued, but no grace period asked for yet */
+    rcuHead*                        next;
+    rcuHead**                       nextTail;
+
+    /* Waiting for grace period waitGP to end */
+    rcuHead*                        waiting;
+    uint32_t                        waitGP;
+
+    /* Grace period over, to be run by work */
+    rcuHead*                        ready;
+    rcuHead**                       readyTail;
+
+    /* Last grace period we reported a quiescent state for */
+    uint32_t                        quiescentGP;
+
+    kernel::deferred::workItem      work;
+};
+
+static rcuCPU cpus[kernel::smp::MAX_CPUS];
+static bool initialized = false;
+
+/*
+ * Grace periods are numbered. One runs at a time: started > completed while
+ * it's running, and pending has the processors that haven't been through a
+ * quiescent state since it started
+ */
+static kernel::sync::spinlock gpLock;
+static volatile uint32_t gpStarted = 0;
+static volatile uint32_t gpCompleted = 0;
+static volatile cpuMask gpPending = 0;
+static bool gpNeeded = false;
+
+// Wrap safe a >= b
+static inline bool gpAfterOrEqual(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b) >= 0;
+}
+
+/**
+ * @brief Start a grace period, gpLock held
+ * 
+ */
+static void startGPLocked()
+{
+    gpNeeded = false;
+    __atomic_store_n(&gpPending,kernel::smp::onlineMask(),__ATOMIC_RELAXED);
+    // Pending must be set before anyone sees the new number
+    __atomic_store_n(&gpStarted,gpStarted + 1,__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Ask for a grace period
+ * 
+ * @return uint32_t Grace period that has to complete before callbacks queued
+ * until now can run
+ */
+static uint32_t requestGP()
+{
+    gpLock.lockRaw();
+    uint32_t target;
+    if (gpStarted == gpCompleted)
+    {
+        startGPLocked();
+        target = gpStarted;
+    }
+    else
+    {
+        // The one running might have started before our callbacks were
+        // queued, it has to be the next one
+        gpNeeded = true;
+        target = gpStarted + 1;
+    }
+    gpLock.unlockRaw();
+    return target;
+}
+
+/**
+ * @brief Run ready callbacks, with interrupts enabled
+ * 
+ */
+static void runCallbacks(kernel::deferred::workItem* item)
+{
+    rcuCPU* rc = reinterpret_cast<rcuCPU*>(reinterpret_cast<uint8_t*>(item)
+            - __builtin_offsetof(rcuCPU,work));
+
+    const uint32_t flags = kernel::saveAndDisableInterrupts();
+    rcuHead* list = rc->ready;
+    rc->ready = nullptr;
+    rc->readyTail = &rc->ready;
+    kernel::restoreInterrupts(flags);
+
+    while (list != nullptr)
+    {
+        rcuHead* next = list->next;
+        list->function(list);
+        list = next;
+    }
+}
+
+/**
+ * @brief Move callbacks along as grace periods end, interrupts disabled
+ * 
+ */
+static void advanceCallbacks(rcuCPU* rc)
+{
+    if (rc->waiting != nullptr &&
+            gpAfterOrEqual(__atomic_load_n(&gpCompleted,__ATOMIC_ACQUIRE),rc->waitGP))
+    {
+        *rc->readyTail = rc->waiting;
+        while (*rc->readyTail != nullptr)
+            rc->readyTail = &(*rc->readyTail)->next;
+        rc->waiting = nullptr;
+        kernel::deferred::queueWork(&rc->work);
+    }
+
+    if (rc->waiting == nullptr && rc->next != nullptr)
+    {
+        rc->waiting = rc->next;
+        rc->next = nullptr;
+        rc->nextTail = &rc->next;
+        rc->waitGP = requestGP();
+    }
+}
+
+void kernel::rcu::init()
+{
+    for (size_t i = 0; i < smp::MAX_CPUS; i++)
+    {
+        cpus[i].nextTail = &cpus[i].next;
+        cpus[i].readyTail = &cpus[i].ready;
+        deferred::initItem(&cpus[i].work,&runCallbacks,deferred::workPriority::NORMAL);
+    }
+    __atomic_store_n(&initialized,true,__ATOMIC_RELEASE);
+}
+
+void kernel::rcu::quiescentState()
+{
+    if (!initialized)
+        return;
+
+    const uint32_t me = smp::cpuIndex();
+    rcuCPU* rc = cpus + me;
+    const uint32_t started = __atomic_load_n(&gpStarted,__ATOMIC_ACQUIRE);
+    if (rc->quiescentGP != started)
+    {
+        rc->quiescentGP = started;
+
+        // Everything we did before this point, reads included, is done before
+        // the writer sees the grace period end
+        const cpuMask bit = cpuMask(1) << me;
+        if (__atomic_fetch_and(&gpPending,~bit,__ATOMIC_ACQ_REL) == bit)
+        {
+            // We were the last one
+            gpLock.lockRaw();
+            __atomic_store_n(&gpCompleted,started,__ATOMIC_RELEASE);
+            if (gpNeeded)
+                startGPLocked();
+            gpLock.unlockRaw();
+        }
+    }
+
+    advanceCallbacks(rc);
+}
+
+void kernel::rcu::onTick(bool inReadSection)
+{
+    if (!initialized)
+        return;
+
+    if (inReadSection)
+        advanceCallbacks(cpus + smp::cpuIndex());
+    else
+        quiescentState();
+}
+
+void kernel::rcu::callRCU(rcuHead* head, rcuCallback function)
+{
+    head->function = function;
+    head->next = nullptr;
+
+    const uint32_t flags = saveAndDisableInterrupts();
+    rcuCPU* rc = cpus + smp::cpuIndex();
+    *rc->nextTail = head;
+    rc->nextTail = &head->next;
+    restoreInterrupts(flags);
+}
+
+/**
+ * @brief What synchronize() waits on
+ * 
+ */
+struct synchronizeWaiter
+{
+    rcuHead                 head;
+    kernel::sched::thread*  thread;
+
+    /* 1 once the grace period is over, 2 once the waker is done with us */
+    volatile uint32_t       state;
+};
+
+static void synchronizeCallback(rcuHead* head)
+{
+    synchronizeWaiter* waiter = reinterpret_cast<synchronizeWaiter*>(head);
+    __atomic_store_n(&waiter->state,1,__ATOMIC_RELEASE);
+    kernel::sched::wake(waiter->thread);
+    // After this the waiter (and its stack) can go away
+    __atomic_store_n(&waiter->state,2,__ATOMIC_RELEASE);
+}
+
+void kernel::rcu::synchronize()
+{
+    synchronizeWaiter waiter;
+    waiter.thread = sched::currentThread();
+    waiter.state = 0;
+
+    callRCU(&waiter.head,&synchronizeCallback);
+    uint32_t state;
+    while ((state = __atomic_load_n(&waiter.state,__ATOMIC_ACQUIRE)) != 2)
+    {
+        if (state == 0)
+            sched::block();
+        else
+            sync::cpuRelax(); // Woken, the waker is about to let go
+    }
+}
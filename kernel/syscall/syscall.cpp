@@ -0,0 +1,293 @@
+/**
+ * @file syscall.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from syscall.hpp
+ * @version 0.1
+ * @date 2025-03-18
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/syscall/syscall.hpp>
+#include <kernelInternal/devices/cpu/cpuid.hpp>
+#include <kernelInternal/devices/cpu/msr.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/system/percpu.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/mm/addressSpace.hpp>
+#include <kernelInternal/proc/process.hpp>
+#include <kernelInternal/devices/block.hpp>
+#include <kernelInternal/fs/vfs.hpp>
+#include <kernelInternal/gdt.h>
+
+using namespace kernel::syscall;
+
+extern "C" {
+    extern uint8_t sysenterEntry[];
+    extern uint8_t syscallInterruptEntry[];
+}
+
+// Written once by init(), before there's any user code
+static const syscallDescriptor* table[NUM_SYSCALLS];
+static bool sysenterAvailable = false;
+
+// Counted on the processor that ran the call, with a single instruction, so
+// nobody fights over them
+static DEFINE_PER_CPU(uint32_t, callCounts[NUM_SYSCALLS]) = {};
+static DEFINE_PER_CPU(uint32_t, rejectCounts[NUM_SYSCALLS]) = {};
+
+/**========================================================================
+ *                           Built-in calls
+ *========================================================================**/
+
+static int32_t sysNull(const uint32_t*)
+{
+    return 0;
+}
+
+static int32_t sysExit(const uint32_t* args)
+{
+    kernel::proc::exit(static_cast<int32_t>(args[0]));
+}
+
+static int32_t sysYield(const uint32_t*)
+{
+    kernel::sched::yield();
+    return 0;
+}
+
+static int32_t sysGetCPU(const uint32_t*)
+{
+    return static_cast<int32_t>(kernel::smp::cpuIndex());
+}
+
+static int32_t sysWrite(const uint32_t* args)
+{
+    return kernel::proc::writeDescriptor(static_cast<int32_t>(args[0]),args[1],args[2]);
+}
+
+static int32_t sysRead(const uint32_t* args)
+{
+    return kernel::proc::readDescriptor(static_cast<int32_t>(args[0]),args[1],args[2]);
+}
+
+static int32_t sysClose(const uint32_t* args)
+{
+    return kernel::proc::closeDescriptor(static_cast<int32_t>(args[0]));
+}
+
+static int32_t sysSpawn(const uint32_t* args)
+{
+    char path[kernel::vfs::MAX_PATH_LENGTH + 1];
+    if (args[1] == 0)
+        return -ENOENT;
+    if (args[1] >= sizeof(path))
+        return -ENAMETOOLONG;
+    if (!copyFromUser(path,args[0],args[1]))
+        return -EFAULT;
+    path[args[1]] = '\0';
+    return kernel::proc::spawn(path);
+}
+
+static int32_t sysOpenDevice(const uint32_t* args)
+{
+    char name[kernel::block::DEVICE_NAME_LENGTH + 1];
+    if (args[1] == 0 || args[1] >= sizeof(name))
+        return -ENOENT;
+    if (!copyFromUser(name,args[0],args[1]))
+        return -EFAULT;
+    name[args[1]] = '\0';
+
+    const kernel::block::blockDevice* device = kernel::block::findDevice(name);
+    if (device == nullptr)
+        return -ENOENT;
+    // Devices never go away, there's no reference to take
+    return kernel::proc::openDescriptor(kernel::proc::descriptorType::BLOCK_DEVICE,
+            const_cast<kernel::block::blockDevice*>(device));
+}
+
+static int32_t sysFsync(const uint32_t* args)
+{
+    return kernel::proc::syncDescriptor(static_cast<int32_t>(args[0]));
+}
+
+static const syscallDescriptor nullDescriptor =     {"null",&sysNull,0,{}};
+static const syscallDescriptor exitDescriptor =     {"exit",&sysExit,1,{argKind::VALUE}};
+static const syscallDescriptor yieldDescriptor =    {"yield",&sysYield,0,{}};
+static const syscallDescriptor getCPUDescriptor =   {"getcpu",&sysGetCPU,0,{}};
+static const syscallDescriptor writeDescriptor =    {"write",&sysWrite,3,
+        {argKind::VALUE,argKind::USER_POINTER,argKind::LENGTH}};
+static const syscallDescriptor readDescriptor =     {"read",&sysRead,3,
+        {argKind::VALUE,argKind::USER_POINTER,argKind::LENGTH}};
+static const syscallDescriptor closeDescriptor =    {"close",&sysClose,1,{argKind::VALUE}};
+static const syscallDescriptor spawnDescriptor =    {"spawn",&sysSpawn,2,
+        {argKind::USER_POINTER,argKind::LENGTH}};
+static const syscallDescriptor openDeviceDescriptor = {"open_device",&sysOpenDevice,2,
+        {argKind::USER_POINTER,argKind::LENGTH}};
+static const syscallDescriptor fsyncDescriptor =    {"fsync",&sysFsync,1,{argKind::VALUE}};
+
+/**========================================================================
+ *                           Dispatcher
+ *========================================================================**/
+
+/**
+ * @brief Check the arguments against what the descriptor says they are
+ * 
+ */
+static bool validArguments(const syscallDescriptor* descriptor, const uint32_t* args)
+{
+    for (size_t i = 0; i < descriptor->argCount; i++)
+    {
+        // registerSyscall() made sure a LENGTH follows
+        if (descriptor->args[i] == argKind::USER_POINTER &&
+                !isUserRange(args[i],args[i + 1]))
+            return false;
+    }
+    return true;
+}
+
+void syscallDispatch(syscallFrame* frame)
+{
+    const uint32_t number = frame->regs.eax;
+    const syscallDescriptor* descriptor = number < NUM_SYSCALLS ?
+            __atomic_load_n(table + number,__ATOMIC_ACQUIRE) : nullptr;
+    if (descriptor == nullptr)
+    {
+        frame->regs.eax = static_cast<uint32_t>(-ENOSYS);
+        return;
+    }
+
+    const uint32_t registers[MAX_SYSCALL_ARGS] = {frame->regs.ebx,frame->regs.ecx,
+            frame->regs.edx,frame->regs.esi,frame->regs.edi};
+    uint32_t args[MAX_SYSCALL_ARGS] = {};
+    for (size_t i = 0; i < descriptor->argCount; i++)
+        args[i] = registers[i];
+
+    if (!validArguments(descriptor,args))
+    {
+        kernel::smp::thisCPUInc(rejectCounts[number]);
+        frame->regs.eax = static_cast<uint32_t>(-EFAULT);
+        return;
+    }
+
+    kernel::smp::thisCPUInc(callCounts[number]);
+    frame->regs.eax = static_cast<uint32_t>(descriptor->function(args));
+}
+
+/**========================================================================
+ *                           Interface
+ *========================================================================**/
+
+bool kernel::syscall::registerSyscall(uint32_t number, const syscallDescriptor* descriptor)
+{
+    if (number >= NUM_SYSCALLS || descriptor == nullptr || descriptor->function == nullptr ||
+            descriptor->argCount > MAX_SYSCALL_ARGS)
+        return false;
+
+    // Every pointer needs its length right after it, and every length a pointer
+    for (size_t i = 0; i < descriptor->argCount; i++)
+    {
+        const bool pointer = descriptor->args[i] == argKind::USER_POINTER;
+        const bool hasLength = i + 1 < descriptor->argCount &&
+                descriptor->args[i + 1] == argKind::LENGTH;
+        if (pointer && !hasLength)
+            return false;
+        if (descriptor->args[i] == argKind::LENGTH &&
+                (i == 0 || descriptor->args[i - 1] != argKind::USER_POINTER))
+            return false;
+    }
+
+    const syscallDescriptor* expected = nullptr;
+    return __atomic_compare_exchange_n(table + number,&expected,descriptor,false,
+            __ATOMIC_RELEASE,__ATOMIC_RELAXED);
+}
+
+bool kernel::syscall::isUserRange(uint32_t address, size_t length)
+{
+    if (length == 0)
+        return true; // Nothing will be touched
+    return address >= USER_SPACE_START && address < USER_SPACE_END &&
+            length <= USER_SPACE_END - address;
+}
+
+bool kernel::syscall::copyFromUser(void* destination, uint32_t source, size_t length)
+{
+    // Every page must be in a region. Faulting them in can still fail, which
+    // userCopy() stops at
+    kernel::mm::addressSpace* space = kernel::sched::currentThread()->space;
+    if (length != 0 && (space == nullptr || !space->checkRange(source,length,false)))
+        return false;
+    return userCopy(destination,reinterpret_cast<const void*>(source),length) == 0;
+}
+
+bool kernel::syscall::copyToUser(uint32_t destination, const void* source, size_t length)
+{
+    kernel::mm::addressSpace* space = kernel::sched::currentThread()->space;
+    if (length != 0 && (space == nullptr || !space->checkRange(destination,length,true)))
+        return false;
+    return userCopy(reinterpret_cast<void*>(destination),source,length) == 0;
+}
+
+void kernel::syscall::init()
+{
+    // Family 6, model < 3, stepping < 3 (early Pentium Pro) claims SEP but
+    // doesn't have it
+    uint32_t eax,ebx,ecx,edx;
+    cpu::cpuid(1,&eax,&ebx,&ecx,&edx);
+    const uint32_t family = (eax >> 8) & 0xf;
+    const uint32_t model = (eax >> 4) & 0xf;
+    const uint32_t stepping = eax & 0xf;
+    sysenterAvailable = (edx & static_cast<uint32_t>(cpu::cpuid_features::CPUID_FEAT_EDX_SEP)) &&
+            !(family == 6 && model < 3 && stepping < 3);
+
+    registerSyscall(SYS_NULL,&nullDescriptor);
+    registerSyscall(SYS_EXIT,&exitDescriptor);
+    registerSyscall(SYS_YIELD,&yieldDescriptor);
+    registerSyscall(SYS_GETCPU,&getCPUDescriptor);
+    registerSyscall(SYS_WRITE,&writeDescriptor);
+    registerSyscall(SYS_READ,&readDescriptor);
+    registerSyscall(SYS_CLOSE,&closeDescriptor);
+    registerSyscall(SYS_SPAWN,&spawnDescriptor);
+    registerSyscall(SYS_OPEN_DEVICE,&openDeviceDescriptor);
+    registerSyscall(SYS_FSYNC,&fsyncDescriptor);
+
+    // Always there, even with SYSENTER
+    interruptDescriptorTable idt;
+    idt.installInterrupt(SYSCALL_VECTOR,syscallInterruptEntry,3);
+
+    initCPU();
+}
+
+void kernel::syscall::initCPU()
+{
+    if (!sysenterAvailable)
+        return;
+
+    // SYSENTER can't switch stacks by itself: it gets pointed to where the TSS
+    // keeps the current thread's stack, which the scheduler already updates
+    smp::perCPU* self = smp::thisCPU();
+    cpu::setMSR(cpu::IA32_SYSENTER_CS,CODE32_KSEGMENT,0);
+    cpu::setMSR(cpu::IA32_SYSENTER_ESP,self->gdt.kernelStackSlot(),0);
+    cpu::setMSR(cpu::IA32_SYSENTER_EIP,reinterpret_cast<uint32_t>(sysenterEntry),0);
+}
+
+bool kernel::syscall::hasSysenter()
+{
+    return sysenterAvailable;
+}
+
+syscallStats kernel::syscall::getStats(uint32_t number)
+{
+    syscallStats stats = {0,0};
+    if (number >= NUM_SYSCALLS)
+        return stats;
+
+    for (size_t i = 0; i < smp::cpuCount(); i++)
+    {
+        stats.calls += *smp::perCPUPointer(callCounts[number],i);
+        stats.rejected += *smp::perCPUPointer(rejectCounts[number],i);
+    }
+    return stats;
+}
@@ -98,21 +98,17 @@ acpi_madt::acpi_madt(acpi_header* acpiPtr)
     _ptr = reinterpret_cast<madt_table*>(foundPtr);
 }
 
-void* acpi_madt::getEntry(int type)
+void* acpi_madt::getEntry(int type, size_t index)
 {
-    // For now, we only support type 1
-    if (type != 1)
-    {
-        return nullptr;
-    }
-
     // Walk through the fields
     auto walker = reinterpret_cast<uint8_t*>(_ptr) + sizeof(madt_table);
     auto limit = reinterpret_cast<uint8_t*>(_ptr) + _ptr->header.length;
     while (walker < limit)
     {
         auto curr = reinterpret_cast<madt_entry_header*>(walker);
-        if (curr->entry_type == 1)
+        if (curr->record_length == 0) // Broken table, don't loop forever
+            break;
+        if (curr->entry_type == type && index-- == 0)
             return reinterpret_cast<void*>(walker);
         // Walk to next one        
         walker += curr->record_length;
@@ -120,4 +116,12 @@ void* acpi_madt::getEntry(int type)
     
     // If we got here, we found nothing
     return nullptr;
+}
+
+size_t acpi_madt::getEntryCount(int type)
+{
+    size_t count = 0;
+    while (getEntry(type,count) != nullptr)
+        count++;
+    return count;
 }
\ No newline at end of file
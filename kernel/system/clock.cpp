@@ -0,0 +1,70 @@
+/**
+ * @file clock.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from clock.hpp
+ * @version 0.1
+ * @date 2025-03-08
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/devices/cpu/pit.hpp>
+#include <kernelInternal/sync/seqlock.hpp>
+
+using namespace kernel::clock;
+
+// Calibration window, in microseconds
+static const uint32_t CALIBRATION_TIME = 10000;
+
+// Read on every clock read, written almost never
+static clockParameters parameters;
+static kernel::sync::seqlock parametersLock;
+
+void kernel::clock::init()
+{
+    const uint64_t start = readTSC();
+    kernel::cpu::pitBusyWait(CALIBRATION_TIME);
+    const uint64_t end = readTSC();
+
+    const uint64_t frequency = (end - start) * (1000000 / CALIBRATION_TIME);
+
+    // Biggest shift that keeps mult in 32 bits, for the most precision
+    uint32_t shift = 32;
+    uint64_t mult;
+    while ((mult = (1000000000ULL << shift) / frequency) > 0xffffffffULL)
+        shift--;
+
+    // Before the scheduler is up, so no preemption to turn off
+    const uint32_t flags = parametersLock.writeBeginIrqSave();
+    parameters.tscFrequency = frequency;
+    parameters.mult = static_cast<uint32_t>(mult);
+    parameters.shift = shift;
+    parameters.tscBase = end;
+    parametersLock.writeEndIrqRestore(flags);
+}
+
+clockParameters kernel::clock::getParameters()
+{
+    clockParameters copy;
+    uint32_t sequence;
+    do
+    {
+        sequence = parametersLock.readBegin();
+        copy = parameters;
+    } while (parametersLock.readRetry(sequence));
+    return copy;
+}
+
+uint64_t kernel::clock::nanoseconds()
+{
+    const clockParameters current = getParameters();
+    return mulShift(readTSC() - current.tscBase,current.mult,current.shift);
+}
+
+uint64_t kernel::clock::cyclesToNanoseconds(uint64_t cycles)
+{
+    const clockParameters current = getParameters();
+    return mulShift(cycles,current.mult,current.shift);
+}
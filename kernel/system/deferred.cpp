@@ -0,0 +1,301 @@
+/**
+ * @file deferred.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from deferred.hpp
+ * @version 0.1
+ * @date 2025-03-10
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/system/deferred.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+
+using namespace kernel::deferred;
+
+/**
+ * @brief One priority of a processor's queue. Producers push onto head with a
+ * CAS (a Treiber stack), the consumer takes the whole stack at once and keeps
+ * it in FIFO order in backlog. Taking everything means there's no ABA
+ * 
+ */
+struct workQueue
+{
+    /* Producer side, newest first */
+    workItem*           head;
+
+    /* Consumer side, oldest first */
+    workItem*           backlog;
+};
+
+struct alignas(64) cpuWork
+{
+    workQueue                   queues[NUM_WORK_PRIORITIES];
+    workStats                   stats[NUM_WORK_PRIORITIES];
+
+    /* Someone is running the queues, only one at a time */
+    bool                        draining;
+
+    kernel::sched::thread*      worker;
+};
+
+static cpuWork work[kernel::smp::MAX_CPUS];
+
+/* Interrupt handlers this processor is nested in */
+static DEFINE_PER_CPU(uint32_t, interruptNesting) = 0;
+static bool initialized = false;
+
+static inline size_t priorityIndex(workPriority priority)
+{
+    return static_cast<size_t>(priority);
+}
+
+/**
+ * @brief Next item to run, highest priority first. Consumer only
+ * 
+ */
+static workItem* nextItem(cpuWork* cw)
+{
+    for (size_t p = 0; p < NUM_WORK_PRIORITIES; p++)
+    {
+        workQueue* queue = cw->queues + p;
+        if (queue->backlog == nullptr)
+        {
+            workItem* list = __atomic_exchange_n(&queue->head,nullptr,__ATOMIC_ACQUIRE);
+            if (list == nullptr)
+                continue;
+
+            // Reverse it, to run in the order it was queued
+            workItem* reversed = nullptr;
+            while (list != nullptr)
+            {
+                workItem* next = list->next;
+                list->next = reversed;
+                reversed = list;
+                list = next;
+            }
+            queue->backlog = reversed;
+        }
+
+        workItem* item = queue->backlog;
+        queue->backlog = item->next;
+        return item;
+    }
+    return nullptr;
+}
+
+static bool hasWork(cpuWork* cw)
+{
+    for (size_t p = 0; p < NUM_WORK_PRIORITIES; p++)
+    {
+        if (cw->queues[p].backlog != nullptr ||
+                __atomic_load_n(&cw->queues[p].head,__ATOMIC_RELAXED) != nullptr)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Run up to budget items. Interrupts enabled, draining set by the caller
+ * 
+ * @return true Everything was run
+ */
+static bool drain(cpuWork* cw, uint32_t budget)
+{
+    workItem* item;
+    while (budget != 0 && (item = nextItem(cw)) != nullptr)
+    {
+        workStats* stats = cw->stats + priorityIndex(item->priority);
+        const uint64_t latency = kernel::clock::readTSC() - item->queuedAt;
+        stats->totalLatency += latency;
+        if (latency > stats->maxLatency)
+            stats->maxLatency = latency;
+        stats->executed++;
+        __atomic_sub_fetch(&stats->depth,1,__ATOMIC_RELAXED);
+
+        // Cleared before it runs, so it can queue itself again
+        __atomic_store_n(&item->pending,false,__ATOMIC_RELEASE);
+        item->function(item);
+        budget--;
+    }
+    return !hasWork(cw);
+}
+
+/**
+ * @brief Take the right to drain this processor's queues
+ * 
+ * @return cpuWork* nullptr if someone else has it
+ */
+static cpuWork* claim()
+{
+    const uint32_t flags = kernel::saveAndDisableInterrupts();
+    cpuWork* cw = work + kernel::smp::cpuIndex();
+    const bool taken = cw->draining;
+    cw->draining = true;
+    kernel::restoreInterrupts(flags);
+    return taken ? nullptr : cw;
+}
+
+static void workerThread(void* arg)
+{
+    cpuWork* cw = static_cast<cpuWork*>(arg);
+    while (true)
+    {
+        if (claim() != nullptr)
+        {
+            const bool done = drain(cw,WORKER_BUDGET);
+            cw->draining = false;
+            if (!done)
+            {
+                kernel::sched::yield();
+                continue;
+            }
+        }
+        kernel::sched::block();
+    }
+}
+
+static void wakeWorker(cpuWork* cw)
+{
+    if (cw->worker != nullptr)
+        kernel::sched::wake(cw->worker);
+}
+
+void kernel::deferred::initItem(workItem* item, workFunction function,
+            workPriority priority)
+{
+    item->next = nullptr;
+    item->function = function;
+    item->priority = priority;
+    item->pending = false;
+    item->queuedAt = 0;
+}
+
+bool kernel::deferred::queueWorkOn(size_t cpu, workItem* item)
+{
+    if (cpu >= smp::cpuCount())
+        return false;
+    if (__atomic_exchange_n(&item->pending,true,__ATOMIC_ACQ_REL))
+        return false; // Already queued
+
+    cpuWork* cw = work + cpu;
+    workStats* stats = cw->stats + priorityIndex(item->priority);
+    item->queuedAt = clock::readTSC();
+
+    // Counters first, so depth never goes below zero
+    __atomic_add_fetch(&stats->queued,1,__ATOMIC_RELAXED);
+    const uint32_t depth = __atomic_add_fetch(&stats->depth,1,__ATOMIC_RELAXED);
+    uint32_t maxDepth = __atomic_load_n(&stats->maxDepth,__ATOMIC_RELAXED);
+    while (depth > maxDepth && !__atomic_compare_exchange_n(&stats->maxDepth,&maxDepth,
+            depth,true,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+
+    workQueue* queue = cw->queues + priorityIndex(item->priority);
+    workItem* head = __atomic_load_n(&queue->head,__ATOMIC_RELAXED);
+    do
+    {
+        item->next = head;
+    } while (!__atomic_compare_exchange_n(&queue->head,&head,item,true,
+            __ATOMIC_RELEASE,__ATOMIC_RELAXED));
+
+    // A handler on this processor gets it run on its way out, anyone else has
+    // to wake the worker
+    if (!initialized)
+        return true;
+    const uint32_t flags = saveAndDisableInterrupts();
+    if (cpu != smp::cpuIndex() || smp::thisCPURead(interruptNesting) == 0)
+        wakeWorker(cw);
+    restoreInterrupts(flags);
+
+    return true;
+}
+
+bool kernel::deferred::queueWork(workItem* item)
+{
+    const uint32_t flags = saveAndDisableInterrupts();
+    const size_t cpu = smp::cpuIndex();
+    const bool queued = queueWorkOn(cpu,item);
+    restoreInterrupts(flags);
+    return queued;
+}
+
+void kernel::deferred::init()
+{
+    smp::cpuMask online = smp::onlineMask();
+    while (online != 0)
+    {
+        const int index = __builtin_ctz(online);
+        online &= online - 1;
+        work[index].worker = sched::createThread(&workerThread,work + index,
+                sched::PRIORITY_HIGH,"deferred",index);
+    }
+    __atomic_store_n(&initialized,true,__ATOMIC_RELEASE);
+
+    // Anything queued before now
+    online = smp::onlineMask();
+    while (online != 0)
+    {
+        const int index = __builtin_ctz(online);
+        online &= online - 1;
+        if (hasWork(work + index))
+            wakeWorker(work + index);
+    }
+}
+
+void kernel::deferred::interruptEnter()
+{
+    if (!initialized)
+        return;
+    smp::thisCPUInc(interruptNesting);
+}
+
+void kernel::deferred::interruptExit()
+{
+    if (!initialized)
+        return;
+
+    // 0 if we came in before init()
+    const uint32_t nesting = smp::thisCPURead(interruptNesting);
+    if (nesting == 0)
+        return;
+    smp::thisCPUDec(interruptNesting);
+
+    cpuWork* cw = work + smp::cpuIndex();
+    if (nesting != 1 || !hasWork(cw))
+        return;
+
+    // The worker has it, and might be past its last look at the queues
+    if (cw->draining)
+    {
+        wakeWorker(cw);
+        return;
+    }
+
+    // Run with interrupts enabled, but stay on this thread: a nested
+    // interrupt sees draining set and leaves the queues alone
+    cw->draining = true;
+    sched::thread* current = sched::currentThread();
+    if (current != nullptr)
+        current->preemptCount++;
+    enableInterrupts();
+
+    const bool done = drain(cw,IRQ_EXIT_BUDGET);
+
+    disableInterrupts();
+    if (current != nullptr)
+        current->preemptCount--;
+    cw->draining = false;
+
+    if (!done)
+        wakeWorker(cw);
+}
+
+const workStats* kernel::deferred::getStats(size_t cpu, workPriority priority)
+{
+    if (cpu >= smp::cpuCount())
+        return nullptr;
+    return work[cpu].stats + priorityIndex(priority);
+}
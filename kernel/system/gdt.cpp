@@ -0,0 +1,88 @@
+/**
+ * @file gdt.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from gdt.hpp
+ * @version 0.1
+ * @date 2025-03-02
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/system/gdt.hpp>
+#include <kernelInternal/gdt.h>
+#include <klib/string.h>
+
+// Access bytes
+static const uint8_t ACCESS_KCODE =     0x9a;
+static const uint8_t ACCESS_KDATA =     0x92;
+static const uint8_t ACCESS_UCODE =     0xfa;
+static const uint8_t ACCESS_UDATA =     0xf2;
+static const uint8_t ACCESS_TSS =       0x89; // Present, 32-bit available TSS
+
+// Flags (high nibble of byte 6)
+static const uint8_t FLAGS_FLAT =       0xc; // 4K granularity, 32-bit
+
+void kernel::globalDescriptorTable::setEntry(uint16_t selector, uint32_t base,
+        uint32_t limit, uint8_t access, uint8_t flags)
+{
+    segmentDescriptor* entry = _table + selector / sizeof(segmentDescriptor);
+    entry->limit_low = limit & 0xffff;
+    entry->base_low = base & 0xffff;
+    entry->base_mid = (base >> 16) & 0xff;
+    entry->access = access;
+    entry->flags_limit_high = static_cast<uint8_t>((flags << 4) | ((limit >> 16) & 0xf));
+    entry->base_high = (base >> 24) & 0xff;
+}
+
+void kernel::globalDescriptorTable::init(uint32_t perCPUBase, uint32_t kernelStack)
+{
+    memset(_table,0,sizeof(_table));
+    memset(&_tss,0,sizeof(_tss));
+
+    // Same flat segments boot.S uses
+    setEntry(CODE32_KSEGMENT,0,0xfffff,ACCESS_KCODE,FLAGS_FLAT);
+    setEntry(DATA32_KSEGMENT,0,0xfffff,ACCESS_KDATA,FLAGS_FLAT);
+    setEntry(CODE32_USEGMENT,0,0xfffff,ACCESS_UCODE,FLAGS_FLAT);
+    setEntry(DATA32_USEGMENT,0,0xfffff,ACCESS_UDATA,FLAGS_FLAT);
+
+    // TSS, only the ring 0 stack matters
+    _tss.ss0 = DATA32_KSEGMENT;
+    _tss.esp0 = kernelStack;
+    _tss.iomap_base = sizeof(taskStateSegment);
+    setEntry(TSS_KSEGMENT,reinterpret_cast<uint32_t>(&_tss),
+            sizeof(taskStateSegment) - 1,ACCESS_TSS,0);
+
+    // Per-cpu data segment, flat but shifted. Offsets are addresses in the
+    // .percpu template, and the base moves them to this processor's copy
+    setEntry(PERCPU_KSEGMENT,perCPUBase,0xfffff,ACCESS_KDATA,FLAGS_FLAT);
+}
+
+kernel::globalDescriptorTableRegister kernel::globalDescriptorTable::getRegister()
+{
+    globalDescriptorTableRegister gdtr;
+    gdtr.size = sizeof(_table) - 1;
+    gdtr.address = reinterpret_cast<uint32_t>(_table);
+    return gdtr;
+}
+
+void kernel::globalDescriptorTable::load()
+{
+    globalDescriptorTableRegister gdtr = getRegister();
+
+    __asm__ __volatile__ (
+        "lgdt %0\n\t"
+        "ljmp %1, $1f\n"
+        "1:\n\t"
+        "mov %2, %%ds\n\t"
+        "mov %2, %%es\n\t"
+        "mov %2, %%fs\n\t"
+        "mov %2, %%ss\n\t"
+        "mov %3, %%gs\n\t"
+        "ltr %4"
+        :
+        : "m"(gdtr), "i"(CODE32_KSEGMENT), "r"(DATA32_KSEGMENT),
+          "r"(PERCPU_KSEGMENT), "r"(static_cast<uint16_t>(TSS_KSEGMENT))
+        : "memory"
+    );
+}
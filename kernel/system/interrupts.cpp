@@ -15,9 +15,25 @@
 #include <klib/cpuio.hpp>
 #include <kernelInternal/devices/cpu/pic.hpp>
 #include <klib/io.hpp>
+#include <kernelInternal/devices/cpu/apic.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/system/deferred.hpp>
+#include <kernelInternal/sync/rcu.hpp>
 
 extern "C" void *_handler_stub_table[];
 
+static kernel::interruptHandler_t handlerTable[IDT_SIZE];
+
+bool kernel::setInterruptHandler(uint8_t vector, interruptHandler_t handler)
+{
+    if (vector == SPURIOUS_VECTOR)
+        return false;
+
+    // Read without locks by the dispatcher
+    kernel::rcu::assignPointer(handlerTable[vector],handler);
+    return true;
+}
+
 bool kernel::interruptDescriptorTable::installInterrupt(uint8_t vector,
             void* handler, uint8_t dpl)
 {
@@ -111,12 +127,30 @@ void interruptHandler( kernel::isr_frame_t isr_frame )
     // For now, let's just call an early panic
     uint32_t vector = isr_frame.intNumber;
 
-    if (vector == 0xff) // Spurious interrupt
+    if (vector == kernel::SPURIOUS_VECTOR) // Spurious interrupt, no EOI
     {
         out << "Warning: Spurious interrupt caught\n";
         return;
     }
 
+    // Interrupt handlers are RCU read sections
+    kernel::interruptHandler_t handler = kernel::rcu::dereference(handlerTable[vector]);
+    if (handler != nullptr)
+    {
+        kernel::deferred::interruptEnter();
+        handler(&isr_frame);
+        if (vector >= kernel::FIRST_EXTERNAL_VECTOR)
+            kernel::cpu::getLocalAPIC()->eoi();
+
+        // Bottom halves, with interrupts enabled again
+        kernel::deferred::interruptExit();
+
+        // Preemption point, after the EOI so the next thread can take
+        // interrupts
+        kernel::sched::onInterruptExit();
+        return;
+    }
+
     out << " INFO: Interrupt called with vector 0x" << vector << "\n";
     
 
@@ -0,0 +1,229 @@
+/**
+ * @file log.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from log.hpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/system/log.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/system/clock.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <klib/io.hpp>
+#include <klib/string.h>
+
+using namespace kernel::log;
+
+/**
+ * @brief A line in a ring. sequence says whose turn it is: the slot's position
+ * while it's free for the writer, one past it once there's a record in it for
+ * the flusher, and a lap later when the flusher is done with it
+ * 
+ */
+struct record
+{
+    volatile uint32_t   sequence;
+    uint8_t             level;
+    uint8_t             cpu;
+    uint16_t            length;
+    uint64_t            tsc;
+    char                text[RECORD_TEXT_SIZE];
+};
+
+static_assert(sizeof(record) == 128, "Records should be two cache lines");
+
+/**
+ * @brief A processor's ring. Only the processor writes to it, with interrupts
+ * off for the copy, so writers need no atomics among themselves. The flusher
+ * is the only reader, and sequence hands each record over
+ * 
+ */
+struct alignas(64) cpuLog
+{
+    /* Next position to write, and to read */
+    uint32_t            head;
+    uint32_t            tail;
+
+    record*             records;
+    logStats            stats;
+};
+
+static cpuLog logs[kernel::smp::MAX_CPUS];
+static size_t logCount = 0;
+static bool initialized = false;
+
+static kernel::sched::thread* flusher = nullptr;
+
+/* Set when there's something for the flusher, so only the first line wakes it */
+static bool flushPending = false;
+
+/* Whoever is writing the rings out, only one at a time. Held for a batch of
+   lines, so the flusher can be preempted between batches but not inside one */
+static kernel::sync::spinlock drainLock;
+static const uint32_t DRAIN_BATCH =         16;
+
+static const char LEVEL_LETTERS[] = "EWIDT";
+
+/**
+ * @brief Write a line out: "[seconds.micros] cpu L text"
+ * 
+ */
+static void writeLine(const record* r)
+{
+    const uint64_t micros = kernel::clock::cyclesToNanoseconds(r->tsc) / 1000;
+    char prefix[48];
+    const size_t length = io::formatTo(prefix,sizeof(prefix),"[{:5}.{:06}] {} {} ",
+            micros / 1000000,micros % 1000000,r->cpu,LEVEL_LETTERS[r->level]);
+
+    out.writeString(prefix,length);
+    out.writeString(r->text,r->length);
+    out.writeString("\n",1);
+}
+
+/**
+ * @brief The oldest record in a ring, if its writer is done with it
+ * 
+ */
+static record* peek(cpuLog* log)
+{
+    record* r = log->records + (log->tail & (RING_RECORDS - 1));
+    if (__atomic_load_n(&r->sequence,__ATOMIC_ACQUIRE) != log->tail + 1)
+        return nullptr;
+    return r;
+}
+
+/**
+ * @brief Write out up to a batch of lines, oldest first across processors
+ * 
+ * @return true The rings are empty
+ */
+static bool drain()
+{
+    drainLock.lock();
+    for (uint32_t lines = 0; lines < DRAIN_BATCH; lines++)
+    {
+        cpuLog* oldest = nullptr;
+        record* first = nullptr;
+        for (size_t i = 0; i < logCount; i++)
+        {
+            record* r = peek(logs + i);
+            if (r != nullptr && (first == nullptr || r->tsc < first->tsc))
+            {
+                oldest = logs + i;
+                first = r;
+            }
+        }
+        if (first == nullptr)
+        {
+            drainLock.unlock();
+            return true;
+        }
+
+        // Copied out, so the writer has the slot back while the line is slow
+        // to write
+        record copy;
+        memcpy(&copy,first,sizeof(copy));
+        __atomic_store_n(&first->sequence,oldest->tail + RING_RECORDS,__ATOMIC_RELEASE);
+        oldest->tail++;
+        writeLine(&copy);
+    }
+    drainLock.unlock();
+    return false;
+}
+
+static void flusherThread(void*)
+{
+    while (true)
+    {
+        // Cleared first: a line that comes in while draining wakes us again,
+        // and block() returns right away
+        __atomic_store_n(&flushPending,false,__ATOMIC_RELEASE);
+        while (!drain());
+        kernel::sched::block();
+    }
+}
+
+void kernel::log::write(level l, const char* text, size_t length)
+{
+    if (length > RECORD_TEXT_SIZE)
+        length = RECORD_TEXT_SIZE;
+    if (length != 0 && text[length - 1] == '\n')
+        length--;
+
+    if (!__atomic_load_n(&initialized,__ATOMIC_ACQUIRE))
+    {
+        record r;
+        r.level = static_cast<uint8_t>(l);
+        r.cpu = 0;
+        r.length = static_cast<uint16_t>(length);
+        r.tsc = clock::readTSC();
+        memcpy(r.text,text,length);
+        writeLine(&r);
+        return;
+    }
+
+    const uint32_t flags = saveAndDisableInterrupts();
+    const uint32_t index = smp::cpuIndex();
+    cpuLog* log = logs + index;
+    const uint32_t position = log->head;
+    record* r = log->records + (position & (RING_RECORDS - 1));
+    if (__atomic_load_n(&r->sequence,__ATOMIC_ACQUIRE) != position)
+    {
+        // The flusher is a lap behind
+        log->stats.dropped++;
+        restoreInterrupts(flags);
+        return;
+    }
+
+    r->level = static_cast<uint8_t>(l);
+    r->cpu = static_cast<uint8_t>(index);
+    r->length = static_cast<uint16_t>(length);
+    r->tsc = clock::readTSC();
+    memcpy(r->text,text,length);
+    __atomic_store_n(&r->sequence,position + 1,__ATOMIC_RELEASE);
+    log->head = position + 1;
+    log->stats.written++;
+    restoreInterrupts(flags);
+
+    if (!__atomic_exchange_n(&flushPending,true,__ATOMIC_ACQ_REL))
+        sched::wake(flusher);
+}
+
+void kernel::log::init()
+{
+    logCount = smp::cpuCount();
+    for (size_t i = 0; i < logCount; i++)
+    {
+        logs[i].records = new record[RING_RECORDS];
+        if (logs[i].records == nullptr)
+            earlyPanic("Error: No memory for the log rings!");
+        for (uint32_t slot = 0; slot < RING_RECORDS; slot++)
+            logs[i].records[slot].sequence = slot;
+    }
+
+    // Lines wait for whatever else there is to do
+    flusher = sched::createThread(&flusherThread,nullptr,sched::PRIORITY_LOW,"log");
+    if (flusher == nullptr)
+        earlyPanic("Error: No memory for the log thread!");
+    __atomic_store_n(&initialized,true,__ATOMIC_RELEASE);
+}
+
+void kernel::log::flush()
+{
+    if (!__atomic_load_n(&initialized,__ATOMIC_ACQUIRE))
+        return;
+    while (!drain());
+}
+
+logStats kernel::log::getStats(size_t cpu)
+{
+    if (cpu >= logCount)
+        return {0,0};
+    return logs[cpu].stats;
+}
@@ -0,0 +1,276 @@
+/**
+ * @file smp.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from smp.hpp
+ * @version 0.1
+ * @date 2025-03-02
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/system/smp.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/devices/cpu/pit.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <kernelInternal/mm/paging.hpp>
+#include <klib/string.h>
+#include <klib/cstdlib.hpp>
+#include <earlyLib/memory.hpp>
+
+using namespace kernel::smp;
+
+extern "C" {
+    extern uint8_t _apTrampolineStart[];
+    extern uint8_t _apTrampolineEnd[];
+    extern uint8_t _apTrampolineGDTR[];
+    extern uint8_t stack_top[];
+
+    // Read by the trampoline, one AP at a time
+    uint32_t apBootStackTop;
+    uint32_t apBootIndex;
+}
+
+static perCPU cpus[MAX_CPUS];
+
+DEFINE_PER_CPU(perCPU*, kernel::smp::cpuBlock) = nullptr;
+DEFINE_PER_CPU(uint32_t, kernel::smp::cpuNumber) = 0;
+DEFINE_PER_CPU(uint32_t, kernel::smp::localOffset) = 0;
+
+// Where each processor's copy of .percpu is, relative to the template
+static uint32_t perCPUOffsets[MAX_CPUS];
+
+__attribute__((aligned(16)))
+static uint8_t apStacks[MAX_CPUS][AP_STACK_SIZE];
+
+static size_t numCPUs = 0;
+static volatile cpuMask online = 0;
+static kernel::cpu::l_apic* bspLAPIC;
+
+// How long to wait for an AP to show up after the SIPIs, in ms
+static const uint32_t AP_STARTUP_TIMEOUT = 100;
+
+/**
+ * @brief Copy the .percpu template for a processor. Never freed
+ * 
+ * @return uint32_t Offset of the copy from the template
+ */
+static uint32_t allocatePerCPUArea()
+{
+    const size_t size = static_cast<size_t>(__percpu_end - __percpu_start);
+    // The heap only guarantees HEAP_ALIGNMENT, we want whole cache lines
+    uint8_t* raw = static_cast<uint8_t*>(kalloc(size + 64));
+    if (raw == nullptr)
+        earlyPanic("Error: No memory for the per-cpu variables, aborting!");
+    uint8_t* area = reinterpret_cast<uint8_t*>(
+            (reinterpret_cast<uint32_t>(raw) + 63) & ~uint32_t(63));
+    memcpy(area,__percpu_start,size);
+    return reinterpret_cast<uint32_t>(area) - reinterpret_cast<uint32_t>(__percpu_start);
+}
+
+/**
+ * @brief Fill in the per-cpu block, per-cpu variables and the GDT of a
+ * processor
+ * 
+ */
+static void setupCPU(size_t index, uint32_t apicID, uint32_t stackTop)
+{
+    perCPU* cpu = cpus + index;
+    cpu->index = static_cast<uint32_t>(index);
+    cpu->apicID = apicID;
+    cpu->online = false;
+    cpu->stackTop = stackTop;
+    cpu->activeCR3 = 0;
+
+    const uint32_t offset = allocatePerCPUArea();
+    perCPUOffsets[index] = offset;
+    *perCPUPointer(cpuBlock,index) = cpu;
+    *perCPUPointer(cpuNumber,index) = static_cast<uint32_t>(index);
+    *perCPUPointer(localOffset,index) = offset;
+
+    // %gs:&variable is the processor's own copy
+    cpu->gdt.init(offset,stackTop);
+}
+
+/**
+ * @brief Add a processor found in the MADT, if it's new and there's room
+ * 
+ */
+static void addCPU(uint32_t apicID)
+{
+    if (numCPUs == MAX_CPUS)
+        return; // Can't deal with more than this
+
+    for (size_t i = 0; i < numCPUs; i++)
+    {
+        if (cpus[i].apicID == apicID)
+            return; // BSP, or listed twice
+    }
+
+    setupCPU(numCPUs,apicID,
+            reinterpret_cast<uint32_t>(apStacks[numCPUs] + AP_STACK_SIZE));
+    numCPUs++;
+}
+
+size_t kernel::smp::init(acpi::acpi_madt* madt, cpu::l_apic* lapic)
+{
+    bspLAPIC = lapic;
+
+    // BSP is always index 0, and keeps running on the boot.S stack
+    const uint32_t bspID = lapic->id();
+    setupCPU(0,bspID,reinterpret_cast<uint32_t>(stack_top));
+    cpus[0].gdt.load();
+    cpus[0].online = true;
+    online = 1;
+    numCPUs = 1;
+
+    // Now the rest of the enabled processors in the MADT. APIC IDs below 255
+    // come in type 0 entries, the rest (x2APIC only) in type 9 entries
+    acpi::madt_entry_type0* entry;
+    for (size_t i = 0; (entry = reinterpret_cast<acpi::madt_entry_type0*>
+            (madt->getEntry(0,i))) != nullptr; i++)
+    {
+        if (entry->flags & acpi::MADT_LAPIC_ENABLED)
+            addCPU(entry->apic_id);
+    }
+
+    acpi::madt_entry_type9* x2entry;
+    for (size_t i = 0; (x2entry = reinterpret_cast<acpi::madt_entry_type9*>
+            (madt->getEntry(9,i))) != nullptr; i++)
+    {
+        // Without x2APIC mode we can't even address these
+        if (x2entry->x2apic_id > 0xff && !lapic->isX2APIC())
+            continue;
+        if (x2entry->flags & acpi::MADT_LAPIC_ENABLED)
+            addCPU(x2entry->x2apic_id);
+    }
+
+    return numCPUs;
+}
+
+/**
+ * @brief Start a single AP, and wait until it says it's alive
+ * 
+ * @return true If the AP came up
+ */
+static bool startAP(size_t index)
+{
+    perCPU* cpu = cpus + index;
+
+    // Point the trampoline to this AP's GDT and stack
+    auto gdtr = cpu->gdt.getRegister();
+    const uint32_t gdtrOffset =
+            static_cast<uint32_t>(_apTrampolineGDTR - _apTrampolineStart);
+    memcpy(reinterpret_cast<void*>(kernel::smp::AP_TRAMPOLINE_ADDRESS + gdtrOffset),
+            &gdtr,sizeof(gdtr));
+    apBootStackTop = cpu->stackTop;
+    apBootIndex = cpu->index;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    // INIT, wait 10ms, SIPI, wait 200us, and a second SIPI if it's not up yet
+    const uint8_t vector = kernel::smp::AP_TRAMPOLINE_ADDRESS >> 12;
+    bspLAPIC->sendInitIPI(cpu->apicID);
+    kernel::cpu::pitBusyWait(10000);
+    bspLAPIC->sendStartupIPI(cpu->apicID,vector);
+    kernel::cpu::pitBusyWait(200);
+    if (!cpu->online)
+        bspLAPIC->sendStartupIPI(cpu->apicID,vector);
+
+    for (uint32_t ms = 0; ms < AP_STARTUP_TIMEOUT && !cpu->online; ms++)
+        kernel::cpu::pitBusyWait(1000);
+
+    return cpu->online;
+}
+
+size_t kernel::smp::startAPs()
+{
+    // Copy the trampoline below 1 MiB
+    memcpy(reinterpret_cast<void*>(AP_TRAMPOLINE_ADDRESS),_apTrampolineStart,
+            static_cast<size_t>(_apTrampolineEnd - _apTrampolineStart));
+
+    size_t started = 1;
+    // APs are started one at a time, since they share the trampoline and boot
+    // variables
+    for (size_t i = 1; i < numCPUs; i++)
+    {
+        if (startAP(i))
+        {
+            __atomic_or_fetch(&online,cpuMask(1) << i,__ATOMIC_SEQ_CST);
+            started++;
+        }
+    }
+
+    return started;
+}
+
+uint32_t kernel::smp::perCPUOffset(size_t cpu)
+{
+    if (cpu >= MAX_CPUS)
+        return 0;
+    return perCPUOffsets[cpu];
+}
+
+size_t kernel::smp::cpuCount()
+{
+    return numCPUs;
+}
+
+perCPU* kernel::smp::getCPU(size_t index)
+{
+    if (index >= numCPUs)
+        return nullptr;
+    return cpus + index;
+}
+
+cpuMask kernel::smp::onlineMask()
+{
+    return online;
+}
+
+void kernel::smp::sendIPI(cpuMask mask, uint8_t vector)
+{
+    mask &= online;
+    while (mask != 0)
+    {
+        const int index = __builtin_ctz(mask);
+        mask &= mask - 1;
+        bspLAPIC->sendIPI(cpus[index].apicID,vector);
+    }
+}
+
+void kernel::smp::broadcastIPI(uint8_t vector)
+{
+    // Shorthand is only safe once everyone is up, otherwise processors that
+    // are still waiting for the SIPI get it too
+    const cpuMask all = numCPUs == MAX_CPUS ? ~cpuMask(0) : (cpuMask(1) << numCPUs) - 1;
+    if (online == all)
+        bspLAPIC->broadcastIPI(vector,false);
+    else
+        sendIPI(online & ~(cpuMask(1) << cpuIndex()),vector);
+}
+
+void apMain(uint32_t index)
+{
+    perCPU* cpu = cpus + index;
+
+    // Get on our own GDT, TSS, and per-cpu segment
+    cpu->gdt.load();
+    kernel::mm::initCPU();
+
+    // Every processor has its own local APIC, at the same address
+    bspLAPIC->enable();
+
+    // Same IDT as everyone else
+    kernel::interruptDescriptorTable idt;
+    idt.loadIDT();
+    kernel::syscall::initCPU();
+
+    // This context becomes our idle thread
+    kernel::sched::initCPU();
+
+    // Tell the BSP we're alive
+    __atomic_store_n(&cpu->online,true,__ATOMIC_RELEASE);
+
+    kernel::sched::idle();
+}
@@ -0,0 +1,202 @@
+/**
+ * @file tlb.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from tlb.hpp
+ * @version 0.1
+ * @date 2025-03-05
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/system/tlb.hpp>
+#include <kernelInternal/system/smp.hpp>
+#include <kernelInternal/system/interrupts.hpp>
+#include <kernelInternal/sched/scheduler.hpp>
+
+using namespace kernel::tlb;
+using kernel::smp::cpuMask;
+
+/**
+ * @brief What an initiator wants the others to invalidate. Each processor has
+ * its own, so several shootdowns can be in flight at the same time
+ * 
+ */
+struct shootdownRequest
+{
+    uint32_t            cr3;
+    bool                flushAll;
+    size_t              count;
+    range               ranges[BATCH_RANGES];
+
+    /* Number of targets that haven't finished yet */
+    volatile uint32_t   pendingAcks;
+};
+
+// Indexed by initiator
+static shootdownRequest requests[kernel::smp::MAX_CPUS];
+
+// Indexed by target: set of initiators it still has to serve
+static volatile cpuMask pendingFrom[kernel::smp::MAX_CPUS];
+
+static void invalidate(const range* ranges, size_t count, bool flushAll)
+{
+    if (flushAll)
+    {
+        flushLocal();
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t address = ranges[i].start;
+        for (uint32_t page = 0; page < ranges[i].pages; page++, address += PAGE_SIZE)
+            invalidatePage(address);
+    }
+}
+
+static inline bool inAddressSpace(uint32_t cr3, uint32_t activeCR3)
+{
+    return cr3 == ALL_ADDRESS_SPACES || cr3 == activeCR3;
+}
+
+/**
+ * @brief Serve every request pending for this processor
+ * 
+ */
+static void processPending()
+{
+    kernel::smp::perCPU* cpu = kernel::smp::thisCPU();
+    cpuMask from = __atomic_exchange_n(&pendingFrom[cpu->index],0,__ATOMIC_ACQ_REL);
+
+    while (from != 0)
+    {
+        shootdownRequest* request = requests + __builtin_ctz(from);
+        from &= from - 1;
+
+        // If we left that address space in the meantime, the CR3 load already
+        // flushed everything
+        if (inAddressSpace(request->cr3,cpu->activeCR3))
+            invalidate(request->ranges,request->count,request->flushAll);
+
+        __atomic_sub_fetch(&request->pendingAcks,1,__ATOMIC_RELEASE);
+    }
+}
+
+static void shootdownHandler(kernel::isr_frame_t*)
+{
+    processPending();
+}
+
+void kernel::tlb::init()
+{
+    kernel::setInterruptHandler(kernel::IPI_TLB_SHOOTDOWN_VECTOR,&shootdownHandler);
+}
+
+void kernel::tlb::setActiveAddressSpace(uint32_t cr3)
+{
+    kernel::smp::thisCPU()->activeCR3 = cr3;
+    // Has to be visible before the CR3 load, see shootdownBatch::flush()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void shootdownBatch::add(uint32_t address, uint32_t pages)
+{
+    if (_flushAll || pages == 0)
+        return;
+
+    address &= ~(PAGE_SIZE - 1);
+    _pages += pages;
+    if (_pages > FULL_FLUSH_THRESHOLD)
+    {
+        _flushAll = true;
+        return;
+    }
+
+    // Extend the last range if this one follows it, which is the usual case
+    // when unmapping a region page by page
+    if (_count != 0 && _ranges[_count-1].start + _ranges[_count-1].pages * PAGE_SIZE == address)
+    {
+        _ranges[_count-1].pages += pages;
+        return;
+    }
+
+    if (_count == BATCH_RANGES)
+    {
+        _flushAll = true;
+        return;
+    }
+
+    _ranges[_count].start = address;
+    _ranges[_count].pages = pages;
+    _count++;
+}
+
+void shootdownBatch::flush()
+{
+    if (!_flushAll && _count == 0)
+        return;
+
+    // We can't move to another processor halfway through, the local flush
+    // and the request slot are this processor's
+    kernel::sched::preemptDisable();
+    kernel::smp::perCPU* self = kernel::smp::thisCPU();
+
+    if (inAddressSpace(_cr3,self->activeCR3))
+        invalidate(_ranges,_count,_flushAll);
+
+    // The page table changes must be visible before we look at who is in the
+    // address space: anyone switching in after this point reloads CR3 with
+    // the new tables, anyone already in it is in targets
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    cpuMask targets = 0;
+    uint32_t targetCount = 0;
+    cpuMask others = kernel::smp::onlineMask() & ~(cpuMask(1) << self->index);
+    while (others != 0)
+    {
+        const int index = __builtin_ctz(others);
+        others &= others - 1;
+        if (inAddressSpace(_cr3,kernel::smp::getCPU(static_cast<size_t>(index))->activeCR3))
+        {
+            targets |= cpuMask(1) << index;
+            targetCount++;
+        }
+    }
+
+    if (targets != 0)
+    {
+        shootdownRequest* request = requests + self->index;
+        request->cr3 = _cr3;
+        request->flushAll = _flushAll;
+        request->count = _count;
+        for (size_t i = 0; i < _count; i++)
+            request->ranges[i] = _ranges[i];
+        request->pendingAcks = targetCount;
+
+        // Publish the request, then one IPI per target for the whole batch
+        cpuMask remaining = targets;
+        while (remaining != 0)
+        {
+            const int index = __builtin_ctz(remaining);
+            remaining &= remaining - 1;
+            __atomic_or_fetch(&pendingFrom[index],cpuMask(1) << self->index,
+                    __ATOMIC_RELEASE);
+        }
+        kernel::smp::sendIPI(targets,kernel::IPI_TLB_SHOOTDOWN_VECTOR);
+
+        // Keep serving other initiators while we wait, or two processors
+        // shooting at each other would wait forever
+        while (__atomic_load_n(&request->pendingAcks,__ATOMIC_ACQUIRE) != 0)
+        {
+            processPending();
+            __asm__ __volatile__ ("pause");
+        }
+    }
+
+    _count = 0;
+    _pages = 0;
+    _flushAll = false;
+
+    kernel::sched::preemptEnable();
+}
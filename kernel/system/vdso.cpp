@@ -0,0 +1,68 @@
+/**
+ * @file vdso.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from vdso.hpp
+ * @version 0.1
+ * @date 2025-03-21
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <kernelInternal/system/vdso.hpp>
+#include <kernelInternal/mm/frames.hpp>
+#include <kernelInternal/sync/spinlock.hpp>
+#include <kernelInternal/syscall/syscall.hpp>
+#include <klib/cstdlib.hpp>
+
+static_assert(sizeof(vdso_data) <= kernel::mm::PAGE_SIZE, "vdso_data must fit in a page");
+static_assert(VDSO_DATA_ADDRESS % kernel::mm::PAGE_SIZE == 0, "VDSO_DATA_ADDRESS must be page aligned");
+
+// One frame, mapped read-only by every process and written here
+static kernel::mm::memoryObject* page = nullptr;
+static vdso_data* data = nullptr;
+
+// Serializes writers. Readers only go by the sequence, they can't take locks
+static kernel::sync::spinlock writeLock;
+
+void kernel::vdso::init()
+{
+    page = mm::memoryObject::create(1);
+    if (page == nullptr)
+        earlyPanic("vdso: out of memory for the shared page");
+
+    vdso_data* shared = static_cast<vdso_data*>(mm::frameAddress(page->frame(0)));
+    shared->version = VDSO_VERSION;
+    shared->syscallEntry = syscall::hasSysenter() ? reinterpret_cast<uint32_t>(sysenterCall) : 0;
+    __atomic_store_n(&data,shared,__ATOMIC_RELEASE);
+
+    updateClock(clock::getParameters());
+}
+
+void kernel::vdso::updateClock(const clock::clockParameters& parameters)
+{
+    vdso_data* shared = __atomic_load_n(&data,__ATOMIC_ACQUIRE);
+    if (shared == nullptr)
+        return;
+
+    // Same protocol as sync::seqlock, with the sequence in the page itself
+    const uint32_t flags = writeLock.lockIrqSave();
+    __atomic_store_n(&shared->sequence,shared->sequence + 1,__ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    shared->tscBase = parameters.tscBase;
+    shared->mult = parameters.mult;
+    shared->shift = parameters.shift;
+    shared->tscFrequency = parameters.tscFrequency;
+
+    __atomic_store_n(&shared->sequence,shared->sequence + 1,__ATOMIC_RELEASE);
+    writeLock.unlockIrqRestore(flags);
+}
+
+bool kernel::vdso::mapInto(mm::addressSpace* space)
+{
+    if (page == nullptr)
+        return false;
+    return space->addRegion(VDSO_DATA_ADDRESS,VDSO_DATA_ADDRESS + mm::PAGE_SIZE,mm::REGION_READ,
+            page,0,VDSO_DATA_ADDRESS + mm::PAGE_SIZE);
+}
@@ -15,43 +15,41 @@
 #include <klib/cstdlib.hpp>
 
 const size_t mem::heapEntry_headerSize = sizeof(mem::heapEntry);
+static_assert(mem::HEAP_ALIGNMENT % sizeof(mem::heapEntry) == 0);
 
 static mem::heapEntry* heap;
 static mem::heapEntry* heapEnd;
 
 void* mem::heapEntry::allocate(size_t size)
-// BUG Deal with no memory available
 {
-    if (_next == NULL) // Reached end of list
-    {
-        return nullptr; // There's no memory left
-    }
-    
-    size_t available;
+    // Keep every header (and so every data pointer) aligned
+    size = (size + HEAP_ALIGNMENT - 1) & ~(HEAP_ALIGNMENT - 1);
 
-    // Check if we're reserved or too small
-    if (_flags.reserved || size > (available = getSize()))
+    // First fit. Iterative, the list can get long enough to blow the stack
+    heapEntry* entry = this;
+    size_t available;
+    while (entry->_flags.reserved || size > (available = entry->getSize()))
     {
-        return _next->allocate(size);
+        if (entry->_next == NULL) // Reached end of list
+            return nullptr; // There's no memory left
+        entry = entry->_next;
     }
 
     // We're gonna allocate this one
-    // TODO maybe here set a minimum size, or list can get too big
-    void* ptr = getDataPtr();
+    void* ptr = entry->getDataPtr();
 
-    if ( size - available > heapEntry_headerSize + 4 )
+    if ( available - size > heapEntry_headerSize + HEAP_ALIGNMENT )
     {
         // There's space leftover, so we split the memory
-        heapEntry* old_next = _next;
+        heapEntry* old_next = entry->_next;
 
-        _next = reinterpret_cast<heapEntry*>( 
-            reinterpret_cast<uint32_t>(ptr)
-            + static_cast<uint32_t>(size) );
-        _next->init(old_next);
+        entry->_next = reinterpret_cast<heapEntry*>( 
+            reinterpret_cast<uintptr_t>(ptr) + size );
+        entry->_next->init(old_next);
     }
 
     // Set the reserved flag
-    _flags.reserved = true;
+    entry->_flags.reserved = true;
 
     return ptr;
     
@@ -69,41 +67,77 @@ void mem::heapEntry::free()
 
 void mem::heapEntry::defragment()
 {
-    if ( !_next->_flags.reserved ) // Next one is free
-    {
+    // Swallow free blocks until we find a reserved one (the last entry is
+    // always reserved)
+    while ( !_next->_flags.reserved )
         _next = _next->_next;
-        defragment(); // Goes until it finds a reserved block
+}
+
+/**
+ * @brief Heap lock. Taken with interrupts disabled, so that an interrupt
+ * handler allocating can't deadlock against the code it interrupted. Built
+ * for the host, there are no interrupts to disable
+ * 
+ */
+static volatile uint32_t heapLock = 0;
+
+static inline uint32_t lockHeap()
+{
+    uint32_t flags = 0;
+#ifndef __host__
+    __asm__ __volatile__ ("pushfl\n\tpopl %0\n\tcli" : "=r"(flags) : : "memory");
+#endif
+    while (__atomic_exchange_n(&heapLock,1,__ATOMIC_ACQUIRE) != 0)
+    {
+        while (__atomic_load_n(&heapLock,__ATOMIC_RELAXED) != 0)
+            __asm__ __volatile__ ("pause");
     }
+    return flags;
+}
+
+static inline void unlockHeap([[maybe_unused]] uint32_t flags)
+{
+    __atomic_store_n(&heapLock,0,__ATOMIC_RELEASE);
+#ifndef __host__
+    if (flags & (1 << 9)) // IF
+        __asm__ __volatile__ ("sti" : : : "memory");
+#endif
 }
 
 void *kalloc(size_t size)
 {
-    return heap->allocate(size);
+    const uint32_t flags = lockHeap();
+    void* ptr = heap->allocate(size);
+    unlockHeap(flags);
+    return ptr;
 }
 
 void kfree(void* ptr)
 {
+    const uint32_t flags = lockHeap();
     mem::heapEntry* it = heap;
     while (!it->isLast())
     {
         if (it->getDataPtr() == ptr)
         {
             it->free();
+            unlockHeap(flags);
             return;
         }
         it = it->getNext();
     }
+    unlockHeap(flags);
     earlyPanic("kfree: no such memory address!");
 }
 
 void *operator new(size_t size)
 {
-    return heap->allocate(size);
+    return kalloc(size);
 }
 
 void *operator new[](size_t size)
 {
-    return heap->allocate(size);
+    return kalloc(size);
 }
 
 void operator delete(void *ptr)
@@ -129,9 +163,13 @@ void operator delete[](void *ptr, size_t size)
 
 void mem::heapInitialize(void* ptr, size_t maxSize)
 {
-    heap = reinterpret_cast<mem::heapEntry*>(ptr);
-    heapEnd = reinterpret_cast<mem::heapEntry*>(reinterpret_cast<uint32_t>(ptr)
-                                        + maxSize - mem::heapEntry_headerSize );
+    // Align both ends, so every block is aligned
+    const uintptr_t start = (reinterpret_cast<uintptr_t>(ptr) + HEAP_ALIGNMENT - 1)
+                            & ~(HEAP_ALIGNMENT - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + maxSize) & ~(HEAP_ALIGNMENT - 1);
+
+    heap = reinterpret_cast<mem::heapEntry*>(start);
+    heapEnd = reinterpret_cast<mem::heapEntry*>(end - mem::heapEntry_headerSize);
 
     heap->init(heapEnd);
 
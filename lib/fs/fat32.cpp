@@ -26,6 +26,10 @@ constexpr uint32_t clusterMask = 0xFFFFFFF;
 #define FAT_NAME_SIZE 13 // 11 chars, the '.', and '\0'
 
 const size_t sectorSize = 512;
+const size_t entriesPerSector = sectorSize / sizeof(fs::fat32_dirEntry);
+
+// Sectors readDirectory() reads at once, into the stack
+const size_t directoryChunkSectors = 4;
 
 int fs::fat32::init( uint32_t partitionLBA )
 {
@@ -50,236 +54,595 @@ int fs::fat32::init( uint32_t partitionLBA )
 }
 
 
-fs::fat32_internalDirList* fs::fat32::getInternalDirectoryList(const char* directory)
+static inline bool isClusterEnd(size_t clusterNum)
 {
-    /*// First off, read Root Dir if it's not been read before*/
-    size_t clusterNumberRoot = _vbr->bpd.clusterNumberRoot;
-    auto dirStruct = readDir( clusterNumberRoot );
+    // TODO we should check also for too high cluster num, as that also signifies
+    // EOF
 
-    // Assemble return struct
-    auto returnStruct = new fat32_internalDirList;
-    
-    char** filenameList = new char*[dirStruct->numEntries];
-    returnStruct->attr = new fat32_dirEntry_attributes[dirStruct->numEntries];
+    // Mask out unnecessary part of clusterNum
+    clusterNum = clusterNum & 0xFFFFFFF;
 
-    // FIXME We are dropping LFNs
-    for (size_t i = 0; i < dirStruct->numEntries; i++)
+    if (clusterNum >= 0xFFFFFF8 && clusterNum <= 0xFFFFFFF)
     {
-        if (dirStruct->entries[i].attributes == static_cast<uint8_t>(fat32_dirEntry_attributes::LFN))
-        {
-            char str[] = "LFN";
-            filenameList[i] = str;
-            returnStruct->attr[i] = fat32_dirEntry_attributes::LFN;
-            continue;
-        }
-
-        // Temporary storage for the file names
-        char str[FAT_NAME_SIZE];
+        return true;
+    }
     
-        // Fill up the table
-        size_t j = 0;
-        for ( ; j < 8; j++)
-        {
-            char c = char(dirStruct->entries[i].fileName[j]);
-            if(c == ' ') break;
-            str[j] = c;
-        }
-
-        if (dirStruct->entries[i].attributes != static_cast<uint8_t>(fat32_dirEntry_attributes::SUBDIRECTORY))
-        {
-            str[j++] = '.';
-            for (size_t k = 0; k < 3; k++,j++)
-            {
-                str[j] = char(dirStruct->entries[i].fileExtension[k]);
-            }
-        }
-        
-        str[j] = '\0';
-        
-        filenameList[i] = new char[strlen(str)+1];
-
-        strcpy(filenameList[i],str);
+    return false;
+}
 
-        
+/**
+ * @brief Whether an entry is something with a name: not free, deleted, an
+ * LFN, or the volume label
+ * 
+ */
+static inline bool isNamedEntry(const fs::fat32_dirEntry* entry)
+{
+    return entry->fileName[0] != 0 && entry->fileName[0] != 0xe5 &&
+            entry->attributes != static_cast<uint8_t>(fs::fat32_dirEntry_attributes::LFN) &&
+            !(entry->attributes & 0x08);
+}
 
-        returnStruct->attr[i] = static_cast<fs::fat32_dirEntry_attributes>
-                (dirStruct->entries[i].attributes);
+/**
+ * @brief Write the 8.3 name of an entry, "NAME.EXT", or "NAME" when there's
+ * no extension
+ * 
+ * @param name At least FAT_NAME_SIZE characters, gets terminated
+ * @return size_t Its length
+ */
+static size_t shortName(const fs::fat32_dirEntry* entry, char* name)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < 8 && entry->fileName[i] != ' '; i++)
+        name[length++] = char(entry->fileName[i]);
+    // 0xe5 is a real first character, stored as 0x05 so it's not a deleted entry
+    if (length != 0 && name[0] == 0x05)
+        name[0] = char(0xe5);
+
+    size_t extension = 3;
+    while (extension != 0 && entry->fileExtension[extension - 1] == ' ')
+        extension--;
+    if (extension != 0)
+    {
+        name[length++] = '.';
+        for (size_t i = 0; i < extension; i++)
+            name[length++] = char(entry->fileExtension[i]);
     }
 
-    returnStruct->list = filenameList;
-    returnStruct->size = dirStruct->numEntries;
-    returnStruct->returnCode = 0;
-    return returnStruct;
+    name[length] = '\0';
+    return length;
+}
 
+static inline char upperCase(char c)
+{
+    return c >= 'a' && c <= 'z' ? char(c - 'a' + 'A') : c;
 }
 
-fs::fat32::readDirResult* fs::fat32::readDir( size_t clusterNumber )
+// Where each character of a long name entry is, in bytes. They aren't
+// aligned, so they're copied out from there
+static const uint8_t lfnOffsets[LFN_CHARACTERS] = {1,3,5,7,9,14,16,18,20,22,24,28,30};
+
+/**
+ * @brief Where a long name is at while a directory is read, entry by entry
+ * and cluster by cluster. Only this is kept, the characters go to whoever
+ * wants them as they come
+ * 
+ */
+struct longNameState
 {
-    uint32_t cluster = _FATptr[clusterNumber] & clusterMask;
+    /* Order of the last entry of it read, 0 if there's no name going */
+    uint8_t                 order;
+    uint8_t                 checksum;
 
-    // TODO: add support for multiclusters
-    if ( (cluster & 0xFFFFFF0) != 0xFFFFFF0 &&
-            (cluster & 0xF) < 8 ) // Test if it's not end of cluster
-    {
-        earlyPanic("readDir(): No support for multiclusters right now");
-    }
-    
-    // Allocate space
-    fs::fat32_dirEntry *dirPtr = reinterpret_cast<fs::fat32_dirEntry*>
-            (new uint8_t[_vbr->bpd.sectorsPerCluster * _vbr->bpd.bytesPerSector]);
+    /* In UTF-16 characters, known from its first entry */
+    size_t                  length;
 
-    // Calculate LBA to read
-    const size_t firstDataSector = _vbr->bpd.reservedSectors +
-            (_vbr->bpd.numberOfFATs * _vbr->bpd.sectorsPerFAT);
+    /* Where that entry is */
+    uint32_t                cluster;
+    uint32_t                index;
+};
 
-    size_t currentLBA = ((clusterNumber - 2) * _vbr->bpd.sectorsPerCluster +
-            firstDataSector + _partitionLBA );
+/**
+ * @brief Upper case of a UTF-16 character, for ASCII and Latin-1
+ * 
+ */
+static inline uint16_t foldCase(uint16_t c)
+{
+    if ((c >= 'a' && c <= 'z') || (c >= 0xe0 && c <= 0xfe && c != 0xf7))
+        return static_cast<uint16_t>(c - 0x20);
+    return c;
+}
+
+/**
+ * @brief What the checksum of the long name entries of a short one should
+ * be
+ * 
+ */
+static uint8_t shortChecksum(const fs::fat32_dirEntry* entry)
+{
+    uint8_t name[11];
+    memcpy(name,entry->fileName,8);
+    memcpy(name + 8,entry->fileExtension,3);
+    uint8_t sum = 0;
+    for (uint8_t c : name)
+        sum = static_cast<uint8_t>(((sum & 1) << 7) + (sum >> 1) + c);
+    return sum;
+}
 
-    // Actually read the cluster
-    if (! (*_diskReadFunc)(currentLBA,dirPtr,_vbr->bpd.sectorsPerCluster))
+/**
+ * @brief Take the next long name entry of a directory
+ * 
+ * @param characters Filled with its LFN_CHARACTERS characters
+ * @return true It's part of a name, whose part state->order it is. If not,
+ * whatever name was going is forgotten
+ */
+static bool longNameStep(longNameState* state, const fs::fat32_dirEntry* entry, uint32_t cluster,
+            uint32_t index, uint16_t* characters)
+{
+    const fs::fat32_lfnEntry* lfn = reinterpret_cast<const fs::fat32_lfnEntry*>(entry);
+    const uint8_t* raw = reinterpret_cast<const uint8_t*>(entry);
+    for (size_t i = 0; i < LFN_CHARACTERS; i++)
+        memcpy(characters + i,raw + lfnOffsets[i],sizeof(uint16_t));
+
+    const uint8_t order = static_cast<uint8_t>(lfn->order & ~LFN_LAST_ENTRY);
+    if (lfn->order & LFN_LAST_ENTRY)
     {
-        earlyPanic("readDir(): Disk read failure!");
+        // The last part, first: it says how long the name is
+        if (order == 0 || order > LFN_MAX_ENTRIES)
+        {
+            state->order = 0;
+            return false;
+        }
+        size_t length = 0;
+        while (length < LFN_CHARACTERS && characters[length] != 0)
+            length++;
+        *state = {order,lfn->checksum,(order - 1u) * LFN_CHARACTERS + length,cluster,index};
+        return true;
     }
 
-    // Get number of entries
-    size_t numEntries = 0;
-    while (* reinterpret_cast<uint8_t*>(dirPtr + numEntries) != 0)
+    if (state->order == 0 || order != state->order - 1 || lfn->checksum != state->checksum)
     {
-        numEntries++;
+        state->order = 0;
+        return false;
     }
-    
-    // Fill up return struct
-    auto returnStruct = new readDirResult;
-    returnStruct->returnCode = 0;
-    returnStruct->numEntries = numEntries;
-    returnStruct->entries = dirPtr;
+    state->order = order;
+    return true;
+}
 
-    return returnStruct;
+/**
+ * @brief Whether the long name entries read so far are a whole name for a
+ * short entry
+ * 
+ */
+static inline bool longNameComplete(const longNameState* state, const fs::fat32_dirEntry* entry)
+{
+    return state->order == 1 && state->checksum == shortChecksum(entry);
 }
 
-const char* fs::fat32::nameFromEntry( fs::fat32_dirEntry* ptr )
+/**
+ * @brief UTF-8 to UTF-16, surrogate pairs and all
+ * 
+ * @return size_t Characters, 0 if it isn't valid UTF-8 or doesn't fit
+ */
+static size_t toUTF16(const char* name, size_t length, uint16_t* out, size_t room)
 {
-    if (ptr->attributes == static_cast<uint8_t>(fat32_dirEntry_attributes::LFN))
+    size_t count = 0;
+    for (size_t i = 0; i < length; )
     {
-        static const char lfn[] = "LFN";
-        return lfn;
+        const uint8_t first = static_cast<uint8_t>(name[i]);
+        const size_t bytes = first < 0x80 ? 1 : (first & 0xe0) == 0xc0 ? 2 :
+                (first & 0xf0) == 0xe0 ? 3 : (first & 0xf8) == 0xf0 ? 4 : 0;
+        if (bytes == 0 || i + bytes > length)
+            return 0;
+        uint32_t c = bytes == 1 ? first : first & (0x7f >> bytes);
+        for (size_t j = 1; j < bytes; j++)
+        {
+            const uint8_t next = static_cast<uint8_t>(name[i + j]);
+            if ((next & 0xc0) != 0x80)
+                return 0;
+            c = c << 6 | (next & 0x3f);
+        }
+        i += bytes;
+
+        if (c >= 0x10000)
+        {
+            if (count + 2 > room)
+                return 0;
+            c -= 0x10000;
+            out[count++] = static_cast<uint16_t>(0xd800 | c >> 10);
+            out[count++] = static_cast<uint16_t>(0xdc00 | (c & 0x3ff));
+        }
+        else
+        {
+            if (count == room)
+                return 0;
+            out[count++] = static_cast<uint16_t>(c);
+        }
     }
+    return count;
+}
 
-    // Normal file, read name
-    char* fileName = new char[FAT_NAME_SIZE];
-    
-    size_t i = 0;
-    for ( ; i < 8; i++)
+/**
+ * @brief UTF-16 to UTF-8. Surrogates that aren't in pairs come out as '?'
+ * 
+ * @param out At least 3 bytes a character, and the terminator
+ * @return size_t Its length
+ */
+static size_t toUTF8(const uint16_t* name, size_t length, char* out)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++)
     {
-        char c = char(ptr->fileName[i]);
-        if(c == ' ') break;
-        fileName[i] = c;
+        uint32_t c = name[i];
+        if (c >= 0xd800 && c < 0xdc00 && i + 1 < length && name[i + 1] >= 0xdc00 &&
+                name[i + 1] < 0xe000)
+            c = 0x10000 + ((c - 0xd800) << 10 | (name[++i] - 0xdc00u));
+        else if (c >= 0xd800 && c < 0xe000)
+            c = '?';
+
+        if (c < 0x80)
+            out[count++] = char(c);
+        else if (c < 0x800)
+        {
+            out[count++] = char(0xc0 | c >> 6);
+            out[count++] = char(0x80 | (c & 0x3f));
+        }
+        else if (c < 0x10000)
+        {
+            out[count++] = char(0xe0 | c >> 12);
+            out[count++] = char(0x80 | (c >> 6 & 0x3f));
+            out[count++] = char(0x80 | (c & 0x3f));
+        }
+        else
+        {
+            out[count++] = char(0xf0 | c >> 18);
+            out[count++] = char(0x80 | (c >> 12 & 0x3f));
+            out[count++] = char(0x80 | (c >> 6 & 0x3f));
+            out[count++] = char(0x80 | (c & 0x3f));
+        }
     }
+    out[count] = '\0';
+    return count;
+}
 
-    // Check if it's normal file
-    if (ptr->attributes != static_cast<uint8_t>(fat32_dirEntry_attributes::SUBDIRECTORY))
+/**
+ * @brief How long toUTF8() would make a name, without writing it
+ * 
+ */
+static size_t lengthUTF8(const uint16_t* name, size_t length)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++)
     {
-        fileName[i++] = '.';
-        for (size_t j = 0; j < 3; j++,i++)
+        const uint16_t c = name[i];
+        if (c >= 0xd800 && c < 0xdc00 && i + 1 < length && name[i + 1] >= 0xdc00 &&
+                name[i + 1] < 0xe000)
         {
-            fileName[i] = char(ptr->fileExtension[j]);
+            count += 4;
+            i++;
         }
+        else
+            count += c < 0x80 ? 1 : c < 0x800 ? 2 : 3;
     }
+    return count;
+}
 
-    fileName[i] = '\0';
+uint32_t fs::fat32::nextCluster( uint32_t cluster ) const
+{
+    // Anything past the end of the FAT is as good as the end of the chain
+    const size_t FATentries = _vbr->bpd.sectorsPerFAT * sectorSize / 4;
+    if (cluster >= FATentries)
+        return clusterMask;
+    return _FATptr[cluster] & clusterMask;
+}
 
-    return fileName;
+bool fs::fat32::isChainEnd(uint32_t cluster)
+{
+    // 0xFFFFFF7 marks a bad cluster, which no chain should lead to
+    return cluster < 2 || (cluster & clusterMask) == 0xFFFFFF7 || isClusterEnd(cluster);
 }
 
-static inline bool isClusterEnd(size_t clusterNum)
+uint64_t fs::fat32::clusterLBA(uint32_t cluster) const
 {
-    // TODO we should check also for too high cluster num, as that also signifies
-    // EOF
+    const uint64_t firstDataSector = _vbr->bpd.reservedSectors +
+            static_cast<uint64_t>(_vbr->bpd.numberOfFATs) * _vbr->bpd.sectorsPerFAT;
+    return static_cast<uint64_t>(cluster - 2) * _vbr->bpd.sectorsPerCluster + firstDataSector +
+            _partitionLBA;
+}
 
-    // Mask out unnecessary part of clusterNum
-    clusterNum = clusterNum & 0xFFFFFFF;
+uint32_t fs::fat32::clusterEnd() const
+{
+    const uint32_t sectors = _vbr->bpd.totalSectors != 0 ? _vbr->bpd.totalSectors :
+            _vbr->bpd.largeSectorCount;
+    const uint32_t dataStart = _vbr->bpd.reservedSectors +
+            static_cast<uint32_t>(_vbr->bpd.numberOfFATs) * _vbr->bpd.sectorsPerFAT;
+    const uint32_t FATentries = static_cast<uint32_t>(_vbr->bpd.sectorsPerFAT * sectorSize / 4);
+    const uint32_t end = sectors > dataStart ?
+            (sectors - dataStart) / _vbr->bpd.sectorsPerCluster + 2 : 2;
+    return end < FATentries ? end : FATentries;
+}
 
-    if (clusterNum >= 0xFFFFFF8 && clusterNum <= 0xFFFFFFF)
+bool fs::fat32::readCluster( uint32_t cluster, void* buffer )
+{
+    return (*_diskReadFunc)(clusterLBA(cluster),buffer,_vbr->bpd.sectorsPerCluster);
+}
+
+int fs::fat32::readDirectory(uint32_t directoryCluster, uint32_t* cursor, void* buffer,
+            size_t size)
+{
+    const uint32_t perCluster = static_cast<uint32_t>(clusterSize() / sizeof(fat32_dirEntry));
+    const size_t sectorsPerCluster = _vbr->bpd.sectorsPerCluster;
+
+    // The cursor is an entry of the directory, counting from its first
+    uint32_t cluster = directoryCluster;
+    for (uint32_t skip = *cursor / perCluster; skip != 0 && !isChainEnd(cluster); skip--)
+        cluster = nextCluster(cluster);
+
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    size_t filled = 0;
+    fat32_dirEntry chunk[directoryChunkSectors * entriesPerSector];
+    longNameState state = {};
+    uint16_t longName[LFN_MAX_ENTRIES * LFN_CHARACTERS];
+
+    uint32_t position = *cursor;
+    for (; !isChainEnd(cluster); cluster = nextCluster(cluster))
     {
-        return true;
+        for (size_t sector = position % perCluster / entriesPerSector; sector < sectorsPerCluster;
+                sector += directoryChunkSectors)
+        {
+            const size_t count = sectorsPerCluster - sector < directoryChunkSectors ?
+                    sectorsPerCluster - sector : directoryChunkSectors;
+            if (!readSectors(clusterLBA(cluster) + sector,chunk,count))
+                return -2;
+
+            for (size_t i = position % entriesPerSector; i < count * entriesPerSector; i++, position++)
+            {
+                const fat32_dirEntry* entry = chunk + i;
+                // A free entry ends the directory
+                if (entry->fileName[0] == 0)
+                {
+                    *cursor = position;
+                    return static_cast<int>(filled);
+                }
+
+                if (entry->attributes == static_cast<uint8_t>(fat32_dirEntry_attributes::LFN) &&
+                        entry->fileName[0] != 0xe5)
+                {
+                    uint16_t characters[LFN_CHARACTERS];
+                    if (longNameStep(&state,entry,cluster,0,characters))
+                        memcpy(longName + (state.order - 1) * LFN_CHARACTERS,characters,
+                                sizeof(characters));
+                }
+                else if (isNamedEntry(entry))
+                {
+                    const bool hasLongName = longNameComplete(&state,entry) &&
+                            state.length <= LFN_MAX_LENGTH;
+                    char shortBuffer[FAT_NAME_SIZE];
+                    const size_t nameLength = hasLongName ? lengthUTF8(longName,state.length) :
+                            shortName(entry,shortBuffer);
+                    const size_t length = (sizeof(fat32_dirRecord) + nameLength + 1 + 3) & ~size_t(3);
+                    if (filled + length > size)
+                        return filled != 0 ? static_cast<int>(filled) : -1;
+
+                    fat32_dirRecord* record = reinterpret_cast<fat32_dirRecord*>(out + filled);
+                    *record = {entry->size,firstCluster(entry),position + 1,cluster,
+                            static_cast<uint16_t>(length),static_cast<uint16_t>(nameLength),
+                            static_cast<uint16_t>(position % perCluster),entry->attributes,0};
+                    char* name = reinterpret_cast<char*>(record + 1);
+                    if (hasLongName)
+                        toUTF8(longName,state.length,name);
+                    else
+                        memcpy(name,shortBuffer,nameLength + 1);
+                    filled += length;
+                    state.order = 0;
+                }
+                else
+                    state.order = 0;
+
+                // A long name that's going has to be read again from its
+                // start, so the cursor waits for it to be done
+                if (state.order == 0)
+                    *cursor = position + 1;
+            }
+        }
     }
-    
-    return false;
-}
 
+    *cursor = position;
+    return static_cast<int>(filled);
+}
 
 fs::fat32_fileResult* fs::fat32::getRootFile(const char* file)
 {
-    // Read the root directory
-    size_t clusterNumberRoot = _vbr->bpd.clusterNumberRoot;
-    auto directory = readDir( clusterNumberRoot );
-
     auto returnStruct = new fat32_fileResult;
+    returnStruct->returnCode=1;
+    returnStruct->ptr=nullptr;
+    returnStruct->size=0;
 
-    if (directory->returnCode)
+    fat32_dirEntry entry;
+    const int found = lookup(_vbr->bpd.clusterNumberRoot,file,strlen(file),&entry,nullptr);
+    if (found == 2)
     {
         earlyPanic("getRootFile(): Failure reading directory!");
     }
+    if (found != 0)
+    {
+        // If we get here, no file was found
+        return returnStruct;
+    }
 
-    // Read each entry
-    for (size_t i = 0; i < directory->numEntries; i++)
+    #ifdef TRACEMAX
+        traceOut << "Found the file!\n";
+        traceOut << "cluster number is " << firstCluster(&entry) << "\n";
+        traceOut << "File size is " << entry.size << "\n";
+    #endif
+
+    // Final file buffer
+    const size_t numSectors = entry.size / sectorSize + 1;
+    uint8_t* buffer = new uint8_t[numSectors * sectorSize];
+
+    if (readFile(&entry,0,buffer,entry.size) != entry.size)
     {
-        auto ptr = &directory->entries[i];
-        const char* testFilename = nameFromEntry(ptr);
-        if (!strcmp(testFilename,file)) // Found a match
+        earlyPanic("getRootFile(): Failure on read!");
+    }
+
+    // Fill up the return struct
+    returnStruct->ptr = reinterpret_cast<void*>(buffer);
+    returnStruct->returnCode = 0;
+    returnStruct->size = entry.size;
+
+    return returnStruct;
+}
+
+int fs::fat32::findRootFile(const char* file, fat32_dirEntry* entry)
+{
+    return lookup(_vbr->bpd.clusterNumberRoot,file,strlen(file),entry,nullptr) == 0 ? 0 : 1;
+}
+
+int fs::fat32::lookup(uint32_t directoryCluster, const char* name, size_t length,
+            fat32_dirEntry* entry, fat32_entryLocation* location)
+{
+    // Each UTF-16 character is 3 UTF-8 bytes at most
+    if (length == 0 || length > LFN_MAX_LENGTH * 3)
+        return 1;
+
+    // What the long names are checked against, folded once here. Names that
+    // aren't valid UTF-8 can still be short ones
+    uint16_t target[LFN_MAX_LENGTH];
+    const size_t targetLength = toUTF16(name,length,target,LFN_MAX_LENGTH);
+    for (size_t i = 0; i < targetLength; i++)
+        target[i] = foldCase(target[i]);
+
+    const size_t size = clusterSize();
+    fat32_dirEntry* entries = reinterpret_cast<fat32_dirEntry*>(new uint8_t[size]);
+    if (entries == nullptr)
+        return 2;
+
+    // The long name going by, which can start a cluster before its short
+    // entry. Its characters are compared as they come, so all that's kept is
+    // whether they matched so far
+    longNameState state = {};
+    bool matching = false;
+
+    int returnCode = 1;
+    bool end = false;
+    for (uint32_t cluster = directoryCluster; returnCode == 1 && !end && cluster >= 2 &&
+            !isClusterEnd(cluster); cluster = nextCluster(cluster))
+    {
+        if (!readCluster(cluster,entries))
         {
-            size_t clusterNum = ptr->highClusterNumber << 16 | ptr->lowClusterNumber;
-            
-            #ifdef TRACEMAX
-                traceOut << "Found the file!\n";
-                traceOut << "cluster number is " << clusterNum << "\n";
-                traceOut << "File size is " << ptr->size << "\n";
-            #endif
-
-            // Some setup
-            const size_t firstDataSector = _vbr->bpd.reservedSectors +
-                    (_vbr->bpd.numberOfFATs * _vbr->bpd.sectorsPerFAT);
-            const size_t numSectors = ptr->size / sectorSize + 1;
-
-            // Final file buffer
-            uint8_t* buffer = new uint8_t[numSectors * sectorSize];
-
-            size_t j = 0;
-            while (! isClusterEnd(clusterNum))
+            returnCode = 2;
+            break;
+        }
+
+        for (size_t i = 0; i < size / sizeof(fat32_dirEntry); i++)
+        {
+            // A free entry ends the directory
+            if (entries[i].fileName[0] == 0)
             {
-                const size_t currLBA = ((clusterNum-2) * _vbr->bpd.sectorsPerCluster + 
-                        firstDataSector + _partitionLBA);
-                const size_t offset = j * sectorSize;
+                end = true;
+                break;
+            }
 
-                if(! (*_diskReadFunc)(currLBA,buffer + offset,1))
+            if (entries[i].attributes == static_cast<uint8_t>(fat32_dirEntry_attributes::LFN) &&
+                    entries[i].fileName[0] != 0xe5)
+            {
+                uint16_t characters[LFN_CHARACTERS];
+                const bool first = entries[i].fileName[0] & LFN_LAST_ENTRY;
+                if (!longNameStep(&state,entries + i,cluster,static_cast<uint32_t>(i),characters))
+                    continue;
+                if (first)
+                    matching = targetLength != 0 && state.length == targetLength;
+                if (!matching)
+                    continue;
+
+                const size_t base = (state.order - 1u) * LFN_CHARACTERS;
+                for (size_t j = 0; j < LFN_CHARACTERS && base + j < targetLength; j++)
                 {
-                    earlyPanic("getRootFile(): Failure on read!");
+                    if (foldCase(characters[j]) != target[base + j])
+                    {
+                        matching = false;
+                        break;
+                    }
                 }
-
-                // Increment
-                clusterNum = _FATptr[clusterNum] & clusterMask;
-                j++;
+                continue;
+            }
+            if (!isNamedEntry(entries + i))
+            {
+                state.order = 0;
+                continue;
             }
 
-            // Fill up the return struct
-            returnStruct->ptr = reinterpret_cast<void*>(buffer);
-            returnStruct->returnCode = 0;
-            returnStruct->size = ptr->size;
+            const bool hasLongName = longNameComplete(&state,entries + i);
+            bool found = hasLongName && matching;
+            if (!found && length < FAT_NAME_SIZE)
+            {
+                char testFilename[FAT_NAME_SIZE];
+                if (shortName(entries + i,testFilename) == length)
+                {
+                    size_t j = 0;
+                    while (j < length && upperCase(testFilename[j]) == upperCase(name[j]))
+                        j++;
+                    found = j == length;
+                }
+            }
+            if (!found)
+            {
+                state.order = 0;
+                continue;
+            }
 
-            return returnStruct;
-            
+            *entry = entries[i];
+            if (location != nullptr)
+            {
+                if (hasLongName)
+                    *location = {cluster,static_cast<uint32_t>(i),state.cluster,state.index};
+                else
+                    *location = {cluster,static_cast<uint32_t>(i),cluster,static_cast<uint32_t>(i)};
+            }
+            returnCode = 0;
+            break;
         }
     }
 
-    // If we get here, no file was found
-    returnStruct->returnCode=1;
-    returnStruct->ptr=nullptr;
-    returnStruct->size=0;
-
-    return returnStruct;
-    
-
+    delete[] reinterpret_cast<uint8_t*>(entries);
+    return returnCode;
 }
 
+size_t fs::fat32::readFile(const fat32_dirEntry* entry, size_t offset, void* buffer, size_t size)
+{
+    if (offset >= entry->size)
+        return 0;
+    if (size > entry->size - offset)
+        size = entry->size - offset;
+
+    const size_t clusterBytes = clusterSize();
+
+    // Walk the chain up to the cluster offset is in
+    uint32_t clusterNum = firstCluster(entry);
+    for (size_t skip = offset / clusterBytes; skip != 0 && !isClusterEnd(clusterNum); skip--)
+        clusterNum = nextCluster(clusterNum);
+
+    uint8_t* cluster = new uint8_t[clusterBytes];
+    if (cluster == nullptr)
+        return 0;
+
+    uint8_t* destination = static_cast<uint8_t*>(buffer);
+    size_t within = offset % clusterBytes;
+    size_t done = 0;
+    while (done < size && clusterNum >= 2 && !isClusterEnd(clusterNum))
+    {
+        if (! readCluster(clusterNum,cluster))
+            break;
 
+        size_t chunk = clusterBytes - within;
+        if (chunk > size - done)
+            chunk = size - done;
+        memcpy(destination + done,cluster + within,chunk);
 
+        done += chunk;
+        within = 0;
+        clusterNum = nextCluster(clusterNum);
+    }
+
+    delete[] cluster;
+    return done;
+}
@@ -0,0 +1,286 @@
+/**
+ * @file fat32Check.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions for the checking part of fat32.hpp: a consistency check
+ * of the FAT against the directory tree, which the kernel splits across
+ * processors. Nothing in it writes anything
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <fs/fat32.hpp>
+#include <stdint.h>
+#include <stddef.h>
+#include <klib/string.h>
+
+// Mask to apply to clusters
+constexpr uint32_t clusterMask = 0xFFFFFFF;
+
+// A cluster the disk can't use, which no chain should have
+constexpr uint32_t badCluster = 0xFFFFFF7;
+
+const size_t sectorSize = 512;
+
+// Records checkTree() lists at once, enough for the longest name there is
+const size_t recordBufferSize = 1024;
+
+// Directories checkTree() makes room for at first, and then doubles
+const size_t firstPendingDirectories = 64;
+
+static inline bool testBit(const uint32_t* map, uint32_t bit)
+{
+    return map[bit / 32] & (1u << (bit % 32));
+}
+
+/**
+ * @brief Follow the chain an entry starts, marking it as owned
+ * 
+ * @param length Set to its length in clusters
+ * @return true It ended where it should. If not, what went wrong was counted:
+ * links from the FAT already were by checkFAT(), so only the entry's own
+ * first cluster is here
+ */
+static bool ownChain(const fs::fat32* fat, const fs::fat32_check* check, uint32_t start,
+            uint32_t* length, fs::fat32_checkResult* result)
+{
+    *length = 0;
+    for (uint32_t cluster = start; !fs::fat32::isChainEnd(cluster); cluster = fat->nextCluster(cluster))
+    {
+        if (cluster >= check->clusterEnd || fat->nextCluster(cluster) == 0)
+        {
+            if (cluster == start)
+                result->badLinks++;
+            return false;
+        }
+        if (testBit(check->owned,cluster))
+        {
+            result->crossLinks++;
+            return false;
+        }
+        check->owned[cluster / 32] |= 1u << (cluster % 32);
+        (*length)++;
+    }
+    return true;
+}
+
+bool fs::fat32::checkBegin(fat32_check* check) const
+{
+    const uint32_t end = clusterEnd();
+    const size_t words = (end + 31) / 32;
+    uint32_t* linked = new uint32_t[words];
+    uint32_t* owned = new uint32_t[words];
+    if (linked == nullptr || owned == nullptr)
+    {
+        delete[] linked;
+        delete[] owned;
+        return false;
+    }
+    memset(linked,0,words * sizeof(uint32_t));
+    memset(owned,0,words * sizeof(uint32_t));
+    *check = {end,linked,owned};
+    return true;
+}
+
+void fs::fat32::checkFAT(const fat32_check* check, uint32_t first, uint32_t end, void* scratch,
+            fat32_checkResult* result) const
+{
+    if (end > check->clusterEnd)
+        end = check->clusterEnd;
+    if (first >= end)
+        return;
+
+    // The other copies, sector by sector, against the one that was read.
+    // Without mirroring only the active one is kept up to date
+    const uint32_t sectorsPerFAT = _vbr->bpd.sectorsPerFAT;
+    const uint32_t firstSector = first / FAT32_CHECK_ALIGN;
+    uint32_t endSector = (end + FAT32_CHECK_ALIGN - 1) / FAT32_CHECK_ALIGN;
+    if (endSector > sectorsPerFAT)
+        endSector = sectorsPerFAT;
+    const bool mirrored = !(_vbr->bpd.flags & 0x80);
+    const uint8_t* FAT = reinterpret_cast<const uint8_t*>(_FATptr);
+    uint8_t* copySectors = static_cast<uint8_t*>(scratch);
+    for (uint32_t copy = 1; mirrored && copy < _vbr->bpd.numberOfFATs; copy++)
+    {
+        for (uint32_t sector = firstSector; sector < endSector; )
+        {
+            const uint32_t run = endSector - sector < FAT32_CHECK_SCRATCH_SECTORS ?
+                    endSector - sector : FAT32_CHECK_SCRATCH_SECTORS;
+            const uint64_t LBA = _partitionLBA + _vbr->bpd.reservedSectors +
+                    static_cast<uint64_t>(copy) * sectorsPerFAT + sector;
+            if (!(*_diskReadFunc)(LBA,copySectors,run))
+                result->diskErrors += run;
+            else
+            {
+                for (uint32_t i = 0; i < run; i++)
+                {
+                    if (memcmp(copySectors + i * sectorSize,FAT + (sector + i) * sectorSize,
+                            sectorSize) != 0)
+                        result->mirrorMismatches++;
+                }
+            }
+            sector += run;
+        }
+    }
+
+    // Where each entry points. Ranges meet inside a word of linked, hence
+    // the atomic
+    for (uint32_t cluster = first < 2 ? 2 : first; cluster < end; cluster++)
+    {
+        const uint32_t next = _FATptr[cluster] & clusterMask;
+        if (next == 0 || next == badCluster)
+            continue;
+        result->usedClusters++;
+        if (isChainEnd(next))
+        {
+            // 1 isn't an end, or anything else
+            if (next < 2)
+                result->badLinks++;
+            continue;
+        }
+        if (next >= check->clusterEnd || (_FATptr[next] & clusterMask) == 0)
+        {
+            result->badLinks++;
+            continue;
+        }
+        __atomic_fetch_or(check->linked + next / 32,1u << (next % 32),__ATOMIC_RELAXED);
+    }
+}
+
+bool fs::fat32::checkTree(const fat32_check* check, fat32_checkResult* result)
+{
+    const size_t bytesPerCluster = clusterSize();
+
+    // Directories found and not listed yet. A directory two entries lead
+    // to is a cross-link, and isn't listed twice, so loops end too
+    size_t capacity = firstPendingDirectories;
+    size_t pending = 0;
+    uint32_t* directories = new uint32_t[capacity];
+    if (directories == nullptr)
+        return false;
+
+    uint32_t length;
+    result->directories++;
+    if (ownChain(this,check,rootCluster(),&length,result))
+        directories[pending++] = rootCluster();
+
+    alignas(4) uint8_t records[recordBufferSize];
+    bool complete = true;
+    while (pending != 0 && complete)
+    {
+        const uint32_t directory = directories[--pending];
+        uint32_t cursor = FAT32_DIRECTORY_START;
+        int listed;
+        while ((listed = readDirectory(directory,&cursor,records,sizeof(records))) > 0)
+        {
+            for (int at = 0; at < listed; )
+            {
+                const fat32_dirRecord* record = reinterpret_cast<const fat32_dirRecord*>(records + at);
+                const char* name = reinterpret_cast<const char*>(record + 1);
+                at += record->length;
+                if (name[0] == '.' && (record->nameLength == 1 ||
+                        (record->nameLength == 2 && name[1] == '.')))
+                    continue;
+
+                if (!(record->attributes & static_cast<uint8_t>(fat32_dirEntry_attributes::SUBDIRECTORY)))
+                {
+                    result->files++;
+                    const uint32_t expected = static_cast<uint32_t>((record->size + bytesPerCluster - 1) /
+                            bytesPerCluster);
+                    if (ownChain(this,check,record->cluster,&length,result) && length != expected)
+                        result->sizeMismatches++;
+                    continue;
+                }
+
+                result->directories++;
+                if (record->cluster == 0)
+                {
+                    result->badLinks++;
+                    continue;
+                }
+                if (!ownChain(this,check,record->cluster,&length,result))
+                    continue;
+                if (pending == capacity)
+                {
+                    uint32_t* grown = new uint32_t[capacity * 2];
+                    if (grown == nullptr)
+                    {
+                        complete = false;
+                        break;
+                    }
+                    memcpy(grown,directories,pending * sizeof(uint32_t));
+                    delete[] directories;
+                    directories = grown;
+                    capacity *= 2;
+                }
+                directories[pending++] = record->cluster;
+            }
+        }
+        if (listed < 0)
+            result->diskErrors++;
+    }
+
+    delete[] directories;
+    return complete;
+}
+
+void fs::fat32::checkLost(const fat32_check* check, uint32_t first, uint32_t end,
+            fat32_checkResult* result) const
+{
+    if (end > check->clusterEnd)
+        end = check->clusterEnd;
+    for (uint32_t cluster = first < 2 ? 2 : first; cluster < end; cluster++)
+    {
+        const uint32_t next = _FATptr[cluster] & clusterMask;
+        if (next == 0 || next == badCluster || testBit(check->owned,cluster))
+            continue;
+        result->lostClusters++;
+        // Nothing points at it, so a chain starts there
+        if (!testBit(check->linked,cluster))
+            result->lostChains++;
+    }
+}
+
+void fs::fat32::checkEnd(fat32_check* check)
+{
+    delete[] check->linked;
+    delete[] check->owned;
+    check->linked = nullptr;
+    check->owned = nullptr;
+}
+
+void fs::fat32::addResults(fat32_checkResult* total, const fat32_checkResult* result)
+{
+    total->files += result->files;
+    total->directories += result->directories;
+    total->usedClusters += result->usedClusters;
+    total->lostChains += result->lostChains;
+    total->lostClusters += result->lostClusters;
+    total->crossLinks += result->crossLinks;
+    total->sizeMismatches += result->sizeMismatches;
+    total->badLinks += result->badLinks;
+    total->mirrorMismatches += result->mirrorMismatches;
+    total->diskErrors += result->diskErrors;
+}
+
+bool fs::fat32::check(fat32_checkResult* result)
+{
+    *result = {};
+    fat32_check state;
+    if (!checkBegin(&state))
+        return false;
+    uint8_t* scratch = new uint8_t[FAT32_CHECK_SCRATCH_SECTORS * sectorSize];
+    bool checked = scratch != nullptr;
+    if (checked)
+    {
+        checkFAT(&state,0,state.clusterEnd,scratch,result);
+        delete[] scratch;
+        checked = checkTree(&state,result);
+    }
+    if (checked)
+        checkLost(&state,0,state.clusterEnd,result);
+    checkEnd(&state);
+    return checked;
+}
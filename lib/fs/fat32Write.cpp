@@ -0,0 +1,529 @@
+/**
+ * @file fat32Write.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions for the writing half of fat32.hpp. Kept apart from
+ * fat32.cpp, so what only reads (the bootloader) doesn't link any of it
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <fs/fat32.hpp>
+#include <stdint.h>
+#include <stddef.h>
+#include <klib/string.h>
+
+// Mask to apply to clusters
+constexpr uint32_t clusterMask = 0xFFFFFFF;
+
+// What ends a chain
+constexpr uint32_t chainEnd = 0xFFFFFFF;
+
+const size_t sectorSize = 512;
+const size_t entriesPerSector = sectorSize / sizeof(fs::fat32_dirEntry);
+
+/* Deleted entries start with this */
+const uint8_t deletedEntry = 0xe5;
+
+/**
+ * @brief Whether a character can be in a short name: not a control
+ * character, or anything DOS never allowed
+ * 
+ */
+static bool allowedCharacter(char c)
+{
+    static const char forbidden[] = "\"*+,/:;<=>?[\\]| ";
+    if (static_cast<uint8_t>(c) < 0x20)
+        return false;
+    for (size_t i = 0; i < sizeof(forbidden) - 1; i++)
+    {
+        if (c == forbidden[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Turn "NAME.EXT" into the 11 characters an entry has, upper case and
+ * padded with spaces
+ * 
+ * @return false It isn't a valid 8.3 name
+ */
+static bool makeShortName(const char* name, size_t length, uint8_t* shortName)
+{
+    memset(shortName,' ',11);
+    size_t dot = length;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (name[i] == '.')
+        {
+            // Only one, and not the first thing
+            if (dot != length || i == 0)
+                return false;
+            dot = i;
+        }
+    }
+    if (dot == 0 || dot > 8 || length - dot > 4 || (dot != length && length - dot == 1))
+        return false;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (i == dot)
+            continue;
+        char c = name[i];
+        if (c >= 'a' && c <= 'z')
+            c = char(c - 'a' + 'A');
+        if (!allowedCharacter(c))
+            return false;
+        shortName[i < dot ? i : 8 + i - dot - 1] = static_cast<uint8_t>(c);
+    }
+
+    // A real 0xe5 is stored as 0x05, so the entry doesn't look deleted
+    if (shortName[0] == deletedEntry)
+        shortName[0] = 0x05;
+    return true;
+}
+
+/**========================================================================
+ *                           Clusters
+ *========================================================================**/
+
+bool fs::fat32::isFree(uint32_t cluster) const
+{
+    return _freeMap[cluster / 32] & (1u << (cluster % 32));
+}
+
+void fs::fat32::setNext(uint32_t cluster, uint32_t next)
+{
+    _FATptr[cluster] = (_FATptr[cluster] & ~clusterMask) | (next & clusterMask);
+    const size_t sector = cluster * sizeof(uint32_t) / sectorSize;
+    _dirtyFAT[sector / 32] |= 1u << (sector % 32);
+
+    if (next == 0)
+    {
+        _freeMap[cluster / 32] |= 1u << (cluster % 32);
+        _freeClusters++;
+    }
+    _FSInfoDirty = true;
+}
+
+bool fs::fat32::buildFreeMap()
+{
+    if (_freeMap != nullptr)
+        return true;
+
+    const uint32_t end = clusterEnd();
+
+    const size_t FATwords = (_vbr->bpd.sectorsPerFAT + 31) / 32;
+    uint32_t* freeMap = new uint32_t[(end + 31) / 32];
+    uint32_t* dirty = new uint32_t[FATwords];
+    FAT32FSInfo* info = new FAT32FSInfo;
+    if (freeMap == nullptr || dirty == nullptr || info == nullptr)
+    {
+        delete[] freeMap;
+        delete[] dirty;
+        delete info;
+        return false;
+    }
+    memset(freeMap,0,(end + 31) / 32 * sizeof(uint32_t));
+    memset(dirty,0,FATwords * sizeof(uint32_t));
+
+    uint32_t freeCount = 0;
+    for (uint32_t cluster = 2; cluster < end; cluster++)
+    {
+        if ((_FATptr[cluster] & clusterMask) == 0)
+        {
+            freeMap[cluster / 32] |= 1u << (cluster % 32);
+            freeCount++;
+        }
+    }
+
+    // The hint only says where to start looking, and only if it makes sense
+    const uint16_t infoSector = _vbr->bpd.sectorNumberFSInfo;
+    if (infoSector != 0 && infoSector != 0xffff && infoSector < _vbr->bpd.reservedSectors &&
+            (*_diskReadFunc)(_partitionLBA + infoSector,info,1) &&
+            info->leadSignature == FSINFO_LEAD_SIGNATURE &&
+            info->anotherSignature == FSINFO_OTHER_SIGNATURE &&
+            info->trailSignature == FSINFO_TRAIL_SIGNATURE)
+    {
+        if (info->hintAvailableCluster >= 2 && info->hintAvailableCluster < end)
+            _nextFree = info->hintAvailableCluster;
+        // Whatever it said, it gets the real count on the next flush()
+        _FSInfoDirty = info->lastFreeClusterCount != freeCount;
+    }
+    else
+    {
+        delete info;
+        info = nullptr;
+    }
+
+    _freeMap = freeMap;
+    _dirtyFAT = dirty;
+    _FSInfo = info;
+    _clusterEnd = end;
+    _freeClusters = freeCount;
+    return true;
+}
+
+/**
+ * @brief How many free clusters there are from start on, up to limit of
+ * them
+ * 
+ */
+uint32_t fs::fat32::freeRun(uint32_t start, uint32_t limit) const
+{
+    uint32_t length = 0;
+    while (length < limit && start + length < _clusterEnd && isFree(start + length))
+        length++;
+    return length;
+}
+
+/**
+ * @brief First run of count free clusters, from _nextFree round to it again
+ * 
+ */
+bool fs::fat32::findRun(uint32_t count, uint32_t* start) const
+{
+    uint32_t cluster = _nextFree;
+    for (uint32_t looked = 0; looked < _clusterEnd - 2; )
+    {
+        // Whole words of used clusters at a time
+        if (cluster % 32 == 0 && cluster + 32 <= _clusterEnd && _freeMap[cluster / 32] == 0)
+        {
+            cluster += 32;
+            looked += 32;
+        }
+        else
+        {
+            const uint32_t length = freeRun(cluster,count);
+            if (length == count)
+            {
+                *start = cluster;
+                return true;
+            }
+            cluster += length + 1;
+            looked += length + 1;
+        }
+        if (cluster >= _clusterEnd)
+            cluster = 2 + (cluster - _clusterEnd);
+    }
+    return false;
+}
+
+/**
+ * @brief Mark a run of free clusters used, each leading to the next, and
+ * link it after previous, if that isn't 0. previous ends up as the last one
+ * 
+ */
+void fs::fat32::takeRun(uint32_t start, uint32_t count, uint32_t* previous)
+{
+    for (uint32_t cluster = start; cluster < start + count; cluster++)
+    {
+        _freeMap[cluster / 32] &= ~(1u << (cluster % 32));
+        _freeClusters--;
+        setNext(cluster,chainEnd);
+        if (*previous != 0)
+            setNext(*previous,cluster);
+        *previous = cluster;
+    }
+    _nextFree = *previous + 1 < _clusterEnd ? *previous + 1 : 2;
+}
+
+uint32_t fs::fat32::allocateClusters(uint32_t last, uint32_t count)
+{
+    if (count == 0 || !buildFreeMap() || count > _freeClusters)
+        return 0;
+
+    uint32_t previous = last;
+    uint32_t remaining = count;
+    uint32_t first = 0;
+
+    // Right where the chain ends, so it stays in one piece
+    if (last != 0)
+    {
+        const uint32_t length = freeRun(last + 1,remaining);
+        if (length != 0)
+        {
+            takeRun(last + 1,length,&previous);
+            first = last + 1;
+            remaining -= length;
+        }
+    }
+
+    // Somewhere the rest fits in one go
+    uint32_t start;
+    if (remaining != 0 && findRun(remaining,&start))
+    {
+        takeRun(start,remaining,&previous);
+        if (first == 0)
+            first = start;
+        remaining = 0;
+    }
+
+    // Or else in the pieces there are, in order. There are enough of them
+    for (uint32_t cluster = _nextFree; remaining != 0; )
+    {
+        const uint32_t length = freeRun(cluster,remaining);
+        if (length != 0)
+        {
+            takeRun(cluster,length,&previous);
+            if (first == 0)
+                first = cluster;
+            remaining -= length;
+        }
+        cluster += length + 1;
+        if (cluster >= _clusterEnd)
+            cluster = 2;
+    }
+    return first;
+}
+
+void fs::fat32::freeChain(uint32_t cluster)
+{
+    if (!buildFreeMap())
+        return;
+
+    // Stops at clusters that are free already, so a chain that loops ends
+    while (!isChainEnd(cluster) && cluster < _clusterEnd && !isFree(cluster))
+    {
+        const uint32_t next = nextCluster(cluster);
+        setNext(cluster,0);
+        cluster = next;
+    }
+}
+
+void fs::fat32::truncateChain(uint32_t cluster)
+{
+    if (!buildFreeMap())
+        return;
+
+    const uint32_t next = nextCluster(cluster);
+    if (isChainEnd(next))
+        return;
+    setNext(cluster,chainEnd);
+    freeChain(next);
+}
+
+bool fs::fat32::flush()
+{
+    if (_dirtyFAT == nullptr)
+        return true;
+
+    // Every copy, unless mirroring is off, and then only the one in use
+    const uint32_t sectorsPerFAT = _vbr->bpd.sectorsPerFAT;
+    const bool mirrored = !(_vbr->bpd.flags & 0x80);
+    const uint32_t firstFAT = mirrored ? 0 : _vbr->bpd.flags & 0xf;
+    const uint32_t lastFAT = mirrored ? _vbr->bpd.numberOfFATs : firstFAT + 1;
+
+    bool written = true;
+    uint32_t sector = 0;
+    while (sector < sectorsPerFAT)
+    {
+        if (!(_dirtyFAT[sector / 32] & (1u << (sector % 32))))
+        {
+            sector++;
+            continue;
+        }
+        uint32_t run = 1;
+        while (sector + run < sectorsPerFAT &&
+                (_dirtyFAT[(sector + run) / 32] & (1u << ((sector + run) % 32))))
+            run++;
+
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(_FATptr) + sector * sectorSize;
+        for (uint32_t copy = firstFAT; copy < lastFAT; copy++)
+        {
+            const uint64_t LBA = _partitionLBA + _vbr->bpd.reservedSectors +
+                    static_cast<uint64_t>(copy) * sectorsPerFAT + sector;
+            written = writeSectors(LBA,data,run) && written;
+        }
+        for (uint32_t i = sector; i < sector + run; i++)
+            _dirtyFAT[i / 32] &= ~(1u << (i % 32));
+        sector += run;
+    }
+
+    if (_FSInfo != nullptr && _FSInfoDirty && written)
+    {
+        _FSInfo->lastFreeClusterCount = _freeClusters;
+        _FSInfo->hintAvailableCluster = _nextFree;
+        written = writeSectors(_partitionLBA + _vbr->bpd.sectorNumberFSInfo,_FSInfo,1);
+        _FSInfoDirty = !written;
+    }
+    return written;
+}
+
+/**========================================================================
+ *                           Directories
+ *========================================================================**/
+
+bool fs::fat32::writeCluster(uint32_t cluster, const void* buffer)
+{
+    return writeSectors(clusterLBA(cluster),buffer,_vbr->bpd.sectorsPerCluster);
+}
+
+fs::fat32_createResult fs::fat32::createEntry(uint32_t directoryCluster, const char* name,
+            size_t length, uint8_t attributes, uint32_t cluster, fat32_dirEntry* entry,
+            fat32_entryLocation* location)
+{
+    fat32_dirEntry made = {};
+    if (!makeShortName(name,length,made.fileName))
+        return fat32_createResult::BAD_NAME;
+    made.attributes = attributes;
+    setFirstCluster(&made,cluster);
+    // No clock to take the time from, so the earliest date there is,
+    // 1980-01-01, as the disk has it (the day in the low bits)
+    const uint16_t firstDate = 1 << 5 | 1;
+    memcpy(&made.creationDate,&firstDate,sizeof(firstDate));
+    made.modificationDate = made.creationDate;
+    made.lastAccessed = made.creationDate;
+
+    fat32_dirEntry existing;
+    switch (lookup(directoryCluster,name,length,&existing,nullptr))
+    {
+    case 0:
+        return fat32_createResult::EXISTS;
+    case 1:
+        break;
+    default:
+        return fat32_createResult::DISK_ERROR;
+    }
+
+    const size_t size = clusterSize();
+    fat32_dirEntry* entries = reinterpret_cast<fat32_dirEntry*>(new uint8_t[size]);
+    if (entries == nullptr)
+        return fat32_createResult::NO_SPACE;
+
+    // The first slot that's free or deleted
+    fat32_createResult result = fat32_createResult::NO_SPACE;
+    bool found = false;
+    uint32_t last = 0;
+    for (uint32_t c = directoryCluster; !found && !isChainEnd(c); c = nextCluster(c))
+    {
+        last = c;
+        if (!readCluster(c,entries))
+        {
+            result = fat32_createResult::DISK_ERROR;
+            break;
+        }
+        for (uint32_t i = 0; i < size / sizeof(fat32_dirEntry); i++)
+        {
+            if (entries[i].fileName[0] == 0 || entries[i].fileName[0] == deletedEntry)
+            {
+                *location = {c,i,c,i};
+                found = true;
+                break;
+            }
+        }
+    }
+
+    // Full, so it gets another cluster, all free entries
+    if (!found && last != 0 && result != fat32_createResult::DISK_ERROR)
+    {
+        const uint32_t added = allocateClusters(last,1);
+        if (added != 0)
+        {
+            memset(entries,0,size);
+            if (writeCluster(added,entries))
+            {
+                *location = {added,0,added,0};
+                found = true;
+            }
+            else
+            {
+                truncateChain(last);
+                result = fat32_createResult::DISK_ERROR;
+            }
+        }
+    }
+    delete[] reinterpret_cast<uint8_t*>(entries);
+
+    if (!found)
+        return result;
+    if (!writeEntry(location,&made))
+        return fat32_createResult::DISK_ERROR;
+    *entry = made;
+    return fat32_createResult::SUCCESS;
+}
+
+fs::fat32_createResult fs::fat32::createDirectory(uint32_t directoryCluster, const char* name,
+            size_t length, fat32_dirEntry* entry, fat32_entryLocation* location)
+{
+    const uint8_t attributes = static_cast<uint8_t>(fat32_dirEntry_attributes::SUBDIRECTORY);
+    const uint32_t cluster = allocateClusters(0,1);
+    if (cluster == 0)
+        return fat32_createResult::NO_SPACE;
+
+    const size_t size = clusterSize();
+    fat32_dirEntry* entries = reinterpret_cast<fat32_dirEntry*>(new uint8_t[size]);
+    if (entries == nullptr)
+    {
+        freeChain(cluster);
+        return fat32_createResult::NO_SPACE;
+    }
+
+    // "." is itself, ".." the parent, which is 0 for the root
+    memset(entries,0,size);
+    memset(entries[0].fileName,' ',11);
+    entries[0].fileName[0] = '.';
+    entries[0].attributes = attributes;
+    setFirstCluster(entries,cluster);
+    entries[1] = entries[0];
+    entries[1].fileName[1] = '.';
+    setFirstCluster(entries + 1,directoryCluster == rootCluster() ? 0 : directoryCluster);
+
+    fat32_createResult result = writeCluster(cluster,entries) ?
+            createEntry(directoryCluster,name,length,attributes,cluster,entry,location) :
+            fat32_createResult::DISK_ERROR;
+    delete[] reinterpret_cast<uint8_t*>(entries);
+    if (result != fat32_createResult::SUCCESS)
+        freeChain(cluster);
+    return result;
+}
+
+bool fs::fat32::writeEntry(const fat32_entryLocation* location, const fat32_dirEntry* entry)
+{
+    // Just the sector it's in
+    const uint64_t LBA = clusterLBA(location->cluster) + location->index / entriesPerSector;
+    fat32_dirEntry sector[entriesPerSector];
+    if (!(*_diskReadFunc)(LBA,sector,1))
+        return false;
+    sector[location->index % entriesPerSector] = *entry;
+    return writeSectors(LBA,sector,1);
+}
+
+bool fs::fat32::removeEntry(const fat32_entryLocation* location)
+{
+    const size_t size = clusterSize();
+    fat32_dirEntry* entries = reinterpret_cast<fat32_dirEntry*>(new uint8_t[size]);
+    if (entries == nullptr)
+        return false;
+
+    // From where its long name starts to the entry itself, a cluster at a
+    // time, following the directory's chain if the name started in another
+    bool written = true;
+    uint32_t cluster = location->nameCluster;
+    uint32_t first = location->nameIndex;
+    while (written)
+    {
+        written = readCluster(cluster,entries);
+        if (!written)
+            break;
+        const bool lastCluster = cluster == location->cluster;
+        const uint32_t end = lastCluster ? location->index + 1 :
+                static_cast<uint32_t>(size / sizeof(fat32_dirEntry));
+        for (uint32_t i = first; i < end; i++)
+            entries[i].fileName[0] = deletedEntry;
+        written = writeCluster(cluster,entries);
+        if (lastCluster)
+            break;
+
+        cluster = nextCluster(cluster);
+        first = 0;
+        // The chain doesn't get to the entry, nothing more to do
+        if (isChainEnd(cluster))
+            written = false;
+    }
+    delete[] reinterpret_cast<uint8_t*>(entries);
+    return written;
+}
@@ -81,6 +81,14 @@ int io::framebuffer_terminal::putchar(char c)
     
 }
 
+void io::framebuffer_terminal::write(const char* str, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        putchar(str[i]);
+    }
+}
+
 int io::framebuffer_terminal::scroll(size_t lines)
 {
     // Check lines is number allowed
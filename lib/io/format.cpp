@@ -0,0 +1,315 @@
+/**
+ * @file format.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from format.hpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <klib/format.hpp>
+#include <klib/string.h>
+
+static const char DIGIT_PAIRS[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+static const char HEX_LOWER[] = "0123456789abcdef";
+static const char HEX_UPPER[] = "0123456789ABCDEF";
+
+static const uint32_t POWERS_OF_10[] = {
+    1,10,100,1000,10000,100000,1000000,10000000,100000000,1000000000
+};
+
+/* Digits a 64 bit number is split into 32 bit parts of */
+static const uint32_t DECIMAL_PART_DIGITS = 8;
+static const uint32_t DECIMAL_PART = 100000000;
+
+static size_t decimalLength(uint32_t value)
+{
+    size_t length = 1;
+    while (length < 10 && value >= POWERS_OF_10[length])
+        length++;
+    return length;
+}
+
+/**
+ * @brief Write a number's digits backwards, two at a time, ending right before
+ * end. Only as many as it has
+ * 
+ */
+static void writeDecimal(uint32_t value, char* end)
+{
+    while (value >= 100)
+    {
+        const uint32_t pair = (value % 100) * 2;
+        value /= 100;
+        end -= 2;
+        end[0] = DIGIT_PAIRS[pair];
+        end[1] = DIGIT_PAIRS[pair + 1];
+    }
+    if (value >= 10)
+    {
+        end -= 2;
+        end[0] = DIGIT_PAIRS[value * 2];
+        end[1] = DIGIT_PAIRS[value * 2 + 1];
+    }
+    else
+        *--end = static_cast<char>('0' + value);
+}
+
+/**
+ * @brief Write a number's last length nibbles, backwards from str + length
+ * 
+ */
+static void writeHex(uint32_t value, char* str, size_t length, const char* digits)
+{
+    for (size_t i = length; i != 0; i--)
+    {
+        str[i - 1] = digits[value & 0xF];
+        value >>= 4;
+    }
+}
+
+size_t io::formatDecimal(uint32_t value, char* str)
+{
+    const size_t length = decimalLength(value);
+    writeDecimal(value,str + length);
+    return length;
+}
+
+size_t io::formatDecimal(uint64_t value, char* str)
+{
+    if ((value >> 32) == 0)
+        return formatDecimal(static_cast<uint32_t>(value),str);
+
+    // One 64 bit division for every 8 digits, the rest is 32 bit
+    const uint64_t high = value / DECIMAL_PART;
+    const uint32_t low = static_cast<uint32_t>(value - high * DECIMAL_PART);
+    const size_t length = formatDecimal(high,str);
+    memset(str + length,'0',DECIMAL_PART_DIGITS);
+    writeDecimal(low,str + length + DECIMAL_PART_DIGITS);
+    return length + DECIMAL_PART_DIGITS;
+}
+
+size_t io::formatHex(uint32_t value, char* str, bool upper)
+{
+    // From the highest nibble that isn't 0, so nothing needs reversing
+    const size_t length = value == 0 ? 1 : (32 - static_cast<size_t>(__builtin_clz(value)) + 3) / 4;
+    writeHex(value,str,length,upper ? HEX_UPPER : HEX_LOWER);
+    return length;
+}
+
+size_t io::formatHex(uint64_t value, char* str, bool upper)
+{
+    const uint32_t high = static_cast<uint32_t>(value >> 32);
+    if (high == 0)
+        return formatHex(static_cast<uint32_t>(value),str,upper);
+
+    const size_t length = formatHex(high,str,upper);
+    writeHex(static_cast<uint32_t>(value),str + length,8,upper ? HEX_UPPER : HEX_LOWER);
+    return length + 8;
+}
+
+/**
+ * @brief Put characters in the sink, flushing it whenever it's full
+ * 
+ */
+static void put(io::formatSink* sink, const char* str, size_t size)
+{
+    // Most of it is a few characters at a time, which a call to memcpy() is
+    // slower for
+    if (size <= sink->size - sink->used)
+    {
+        char* to = sink->buffer + sink->used;
+        for (size_t i = 0; i < size; i++)
+            to[i] = str[i];
+        sink->used += size;
+        return;
+    }
+
+    while (size != 0)
+    {
+        if (sink->used == sink->size)
+        {
+            if (sink->flush == nullptr)
+                return;
+            sink->flush(sink);
+        }
+        size_t chunk = sink->size - sink->used;
+        if (chunk > size)
+            chunk = size;
+        memcpy(sink->buffer + sink->used,str,chunk);
+        sink->used += chunk;
+        str += chunk;
+        size -= chunk;
+    }
+}
+
+/**
+ * @brief Put text with {{ and }} in it, each as one brace
+ * 
+ * @return size_t Characters it took
+ */
+static size_t putUnescaped(io::formatSink* sink, const char* str, size_t size)
+{
+    size_t written = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (str[i] == '{' || str[i] == '}')
+        {
+            put(sink,str + start,i + 1 - start);
+            written += i + 1 - start;
+            start = ++i + 1;
+        }
+    }
+    put(sink,str + start,size - start);
+    return written + size - start;
+}
+
+/**
+ * @brief Put a string, copied as it's read rather than measured first
+ * 
+ * @return size_t Its length
+ */
+static size_t putString(io::formatSink* sink, const char* str)
+{
+    size_t written = 0;
+    while (*str != '\0')
+    {
+        if (sink->used == sink->size)
+        {
+            if (sink->flush == nullptr)
+                return written + strlen(str);
+            sink->flush(sink);
+        }
+        sink->buffer[sink->used++] = *str++;
+        written++;
+    }
+    return written;
+}
+
+static void pad(io::formatSink* sink, char c, size_t count)
+{
+    if (count == 0)
+        return;
+    char padding[io::FORMAT_MAX_WIDTH];
+    memset(padding,c,count);
+    put(sink,padding,count);
+}
+
+/**
+ * @brief Put an argument's characters, padded to the placeholder's width
+ * 
+ * @param prefix Sign or 0x, that zeros go after
+ * @return size_t Characters it took
+ */
+static size_t putPadded(io::formatSink* sink, const io::formatOp* op, const char* prefix,
+        size_t prefixLength, const char* str, size_t length)
+{
+    const size_t total = prefixLength + length;
+    const size_t padding = op->width > total ? op->width - total : 0;
+    if (op->flags & io::formatOp::ZERO_PAD)
+    {
+        put(sink,prefix,prefixLength);
+        pad(sink,'0',padding);
+    }
+    else
+    {
+        pad(sink,' ',padding);
+        put(sink,prefix,prefixLength);
+    }
+    put(sink,str,length);
+    return total + padding;
+}
+
+/**
+ * @brief Write one argument, as its placeholder says
+ * 
+ * @return size_t Characters it took
+ */
+static size_t writeArgument(io::formatSink* sink, const io::formatOp* op,
+        const io::formatArgument* argument)
+{
+    using kind = io::formatArgument::kind;
+
+    const char* str;
+    switch (argument->type)
+    {
+    case kind::STRING:
+        str = argument->string != nullptr ? argument->string : "(null)";
+        if (op->width == 0)
+            return putString(sink,str);
+        return putPadded(sink,op,"",0,str,strlen(str));
+    case kind::BOOLEAN:
+        str = argument->value != 0 ? "true" : "false";
+        return putPadded(sink,op,"",0,str,strlen(str));
+    case kind::CHARACTER:
+    {
+        const char c = static_cast<char>(argument->value);
+        return putPadded(sink,op,"",0,&c,1);
+    }
+    case kind::SIGNED:
+    case kind::UNSIGNED:
+    case kind::POINTER:
+    default:
+        break;
+    }
+
+    // Numbers go straight into the sink when they fit and need no padding
+    char number[io::FORMAT_NUMBER_SIZE + 2];
+    const bool direct = op->width == 0 && sink->size - sink->used >= sizeof(number);
+    char* to = direct ? sink->buffer + sink->used : number;
+
+    uint64_t magnitude = argument->value;
+    size_t prefixLength = 0;
+    if (argument->type == kind::POINTER && (op->type == 0 || op->type == 'p'))
+    {
+        to[prefixLength++] = '0';
+        to[prefixLength++] = 'x';
+    }
+    else if (argument->type == kind::SIGNED && static_cast<int64_t>(magnitude) < 0)
+    {
+        to[prefixLength++] = '-';
+        magnitude = 0 - magnitude;
+    }
+
+    size_t length;
+    if (argument->type == kind::POINTER || op->type == 'x' || op->type == 'X')
+        length = io::formatHex(magnitude,to + prefixLength,op->type == 'X');
+    else
+        length = io::formatDecimal(magnitude,to + prefixLength);
+
+    if (direct)
+    {
+        sink->used += prefixLength + length;
+        return prefixLength + length;
+    }
+    return putPadded(sink,op,number,prefixLength,number + prefixLength,length);
+}
+
+size_t io::formatWrite(formatSink* sink, const char* text, const formatOp* ops, size_t count,
+        const formatArgument* arguments)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const formatOp* op = ops + i;
+        if (op->flags & formatOp::ESCAPES)
+            total += putUnescaped(sink,text + op->textStart,op->textLength);
+        else
+        {
+            put(sink,text + op->textStart,op->textLength);
+            total += op->textLength;
+        }
+        if (op->argument != formatOp::NO_ARGUMENT)
+            total += writeArgument(sink,op,arguments + op->argument);
+    }
+    return total;
+}
@@ -0,0 +1,235 @@
+/**
+ * @file serial.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from serial.hpp
+ * @version 0.1
+ * @date 2025-03-25
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <klib/cpuio.hpp>
+#include <devices/serial.hpp>
+
+using kernel::cpu::io::inb;
+using kernel::cpu::io::outb;
+
+// Registers, from the first port
+static const uint16_t DATA =                0; // THR and RBR, divisor low with DLAB
+static const uint16_t INTERRUPT_ENABLE =    1; // Divisor high with DLAB
+static const uint16_t FIFO_CONTROL =        2; // IIR when read
+static const uint16_t LINE_CONTROL =        3;
+static const uint16_t MODEM_CONTROL =       4;
+static const uint16_t LINE_STATUS =         5;
+
+static const uint8_t IER_TRANSMIT_EMPTY =   0x02;
+static const uint8_t IIR_FIFO_ENABLED =     0xC0;
+static const uint8_t FCR_ENABLE_CLEAR =     0xC7; // On, both cleared, 14 byte receive trigger
+static const uint8_t LCR_8N1 =              0x03;
+static const uint8_t LCR_DLAB =             0x80;
+static const uint8_t MCR_LOOPBACK =         0x1E;
+static const uint8_t MCR_NORMAL =           0x0F; // DTR, RTS, and OUT2, which lets the IRQ out
+static const uint8_t LSR_TRANSMIT_EMPTY =   0x20; // THR (or its FIFO) is empty
+static const uint8_t LSR_IDLE =             0x40; // And so is the shift register
+
+static const uint8_t LOOPBACK_TEST_BYTE =   0xAE;
+
+static const uint32_t CLOCK_BAUD =          115200;
+static const uint32_t FLAGS_IF =            1 << 9;
+
+bool io::serial_port::init(uint16_t port, uint32_t baud)
+{
+    _port = port;
+    _present = false;
+    _interrupts = false;
+    _transmitting = false;
+    _fifoRoom = 0;
+    _lock = 0;
+    _head = 0;
+    _tail = 0;
+    _ring = nullptr;
+
+    uint32_t divisor = baud == 0 ? 1 : CLOCK_BAUD / baud;
+    if (divisor == 0)
+        divisor = 1;
+
+    outb(_port + INTERRUPT_ENABLE,0);
+    outb(_port + LINE_CONTROL,LCR_DLAB);
+    outb(_port + DATA,static_cast<uint8_t>(divisor));
+    outb(_port + INTERRUPT_ENABLE,static_cast<uint8_t>(divisor >> 8));
+    outb(_port + LINE_CONTROL,LCR_8N1);
+    outb(_port + FIFO_CONTROL,FCR_ENABLE_CLEAR);
+
+    // Nothing at the port reads back all ones, which loopback doesn't give
+    outb(_port + MODEM_CONTROL,MCR_LOOPBACK);
+    outb(_port + DATA,LOOPBACK_TEST_BYTE);
+    if (inb(_port + DATA) != LOOPBACK_TEST_BYTE)
+        return false;
+    outb(_port + MODEM_CONTROL,MCR_NORMAL);
+
+    // An 8250 or 16450 has no FIFO, and takes a byte at a time
+    _fifoSize = (inb(_port + FIFO_CONTROL) & IIR_FIFO_ENABLED) == IIR_FIFO_ENABLED ?
+            SERIAL_FIFO_SIZE : 1;
+    _present = true;
+    return true;
+}
+
+void io::serial_port::clear()
+{
+    for (const char* c = "\x1b[2J\x1b[H"; *c != '\0'; c++)
+        putchar(*c);
+}
+
+int io::serial_port::putchar(char c)
+{
+    if (!_present)
+        return 1;
+    write(&c,1);
+    return 0;
+}
+
+void io::serial_port::write(const char* str, size_t size)
+{
+    if (!_present)
+        return;
+
+    while (size != 0)
+    {
+        const size_t batch = size < SERIAL_WRITE_BATCH ? size : SERIAL_WRITE_BATCH;
+        const uint32_t flags = lock();
+        // With interrupts off, the queue might not drain before whatever is
+        // printing (a panic, an interrupt handler) is done
+        const bool queue = _interrupts && (flags & FLAGS_IF);
+        size_t i = 0;
+        for (; i < batch && (!queue || SERIAL_RING_SIZE - (_head - _tail) >= 2); i++)
+        {
+            if (str[i] == '\n')
+                put('\r',queue);
+            put(static_cast<uint8_t>(str[i]),queue);
+        }
+        unlock(flags);
+        str += i;
+        size -= i;
+
+        // The queue is full. The interrupt empties it a FIFO full at a time,
+        // which is waited for with the lock dropped and interrupts on
+        if (i < batch)
+        {
+            while (SERIAL_RING_SIZE - (__atomic_load_n(&_head,__ATOMIC_RELAXED) -
+                    __atomic_load_n(&_tail,__ATOMIC_RELAXED)) < 2)
+                __builtin_ia32_pause();
+        }
+    }
+}
+
+void io::serial_port::flush()
+{
+    if (!_present)
+        return;
+
+    const uint32_t flags = lock();
+    fillFIFO(true);
+    while (!(inb(_port + LINE_STATUS) & LSR_IDLE))
+        __builtin_ia32_pause();
+    unlock(flags);
+}
+
+void io::serial_port::startInterrupts(char* ring)
+{
+    if (!_present)
+        return;
+
+    const uint32_t flags = lock();
+    _ring = ring;
+    _interrupts = true;
+    unlock(flags);
+}
+
+void io::serial_port::onInterrupt()
+{
+    if (!_present)
+        return;
+
+    const uint32_t flags = lock();
+
+    // Reading IIR acknowledges a transmitter interrupt. The line status is
+    // only looked at here, once per FIFO full
+    inb(_port + FIFO_CONTROL);
+    if (inb(_port + LINE_STATUS) & LSR_TRANSMIT_EMPTY)
+        _fifoRoom = _fifoSize;
+    fillFIFO(false);
+
+    // Nothing left, and an empty FIFO would keep interrupting
+    if (_head == _tail && _transmitting)
+    {
+        _transmitting = false;
+        outb(_port + INTERRUPT_ENABLE,0);
+    }
+    unlock(flags);
+}
+
+uint32_t io::serial_port::lock()
+{
+    uint32_t flags;
+    __asm__ __volatile__ ("pushfl\n\tpopl %0\n\tcli" : "=r"(flags) : : "memory");
+    while (__atomic_exchange_n(&_lock,1u,__ATOMIC_ACQUIRE) != 0)
+        __builtin_ia32_pause();
+    return flags;
+}
+
+void io::serial_port::unlock(uint32_t flags)
+{
+    __atomic_store_n(&_lock,0u,__ATOMIC_RELEASE);
+    if (flags & FLAGS_IF)
+        __asm__ __volatile__ ("sti" : : : "memory");
+}
+
+void io::serial_port::send(uint8_t byte)
+{
+    // The FIFO empties all at once as far as we can tell, so the line status
+    // only needs looking at once every FIFO full
+    if (_fifoRoom == 0)
+    {
+        while (!(inb(_port + LINE_STATUS) & LSR_TRANSMIT_EMPTY))
+            __builtin_ia32_pause();
+        _fifoRoom = _fifoSize;
+    }
+    outb(_port + DATA,byte);
+    _fifoRoom--;
+}
+
+void io::serial_port::fillFIFO(bool wait)
+{
+    // Without waiting, only into the room the FIFO is known to have. The
+    // interrupt says when there's more
+    while (_tail != _head && (wait || _fifoRoom != 0))
+    {
+        send(static_cast<uint8_t>(_ring[_tail % SERIAL_RING_SIZE]));
+        _tail++;
+    }
+}
+
+void io::serial_port::put(uint8_t byte, bool queue)
+{
+    if (!queue)
+    {
+        // What's queued goes first
+        fillFIFO(true);
+        send(byte);
+        return;
+    }
+
+    _ring[_head % SERIAL_RING_SIZE] = static_cast<char>(byte);
+    _head++;
+
+    // Straight to the FIFO if it has room, the interrupt does the rest
+    fillFIFO(false);
+    if (_head != _tail && !_transmitting)
+    {
+        _transmitting = true;
+        outb(_port + INTERRUPT_ENABLE,IER_TRANSMIT_EMPTY);
+    }
+}
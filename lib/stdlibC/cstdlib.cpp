@@ -15,6 +15,10 @@
 
 [[noreturn,maybe_unused]] void earlyPanic(const char* str)
 {
+    // Nothing else runs from here on, and output that waits for interrupts
+    // (the serial port's) goes out straight away
+    __asm__ __volatile__ ("cli");
+
     #if defined(__is32__) || defined(__is64__)
     io::framebuffer_terminal* termPtr = out.getBackEnd();
     termPtr->setColor(io::vga_color::VGA_COLOR_LIGHT_GREY,
@@ -0,0 +1,272 @@
+/**
+ * @file init.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief First user program. Says hello, and pokes at every kind of page the
+ * loader hands out: shared text and rodata, copy-on-write data, zero filled
+ * bss, the stack, and the vdso page. Then sends some pages through a pipe,
+ * checks shared memory, reads the disk through an I/O ring, and goes through
+ * the filesystem: its own executable, read, mapped and listed, and a file in
+ * /tmp, written, appended to, truncated and unlinked
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <syscall.hpp>
+#include <time.hpp>
+#include <ipc.hpp>
+#include <ioring.hpp>
+
+extern "C" int main();
+
+static const char greeting[] = "Hello from ring 3, on processor ";
+
+// .data, copied the first time it's written
+static char digits[] = "0123456789";
+
+// .bss, zero filled
+static uint8_t scratch[3 * 4096];
+
+// The boot sector, read through the ring
+static uint8_t bootSector[512];
+
+// Page aligned, so the whole pages get remapped through the pipe
+static const size_t MESSAGE_SIZE = 2 * 4096 + 100;
+__attribute__((aligned(4096))) static uint8_t outgoing[MESSAGE_SIZE];
+__attribute__((aligned(4096))) static uint8_t incoming[MESSAGE_SIZE];
+
+static size_t length(const char* str)
+{
+    size_t i = 0;
+    while (str[i] != '\0')
+        i++;
+    return i;
+}
+
+static void print(const char* str)
+{
+    sys::write(sys::STDOUT,str,length(str));
+}
+
+int main()
+{
+    print(greeting);
+    const uint32_t cpu = sys::getCPU();
+    char number[2] = {digits[cpu % 10], '\n'};
+    sys::write(sys::STDOUT,number,sizeof(number));
+
+    // Every page of the bss must come in zeroed
+    for (size_t i = 0; i < sizeof(scratch); i += 512)
+    {
+        if (scratch[i] != 0)
+        {
+            print("init: bss isn't zeroed\n");
+            return 1;
+        }
+        scratch[i] = 1;
+    }
+
+    digits[0] = 'x';
+    if (digits[0] != 'x' || digits[1] != '1')
+    {
+        print("init: data page is broken\n");
+        return 2;
+    }
+
+    // Read without a system call, so time must still move forward
+    sys::timespec start, end;
+    if (sys::clock_gettime(sys::CLOCK_MONOTONIC,&start) != 0)
+    {
+        print("init: no monotonic clock\n");
+        return 3;
+    }
+    for (size_t i = 0; i < 1000; i++)
+        sys::yield();
+    sys::clock_gettime(sys::CLOCK_MONOTONIC,&end);
+    if (end.tv_sec < start.tv_sec || (end.tv_sec == start.tv_sec && end.tv_nsec <= start.tv_nsec))
+    {
+        print("init: the clock went backwards\n");
+        return 4;
+    }
+
+    int32_t fds[2];
+    if (sys::pipe(fds) != 0)
+    {
+        print("init: no pipe\n");
+        return 5;
+    }
+    for (size_t i = 0; i < MESSAGE_SIZE; i++)
+        outgoing[i] = static_cast<uint8_t>(i * 7);
+    if (sys::write(fds[1],outgoing,MESSAGE_SIZE) != static_cast<int32_t>(MESSAGE_SIZE) ||
+            sys::read(fds[0],incoming,MESSAGE_SIZE) != static_cast<int32_t>(MESSAGE_SIZE))
+    {
+        print("init: pipe lost data\n");
+        return 6;
+    }
+    // The lent pages are copy-on-write: this mustn't show up on the other side
+    outgoing[0] = 0xff;
+    for (size_t i = 0; i < MESSAGE_SIZE; i++)
+    {
+        if (incoming[i] != static_cast<uint8_t>(i * 7))
+        {
+            print("init: pipe mangled data\n");
+            return 7;
+        }
+    }
+    sys::close(fds[0]);
+    sys::close(fds[1]);
+
+    volatile uint32_t* shared = static_cast<volatile uint32_t*>(sys::shmOpen("init",4096));
+    if (shared == nullptr)
+    {
+        print("init: no shared memory\n");
+        return 8;
+    }
+    *shared = 1;
+    if (sys::shmWait(shared,0) != -sys::EAGAIN)
+    {
+        print("init: shmWait() slept on a stale value\n");
+        return 9;
+    }
+    sys::shmUnlink("init");
+
+    // Two operations, one system call: the boot sector, and whether a pipe
+    // with data in it is readable
+    sys::ioRing ring;
+    const int32_t disk = sys::openDevice("ata0");
+    if (disk < 0 || ring.setup(8) != 0 || sys::pipe(fds) != 0 || sys::write(fds[1],"x",1) != 1)
+    {
+        print("init: no I/O ring\n");
+        return 10;
+    }
+    sys::prepare(ring.getSqe(),IORING_OP_READ,disk,bootSector,sizeof(bootSector),0,1);
+    sys::prepare(ring.getSqe(),IORING_OP_POLL,fds[0],nullptr,POLLIN,0,2);
+    if (ring.submit(2) != 2)
+    {
+        print("init: the ring took nothing\n");
+        return 11;
+    }
+    size_t completed = 0;
+    for (io_cqe* cqe = ring.peekCqe(); cqe != nullptr; cqe = ring.peekCqe(), completed++)
+    {
+        const bool good = cqe->userData == 1 ? cqe->result == static_cast<int32_t>(sizeof(bootSector)) &&
+                bootSector[510] == 0x55 && bootSector[511] == 0xaa :
+                cqe->result == POLLIN;
+        ring.seen();
+        if (!good)
+        {
+            print("init: an I/O ring operation went wrong\n");
+            return 12;
+        }
+    }
+    if (completed != 2)
+    {
+        print("init: I/O ring completions went missing\n");
+        return 13;
+    }
+    ring.close();
+    sys::close(fds[0]);
+    sys::close(fds[1]);
+    sys::close(disk);
+
+    // Its own executable, read and mapped, which must agree
+    const int32_t self = sys::open("/boot/INIT.ELF",O_RDONLY);
+    uint8_t magic[4];
+    if (self < 0 || sys::pread(self,magic,sizeof(magic),0) != sizeof(magic) ||
+            magic[0] != 0x7f || magic[1] != 'E' || magic[2] != 'L' || magic[3] != 'F')
+    {
+        print("init: can't read /boot/INIT.ELF\n");
+        return 14;
+    }
+    const uint8_t* image = static_cast<const uint8_t*>(sys::mmap(self,4096,0,PROT_READ));
+    if (image == nullptr || image[0] != magic[0] || image[3] != magic[3])
+    {
+        print("init: can't map /boot/INIT.ELF\n");
+        return 15;
+    }
+    sys::munmap(const_cast<uint8_t*>(image));
+    sys::close(self);
+
+    // The dentry cache remembers this isn't there, and must go on saying so
+    for (int i = 0; i < 2; i++)
+    {
+        if (sys::open("/boot/NOPE.ELF",O_RDONLY) != -sys::ENOENT)
+        {
+            print("init: found a file that isn't there\n");
+            return 16;
+        }
+    }
+
+    // Written, then read back through another descriptor
+    static const char note[] = "init was here";
+    char back[sizeof(note)];
+    const int32_t out = sys::open("/tmp/init",O_WRONLY | O_CREAT | O_EXCL);
+    if (out < 0 || sys::write(out,note,sizeof(note)) != sizeof(note))
+    {
+        print("init: can't write /tmp/init\n");
+        return 17;
+    }
+    sys::close(out);
+    const int32_t in = sys::open("/tmp/init",O_RDONLY);
+    if (in < 0 || sys::read(in,back,sizeof(back)) != sizeof(back))
+    {
+        print("init: can't read /tmp/init back\n");
+        return 18;
+    }
+    for (size_t i = 0; i < sizeof(note); i++)
+    {
+        if (back[i] != note[i])
+        {
+            print("init: /tmp/init came back wrong\n");
+            return 18;
+        }
+    }
+
+    // Added to, cut back to what it was, and gone
+    const int32_t log = sys::open("/tmp/init",O_WRONLY | O_APPEND);
+    const bool appended = log >= 0 && sys::write(log,note,sizeof(note)) == sizeof(note) &&
+            sys::pread(in,back,sizeof(back),sizeof(note)) == sizeof(back) &&
+            sys::ftruncate(log,sizeof(note)) == 0 &&
+            sys::pread(in,back,sizeof(back),sizeof(note)) == 0;
+    sys::close(log);
+    sys::close(in);
+    if (!appended || sys::unlink("/tmp/init") != 0 ||
+            sys::open("/tmp/init",O_RDONLY) != -sys::ENOENT)
+    {
+        print("init: can't append to, truncate or unlink /tmp/init\n");
+        return 19;
+    }
+
+    // Its own executable once more, found by listing /boot a record or two
+    // at a time, so every call carries on from the last
+    static const char selfName[] = "init.elf";
+    const int32_t boot = sys::open("/boot",O_RDONLY);
+    alignas(4) uint8_t records[64];
+    bool listed = false;
+    int32_t got = -sys::EBADF;
+    while (boot >= 0 && (got = sys::getdents(boot,records,sizeof(records))) > 0)
+    {
+        for (int32_t at = 0; at < got; )
+        {
+            const dirent* d = reinterpret_cast<const dirent*>(records + at);
+            const char* name = reinterpret_cast<const char*>(d + 1);
+            size_t same = 0;
+            while (same < sizeof(selfName) - 1 && same < d->d_namlen &&
+                    (name[same] | 0x20) == selfName[same])
+                same++;
+            listed |= d->d_namlen == sizeof(selfName) - 1 && same == d->d_namlen &&
+                    d->d_type == DT_REG;
+            at += d->d_reclen;
+        }
+    }
+    sys::close(boot);
+    if (!listed || got != 0)
+    {
+        print("init: can't find /boot/INIT.ELF by listing /boot\n");
+        return 20;
+    }
+
+    return 0;
+}
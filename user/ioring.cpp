@@ -0,0 +1,77 @@
+/**
+ * @file ioring.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from ioring.hpp
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <ioring.hpp>
+
+int32_t sys::ioRing::setup(uint32_t entries, uint32_t flags)
+{
+    io_ring_params params = {entries,0,flags,0,0,0};
+    const int32_t fd = syscall2(SYS_IORING_SETUP,reinterpret_cast<uint32_t>(&params),sizeof(params));
+    if (fd < 0)
+        return fd;
+
+    _fd = fd;
+    _flags = flags;
+    _header = reinterpret_cast<io_ring_header*>(params.address);
+    _sqes = reinterpret_cast<io_sqe*>(params.address + params.sqOffset);
+    _cqes = reinterpret_cast<io_cqe*>(params.address + params.cqOffset);
+    _sqEntries = params.sqEntries;
+    _cqEntries = params.cqEntries;
+    _sqTail = _header->sqTail;
+    return 0;
+}
+
+io_sqe* sys::ioRing::getSqe()
+{
+    if (_sqTail - __atomic_load_n(&_header->sqHead,__ATOMIC_ACQUIRE) >= _sqEntries)
+        return nullptr;
+    return _sqes + (_sqTail++ & (_sqEntries - 1));
+}
+
+int32_t sys::ioRing::submit(uint32_t waitFor)
+{
+    const uint32_t pending = _sqTail - _header->sqTail;
+    __atomic_store_n(&_header->sqTail,_sqTail,__ATOMIC_RELEASE);
+
+    uint32_t flags = waitFor != 0 ? IORING_ENTER_GETEVENTS : 0;
+    if (_flags & IORING_SETUP_SQPOLL)
+    {
+        // Pairs with the polling thread setting the flag, then looking at
+        // sqTail once more
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&_header->flags,__ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+            flags |= IORING_ENTER_WAKEUP;
+        if (flags == 0)
+            return static_cast<int32_t>(pending);
+    }
+    return syscall4(SYS_IORING_ENTER,static_cast<uint32_t>(_fd),pending,waitFor,flags);
+}
+
+io_cqe* sys::ioRing::peekCqe()
+{
+    const uint32_t head = _header->cqHead;
+    if (head == __atomic_load_n(&_header->cqTail,__ATOMIC_ACQUIRE))
+        return nullptr;
+    return _cqes + (head & (_cqEntries - 1));
+}
+
+void sys::ioRing::seen()
+{
+    __atomic_store_n(&_header->cqHead,_header->cqHead + 1,__ATOMIC_RELEASE);
+}
+
+void sys::ioRing::close()
+{
+    if (_fd >= 0)
+        sys::close(_fd);
+    _fd = -1;
+    _header = nullptr;
+}
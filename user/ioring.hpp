@@ -0,0 +1,108 @@
+/**
+ * @file ioring.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Asynchronous I/O rings, from user programs: queue any number of
+ * operations, hand them to the kernel with one system call (or none, with a
+ * polling thread), and pick up their completions as they come
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <syscall.hpp>
+#include <sys/ioring.h>
+
+namespace sys
+{
+
+class ioRing
+{
+private:
+    int32_t _fd;
+    uint32_t _flags;
+    io_ring_header* _header;
+    io_sqe* _sqes;
+    io_cqe* _cqes;
+    uint32_t _sqEntries;
+    uint32_t _cqEntries;
+
+    /* Entries handed out by getSqe(), published by submit() */
+    uint32_t _sqTail;
+public:
+    constexpr ioRing() : _fd(-1), _flags(0), _header(nullptr), _sqes(nullptr), _cqes(nullptr),
+            _sqEntries(0), _cqEntries(0), _sqTail(0) {}
+
+    /**
+     * @brief Create the rings
+     * 
+     * @param entries Submission entries, a power of two up to
+     * IORING_MAX_ENTRIES
+     * @param flags IORING_SETUP_SQPOLL, or 0
+     * @return int32_t 0, or a negative error
+     */
+    int32_t setup(uint32_t entries, uint32_t flags = 0);
+
+    /**
+     * @brief Get the next submission entry to fill in
+     * 
+     * @return io_sqe* nullptr if the ring is full
+     */
+    io_sqe* getSqe();
+
+    /**
+     * @brief Hand what was filled in to the kernel
+     * 
+     * @param waitFor Completions to wait for, 0 not to
+     * @return int32_t Entries submitted, or a negative error
+     */
+    int32_t submit(uint32_t waitFor = 0);
+
+    /**
+     * @brief Look at the oldest completion, without consuming it
+     * 
+     * @return io_cqe* nullptr if there's none
+     */
+    io_cqe* peekCqe();
+
+    /**
+     * @brief Consume the completion from peekCqe()
+     * 
+     */
+    void seen();
+
+    /**
+     * @brief Close the ring. Operations still queued may or may not run
+     * 
+     */
+    void close();
+};
+
+/**
+ * @brief Fill in a submission entry
+ * 
+ * @param sqe From getSqe()
+ * @param opcode IORING_OP_*
+ * @param fd Descriptor
+ * @param address Buffer, or nullptr
+ * @param length Its size, or POLL* events
+ * @param offset Byte offset, or IORING_OFFSET_CURRENT
+ * @param userData Comes back in the completion
+ */
+static inline void prepare(io_sqe* sqe, uint8_t opcode, int32_t fd, void* address, uint32_t length,
+            uint64_t offset, uint64_t userData)
+{
+    sqe->opcode = opcode;
+    sqe->flags = 0;
+    sqe->reserved = 0;
+    sqe->fd = fd;
+    sqe->offset = offset;
+    sqe->address = reinterpret_cast<uint32_t>(address);
+    sqe->length = length;
+    sqe->userData = userData;
+}
+
+} // namespace sys
@@ -0,0 +1,145 @@
+/**
+ * @file ipc.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Pipes and shared memory, from user programs. Reading and writing
+ * whole, page aligned pages through a pipe remaps them instead of copying
+ * @version 0.1
+ * @date 2025-03-22
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <syscall.hpp>
+
+namespace sys
+{
+
+/* Same values as the kernel's pipe.hpp */
+static const uint32_t PIPE_WRITE =          0x1;
+static const uint32_t PIPE_COPY =           0x2;
+
+/* Same values as the kernel's futex.hpp */
+static const uint32_t FUTEX_WAIT =          0;
+static const uint32_t FUTEX_WAKE =          1;
+static const uint32_t FUTEX_REQUEUE =       2;
+
+static inline size_t nameLength(const char* name)
+{
+    size_t length = 0;
+    while (name[length] != '\0')
+        length++;
+    return length;
+}
+
+/**
+ * @brief Create a pipe
+ * 
+ * @param fds Set to the read end, then the write end
+ * @param flags PIPE_COPY, or 0
+ * @return int32_t 0, or a negative error
+ */
+static inline int32_t pipe(int32_t fds[2], uint32_t flags = 0)
+{
+    return syscall3(SYS_PIPE,reinterpret_cast<uint32_t>(fds),2 * sizeof(int32_t),flags);
+}
+
+/**
+ * @brief Open an end of a named pipe, which any process can open too
+ * 
+ * @param name Name, up to 15 characters
+ * @param flags PIPE_WRITE for the write end, PIPE_COPY
+ * @return int32_t Descriptor, or a negative error
+ */
+static inline int32_t pipeOpen(const char* name, uint32_t flags)
+{
+    return syscall3(SYS_PIPE_OPEN,reinterpret_cast<uint32_t>(name),nameLength(name),flags);
+}
+
+/**
+ * @brief Map a named shared memory segment, creating it if it isn't there
+ * 
+ * @param name Name, up to 15 characters
+ * @param size Size, 0 to map an existing segment whole
+ * @return void* Where it's mapped, nullptr on errors
+ */
+static inline void* shmOpen(const char* name, size_t size)
+{
+    const int32_t result = syscall3(SYS_SHM_OPEN,reinterpret_cast<uint32_t>(name),
+            nameLength(name),size);
+    return isError(result) ? nullptr : reinterpret_cast<void*>(result);
+}
+
+static inline int32_t shmUnlink(const char* name)
+{
+    return syscall2(SYS_SHM_UNLINK,reinterpret_cast<uint32_t>(name),nameLength(name));
+}
+
+/**
+ * @brief Sleep while a word in a segment holds a value
+ * 
+ * @param word Word, 4 byte aligned, in a segment
+ * @param expected Value to sleep on
+ * @return int32_t 0 once woken, -EAGAIN if it changed already
+ */
+static inline int32_t shmWait(volatile uint32_t* word, uint32_t expected)
+{
+    return syscall2(SYS_SHM_WAIT,reinterpret_cast<uint32_t>(word),expected);
+}
+
+/**
+ * @brief Wake threads sleeping on a word
+ * 
+ * @param word Word in a segment
+ * @param count How many, at most
+ * @return int32_t How many were woken
+ */
+static inline int32_t shmWake(volatile uint32_t* word, uint32_t count)
+{
+    return syscall2(SYS_SHM_WAKE,reinterpret_cast<uint32_t>(word),count);
+}
+
+/**
+ * @brief Sleep while a word holds a value. Works on any word, shared or not
+ * 
+ * @param word Word, 4 byte aligned
+ * @param expected Value to sleep on
+ * @return int32_t 0 once woken, -EAGAIN if it changed already
+ */
+static inline int32_t futexWait(volatile uint32_t* word, uint32_t expected)
+{
+    return syscall5(SYS_FUTEX,FUTEX_WAIT,reinterpret_cast<uint32_t>(word),expected,0,0);
+}
+
+/**
+ * @brief Wake threads sleeping on a word
+ * 
+ * @param word Word
+ * @param count How many, at most
+ * @return int32_t How many were woken
+ */
+static inline int32_t futexWake(volatile uint32_t* word, uint32_t count)
+{
+    return syscall5(SYS_FUTEX,FUTEX_WAKE,reinterpret_cast<uint32_t>(word),count,0,0);
+}
+
+/**
+ * @brief Wake some threads sleeping on a word, and move others to another
+ * 
+ * @param word Word
+ * @param wakeCount How many to wake, up to 0xffff
+ * @param target Word the rest go to sleep on
+ * @param requeueCount How many to move, up to 0xffff
+ * @param expected What word must still hold
+ * @return int32_t How many were woken or moved, -EAGAIN if word changed
+ */
+static inline int32_t futexRequeue(volatile uint32_t* word, uint32_t wakeCount,
+            volatile uint32_t* target, uint32_t requeueCount, uint32_t expected)
+{
+    return syscall5(SYS_FUTEX,FUTEX_REQUEUE,reinterpret_cast<uint32_t>(word),
+            wakeCount | requeueCount << 16,reinterpret_cast<uint32_t>(target),expected);
+}
+
+} // namespace sys
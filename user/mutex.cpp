@@ -0,0 +1,87 @@
+/**
+ * @file mutex.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from mutex.hpp
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <mutex.hpp>
+#include <ipc.hpp>
+
+// How many futexRequeue() can move at once
+static const uint32_t REQUEUE_ALL =         0xffff;
+
+/**========================================================================
+ *                           mutex
+ *========================================================================**/
+
+/**
+ * @brief Take the mutex as if someone else was waiting, since we can't know:
+ * whoever unlocks it next then wakes the next one
+ * 
+ */
+void sys::mutex::lockContended()
+{
+    while (__atomic_exchange_n(&_state,2,__ATOMIC_ACQUIRE) != 0)
+        futexWait(&_state,2);
+}
+
+void sys::mutex::lock()
+{
+    uint32_t c = 0;
+    if (__atomic_compare_exchange_n(&_state,&c,1,false,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+        return;
+    lockContended();
+}
+
+bool sys::mutex::tryLock()
+{
+    uint32_t c = 0;
+    return __atomic_compare_exchange_n(&_state,&c,1,false,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED);
+}
+
+void sys::mutex::unlock()
+{
+    // 1 means nobody is waiting, so there's no need to go into the kernel
+    if (__atomic_exchange_n(&_state,0,__ATOMIC_RELEASE) == 2)
+        futexWake(&_state,1);
+}
+
+/**========================================================================
+ *                           condition
+ *========================================================================**/
+
+void sys::condition::wait(mutex* m)
+{
+    const uint32_t sequence = __atomic_load_n(&_sequence,__ATOMIC_RELAXED);
+    _mutex = m;
+    m->unlock();
+
+    // A signal since we read the sequence makes this return right away
+    futexWait(&_sequence,sequence);
+
+    // Others may have been moved to the mutex along with us
+    m->lockContended();
+}
+
+void sys::condition::signal()
+{
+    __atomic_add_fetch(&_sequence,1,__ATOMIC_RELEASE);
+    futexWake(&_sequence,1);
+}
+
+void sys::condition::broadcast()
+{
+    mutex* m = _mutex;
+    if (m == nullptr)
+        return; // Nobody ever waited
+
+    // A signal in between changes the sequence, then do it again
+    uint32_t sequence = __atomic_add_fetch(&_sequence,1,__ATOMIC_RELEASE);
+    while (futexRequeue(&_sequence,1,&m->_state,REQUEUE_ALL,sequence) == -EAGAIN)
+        sequence = __atomic_load_n(&_sequence,__ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,69 @@
+/**
+ * @file mutex.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Mutexes and condition variables, on top of futexes. Neither enters
+ * the kernel unless someone has to wait. They work in shared memory too
+ * @version 0.1
+ * @date 2025-03-23
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace sys
+{
+
+class mutex
+{
+private:
+    /* 0 unlocked, 1 locked, 2 locked and someone may be sleeping on it */
+    volatile uint32_t _state;
+
+    void lockContended();
+    friend class condition;
+public:
+    constexpr mutex() : _state(0) {}
+
+    void lock();
+    bool tryLock();
+    void unlock();
+};
+
+class condition
+{
+private:
+    /* Bumped by every signal, waiters sleep on it */
+    volatile uint32_t _sequence;
+
+    /* What waiters hold, for broadcast() to move them onto */
+    mutex* volatile _mutex;
+public:
+    constexpr condition() : _sequence(0), _mutex(nullptr) {}
+
+    /**
+     * @brief Unlock the mutex, sleep until signalled, and lock it again. It
+     * can return without a signal, so check the condition in a loop
+     * 
+     * @param m Held mutex. Every waiter must use the same one
+     */
+    void wait(mutex* m);
+
+    /**
+     * @brief Wake a waiter
+     * 
+     */
+    void signal();
+
+    /**
+     * @brief Wake every waiter. Only one is actually woken, the rest are
+     * moved to sleep on the mutex, so they don't all wake up to fight over it
+     * 
+     */
+    void broadcast();
+};
+
+} // namespace sys
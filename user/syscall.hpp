@@ -0,0 +1,358 @@
+/**
+ * @file syscall.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief System calls, from user programs. Through the SYSENTER stub the vdso
+ * page points to, or int 0x80 if there isn't one
+ * @version 0.1
+ * @date 2025-03-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/vdso.h>
+#include <sys/fcntl.h>
+#include <sys/mman.h>
+#include <sys/dirent.h>
+
+namespace sys
+{
+
+/* Same numbers as the kernel's syscall.hpp */
+enum syscallNumber : uint32_t
+{
+    SYS_NULL =      0,
+    SYS_EXIT =      1,
+    SYS_YIELD =     2,
+    SYS_GETCPU =    3,
+    SYS_WRITE =     4,
+    SYS_READ =      5,
+    SYS_CLOSE =     6,
+    SYS_SPAWN =     7,
+    SYS_PIPE =      8,
+    SYS_PIPE_OPEN = 9,
+    SYS_SHM_OPEN =  10,
+    SYS_SHM_UNLINK = 11,
+    SYS_SHM_WAIT =  12,
+    SYS_SHM_WAKE =  13,
+    SYS_FUTEX =     14,
+    SYS_OPEN_DEVICE = 15,
+    SYS_FSYNC =     16,
+    SYS_IORING_SETUP = 17,
+    SYS_IORING_ENTER = 18,
+    SYS_OPEN =      19,
+    SYS_PREAD =     20,
+    SYS_MMAP =      21,
+    SYS_MUNMAP =    22,
+    SYS_UNLINK =    23,
+    SYS_FTRUNCATE = 24,
+    SYS_GETDENTS =  25,
+};
+
+static const int STDIN =                    0;
+static const int STDOUT =                   1;
+static const int STDERR =                   2;
+
+/* Same values as the kernel's, returned negated */
+static const int32_t ENOENT =               2;
+static const int32_t EIO =                  5;
+static const int32_t EBADF =                9;
+static const int32_t EAGAIN =               11;
+static const int32_t ENOMEM =               12;
+static const int32_t EFAULT =               14;
+static const int32_t EBUSY =                16;
+static const int32_t EEXIST =               17;
+static const int32_t ENOTDIR =              20;
+static const int32_t EISDIR =               21;
+static const int32_t EINVAL =               22;
+static const int32_t EMFILE =               24;
+static const int32_t ENOSPC =               28;
+static const int32_t ESPIPE =               29;
+static const int32_t EROFS =                30;
+static const int32_t EPIPE =                32;
+
+/* Results from -4095 to -1 are errors, anything else (addresses too) isn't */
+static inline bool isError(int32_t result)
+{
+    return static_cast<uint32_t>(result) > ~uint32_t(4095);
+}
+
+/**
+ * @brief The page the kernel shares with every process
+ * 
+ * @return const vdso_data* 
+ */
+static inline const vdso_data* vdso()
+{
+    return reinterpret_cast<const vdso_data*>(VDSO_DATA_ADDRESS);
+}
+
+// The SYSENTER stub clobbers ecx and edx, and takes the same registers as
+// int 0x80 otherwise. It's called through the vdso page, by absolute address,
+// which leaves every register free for arguments
+static const uint32_t SYSCALL_ENTRY_SLOT =  VDSO_DATA_ADDRESS + offsetof(vdso_data,syscallEntry);
+
+static inline int32_t syscall0(uint32_t number)
+{
+    int32_t result;
+    if (vdso()->syscallEntry != 0)
+        __asm__ __volatile__ ("call *%P[entry]" : "=a"(result)
+                : "a"(number), [entry]"i"(SYSCALL_ENTRY_SLOT) : "ecx", "edx", "memory");
+    else
+        __asm__ __volatile__ ("int $0x80" : "=a"(result) : "a"(number) : "memory");
+    return result;
+}
+
+static inline int32_t syscall1(uint32_t number, uint32_t a)
+{
+    int32_t result;
+    if (vdso()->syscallEntry != 0)
+        __asm__ __volatile__ ("call *%P[entry]" : "=a"(result)
+                : "a"(number), "b"(a), [entry]"i"(SYSCALL_ENTRY_SLOT) : "ecx", "edx", "memory");
+    else
+        __asm__ __volatile__ ("int $0x80" : "=a"(result) : "a"(number), "b"(a) : "memory");
+    return result;
+}
+
+static inline int32_t syscall2(uint32_t number, uint32_t a, uint32_t b)
+{
+    int32_t result;
+    if (vdso()->syscallEntry != 0)
+        __asm__ __volatile__ ("call *%P[entry]" : "=a"(result), "+c"(b)
+                : "a"(number), "b"(a), [entry]"i"(SYSCALL_ENTRY_SLOT) : "edx", "memory");
+    else
+        __asm__ __volatile__ ("int $0x80" : "=a"(result) : "a"(number), "b"(a), "c"(b) : "memory");
+    return result;
+}
+
+static inline int32_t syscall3(uint32_t number, uint32_t a, uint32_t b, uint32_t c)
+{
+    int32_t result;
+    if (vdso()->syscallEntry != 0)
+        __asm__ __volatile__ ("call *%P[entry]" : "=a"(result), "+c"(b), "+d"(c)
+                : "a"(number), "b"(a), [entry]"i"(SYSCALL_ENTRY_SLOT) : "memory");
+    else
+        __asm__ __volatile__ ("int $0x80" : "=a"(result) : "a"(number), "b"(a), "c"(b), "d"(c)
+                : "memory");
+    return result;
+}
+
+static inline int32_t syscall4(uint32_t number, uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    int32_t result;
+    if (vdso()->syscallEntry != 0)
+        __asm__ __volatile__ ("call *%P[entry]" : "=a"(result), "+c"(b), "+d"(c)
+                : "a"(number), "b"(a), "S"(d), [entry]"i"(SYSCALL_ENTRY_SLOT) : "memory");
+    else
+        __asm__ __volatile__ ("int $0x80" : "=a"(result)
+                : "a"(number), "b"(a), "c"(b), "d"(c), "S"(d) : "memory");
+    return result;
+}
+
+static inline int32_t syscall5(uint32_t number, uint32_t a, uint32_t b, uint32_t c, uint32_t d,
+            uint32_t e)
+{
+    int32_t result;
+    if (vdso()->syscallEntry != 0)
+        __asm__ __volatile__ ("call *%P[entry]" : "=a"(result), "+c"(b), "+d"(c)
+                : "a"(number), "b"(a), "S"(d), "D"(e), [entry]"i"(SYSCALL_ENTRY_SLOT) : "memory");
+    else
+        __asm__ __volatile__ ("int $0x80" : "=a"(result)
+                : "a"(number), "b"(a), "c"(b), "d"(c), "S"(d), "D"(e) : "memory");
+    return result;
+}
+
+[[noreturn]] static inline void exit(int32_t status)
+{
+    syscall1(SYS_EXIT,static_cast<uint32_t>(status));
+    __builtin_unreachable();
+}
+
+static inline void yield()
+{
+    syscall0(SYS_YIELD);
+}
+
+static inline uint32_t getCPU()
+{
+    return static_cast<uint32_t>(syscall0(SYS_GETCPU));
+}
+
+/**
+ * @brief Write to a descriptor
+ * 
+ * @param fd STDOUT, STDERR, or one that was opened
+ * @param buffer What to write
+ * @param length How much
+ * @return int32_t Bytes written, or a negative error
+ */
+static inline int32_t write(int fd, const void* buffer, size_t length)
+{
+    return syscall3(SYS_WRITE,static_cast<uint32_t>(fd),reinterpret_cast<uint32_t>(buffer),
+            length);
+}
+
+/**
+ * @brief Read from a descriptor, waiting until there's something to read
+ * 
+ * @param fd Descriptor
+ * @param buffer Where to put it
+ * @param length Size of the buffer
+ * @return int32_t Bytes read, 0 at the end, or a negative error
+ */
+static inline int32_t read(int fd, void* buffer, size_t length)
+{
+    return syscall3(SYS_READ,static_cast<uint32_t>(fd),reinterpret_cast<uint32_t>(buffer),
+            length);
+}
+
+static inline int32_t close(int fd)
+{
+    return syscall1(SYS_CLOSE,static_cast<uint32_t>(fd));
+}
+
+/**
+ * @brief Start a process
+ * 
+ * @param path Executable, or just its name if it's in /boot
+ * @return int32_t Its ID, or a negative error
+ */
+static inline int32_t spawn(const char* path)
+{
+    size_t length = 0;
+    while (path[length] != '\0')
+        length++;
+    return syscall2(SYS_SPAWN,reinterpret_cast<uint32_t>(path),length);
+}
+
+/**
+ * @brief Open a block device, to read and write it whole
+ * 
+ * @param name Device ("ata0", ...)
+ * @return int32_t Descriptor, or a negative error
+ */
+static inline int32_t openDevice(const char* name)
+{
+    size_t length = 0;
+    while (name[length] != '\0')
+        length++;
+    return syscall2(SYS_OPEN_DEVICE,reinterpret_cast<uint32_t>(name),length);
+}
+
+/**
+ * @brief Make what was written to a descriptor stick
+ * 
+ * @param fd Descriptor
+ * @return int32_t 0, or a negative error
+ */
+static inline int32_t fsync(int fd)
+{
+    return syscall1(SYS_FSYNC,static_cast<uint32_t>(fd));
+}
+
+/**
+ * @brief Open a file
+ * 
+ * @param path Absolute ("/boot/INIT.ELF", "/tmp/log")
+ * @param flags O_RDONLY, O_WRONLY or O_RDWR, and O_CREAT, O_EXCL, O_TRUNC,
+ * O_APPEND
+ * @return int32_t Descriptor, or a negative error
+ */
+static inline int32_t open(const char* path, uint32_t flags)
+{
+    size_t length = 0;
+    while (path[length] != '\0')
+        length++;
+    return syscall3(SYS_OPEN,reinterpret_cast<uint32_t>(path),length,flags);
+}
+
+/**
+ * @brief Read from a file at an offset, without moving the descriptor's
+ * 
+ * @param fd File or block device
+ * @param buffer Where to put it
+ * @param length Size of the buffer
+ * @param offset Where in the file
+ * @return int32_t Bytes read, 0 at the end, or a negative error
+ */
+static inline int32_t pread(int fd, void* buffer, size_t length, uint64_t offset)
+{
+    return syscall5(SYS_PREAD,static_cast<uint32_t>(fd),reinterpret_cast<uint32_t>(buffer),
+            length,static_cast<uint32_t>(offset),static_cast<uint32_t>(offset >> 32));
+}
+
+/**
+ * @brief Map part of a file. Writes to it stay private to this process
+ * 
+ * @param fd File
+ * @param length Bytes, rounded up to pages
+ * @param offset Where in the file, page aligned
+ * @param prot PROT_READ, PROT_WRITE, PROT_EXEC
+ * @return void* Where it got mapped, nullptr on failure
+ */
+static inline void* mmap(int fd, size_t length, uint32_t offset, uint32_t prot)
+{
+    const int32_t result = syscall4(SYS_MMAP,static_cast<uint32_t>(fd),length,offset,prot);
+    if (isError(result))
+        return nullptr;
+    return reinterpret_cast<void*>(result);
+}
+
+/**
+ * @brief Remove a mapping made by mmap()
+ * 
+ * @param address What mmap() returned
+ * @return int32_t 0, or a negative error
+ */
+static inline int32_t munmap(void* address)
+{
+    return syscall1(SYS_MUNMAP,reinterpret_cast<uint32_t>(address));
+}
+
+/**
+ * @brief Take a file's name away. It's gone once nobody has it open
+ * 
+ * @param path Absolute
+ * @return int32_t 0, or a negative error
+ */
+static inline int32_t unlink(const char* path)
+{
+    size_t length = 0;
+    while (path[length] != '\0')
+        length++;
+    return syscall2(SYS_UNLINK,reinterpret_cast<uint32_t>(path),length);
+}
+
+/**
+ * @brief Make a file a size, cutting it short or adding zeroes
+ * 
+ * @param fd File, open for writing
+ * @param size In bytes
+ * @return int32_t 0, or a negative error
+ */
+static inline int32_t ftruncate(int fd, uint32_t size)
+{
+    return syscall2(SYS_FTRUNCATE,static_cast<uint32_t>(fd),size);
+}
+
+/**
+ * @brief List a directory, carrying on from where the last call stopped
+ * 
+ * @param fd Directory, opened O_RDONLY
+ * @param buffer For dirent records, each followed by its name, 4 byte
+ * aligned
+ * @param length Bytes in it
+ * @return int32_t Bytes filled, 0 at the end, or a negative error (-EINVAL
+ * if the next record doesn't fit)
+ */
+static inline int32_t getdents(int fd, void* buffer, size_t length)
+{
+    return syscall3(SYS_GETDENTS,static_cast<uint32_t>(fd),reinterpret_cast<uint32_t>(buffer),
+            length);
+}
+
+} // namespace sys
@@ -0,0 +1,68 @@
+/**
+ * @file time.cpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Definitions from time.hpp
+ * @version 0.1
+ * @date 2025-03-21
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include <time.hpp>
+#include <syscall.hpp>
+
+static const uint64_t NANOSECONDS_PER_SECOND = 1000000000;
+
+static inline uint64_t readTSC()
+{
+    uint32_t low,high;
+    __asm__ __volatile__ ("rdtsc" : "=a"(low), "=d"(high));
+    return static_cast<uint64_t>(high) << 32 | low;
+}
+
+// Same as the kernel's clock::mulShift(), so both get the same nanoseconds
+static inline uint64_t mulShift(uint64_t value, uint32_t mult, uint32_t shift)
+{
+    const uint32_t low = static_cast<uint32_t>(value);
+    const uint32_t high = static_cast<uint32_t>(value >> 32);
+    uint64_t result = (static_cast<uint64_t>(low) * mult) >> shift;
+    if (high != 0)
+        result += (static_cast<uint64_t>(high) * mult) << (32 - shift);
+    return result;
+}
+
+uint64_t sys::nanoseconds()
+{
+    const vdso_data* page = vdso();
+    uint32_t sequence;
+    uint64_t tscBase, tsc;
+    uint32_t mult, shift;
+
+    // The kernel may be halfway through new parameters, which would give a
+    // time that's way off. Read again until a whole copy comes through
+    do
+    {
+        while ((sequence = __atomic_load_n(&page->sequence,__ATOMIC_ACQUIRE)) & 1)
+            __asm__ __volatile__ ("pause");
+        tscBase = page->tscBase;
+        mult = page->mult;
+        shift = page->shift;
+        tsc = readTSC();
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&page->sequence,__ATOMIC_RELAXED) != sequence);
+
+    // Another processor's TSC can be a little behind the base
+    return tsc > tscBase ? mulShift(tsc - tscBase,mult,shift) : 0;
+}
+
+int sys::clock_gettime(clockid_t clock, timespec* time)
+{
+    if (clock != CLOCK_MONOTONIC)
+        return -EINVAL;
+
+    const uint64_t now = nanoseconds();
+    time->tv_sec = static_cast<int64_t>(now / NANOSECONDS_PER_SECOND);
+    time->tv_nsec = static_cast<int32_t>(now % NANOSECONDS_PER_SECOND);
+    return 0;
+}
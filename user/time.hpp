@@ -0,0 +1,47 @@
+/**
+ * @file time.hpp
+ * @author Diogo Gomes (dbarrosgomes@gmail.com)
+ * @brief Clocks, for user programs. Read straight from the TSC and the vdso
+ * page, without a system call
+ * @version 0.1
+ * @date 2025-03-21
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace sys
+{
+
+typedef int32_t clockid_t;
+
+/* Time since boot. Same value as Linux */
+static const clockid_t CLOCK_MONOTONIC =    1;
+
+struct timespec
+{
+    int64_t             tv_sec;
+    int32_t             tv_nsec;
+};
+
+/**
+ * @brief Nanoseconds since boot, the same clock the kernel uses
+ * 
+ * @return uint64_t 
+ */
+uint64_t nanoseconds();
+
+/**
+ * @brief Read a clock
+ * 
+ * @param clock CLOCK_MONOTONIC, the only one there is
+ * @param time Where to put it
+ * @return int 0, or -EINVAL for unknown clocks
+ */
+int clock_gettime(clockid_t clock, timespec* time);
+
+} // namespace sys